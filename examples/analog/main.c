@@ -16,10 +16,13 @@
 // This example will supply power to an Analog sensor,
 // read the current (in uA ) OR voltage (in mV) level at the
 // EXT_ANALOG_IN pin and print the value on the debug console.
+// The readings are batched with the time series library and sent together in
+// one message a day, rather than a message for each reading.
 //! [CODE]
 
 #include <stdio.h>
 #include "flex.h"
+#include "myriota/timeseries.h"
 
 #define APPLICATION_NAME "Analog Example"
 
@@ -38,6 +41,13 @@
 // The number of sensor readings a day.
 // Modify this as required by the application.
 #define SENSOR_READINGS_PER_DAY 4
+#define SENSOR_READING_INTERVAL_S (24 * 3600 / SENSOR_READINGS_PER_DAY)
+
+// Send the batched readings once they span a day, i.e. the readings of a day
+// are sent together. A batch is also sent early once its message is full.
+#define BATCH_MAX_AGE_S (24 * 3600 - SENSOR_READING_INTERVAL_S)
+#define BATCH_SAMPLES_MAX 32
+#define MESSAGE_SIZE 20
 
 // Modify this according to the power requirements of the Analog sensor.
 // The FlexSense board supports an output voltage given by the enum FLEX_PowerOut.
@@ -78,7 +88,18 @@ fail_0:
   return SensorReading;
 }
 
+static MYRIOTA_TimeSeries Readings;
+static int32_t ReadingSamples[BATCH_SAMPLES_MAX];
+static uint8_t ReadingMessage[MESSAGE_SIZE];
+
+static int SendReadings(void *ctx, const uint8_t *message, size_t size) {
+  (void)ctx;
+  printf("Scheduled %u byte message of readings.\r\n", (unsigned)size);
+  return FLEX_MessageSchedule(message, size);
+}
+
 static time_t PrintSensorReading(void) {
+  const time_t now = FLEX_TimeGet();
   uint32_t analog_sensor_reading = MeasureAnalogInput();
 
   if (analog_sensor_reading != UINT32_MAX) {
@@ -87,13 +108,28 @@ static time_t PrintSensorReading(void) {
 #else
     printf("Voltage = %lumV.\r\n", analog_sensor_reading);
 #endif
+    if (MYRIOTA_TimeSeriesAdd(&Readings, now, analog_sensor_reading) != TIMESERIES_SUCCESS) {
+      printf("Failed to schedule readings.\r\n");
+    }
   }
 
-  return (FLEX_TimeGet() + 24 * 3600 / SENSOR_READINGS_PER_DAY);
+  return (now + SENSOR_READING_INTERVAL_S);
 }
 
 void FLEX_AppInit() {
   printf("%s (%s mode).\r\n", APPLICATION_NAME, APPLICATION_MODE);
+
+  const MYRIOTA_TimeSeriesOptions options = {
+    .interval_s = SENSOR_READING_INTERVAL_S,
+    .max_age_s = BATCH_MAX_AGE_S,
+    .samples = ReadingSamples,
+    .samples_max = BATCH_SAMPLES_MAX,
+    .message = ReadingMessage,
+    .message_size = sizeof(ReadingMessage),
+    .send = SendReadings,
+  };
+  MYRIOTA_TimeSeriesInit(&Readings, &options);
+
   FLEX_JobSchedule(PrintSensorReading, FLEX_ASAP());
 }
 
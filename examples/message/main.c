@@ -20,33 +20,34 @@
 // The return value of "FLEX_MessageSchedule" indicates the load of the queue.
 // A return value greater than one indicates that the queue is overloaded and
 // that messages may begin to be dropped.
+// The message is described by "message.json", from which the build generates
+// its encoder "message_codec.h" and a host decoder "message_codec.py".
 //! [CODE]
 
 #include <stdio.h>
 #include "flex.h"
+#include "message_codec.h"
 
 #define APPLICATION_NAME "Schedule Message Example"
 
 // Note: Modify this according to the application requirements.
 #define MESSAGES_PER_DAY 4
 
-typedef struct {
-  uint16_t sequence_number;
-  uint32_t time;
-  // ADD YOUR PARAMETERS HERE
-} __attribute__((packed)) message;
-
 static time_t SendMessage(void) {
   static uint16_t sequence_number = 0;
-  message message;
+  message_t fields;
+  uint8_t message[MESSAGE_SIZE];
+  time_t last_fix_time;
 
-  message.sequence_number = sequence_number++;
-  message.time = FLEX_TimeGet();
-  // POPULATE YOUR DATA HERE
+  fields.sequence_number = sequence_number++;
+  fields.time = FLEX_TimeGet();
+  FLEX_LastLocationAndLastFixTime(&fields.latitude, &fields.longitude, &last_fix_time);
+  // ADD YOUR PARAMETERS TO message.json AND POPULATE THEM HERE
 
   // Schedule messages for satellite transmission
-  FLEX_MessageSchedule((void *)&message, sizeof(message));
-  printf("Scheduled message: %u %lu\n", message.sequence_number, message.time);
+  message_encode(&fields, message);
+  FLEX_MessageSchedule(message, sizeof(message));
+  printf("Scheduled message: %lu %lu\n", fields.sequence_number, fields.time);
 
   return (FLEX_TimeGet() + 24 * 3600 / MESSAGES_PER_DAY);
 }
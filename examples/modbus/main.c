@@ -17,30 +17,45 @@
 // library.
 //! [CODE]
 
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
 #include "flex.h"
+#include "myriota/bitpack.h"
 #include "myriota/modbus.h"
+#include "myriota/modbus_plan.h"
+#include "myriota/serial_stream.h"
 
 #define APPLICATION_NAME "DFRobot SEN0438 Modbus Driver Application"
 #define MESSAGES_PER_DAY 4
 #define SENSOR_READ_MAX_RETRIES 3
 #define SENSOR_POWER_STABILIZATION_MS 1500
 
-typedef struct {
-  uint8_t sequence_number;
-  uint32_t time;
-  int32_t latitude;
-  int32_t longitude;
-  int16_t temperature;
-  int16_t humidity;
-} __attribute__((packed)) Message;
+// The message is packed bit by bit, each field taking only the bits its range
+// and resolution need: 13 bytes rather than the 17 of a packed struct.
+#define MESSAGE_SIZE_MAX 20
+#define MESSAGE_SEQUENCE_NUMBER_BITS 8
+#define MESSAGE_TIME_BITS 32
+// Locations are sent to 1e-4 degrees (~11 m), from the fix's 1e-7 degrees.
+#define MESSAGE_LOCATION_DIVISOR 1000
+#define MESSAGE_LATITUDE_MIN (-900000)
+#define MESSAGE_LATITUDE_MAX 900000
+#define MESSAGE_LONGITUDE_MIN (-1800000)
+#define MESSAGE_LONGITUDE_MAX 1800000
+// The sensor's measurement ranges in its units of 0.1 degC and 0.1 %RH.
+#define MESSAGE_TEMPERATURE_MIN (-400)
+#define MESSAGE_TEMPERATURE_MAX 800
+#define MESSAGE_HUMIDITY_MIN 0
+#define MESSAGE_HUMIDITY_MAX 1000
 
 typedef struct {
   FLEX_SerialProtocol protocol;
   uint32_t baud_rate;
   uint32_t rx_timeout_ticks;
+  uint32_t rx_idle_ticks;
+  MYRIOTA_SerialStream stream;
+  uint8_t stream_buffer[SERIAL_STREAM_CAPACITY_DEFAULT];
 } SerialContext;
 
 typedef struct {
@@ -52,7 +67,19 @@ static ApplicationContext application_context = {0};
 
 static int serial_init(void *const ctx) {
   SerialContext *const serial = ctx;
-  return FLEX_SerialInit(serial->protocol, serial->baud_rate);
+  const int result = FLEX_SerialInit(serial->protocol, serial->baud_rate);
+  if (result != FLEX_SUCCESS) {
+    return result;
+  }
+  const MYRIOTA_SerialStreamInterface interface = {
+    .read = FLEX_SerialRead,
+    .write = FLEX_SerialWrite,
+    .tick_get = FLEX_TickGet,
+    .delay_ms = FLEX_DelayMs,
+    .baud_rate = serial->baud_rate,
+  };
+  return MYRIOTA_SerialStreamInit(&serial->stream, interface, serial->stream_buffer,
+    sizeof(serial->stream_buffer));
 }
 
 static void serial_deinit(void *const ctx) {
@@ -63,99 +90,129 @@ static void serial_deinit(void *const ctx) {
 static ssize_t serial_read(void *const ctx, uint8_t *const buffer, const size_t count) {
   SerialContext *const serial = ctx;
 
-  uint8_t *curr = buffer;
-  const uint8_t *const end = buffer + count;
-  const uint32_t end_ticks = FLEX_TickGet() + serial->rx_timeout_ticks;
-  while (FLEX_TickGet() <= end_ticks) {
-    if (curr >= end) {
-      return -1;
-    }
-
-    int num_bytes = FLEX_SerialRead(curr, 1);
-    if (num_bytes < 0) {
-      return -1;
-    }
-    if (num_bytes == 1) {
-      ++curr;
-    }
-  }
+  // Return as soon as the expected number of bytes has arrived, or once the line
+  // has been idle for the inter-frame delay after the response started.
+  const uint32_t deadline = MYRIOTA_SerialStreamDeadline(&serial->stream, serial->rx_timeout_ticks);
+  const int result = MYRIOTA_SerialStreamReadUntilIdle(&serial->stream, buffer, count,
+    serial->rx_idle_ticks, deadline);
+  return result < 0 ? -1 : result;
+}
 
-  return curr - buffer;
+static void serial_set_timeout(void *const ctx, const uint32_t timeout_ms) {
+  SerialContext *const serial = ctx;
+  serial->rx_timeout_ticks = timeout_ms;
+}
+
+static ssize_t serial_poll(void *const ctx, uint8_t *const buffer, const size_t count) {
+  SerialContext *const serial = ctx;
+  return MYRIOTA_SerialStreamRead(&serial->stream, buffer, count);
 }
 
 static ssize_t serial_write(void *const ctx, const uint8_t *const buffer, const size_t count) {
-  (void)ctx;
-  const int result = FLEX_SerialWrite(buffer, count);
-  if (result != FLEX_SUCCESS) {
+  SerialContext *const serial = ctx;
+  const int result = MYRIOTA_SerialStreamWrite(&serial->stream, buffer, count);
+  if (result != SERIAL_STREAM_SUCCESS) {
     return result;
   }
   return count;
 }
 
-inline uint16_t merge_i16(const uint8_t hi, const uint8_t low) {
-  return (int16_t)((uint16_t)hi << 8 | (uint16_t)low);
+typedef struct {
+  int16_t humidity;
+  int16_t temperature;
+} SensorValues;
+
+// The sensor's humidity and temperature registers, decoded straight from the
+// Modbus response. Sites with more sensors add a plan for each to the sweep.
+static const MYRIOTA_ModbusPoint sensor_points[] = {
+  {0x01, MODBUS_READ_HOLDING_REGISTERS, 0x0000, MODBUS_VALUE_TYPE_I16,
+    offsetof(SensorValues, humidity), MODBUS_WORD_ORDER_ABCD},
+  {0x01, MODBUS_READ_HOLDING_REGISTERS, 0x0001, MODBUS_VALUE_TYPE_I16,
+    offsetof(SensorValues, temperature), MODBUS_WORD_ORDER_ABCD},
+};
+static MYRIOTA_ModbusPlanRequest sensor_requests[sizeof(sensor_points) / sizeof(sensor_points[0])];
+static MYRIOTA_ModbusPlan sensor_plan;
+
+static int sensor_power_on(void *const ctx) {
+  (void)ctx;
+  const int result = FLEX_PowerOutInit(FLEX_POWER_OUT_12V);
+  if (result != FLEX_SUCCESS) {
+    printf("Failed to power sensor: %d\n", result);
+    return -1;
+  }
+  return 0;
+}
+
+static void sensor_power_off(void *const ctx) {
+  (void)ctx;
+  FLEX_PowerOutDeinit();
 }
 
 static void read_temperature_and_humidity(int16_t *const temperature, int16_t *const humidity) {
-  const MYRIOTA_ModbusHandle handle = application_context.modbus_handle;
+  // NOTE: The sweep powers the sensors and enables the Modbus driver only for
+  // as long as it takes to poll them, in order to conserve power.
+  const MYRIOTA_ModbusSweepOptions options = {
+    .power_on = sensor_power_on,
+    .power_off = sensor_power_off,
+    .stabilization_ms = SENSOR_POWER_STABILIZATION_MS,
+    .inter_frame_ms = application_context.serial_context.rx_idle_ticks,
+  };
+  SensorValues values = {0};
+  MYRIOTA_ModbusSweepSlave sensors[] = {
+    {.plan = &sensor_plan, .values = &values},
+  };
 
-  // Enable power to the sensor
-  int result = FLEX_PowerOutInit(FLEX_POWER_OUT_12V);
-  if (result != FLEX_SUCCESS) {
-    printf("Failed to power sensor: %d\n", result);
-    return;
-  }
-  FLEX_DelayMs(SENSOR_POWER_STABILIZATION_MS);
-
-  // NOTE: Enable/disable the Modbus driver in order to conserve power.
-  MYRIOTA_ModbusEnable(handle);
-
-  uint8_t bytes[4] = {0};
-  const MYRIOTA_ModbusDeviceAddress slave = 0x01;
-  const MYRIOTA_ModbusDataAddress addr = 0x0000;
-
-  for (uint8_t retries = 0; retries < SENSOR_READ_MAX_RETRIES; ++retries) {
-    result = MYRIOTA_ModbusReadHoldingRegisters(handle, slave, addr, 2, bytes);
-    if (result == MODBUS_SUCCESS) {
-      *humidity = merge_i16(bytes[0], bytes[1]);
-      *temperature = merge_i16(bytes[2], bytes[3]);
-      break;
-    }
+  // NOTE: Failed reads are retried by the driver's retry policy.
+  const int result = MYRIOTA_ModbusSweep(application_context.modbus_handle, &options, sensors,
+    sizeof(sensors) / sizeof(sensors[0]));
+  if (result == MODBUS_SUCCESS) {
+    *humidity = values.humidity;
+    *temperature = values.temperature;
+  } else {
     printf("Sensor Read Failed: %d\n", result);
   }
-
-  MYRIOTA_ModbusDisable(handle);
-  FLEX_PowerOutDeinit();
 }
 
 static time_t send_message(void) {
   static uint8_t sequence_number = 0;
 
-  Message message = {0};
-  message.sequence_number = sequence_number++;
-  message.time = FLEX_TimeGet();
-
+  const uint32_t time = FLEX_TimeGet();
   int32_t latitude = 0;
   int32_t longitude = 0;
   FLEX_LastLocationAndLastFixTime(&latitude, &longitude, NULL);
-  message.latitude = latitude;
-  message.longitude = longitude;
 
   int16_t temperature = 0;
   int16_t humidity = 0;
   read_temperature_and_humidity(&temperature, &humidity);
-  message.temperature = temperature;
-  message.humidity = humidity;
-
-  // Schedule messages for satellite transmission
-  FLEX_MessageSchedule((const uint8_t *const)&message, sizeof(message));
-  printf("Scheduled message: \n");
-  printf("  sequence_number: %u\n", message.sequence_number);
-  printf("  time: %lu\n", message.time);
-  printf("  latitude: %ld\n", message.latitude);
-  printf("  longitude: %ld\n", message.longitude);
-  printf("  temperature: %d\n", message.temperature);
-  printf("  humidity: %d\n", message.humidity);
+
+  uint8_t message[MESSAGE_SIZE_MAX];
+  MYRIOTA_BitPacker packer;
+  MYRIOTA_BitPackInit(&packer, message, sizeof(message));
+  int result = MYRIOTA_BitPackUnsigned(&packer, sequence_number, MESSAGE_SEQUENCE_NUMBER_BITS);
+  result |= MYRIOTA_BitPackUnsigned(&packer, time, MESSAGE_TIME_BITS);
+  result |= MYRIOTA_BitPackRange(&packer, latitude / MESSAGE_LOCATION_DIVISOR,
+    MESSAGE_LATITUDE_MIN, MESSAGE_LATITUDE_MAX);
+  result |= MYRIOTA_BitPackRange(&packer, longitude / MESSAGE_LOCATION_DIVISOR,
+    MESSAGE_LONGITUDE_MIN, MESSAGE_LONGITUDE_MAX);
+  result |= MYRIOTA_BitPackRange(&packer, temperature, MESSAGE_TEMPERATURE_MIN,
+    MESSAGE_TEMPERATURE_MAX);
+  result |= MYRIOTA_BitPackRange(&packer, humidity, MESSAGE_HUMIDITY_MIN, MESSAGE_HUMIDITY_MAX);
+  if (result != BITPACK_SUCCESS) {
+    printf("Failed to pack message\n");
+  } else {
+    // Schedule messages for satellite transmission
+    FLEX_MessageSchedule(message, MYRIOTA_BitPackBytes(&packer));
+    printf("Scheduled message (%u bytes, %u bits free): \n",
+      (unsigned)MYRIOTA_BitPackBytes(&packer),
+      (unsigned)MYRIOTA_BitPackBitsFree(&packer, FLEX_MessageBytesFree()));
+    printf("  sequence_number: %u\n", sequence_number);
+    printf("  time: %lu\n", time);
+    printf("  latitude: %ld\n", latitude);
+    printf("  longitude: %ld\n", longitude);
+    printf("  temperature: %d\n", temperature);
+    printf("  humidity: %d\n", humidity);
+  }
+  ++sequence_number;
 
   return (FLEX_TimeGet() + 24 * 3600 / MESSAGES_PER_DAY);
 }
@@ -167,6 +224,8 @@ void FLEX_AppInit() {
   application_context.serial_context.protocol = FLEX_SERIAL_PROTOCOL_RS485;
   application_context.serial_context.baud_rate = 9600;
   application_context.serial_context.rx_timeout_ticks = 2000;
+  application_context.serial_context.rx_idle_ticks =
+    (MYRIOTA_ModbusInterFrameDelayUs(application_context.serial_context.baud_rate) + 999) / 1000;
   const MYRIOTA_ModbusInitOptions options = {
     .framing_mode = MODBUS_FRAMING_MODE_RTU,
     .serial_interface =
@@ -176,7 +235,17 @@ void FLEX_AppInit() {
         .deinit = serial_deinit,
         .read = serial_read,
         .write = serial_write,
+        .poll = serial_poll,
+        .set_timeout = serial_set_timeout,
       },
+    .tick_get = FLEX_TickGet,
+    .response_timeout_ms = application_context.serial_context.rx_timeout_ticks,
+    .frame_idle_ms = application_context.serial_context.rx_idle_ticks,
+    .delay_ms = FLEX_DelayMs,
+    // Learn the sensor's response time so a failed read doesn't wait out the
+    // worst case timeout, and retry reads that fail due to noise on the line.
+    .adaptive_timeout = true,
+    .retry = {.max_retries = SENSOR_READ_MAX_RETRIES - 1, .backoff_ms = 50},
   };
   application_context.modbus_handle = MYRIOTA_ModbusInit(options);
   if (application_context.modbus_handle <= 0) {
@@ -185,6 +254,19 @@ void FLEX_AppInit() {
     };
   }
 
+  const int plan_result = MYRIOTA_ModbusPlanCompile(&sensor_plan, sensor_points,
+    sizeof(sensor_points) / sizeof(sensor_points[0]), sensor_requests,
+    sizeof(sensor_requests) / sizeof(sensor_requests[0]), 0);
+  if (plan_result != MODBUS_SUCCESS) {
+    printf("Failed to compile the sensor's poll plan: %d\n", plan_result);
+    while (true) {
+    };
+  }
+
+  MYRIOTA_ModbusRamUsage ram_usage = {0};
+  MYRIOTA_ModbusGetRamUsage(&ram_usage);
+  printf("Modbus RAM usage: %u bytes\n", (unsigned)(ram_usage.instances + ram_usage.buffers));
+
   FLEX_JobSchedule(send_message, FLEX_ASAP());
 }
 
@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "flex.h"
+#include "myriota/serial_stream.h"
 
 #define READY_STRING "READY\n"
 #define RECEIVE_TIMEOUT_MS 2000
@@ -51,22 +52,15 @@ const FLEX_DigitalIOPin WakeupPin = FLEX_EXT_DIGITAL_IO_1;
 #error "Must supply a valid 'SERIAL_INTERFACE' to the build!"
 #endif
 
+static MYRIOTA_SerialStream Stream;
+static uint8_t StreamBuffer[SERIAL_STREAM_CAPACITY_DEFAULT];
+
 // Read new line terminated string from the Serial interface with timeout
 // Return number of bytes read or -1 on timeout or string is too long
 int ReadStringWithTimeout(uint8_t *Rx, size_t MaxLength) {
-  const uint32_t start = FLEX_TickGet();
-  size_t count = 0;
-  while (FLEX_TickGet() - start < RECEIVE_TIMEOUT_MS) {
-    uint8_t ch;
-    if (FLEX_SerialRead(&ch, 1) == 1) {
-      if (ch == '\n')
-        return count;
-      Rx[count++] = ch;
-      if (count == MaxLength)
-        return -1;
-    }
-  }
-  return -1;
+  const uint32_t deadline = MYRIOTA_SerialStreamDeadline(&Stream, RECEIVE_TIMEOUT_MS);
+  const int len = MYRIOTA_SerialStreamReadUntil(&Stream, '\n', Rx, MaxLength, deadline);
+  return len < 0 ? -1 : len;
 }
 
 static void Comm() {
@@ -74,15 +68,23 @@ static void Comm() {
     printf("Failed to initialise Serial interface\n");
     return;
   }
-  FLEX_SerialWrite((uint8_t *)READY_STRING, strlen(READY_STRING));
+  const MYRIOTA_SerialStreamInterface interface = {
+    .read = FLEX_SerialRead,
+    .write = FLEX_SerialWrite,
+    .tick_get = FLEX_TickGet,
+    .delay_ms = FLEX_DelayMs,
+    .baud_rate = BAUDRATE,
+  };
+  MYRIOTA_SerialStreamInit(&Stream, interface, StreamBuffer, sizeof(StreamBuffer));
+  MYRIOTA_SerialStreamWrite(&Stream, (const uint8_t *)READY_STRING, strlen(READY_STRING));
 
   uint8_t Rx[RX_BUFFER_MAX] = {0};
   int len = ReadStringWithTimeout(Rx, RX_BUFFER_MAX);
   if (len <= 0) {
     printf("Failed to receive message\n");
   } else {
-    FLEX_SerialWrite((uint8_t *)Rx, len);
-    FLEX_SerialWrite((uint8_t *)ACK_STRING, strlen(ACK_STRING));
+    MYRIOTA_SerialStreamWrite(&Stream, Rx, len);
+    MYRIOTA_SerialStreamWrite(&Stream, (const uint8_t *)ACK_STRING, strlen(ACK_STRING));
     printf("Received message: ");
     for (int i = 0; i < len; i++)
       printf("%02x", Rx[i]);
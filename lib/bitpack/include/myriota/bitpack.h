@@ -0,0 +1,284 @@
+/// \file bitpack.h Myriota Bit Packer
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRIOTA_BITPACK_H
+#define MYRIOTA_BITPACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** \defgroup Bit_Pack Bit Packer Library
+ * Pack telemetry into messages bit by bit rather than in whole bytes, so each
+ * reading takes only the bits its range and resolution need.
+ *
+ * Fields are packed most significant bit first, starting at the most
+ * significant bit of the first byte, so a message reads left to right as a
+ * bit string. Every write is bounds checked against the caller's buffer, and
+ * a field that doesn't fit leaves the packer unchanged.
+ * \{
+ */
+
+/** Error codes for the bit packer. */
+typedef enum {
+  BITPACK_SUCCESS = 0,
+  BITPACK_ERROR_INVALID_ARGUMENT,
+  BITPACK_ERROR_OVERFLOW,
+  BITPACK_ERROR_OUT_OF_RANGE,
+} MYRIOTA_BitPackErrors;
+
+/** The default number of value bits in each group of a varint. */
+#define BITPACK_VARINT_GROUP_BITS_DEFAULT 7
+
+/** A bounds checked bit writer over a caller supplied buffer. */
+typedef struct {
+  /** The buffer being packed. */
+  uint8_t *buffer;
+  /** The size of the buffer in bits. */
+  size_t capacity;
+  /** The number of bits packed. */
+  size_t bits;
+} MYRIOTA_BitPacker;
+
+/** A bounds checked bit reader over a packed buffer. */
+typedef struct {
+  /** The buffer being unpacked. */
+  const uint8_t *buffer;
+  /** The size of the buffer in bits. */
+  size_t capacity;
+  /** The number of bits unpacked. */
+  size_t bits;
+} MYRIOTA_BitUnpacker;
+
+/**
+ * The number of bits MYRIOTA_BitPackRange() packs a range into.
+ *
+ * \param[in] min The smallest value in the range.
+ * \param[in] max The largest value in the range.
+ * \return the field width in bits, 0 for a range of a single value.
+ */
+static inline uint8_t MYRIOTA_BitPackRangeWidth(const int32_t min, const int32_t max) {
+  uint32_t span = (uint32_t)max - (uint32_t)min;
+  uint8_t width = 0;
+  while (span != 0) {
+    span >>= 1;
+    ++width;
+  }
+  return width;
+}
+
+/**
+ * Initialize a packer over a buffer, which is cleared.
+ *
+ * \param[out] packer The packer to initialize.
+ * \param[out] buffer The buffer to pack into, e.g. for FLEX_MessageSchedule().
+ * \param[in] size The size of `buffer` in bytes.
+ * \return 0 on success, -BITPACK_ERROR_INVALID_ARGUMENT if an argument is invalid.
+ */
+int MYRIOTA_BitPackInit(MYRIOTA_BitPacker *const packer, uint8_t *const buffer,
+  const size_t size);
+
+/**
+ * The number of bytes holding packed bits, the size of the message to send.
+ *
+ * \param[in] packer The packer.
+ * \return the packed size in bytes, rounded up.
+ */
+size_t MYRIOTA_BitPackBytes(const MYRIOTA_BitPacker *const packer);
+
+/**
+ * The number of bits that can still be packed into a message that must also
+ * fit in `bytes_free` bytes, e.g. FLEX_MessageBytesFree().
+ *
+ * \param[in] packer The packer.
+ * \param[in] bytes_free The space left for the message in bytes.
+ * \return the bits left, 0 once the packed bits don't fit in `bytes_free`.
+ */
+size_t MYRIOTA_BitPackBitsFree(const MYRIOTA_BitPacker *const packer, const size_t bytes_free);
+
+/**
+ * Pack an unsigned value in a fixed width field.
+ *
+ * \param[in,out] packer The packer.
+ * \param[in] value The value, less than 2^width.
+ * \param[in] width The field width in bits, 0 to 64.
+ * \return 0 on success, or < 0 on failure.
+ * \retval -BITPACK_ERROR_OUT_OF_RANGE: `value` doesn't fit in `width` bits
+ * \retval -BITPACK_ERROR_OVERFLOW: the field doesn't fit in the buffer
+ * \retval -BITPACK_ERROR_INVALID_ARGUMENT: `width` is greater than 64
+ */
+int MYRIOTA_BitPackUnsigned(MYRIOTA_BitPacker *const packer, const uint64_t value,
+  const uint8_t width);
+
+/**
+ * Pack a signed value in a fixed width two's complement field.
+ *
+ * \param[in,out] packer The packer.
+ * \param[in] value The value, from -2^(width-1) to 2^(width-1) - 1.
+ * \param[in] width The field width in bits, 1 to 64.
+ * \return 0 on success, or < 0 on failure as MYRIOTA_BitPackUnsigned().
+ */
+int MYRIOTA_BitPackSigned(MYRIOTA_BitPacker *const packer, const int64_t value,
+  const uint8_t width);
+
+/**
+ * Pack a single bit.
+ *
+ * \param[in,out] packer The packer.
+ * \param[in] value The value.
+ * \return 0 on success, or -BITPACK_ERROR_OVERFLOW.
+ */
+int MYRIOTA_BitPackBool(MYRIOTA_BitPacker *const packer, const bool value);
+
+/**
+ * Pack a value from a known range as its offset from `min`, in
+ * MYRIOTA_BitPackRangeWidth(min, max) bits. Values outside of the range are
+ * clamped to it, as sensor readings saturate.
+ *
+ * \param[in,out] packer The packer.
+ * \param[in] value The value.
+ * \param[in] min The smallest value in the range.
+ * \param[in] max The largest value in the range, at least `min`.
+ * \return 0 on success, or < 0 on failure as MYRIOTA_BitPackUnsigned().
+ */
+int MYRIOTA_BitPackRange(MYRIOTA_BitPacker *const packer, const int32_t value,
+  const int32_t min, const int32_t max);
+
+/**
+ * Pack a real value quantized to steps of `step` from `min`, i.e. the nearest
+ * of `min + n * step` for n from 0 to 2^width - 1. Values outside of the range
+ * are clamped to it. Unpack with MYRIOTA_BitUnpackQuantized().
+ *
+ * \param[in,out] packer The packer.
+ * \param[in] value The value.
+ * \param[in] min The smallest value in the range.
+ * \param[in] step The resolution, greater than 0.
+ * \param[in] width The field width in bits, 1 to 32.
+ * \return 0 on success, or < 0 on failure as MYRIOTA_BitPackUnsigned().
+ */
+int MYRIOTA_BitPackQuantized(MYRIOTA_BitPacker *const packer, const float value,
+  const float min, const float step, const uint8_t width);
+
+/**
+ * Pack an unsigned value in as few groups of `group_bits` value bits as it
+ * needs, each group followed by a continuation bit. Small values, such as the
+ * differences between readings, take a single group.
+ *
+ * \param[in,out] packer The packer.
+ * \param[in] value The value.
+ * \param[in] group_bits The value bits per group, 1 to 32, e.g.
+ *                       BITPACK_VARINT_GROUP_BITS_DEFAULT.
+ * \return 0 on success, or < 0 on failure as MYRIOTA_BitPackUnsigned().
+ */
+int MYRIOTA_BitPackVarint(MYRIOTA_BitPacker *const packer, const uint64_t value,
+  const uint8_t group_bits);
+
+/**
+ * Pack a signed value as a varint of its zigzag encoding, which interleaves
+ * negative and positive values (0, -1, 1, -2, ...) so values near zero of
+ * either sign take a single group.
+ *
+ * \param[in,out] packer The packer.
+ * \param[in] value The value.
+ * \param[in] group_bits The value bits per group, 1 to 32.
+ * \return 0 on success, or < 0 on failure as MYRIOTA_BitPackUnsigned().
+ */
+int MYRIOTA_BitPackZigZag(MYRIOTA_BitPacker *const packer, const int64_t value,
+  const uint8_t group_bits);
+
+/**
+ * Initialize an unpacker over a packed buffer, e.g. a received message.
+ *
+ * \param[out] unpacker The unpacker to initialize.
+ * \param[in] buffer The packed buffer.
+ * \param[in] size The size of `buffer` in bytes.
+ * \return 0 on success, -BITPACK_ERROR_INVALID_ARGUMENT if an argument is invalid.
+ */
+int MYRIOTA_BitUnpackInit(MYRIOTA_BitUnpacker *const unpacker, const uint8_t *const buffer,
+  const size_t size);
+
+/**
+ * Unpack an unsigned value packed by MYRIOTA_BitPackUnsigned().
+ *
+ * \param[in,out] unpacker The unpacker.
+ * \param[out] value The value.
+ * \param[in] width The field width in bits, 0 to 64.
+ * \return 0 on success, -BITPACK_ERROR_OVERFLOW past the end of the buffer.
+ */
+int MYRIOTA_BitUnpackUnsigned(MYRIOTA_BitUnpacker *const unpacker, uint64_t *const value,
+  const uint8_t width);
+
+/**
+ * Unpack a signed value packed by MYRIOTA_BitPackSigned().
+ *
+ * \param[in,out] unpacker The unpacker.
+ * \param[out] value The value.
+ * \param[in] width The field width in bits, 1 to 64.
+ * \return 0 on success, -BITPACK_ERROR_OVERFLOW past the end of the buffer.
+ */
+int MYRIOTA_BitUnpackSigned(MYRIOTA_BitUnpacker *const unpacker, int64_t *const value,
+  const uint8_t width);
+
+/**
+ * Unpack a value packed by MYRIOTA_BitPackRange().
+ *
+ * \param[in,out] unpacker The unpacker.
+ * \param[out] value The value.
+ * \param[in] min The smallest value in the range.
+ * \param[in] max The largest value in the range.
+ * \return 0 on success, -BITPACK_ERROR_OVERFLOW past the end of the buffer.
+ */
+int MYRIOTA_BitUnpackRange(MYRIOTA_BitUnpacker *const unpacker, int32_t *const value,
+  const int32_t min, const int32_t max);
+
+/**
+ * Unpack a value packed by MYRIOTA_BitPackQuantized().
+ *
+ * \param[in,out] unpacker The unpacker.
+ * \param[out] value The quantized value.
+ * \param[in] min The smallest value in the range.
+ * \param[in] step The resolution.
+ * \param[in] width The field width in bits, 1 to 32.
+ * \return 0 on success, -BITPACK_ERROR_OVERFLOW past the end of the buffer.
+ */
+int MYRIOTA_BitUnpackQuantized(MYRIOTA_BitUnpacker *const unpacker, float *const value,
+  const float min, const float step, const uint8_t width);
+
+/**
+ * Unpack a value packed by MYRIOTA_BitPackVarint().
+ *
+ * \param[in,out] unpacker The unpacker.
+ * \param[out] value The value.
+ * \param[in] group_bits The value bits per group, 1 to 32.
+ * \return 0 on success, or < 0 on failure.
+ * \retval -BITPACK_ERROR_OVERFLOW: past the end of the buffer
+ * \retval -BITPACK_ERROR_OUT_OF_RANGE: the value doesn't fit in 64 bits
+ */
+int MYRIOTA_BitUnpackVarint(MYRIOTA_BitUnpacker *const unpacker, uint64_t *const value,
+  const uint8_t group_bits);
+
+/**
+ * Unpack a value packed by MYRIOTA_BitPackZigZag().
+ *
+ * \param[in,out] unpacker The unpacker.
+ * \param[out] value The value.
+ * \param[in] group_bits The value bits per group, 1 to 32.
+ * \return 0 on success, or < 0 on failure as MYRIOTA_BitUnpackVarint().
+ */
+int MYRIOTA_BitUnpackZigZag(MYRIOTA_BitUnpacker *const unpacker, int64_t *const value,
+  const uint8_t group_bits);
+
+/** \} */
+
+#endif /* MYRIOTA_BITPACK_H */
@@ -0,0 +1,461 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "myriota/bitpack.h"
+#include <string.h>
+
+#define BITPACK_WIDTH_MAX 64
+#define BITPACK_GROUP_BITS_MAX 32
+
+static inline uint64_t width_mask(const uint8_t width) {
+  return width >= 64 ? UINT64_MAX : (((uint64_t)1 << width) - 1);
+}
+
+// Writes `width` bits of `value` a byte at a time. The caller has checked the
+// bits fit, and the buffer was cleared by MYRIOTA_BitPackInit().
+static void pack_bits(MYRIOTA_BitPacker *const packer, const uint64_t value, uint8_t width) {
+  while (width > 0) {
+    const uint8_t used = packer->bits % 8;
+    const uint8_t count = 8 - used < width ? 8 - used : width;
+    const uint8_t chunk = (uint8_t)((value >> (width - count)) & width_mask(count));
+    packer->buffer[packer->bits / 8] |= (uint8_t)(chunk << (8 - used - count));
+    width -= count;
+    packer->bits += count;
+  }
+}
+
+static uint64_t unpack_bits(MYRIOTA_BitUnpacker *const unpacker, uint8_t width) {
+  uint64_t value = 0;
+  while (width > 0) {
+    const uint8_t used = unpacker->bits % 8;
+    const uint8_t count = 8 - used < width ? 8 - used : width;
+    const uint8_t chunk =
+      (uint8_t)((unpacker->buffer[unpacker->bits / 8] >> (8 - used - count)) & width_mask(count));
+    value = (value << count) | chunk;
+    width -= count;
+    unpacker->bits += count;
+  }
+  return value;
+}
+
+static inline bool packer_fits(const MYRIOTA_BitPacker *const packer, const size_t bits) {
+  return bits <= packer->capacity - packer->bits;
+}
+
+static inline bool unpacker_fits(const MYRIOTA_BitUnpacker *const unpacker, const size_t bits) {
+  return bits <= unpacker->capacity - unpacker->bits;
+}
+
+static inline uint64_t zigzag_encode(const int64_t value) {
+  return ((uint64_t)value << 1) ^ (value < 0 ? UINT64_MAX : 0);
+}
+
+static inline int64_t zigzag_decode(const uint64_t value) {
+  return (int64_t)((value >> 1) ^ (0 - (value & 1)));
+}
+
+int MYRIOTA_BitPackInit(MYRIOTA_BitPacker *const packer, uint8_t *const buffer,
+  const size_t size) {
+  if (packer == NULL || (buffer == NULL && size > 0)) {
+    return -BITPACK_ERROR_INVALID_ARGUMENT;
+  }
+
+  if (size > 0) {
+    memset(buffer, 0, size);
+  }
+  packer->buffer = buffer;
+  packer->capacity = size * 8;
+  packer->bits = 0;
+  return BITPACK_SUCCESS;
+}
+
+size_t MYRIOTA_BitPackBytes(const MYRIOTA_BitPacker *const packer) {
+  return (packer->bits + 7) / 8;
+}
+
+size_t MYRIOTA_BitPackBitsFree(const MYRIOTA_BitPacker *const packer, const size_t bytes_free) {
+  const size_t limit = bytes_free < packer->capacity / 8 ? bytes_free * 8 : packer->capacity;
+  return limit > packer->bits ? limit - packer->bits : 0;
+}
+
+int MYRIOTA_BitPackUnsigned(MYRIOTA_BitPacker *const packer, const uint64_t value,
+  const uint8_t width) {
+  if (width > BITPACK_WIDTH_MAX) {
+    return -BITPACK_ERROR_INVALID_ARGUMENT;
+  }
+  if ((value & ~width_mask(width)) != 0) {
+    return -BITPACK_ERROR_OUT_OF_RANGE;
+  }
+  if (!packer_fits(packer, width)) {
+    return -BITPACK_ERROR_OVERFLOW;
+  }
+
+  pack_bits(packer, value, width);
+  return BITPACK_SUCCESS;
+}
+
+int MYRIOTA_BitPackSigned(MYRIOTA_BitPacker *const packer, const int64_t value,
+  const uint8_t width) {
+  if (width == 0 || width > BITPACK_WIDTH_MAX) {
+    return -BITPACK_ERROR_INVALID_ARGUMENT;
+  }
+  if (width < 64) {
+    const int64_t max = (int64_t)width_mask(width - 1);
+    if (value > max || value < -max - 1) {
+      return -BITPACK_ERROR_OUT_OF_RANGE;
+    }
+  }
+
+  return MYRIOTA_BitPackUnsigned(packer, (uint64_t)value & width_mask(width), width);
+}
+
+int MYRIOTA_BitPackBool(MYRIOTA_BitPacker *const packer, const bool value) {
+  return MYRIOTA_BitPackUnsigned(packer, value ? 1 : 0, 1);
+}
+
+int MYRIOTA_BitPackRange(MYRIOTA_BitPacker *const packer, const int32_t value,
+  const int32_t min, const int32_t max) {
+  if (max < min) {
+    return -BITPACK_ERROR_INVALID_ARGUMENT;
+  }
+
+  const int32_t clamped = value < min ? min : (value > max ? max : value);
+  return MYRIOTA_BitPackUnsigned(packer, (uint32_t)clamped - (uint32_t)min,
+    MYRIOTA_BitPackRangeWidth(min, max));
+}
+
+int MYRIOTA_BitPackQuantized(MYRIOTA_BitPacker *const packer, const float value,
+  const float min, const float step, const uint8_t width) {
+  if (!(step > 0.0f) || width == 0 || width > 32) {
+    return -BITPACK_ERROR_INVALID_ARGUMENT;
+  }
+
+  // Round to the nearest step, clamping (and mapping NaN) into the range.
+  const uint32_t max_code = (uint32_t)width_mask(width);
+  const float steps = (value - min) / step;
+  uint32_t code = 0;
+  if (steps >= (float)max_code) {
+    code = max_code;
+  } else if (steps > 0.0f) {
+    code = (uint32_t)(steps + 0.5f);
+  }
+  return MYRIOTA_BitPackUnsigned(packer, code, width);
+}
+
+int MYRIOTA_BitPackVarint(MYRIOTA_BitPacker *const packer, const uint64_t value,
+  const uint8_t group_bits) {
+  if (group_bits == 0 || group_bits > BITPACK_GROUP_BITS_MAX) {
+    return -BITPACK_ERROR_INVALID_ARGUMENT;
+  }
+
+  size_t groups = 1;
+  for (uint64_t rest = value >> group_bits; rest != 0; rest >>= group_bits) {
+    ++groups;
+  }
+  if (!packer_fits(packer, groups * (group_bits + 1))) {
+    return -BITPACK_ERROR_OVERFLOW;
+  }
+
+  // Least significant group first, each followed by whether another follows.
+  uint64_t rest = value;
+  for (size_t i = 0; i < groups; ++i) {
+    pack_bits(packer, rest & width_mask(group_bits), group_bits);
+    pack_bits(packer, i + 1 < groups, 1);
+    rest >>= group_bits;
+  }
+  return BITPACK_SUCCESS;
+}
+
+int MYRIOTA_BitPackZigZag(MYRIOTA_BitPacker *const packer, const int64_t value,
+  const uint8_t group_bits) {
+  return MYRIOTA_BitPackVarint(packer, zigzag_encode(value), group_bits);
+}
+
+int MYRIOTA_BitUnpackInit(MYRIOTA_BitUnpacker *const unpacker, const uint8_t *const buffer,
+  const size_t size) {
+  if (unpacker == NULL || (buffer == NULL && size > 0)) {
+    return -BITPACK_ERROR_INVALID_ARGUMENT;
+  }
+
+  unpacker->buffer = buffer;
+  unpacker->capacity = size * 8;
+  unpacker->bits = 0;
+  return BITPACK_SUCCESS;
+}
+
+int MYRIOTA_BitUnpackUnsigned(MYRIOTA_BitUnpacker *const unpacker, uint64_t *const value,
+  const uint8_t width) {
+  if (width > BITPACK_WIDTH_MAX) {
+    return -BITPACK_ERROR_INVALID_ARGUMENT;
+  }
+  if (!unpacker_fits(unpacker, width)) {
+    return -BITPACK_ERROR_OVERFLOW;
+  }
+
+  *value = unpack_bits(unpacker, width);
+  return BITPACK_SUCCESS;
+}
+
+int MYRIOTA_BitUnpackSigned(MYRIOTA_BitUnpacker *const unpacker, int64_t *const value,
+  const uint8_t width) {
+  if (width == 0) {
+    return -BITPACK_ERROR_INVALID_ARGUMENT;
+  }
+
+  uint64_t bits = 0;
+  const int result = MYRIOTA_BitUnpackUnsigned(unpacker, &bits, width);
+  if (result != BITPACK_SUCCESS) {
+    return result;
+  }
+  // Sign extend from the field's top bit.
+  if (width < 64 && (bits >> (width - 1)) != 0) {
+    bits |= ~width_mask(width);
+  }
+  *value = (int64_t)bits;
+  return BITPACK_SUCCESS;
+}
+
+int MYRIOTA_BitUnpackRange(MYRIOTA_BitUnpacker *const unpacker, int32_t *const value,
+  const int32_t min, const int32_t max) {
+  if (max < min) {
+    return -BITPACK_ERROR_INVALID_ARGUMENT;
+  }
+
+  uint64_t offset = 0;
+  const int result =
+    MYRIOTA_BitUnpackUnsigned(unpacker, &offset, MYRIOTA_BitPackRangeWidth(min, max));
+  if (result != BITPACK_SUCCESS) {
+    return result;
+  }
+  *value = (int32_t)((uint32_t)min + (uint32_t)offset);
+  return BITPACK_SUCCESS;
+}
+
+int MYRIOTA_BitUnpackQuantized(MYRIOTA_BitUnpacker *const unpacker, float *const value,
+  const float min, const float step, const uint8_t width) {
+  if (width == 0 || width > 32) {
+    return -BITPACK_ERROR_INVALID_ARGUMENT;
+  }
+
+  uint64_t code = 0;
+  const int result = MYRIOTA_BitUnpackUnsigned(unpacker, &code, width);
+  if (result != BITPACK_SUCCESS) {
+    return result;
+  }
+  *value = min + (float)code * step;
+  return BITPACK_SUCCESS;
+}
+
+int MYRIOTA_BitUnpackVarint(MYRIOTA_BitUnpacker *const unpacker, uint64_t *const value,
+  const uint8_t group_bits) {
+  if (group_bits == 0 || group_bits > BITPACK_GROUP_BITS_MAX) {
+    return -BITPACK_ERROR_INVALID_ARGUMENT;
+  }
+
+  // Leave the unpacker where it was if the varint can't be unpacked.
+  const size_t start = unpacker->bits;
+  uint64_t result = 0;
+  unsigned shift = 0;
+  bool more = true;
+  while (more) {
+    if (!unpacker_fits(unpacker, (size_t)group_bits + 1)) {
+      unpacker->bits = start;
+      return -BITPACK_ERROR_OVERFLOW;
+    }
+    const uint64_t group = unpack_bits(unpacker, group_bits);
+    more = unpack_bits(unpacker, 1) != 0;
+    if (group != 0 && (shift >= 64 || (group & ~(UINT64_MAX >> shift)) != 0)) {
+      unpacker->bits = start;
+      return -BITPACK_ERROR_OUT_OF_RANGE;
+    }
+    if (shift < 64) {
+      result |= group << shift;
+    }
+    shift += group_bits;
+  }
+
+  *value = result;
+  return BITPACK_SUCCESS;
+}
+
+int MYRIOTA_BitUnpackZigZag(MYRIOTA_BitUnpacker *const unpacker, int64_t *const value,
+  const uint8_t group_bits) {
+  uint64_t encoded = 0;
+  const int result = MYRIOTA_BitUnpackVarint(unpacker, &encoded, group_bits);
+  if (result != BITPACK_SUCCESS) {
+    return result;
+  }
+  *value = zigzag_decode(encoded);
+  return BITPACK_SUCCESS;
+}
+
+#ifdef MYRIOTA_BITPACK_UNIT_TESTS
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+/*
+ * `cmocka.h` must be included after standard the above library headers.
+ * NOTE: This comment has dual purpose:
+ * 1. Document the ordering requirement.
+ * 2. Prevent `clang-format` from reordering the headers.
+ */
+#include <cmocka.h>
+
+static void test_fixed_width_fields(void **state) {
+  (void)state;
+  uint8_t buffer[4];
+  MYRIOTA_BitPacker packer;
+  assert_int_equal(MYRIOTA_BitPackInit(&packer, buffer, sizeof(buffer)), BITPACK_SUCCESS);
+
+  assert_int_equal(MYRIOTA_BitPackUnsigned(&packer, 0x5, 3), BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitPackBool(&packer, true), BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitPackSigned(&packer, -2, 6), BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitPackUnsigned(&packer, 0xabc, 12), BITPACK_SUCCESS);
+  assert_int_equal(packer.bits, 22);
+  assert_int_equal(MYRIOTA_BitPackBytes(&packer), 3);
+  // 101 1 111110 101010111100 00
+  const uint8_t expected[] = {0xbf, 0xaa, 0xf0};
+  assert_memory_equal(buffer, expected, sizeof(expected));
+
+  assert_int_equal(MYRIOTA_BitPackUnsigned(&packer, 8, 3), -BITPACK_ERROR_OUT_OF_RANGE);
+  assert_int_equal(MYRIOTA_BitPackSigned(&packer, 32, 6), -BITPACK_ERROR_OUT_OF_RANGE);
+  assert_int_equal(MYRIOTA_BitPackSigned(&packer, -33, 6), -BITPACK_ERROR_OUT_OF_RANGE);
+  assert_int_equal(MYRIOTA_BitPackUnsigned(&packer, 0, 11), -BITPACK_ERROR_OVERFLOW);
+  assert_int_equal(MYRIOTA_BitPackUnsigned(&packer, 0, 65), -BITPACK_ERROR_INVALID_ARGUMENT);
+  assert_int_equal(packer.bits, 22);
+  assert_int_equal(MYRIOTA_BitPackUnsigned(&packer, 0x3ff, 10), BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitPackBitsFree(&packer, 8), 0);
+  assert_int_equal(MYRIOTA_BitPackBool(&packer, false), -BITPACK_ERROR_OVERFLOW);
+
+  MYRIOTA_BitUnpacker unpacker;
+  assert_int_equal(MYRIOTA_BitUnpackInit(&unpacker, buffer, sizeof(buffer)), BITPACK_SUCCESS);
+  uint64_t value = 0;
+  int64_t signed_value = 0;
+  assert_int_equal(MYRIOTA_BitUnpackUnsigned(&unpacker, &value, 3), BITPACK_SUCCESS);
+  assert_int_equal(value, 0x5);
+  assert_int_equal(MYRIOTA_BitUnpackUnsigned(&unpacker, &value, 1), BITPACK_SUCCESS);
+  assert_int_equal(value, 1);
+  assert_int_equal(MYRIOTA_BitUnpackSigned(&unpacker, &signed_value, 6), BITPACK_SUCCESS);
+  assert_int_equal(signed_value, -2);
+  assert_int_equal(MYRIOTA_BitUnpackUnsigned(&unpacker, &value, 12), BITPACK_SUCCESS);
+  assert_int_equal(value, 0xabc);
+  assert_int_equal(MYRIOTA_BitUnpackUnsigned(&unpacker, &value, 10), BITPACK_SUCCESS);
+  assert_int_equal(value, 0x3ff);
+  assert_int_equal(MYRIOTA_BitUnpackUnsigned(&unpacker, &value, 1), -BITPACK_ERROR_OVERFLOW);
+
+  // 64-bit fields don't overflow their masks.
+  uint8_t wide[9];
+  assert_int_equal(MYRIOTA_BitPackInit(&packer, wide, sizeof(wide)), BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitPackBool(&packer, true), BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitPackSigned(&packer, INT64_MIN, 64), BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitUnpackInit(&unpacker, wide, sizeof(wide)), BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitUnpackUnsigned(&unpacker, &value, 1), BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitUnpackSigned(&unpacker, &signed_value, 64), BITPACK_SUCCESS);
+  assert_true(signed_value == INT64_MIN);
+}
+
+static void test_ranged_fields(void **state) {
+  (void)state;
+  uint8_t buffer[8];
+  MYRIOTA_BitPacker packer;
+  assert_int_equal(MYRIOTA_BitPackInit(&packer, buffer, sizeof(buffer)), BITPACK_SUCCESS);
+
+  // Latitude in 1e-4 degrees takes 21 bits.
+  assert_int_equal(MYRIOTA_BitPackRangeWidth(-900000, 900000), 21);
+  assert_int_equal(MYRIOTA_BitPackRangeWidth(5, 5), 0);
+  assert_int_equal(MYRIOTA_BitPackRangeWidth(INT32_MIN, INT32_MAX), 32);
+  assert_int_equal(MYRIOTA_BitPackRange(&packer, -345678, -900000, 900000), BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitPackRange(&packer, 150, 0, 100), BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitPackRange(&packer, 1, 2, 1), -BITPACK_ERROR_INVALID_ARGUMENT);
+  // Humidity to half a percent.
+  assert_int_equal(MYRIOTA_BitPackQuantized(&packer, 47.3f, 0.0f, 0.5f, 8), BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitPackQuantized(&packer, -5.0f, 0.0f, 0.5f, 8), BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitPackQuantized(&packer, 1e9f, 0.0f, 0.5f, 8), BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitPackQuantized(&packer, 1.0f, 0.0f, 0.0f, 8),
+    -BITPACK_ERROR_INVALID_ARGUMENT);
+  assert_int_equal(packer.bits, 21 + 7 + 3 * 8);
+
+  MYRIOTA_BitUnpacker unpacker;
+  assert_int_equal(MYRIOTA_BitUnpackInit(&unpacker, buffer, sizeof(buffer)), BITPACK_SUCCESS);
+  int32_t value = 0;
+  float real = 0.0f;
+  assert_int_equal(MYRIOTA_BitUnpackRange(&unpacker, &value, -900000, 900000), BITPACK_SUCCESS);
+  assert_int_equal(value, -345678);
+  assert_int_equal(MYRIOTA_BitUnpackRange(&unpacker, &value, 0, 100), BITPACK_SUCCESS);
+  assert_int_equal(value, 100);
+  assert_int_equal(MYRIOTA_BitUnpackQuantized(&unpacker, &real, 0.0f, 0.5f, 8), BITPACK_SUCCESS);
+  assert_true(real == 47.5f);
+  assert_int_equal(MYRIOTA_BitUnpackQuantized(&unpacker, &real, 0.0f, 0.5f, 8), BITPACK_SUCCESS);
+  assert_true(real == 0.0f);
+  assert_int_equal(MYRIOTA_BitUnpackQuantized(&unpacker, &real, 0.0f, 0.5f, 8), BITPACK_SUCCESS);
+  assert_true(real == 127.5f);
+}
+
+static void test_varints(void **state) {
+  (void)state;
+  uint8_t buffer[40];
+  MYRIOTA_BitPacker packer;
+  assert_int_equal(MYRIOTA_BitPackInit(&packer, buffer, sizeof(buffer)), BITPACK_SUCCESS);
+
+  // Small values take a single group of group_bits + 1 bits.
+  assert_int_equal(MYRIOTA_BitPackVarint(&packer, 5, 3), BITPACK_SUCCESS);
+  assert_int_equal(packer.bits, 4);
+  assert_int_equal(MYRIOTA_BitPackVarint(&packer, 300, 3), BITPACK_SUCCESS);
+  assert_int_equal(packer.bits, 4 + 3 * 4);
+  const int64_t signed_values[] = {0, -1, 1, -4, 3, INT64_MIN, INT64_MAX};
+  for (size_t i = 0; i < sizeof(signed_values) / sizeof(*signed_values); ++i) {
+    assert_int_equal(MYRIOTA_BitPackZigZag(&packer, signed_values[i], 3), BITPACK_SUCCESS);
+  }
+  assert_int_equal(MYRIOTA_BitPackVarint(&packer, UINT64_MAX, 7), BITPACK_SUCCESS);
+
+  // A varint that doesn't fit leaves the packer unchanged.
+  const size_t bits = packer.bits;
+  assert_int_equal(MYRIOTA_BitPackVarint(&packer, UINT64_MAX, 32), -BITPACK_ERROR_OVERFLOW);
+  assert_int_equal(packer.bits, bits);
+  assert_int_equal(MYRIOTA_BitPackVarint(&packer, 1, 0), -BITPACK_ERROR_INVALID_ARGUMENT);
+
+  MYRIOTA_BitUnpacker unpacker;
+  assert_int_equal(MYRIOTA_BitUnpackInit(&unpacker, buffer, MYRIOTA_BitPackBytes(&packer)),
+    BITPACK_SUCCESS);
+  uint64_t value = 0;
+  int64_t signed_value = 0;
+  assert_int_equal(MYRIOTA_BitUnpackVarint(&unpacker, &value, 3), BITPACK_SUCCESS);
+  assert_int_equal(value, 5);
+  assert_int_equal(MYRIOTA_BitUnpackVarint(&unpacker, &value, 3), BITPACK_SUCCESS);
+  assert_int_equal(value, 300);
+  for (size_t i = 0; i < sizeof(signed_values) / sizeof(*signed_values); ++i) {
+    assert_int_equal(MYRIOTA_BitUnpackZigZag(&unpacker, &signed_value, 3), BITPACK_SUCCESS);
+    assert_true(signed_value == signed_values[i]);
+  }
+  assert_int_equal(MYRIOTA_BitUnpackVarint(&unpacker, &value, 7), BITPACK_SUCCESS);
+  assert_true(value == UINT64_MAX);
+
+  // A truncated varint leaves the unpacker unchanged.
+  const uint8_t truncated[] = {0xff};
+  assert_int_equal(MYRIOTA_BitUnpackInit(&unpacker, truncated, sizeof(truncated)),
+    BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitUnpackVarint(&unpacker, &value, 3), -BITPACK_ERROR_OVERFLOW);
+  assert_int_equal(unpacker.bits, 0);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_fixed_width_fields),
+    cmocka_unit_test(test_ranged_fields),
+    cmocka_unit_test(test_varints),
+  };
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
+#endif /** MYRIOTA_BITPACK_UNIT_TESTS */
@@ -0,0 +1,173 @@
+/// \file coalesce.h Myriota Message Coalescing
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRIOTA_COALESCE_H
+#define MYRIOTA_COALESCE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** \defgroup Coalesce Message Coalescing Library
+ * Stage small records in an open message and schedule it only once it is
+ * full, it reaches its maximum age, or the queue is saved, so each slot of the
+ * message queue carries as much payload as it can.
+ *
+ * FLEX_MessageSchedule() replaces a queued message when no slots are free. A
+ * message is only scheduled while FLEX_MessageSlotsFree() and
+ * FLEX_MessageBytesFree() show room for it, otherwise it stays open and the
+ * record that needed the space is refused, so nothing is replaced silently.
+ * \{
+ */
+
+/** Error codes for the coalescer. */
+typedef enum {
+  COALESCE_SUCCESS = 0,
+  COALESCE_ERROR_INVALID_ARGUMENT,
+  /** The message queue has no room for the open message. */
+  COALESCE_ERROR_QUEUE_FULL,
+  /** Scheduling the message failed. */
+  COALESCE_ERROR_SCHEDULE_FAILURE,
+} MYRIOTA_CoalesceErrors;
+
+/**
+ * The message queue. Messages are scheduled with the user defined context,
+ * e.g. by a function calling FLEX_MessageSchedule(). Leave `slots_free` and
+ * `bytes_free` NULL when the schedule function makes room for messages itself.
+ */
+typedef struct {
+  /** The user defined context passed to `schedule`. */
+  void *ctx;
+  /** Schedule a message, returning < 0 on failure. */
+  int (*schedule)(void *const ctx, const uint8_t *const message, const size_t size);
+  /** The free slots in the queue, e.g. FLEX_MessageSlotsFree, NULL to not check. */
+  int (*slots_free)(void);
+  /** The free bytes in the queue, e.g. FLEX_MessageBytesFree, NULL to not check. */
+  size_t (*bytes_free)(void);
+  /** Save the queue to persistent storage, e.g. FLEX_MessageSave, NULL if not used. */
+  void (*save)(void);
+} MYRIOTA_CoalesceInterface;
+
+/** Coalescer options. */
+typedef struct {
+  /** The message queue. */
+  MYRIOTA_CoalesceInterface interface;
+  /** The open message, its size is the largest message scheduled. */
+  uint8_t *buffer;
+  /** The size of `buffer` in bytes. */
+  size_t size;
+  /** The age of the open message at which it is scheduled, 0 to only schedule full messages. */
+  uint32_t max_age_s;
+  /** Queue slots left free for messages scheduled elsewhere, e.g. alarms, with `slots_free`. */
+  int slots_reserved;
+  /** Precede each record with its size in a byte, so the host can split them. */
+  bool length_prefixed;
+} MYRIOTA_CoalesceOptions;
+
+/** Coalescer counters. */
+typedef struct {
+  /** The messages scheduled. */
+  uint32_t messages;
+  /** The records scheduled. */
+  uint32_t records;
+  /** The bytes scheduled. */
+  uint32_t bytes;
+  /** The records refused as the open message couldn't be scheduled. */
+  uint32_t refused;
+} MYRIOTA_CoalesceStats;
+
+/** A coalescer, managed by the library once initialized. */
+typedef struct {
+  /** The options. */
+  MYRIOTA_CoalesceOptions options;
+  /** The bytes in the open message. */
+  size_t used;
+  /** The records in the open message. */
+  uint32_t records;
+  /** The time the open message's first record was appended. */
+  uint32_t opened;
+  /** The counters. */
+  MYRIOTA_CoalesceStats stats;
+} MYRIOTA_Coalescer;
+
+/**
+ * Initialize a coalescer.
+ *
+ * \param[out] coalescer The coalescer to initialize.
+ * \param[in] options The coalescer options.
+ * \return 0 on success, -COALESCE_ERROR_INVALID_ARGUMENT if an option is invalid.
+ */
+int MYRIOTA_CoalesceInit(MYRIOTA_Coalescer *const coalescer,
+  const MYRIOTA_CoalesceOptions *const options);
+
+/**
+ * Append a record to the open message. If it doesn't fit, the open message is
+ * scheduled first. The message is scheduled as soon as it is full or reaches
+ * `max_age_s`, or stays open until the next append, poll or flush if the
+ * queue has no room for it yet.
+ *
+ * \param[in,out] coalescer The coalescer.
+ * \param[in] record The record.
+ * \param[in] size The size of the record in bytes, 1 to the buffer size (less
+ *                 one when length prefixed).
+ * \param[in] now The current epoch time in seconds, e.g. FLEX_TimeGet().
+ * \return 0 on success, or < 0 on failure.
+ * \retval -COALESCE_ERROR_QUEUE_FULL: the record didn't fit in the open
+ *         message, which the queue has no room for, and was refused
+ * \retval -COALESCE_ERROR_SCHEDULE_FAILURE: a message failed to schedule
+ * \retval -COALESCE_ERROR_INVALID_ARGUMENT: the record is empty or too large
+ */
+int MYRIOTA_CoalesceAppend(MYRIOTA_Coalescer *const coalescer, const void *const record,
+  const size_t size, const uint32_t now);
+
+/**
+ * Schedule the open message if it has reached `max_age_s`, e.g. from a job
+ * scheduled for the deadline when records may stop arriving.
+ *
+ * \param[in,out] coalescer The coalescer.
+ * \param[in] now The current epoch time in seconds.
+ * \return 0 on success, or < 0 on failure as MYRIOTA_CoalesceFlush().
+ */
+int MYRIOTA_CoalescePoll(MYRIOTA_Coalescer *const coalescer, const uint32_t now);
+
+/**
+ * Schedule the open message now. It stays open if the queue has no room.
+ *
+ * \param[in,out] coalescer The coalescer.
+ * \return 0 on success or with no open message, or < 0 on failure.
+ * \retval -COALESCE_ERROR_QUEUE_FULL: the queue has no room for the message
+ * \retval -COALESCE_ERROR_SCHEDULE_FAILURE: the message failed to schedule
+ */
+int MYRIOTA_CoalesceFlush(MYRIOTA_Coalescer *const coalescer);
+
+/**
+ * Schedule the open message and save the queue, in place of FLEX_MessageSave().
+ * The queue is saved even if the message can't be scheduled.
+ *
+ * \param[in,out] coalescer The coalescer.
+ * \return 0 on success, or < 0 on failure as MYRIOTA_CoalesceFlush().
+ */
+int MYRIOTA_CoalesceSave(MYRIOTA_Coalescer *const coalescer);
+
+/**
+ * The bytes a record can take in the open message without scheduling it.
+ *
+ * \param[in] coalescer The coalescer.
+ * \return the bytes free, less the length prefix if records are prefixed.
+ */
+size_t MYRIOTA_CoalesceBytesFree(const MYRIOTA_Coalescer *const coalescer);
+
+/** \} */
+
+#endif /* MYRIOTA_COALESCE_H */
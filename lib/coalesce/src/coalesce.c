@@ -0,0 +1,415 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "myriota/coalesce.h"
+#include <string.h>
+
+static inline size_t prefix_size(const MYRIOTA_Coalescer *const coalescer) {
+  return coalescer->options.length_prefixed ? 1 : 0;
+}
+
+// Whether a record of `size` bytes fits in the open message.
+static inline bool record_fits(const MYRIOTA_Coalescer *const coalescer, const size_t size) {
+  return coalescer->used + prefix_size(coalescer) + size <= coalescer->options.size;
+}
+
+static inline bool coalescer_expired(const MYRIOTA_Coalescer *const coalescer,
+  const uint32_t now) {
+  const uint32_t max_age_s = coalescer->options.max_age_s;
+  return coalescer->used > 0 && max_age_s > 0 && now - coalescer->opened >= max_age_s;
+}
+
+int MYRIOTA_CoalesceInit(MYRIOTA_Coalescer *const coalescer,
+  const MYRIOTA_CoalesceOptions *const options) {
+  if (coalescer == NULL || options == NULL || options->interface.schedule == NULL ||
+      options->buffer == NULL || options->size <= (options->length_prefixed ? 1 : 0) ||
+      (options->length_prefixed && options->size > UINT8_MAX + 1) ||
+      options->slots_reserved < 0) {
+    return -COALESCE_ERROR_INVALID_ARGUMENT;
+  }
+
+  memset(coalescer, 0, sizeof(*coalescer));
+  coalescer->options = *options;
+  return COALESCE_SUCCESS;
+}
+
+int MYRIOTA_CoalesceAppend(MYRIOTA_Coalescer *const coalescer, const void *const record,
+  const size_t size, const uint32_t now) {
+  if (record == NULL || size == 0 || size + prefix_size(coalescer) > coalescer->options.size) {
+    return -COALESCE_ERROR_INVALID_ARGUMENT;
+  }
+
+  if (!record_fits(coalescer, size)) {
+    const int result = MYRIOTA_CoalesceFlush(coalescer);
+    if (result != COALESCE_SUCCESS) {
+      ++coalescer->stats.refused;
+      return result;
+    }
+  }
+
+  if (coalescer->used == 0) {
+    coalescer->opened = now;
+  }
+  if (coalescer->options.length_prefixed) {
+    coalescer->options.buffer[coalescer->used++] = (uint8_t)size;
+  }
+  memcpy(&coalescer->options.buffer[coalescer->used], record, size);
+  coalescer->used += size;
+  ++coalescer->records;
+
+  // A message the queue has no room for yet stays open, and is retried by the
+  // next append, poll or flush.
+  if (!record_fits(coalescer, 1) || coalescer_expired(coalescer, now)) {
+    MYRIOTA_CoalesceFlush(coalescer);
+  }
+  return COALESCE_SUCCESS;
+}
+
+int MYRIOTA_CoalescePoll(MYRIOTA_Coalescer *const coalescer, const uint32_t now) {
+  return coalescer_expired(coalescer, now) ? MYRIOTA_CoalesceFlush(coalescer) : COALESCE_SUCCESS;
+}
+
+int MYRIOTA_CoalesceFlush(MYRIOTA_Coalescer *const coalescer) {
+  if (coalescer->used == 0) {
+    return COALESCE_SUCCESS;
+  }
+
+  const MYRIOTA_CoalesceInterface *const interface = &coalescer->options.interface;
+  if ((interface->slots_free != NULL &&
+        interface->slots_free() <= coalescer->options.slots_reserved) ||
+      (interface->bytes_free != NULL && interface->bytes_free() < coalescer->used)) {
+    return -COALESCE_ERROR_QUEUE_FULL;
+  }
+  if (interface->schedule(interface->ctx, coalescer->options.buffer, coalescer->used) < 0) {
+    return -COALESCE_ERROR_SCHEDULE_FAILURE;
+  }
+
+  ++coalescer->stats.messages;
+  coalescer->stats.records += coalescer->records;
+  coalescer->stats.bytes += coalescer->used;
+  coalescer->used = 0;
+  coalescer->records = 0;
+  return COALESCE_SUCCESS;
+}
+
+int MYRIOTA_CoalesceSave(MYRIOTA_Coalescer *const coalescer) {
+  const int result = MYRIOTA_CoalesceFlush(coalescer);
+  if (coalescer->options.interface.save != NULL) {
+    coalescer->options.interface.save();
+  }
+  return result;
+}
+
+size_t MYRIOTA_CoalesceBytesFree(const MYRIOTA_Coalescer *const coalescer) {
+  const size_t used = coalescer->used + prefix_size(coalescer);
+  return used < coalescer->options.size ? coalescer->options.size - used : 0;
+}
+
+#ifdef MYRIOTA_COALESCE_UNIT_TESTS
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+/*
+ * `cmocka.h` must be included after standard the above library headers.
+ * NOTE: This comment has dual purpose:
+ * 1. Document the ordering requirement.
+ * 2. Prevent `clang-format` from reordering the headers.
+ */
+#include <cmocka.h>
+
+#define TEST_MESSAGE_SIZE 20
+#define TEST_SLOTS 4
+#define TEST_TIME 1700000000
+
+// A message queue that replaces its oldest message when full, as
+// FLEX_MessageSchedule() replaces a queued message.
+static struct {
+  uint8_t messages[TEST_SLOTS][TEST_MESSAGE_SIZE];
+  size_t sizes[TEST_SLOTS];
+  size_t count;
+  size_t bytes_max;
+  uint32_t replaced;
+  uint32_t saves;
+  int result;
+} queue;
+
+static int queue_schedule(void *const ctx, const uint8_t *const message, const size_t size) {
+  assert_true(ctx == &queue);
+  if (queue.result < 0) {
+    return queue.result;
+  }
+  if (queue.count == TEST_SLOTS) {
+    ++queue.replaced;
+    memmove(queue.messages[0], queue.messages[1], sizeof(queue.messages[0]) * (TEST_SLOTS - 1));
+    memmove(&queue.sizes[0], &queue.sizes[1], sizeof(queue.sizes[0]) * (TEST_SLOTS - 1));
+    --queue.count;
+  }
+  memcpy(queue.messages[queue.count], message, size);
+  queue.sizes[queue.count++] = size;
+  return 0;
+}
+
+static int queue_slots_free(void) {
+  return TEST_SLOTS - queue.count;
+}
+
+static size_t queue_bytes_free(void) {
+  size_t used = 0;
+  for (size_t i = 0; i < queue.count; ++i) {
+    used += queue.sizes[i];
+  }
+  return used < queue.bytes_max ? queue.bytes_max - used : 0;
+}
+
+static void queue_save(void) {
+  ++queue.saves;
+}
+
+static uint8_t test_buffer[TEST_MESSAGE_SIZE];
+
+static void test_coalescer_init(MYRIOTA_Coalescer *const coalescer, const uint32_t max_age_s,
+  const bool length_prefixed) {
+  memset(&queue, 0, sizeof(queue));
+  queue.bytes_max = TEST_SLOTS * TEST_MESSAGE_SIZE;
+  const MYRIOTA_CoalesceOptions options = {
+    .interface = {&queue, queue_schedule, queue_slots_free, queue_bytes_free, queue_save},
+    .buffer = test_buffer,
+    .size = sizeof(test_buffer),
+    .max_age_s = max_age_s,
+    .length_prefixed = length_prefixed,
+  };
+  assert_int_equal(MYRIOTA_CoalesceInit(coalescer, &options), COALESCE_SUCCESS);
+}
+
+static void test_init_arguments(void **state) {
+  (void)state;
+  MYRIOTA_Coalescer coalescer;
+  MYRIOTA_CoalesceOptions options = {
+    .interface = {&queue, queue_schedule, queue_slots_free, queue_bytes_free, NULL},
+    .buffer = test_buffer,
+    .size = sizeof(test_buffer),
+  };
+  assert_int_equal(MYRIOTA_CoalesceInit(&coalescer, &options), COALESCE_SUCCESS);
+  assert_int_equal(MYRIOTA_CoalesceBytesFree(&coalescer), TEST_MESSAGE_SIZE);
+  assert_int_equal(MYRIOTA_CoalesceFlush(&coalescer), COALESCE_SUCCESS);
+
+  assert_int_equal(MYRIOTA_CoalesceInit(NULL, &options), -COALESCE_ERROR_INVALID_ARGUMENT);
+  options.interface.schedule = NULL;
+  assert_int_equal(MYRIOTA_CoalesceInit(&coalescer, &options), -COALESCE_ERROR_INVALID_ARGUMENT);
+  options.interface.schedule = queue_schedule;
+  options.size = 1;
+  options.length_prefixed = true;
+  assert_int_equal(MYRIOTA_CoalesceInit(&coalescer, &options), -COALESCE_ERROR_INVALID_ARGUMENT);
+  options.size = 300;
+  assert_int_equal(MYRIOTA_CoalesceInit(&coalescer, &options), -COALESCE_ERROR_INVALID_ARGUMENT);
+}
+
+static void test_fills_messages(void **state) {
+  (void)state;
+  MYRIOTA_Coalescer coalescer;
+  test_coalescer_init(&coalescer, 0, false);
+
+  // Records that don't fit are carried over to the next message.
+  const uint8_t record[6] = {1, 2, 3, 4, 5, 6};
+  for (size_t i = 0; i < 3; ++i) {
+    assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, record, sizeof(record), TEST_TIME),
+      COALESCE_SUCCESS);
+  }
+  assert_int_equal(queue.count, 0);
+  assert_int_equal(MYRIOTA_CoalesceBytesFree(&coalescer), 2);
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, record, sizeof(record), TEST_TIME),
+    COALESCE_SUCCESS);
+  assert_int_equal(queue.count, 1);
+  assert_int_equal(queue.sizes[0], 18);
+  assert_int_equal(coalescer.used, 6);
+
+  // A record that fills the message schedules it straight away.
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, record, sizeof(record), TEST_TIME),
+    COALESCE_SUCCESS);
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, record, sizeof(record), TEST_TIME),
+    COALESCE_SUCCESS);
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, record, 2, TEST_TIME), COALESCE_SUCCESS);
+  assert_int_equal(queue.count, 2);
+  assert_int_equal(queue.sizes[1], 20);
+  assert_int_equal(coalescer.used, 0);
+
+  assert_int_equal(coalescer.stats.messages, 2);
+  assert_int_equal(coalescer.stats.records, 7);
+  assert_int_equal(coalescer.stats.bytes, 38);
+
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, record, 0, TEST_TIME),
+    -COALESCE_ERROR_INVALID_ARGUMENT);
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, test_buffer, TEST_MESSAGE_SIZE + 1,
+                     TEST_TIME),
+    -COALESCE_ERROR_INVALID_ARGUMENT);
+}
+
+static void test_length_prefixed(void **state) {
+  (void)state;
+  MYRIOTA_Coalescer coalescer;
+  test_coalescer_init(&coalescer, 0, true);
+
+  const uint8_t first[] = {0xa1, 0xa2};
+  const uint8_t second[] = {0xb1, 0xb2, 0xb3};
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, first, sizeof(first), TEST_TIME),
+    COALESCE_SUCCESS);
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, second, sizeof(second), TEST_TIME),
+    COALESCE_SUCCESS);
+  assert_int_equal(MYRIOTA_CoalesceBytesFree(&coalescer), 12);
+  assert_int_equal(MYRIOTA_CoalesceFlush(&coalescer), COALESCE_SUCCESS);
+  const uint8_t expected[] = {2, 0xa1, 0xa2, 3, 0xb1, 0xb2, 0xb3};
+  assert_int_equal(queue.sizes[0], sizeof(expected));
+  assert_memory_equal(queue.messages[0], expected, sizeof(expected));
+
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, test_buffer, TEST_MESSAGE_SIZE, TEST_TIME),
+    -COALESCE_ERROR_INVALID_ARGUMENT);
+}
+
+static void test_max_age(void **state) {
+  (void)state;
+  MYRIOTA_Coalescer coalescer;
+  test_coalescer_init(&coalescer, 3600, false);
+
+  const uint8_t record[4] = {0};
+  assert_int_equal(MYRIOTA_CoalescePoll(&coalescer, TEST_TIME), COALESCE_SUCCESS);
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, record, sizeof(record), TEST_TIME),
+    COALESCE_SUCCESS);
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, record, sizeof(record), TEST_TIME + 1800),
+    COALESCE_SUCCESS);
+  assert_int_equal(MYRIOTA_CoalescePoll(&coalescer, TEST_TIME + 3599), COALESCE_SUCCESS);
+  assert_int_equal(queue.count, 0);
+  assert_int_equal(MYRIOTA_CoalescePoll(&coalescer, TEST_TIME + 3600), COALESCE_SUCCESS);
+  assert_int_equal(queue.count, 1);
+  assert_int_equal(queue.sizes[0], 8);
+
+  // The age is from the first record of the open message.
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, record, sizeof(record), TEST_TIME + 5000),
+    COALESCE_SUCCESS);
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, record, sizeof(record), TEST_TIME + 8600),
+    COALESCE_SUCCESS);
+  assert_int_equal(queue.count, 2);
+  assert_int_equal(queue.sizes[1], 8);
+}
+
+static void test_never_replaces(void **state) {
+  (void)state;
+  MYRIOTA_Coalescer coalescer;
+  test_coalescer_init(&coalescer, 0, false);
+  coalescer.options.slots_reserved = 1;
+
+  // Fill the queue but the reserved slot, then the open message.
+  const uint8_t record[10] = {0};
+  for (size_t i = 0; i < 8; ++i) {
+    assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, record, sizeof(record), TEST_TIME),
+      COALESCE_SUCCESS);
+  }
+  assert_int_equal(queue.count, TEST_SLOTS - 1);
+  assert_int_equal(coalescer.used, 20);
+
+  // Records that need the open message scheduled are refused while it can't be.
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, record, sizeof(record), TEST_TIME),
+    -COALESCE_ERROR_QUEUE_FULL);
+  assert_int_equal(MYRIOTA_CoalesceFlush(&coalescer), -COALESCE_ERROR_QUEUE_FULL);
+  assert_int_equal(coalescer.stats.refused, 1);
+  assert_int_equal(queue.replaced, 0);
+
+  // Once a slot frees up, the open message takes it.
+  --queue.count;
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, record, sizeof(record), TEST_TIME),
+    COALESCE_SUCCESS);
+  assert_int_equal(queue.count, TEST_SLOTS - 1);
+  assert_int_equal(coalescer.used, 10);
+
+  // The queue's free bytes are respected as well as its slots.
+  --queue.count;
+  queue.bytes_max = 45;
+  assert_int_equal(MYRIOTA_CoalesceFlush(&coalescer), -COALESCE_ERROR_QUEUE_FULL);
+  queue.bytes_max = 50;
+  assert_int_equal(MYRIOTA_CoalesceFlush(&coalescer), COALESCE_SUCCESS);
+  assert_int_equal(queue.replaced, 0);
+
+  // A failed schedule leaves the message open.
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, record, sizeof(record), TEST_TIME),
+    COALESCE_SUCCESS);
+  --queue.count;
+  queue.bytes_max = TEST_SLOTS * TEST_MESSAGE_SIZE;
+  queue.result = -1;
+  assert_int_equal(MYRIOTA_CoalesceFlush(&coalescer), -COALESCE_ERROR_SCHEDULE_FAILURE);
+  assert_int_equal(coalescer.used, 10);
+}
+
+static void test_unchecked_queue(void **state) {
+  (void)state;
+  MYRIOTA_Coalescer coalescer;
+  test_coalescer_init(&coalescer, 0, false);
+  coalescer.options.interface.slots_free = NULL;
+  coalescer.options.interface.bytes_free = NULL;
+  coalescer.options.slots_reserved = TEST_SLOTS;
+
+  // Without the queue's room to check, messages are left to the schedule
+  // function, e.g. one that evicts to make room.
+  const uint8_t record[10] = {0};
+  for (size_t i = 0; i < 2 * (TEST_SLOTS + 1); ++i) {
+    assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, record, sizeof(record), TEST_TIME),
+      COALESCE_SUCCESS);
+  }
+  assert_int_equal(coalescer.stats.messages, TEST_SLOTS + 1);
+  assert_int_equal(queue.replaced, 1);
+
+  // A message it refuses stays open.
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, record, sizeof(record), TEST_TIME),
+    COALESCE_SUCCESS);
+  queue.result = -1;
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, record, sizeof(record), TEST_TIME),
+    COALESCE_SUCCESS);
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, record, sizeof(record), TEST_TIME),
+    -COALESCE_ERROR_SCHEDULE_FAILURE);
+  assert_int_equal(coalescer.used, 20);
+  assert_int_equal(coalescer.stats.refused, 1);
+}
+
+static void test_save(void **state) {
+  (void)state;
+  MYRIOTA_Coalescer coalescer;
+  test_coalescer_init(&coalescer, 0, false);
+
+  const uint8_t record[4] = {0};
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, record, sizeof(record), TEST_TIME),
+    COALESCE_SUCCESS);
+  assert_int_equal(MYRIOTA_CoalesceSave(&coalescer), COALESCE_SUCCESS);
+  assert_int_equal(queue.count, 1);
+  assert_int_equal(queue.saves, 1);
+
+  // The queue is saved even when the open message can't be scheduled.
+  assert_int_equal(MYRIOTA_CoalesceAppend(&coalescer, record, sizeof(record), TEST_TIME),
+    COALESCE_SUCCESS);
+  queue.bytes_max = 4;
+  assert_int_equal(MYRIOTA_CoalesceSave(&coalescer), -COALESCE_ERROR_QUEUE_FULL);
+  assert_int_equal(queue.saves, 2);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_init_arguments),
+    cmocka_unit_test(test_fills_messages),
+    cmocka_unit_test(test_length_prefixed),
+    cmocka_unit_test(test_max_age),
+    cmocka_unit_test(test_never_replaces),
+    cmocka_unit_test(test_unchecked_queue),
+    cmocka_unit_test(test_save),
+  };
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
+#endif /** MYRIOTA_COALESCE_UNIT_TESTS */
@@ -0,0 +1,84 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Host benchmark of the Modbus CRC16 engines. Reports the throughput of each
+// engine along with the flash its lookup tables cost, so the engine can be
+// picked with `-Dmodbus_crc=<engine>` to suit each firmware image.
+//
+// NOTE: Throughput is measured on the host, use it to compare the engines
+// relative to each other rather than as an absolute figure for the device.
+
+#include <stdio.h>
+#include <time.h>
+
+#include "modbus_crc16.h"
+
+#define BENCHMARK_FRAME_SIZE 256
+#define BENCHMARK_ITERATIONS 200000
+
+typedef uint16_t (*crc16_update_fn)(uint16_t crc, const uint8_t *const buffer, const size_t size);
+
+struct crc16_engine {
+  const char *name;
+  crc16_update_fn update;
+  size_t rom_bytes;
+};
+
+static double elapsed_seconds(const struct timespec *const start,
+  const struct timespec *const end) {
+  return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main(void) {
+  const struct crc16_engine engines[] = {
+    {"nibble", modbus_crc16_update_nibble, sizeof(modbus_crc16_nibble_table)},
+    {"byte", modbus_crc16_update_byte, sizeof(modbus_crc16_byte_table)},
+    {"slice4", modbus_crc16_update_slice4,
+      sizeof(modbus_crc16_byte_table) + sizeof(modbus_crc16_slice4_table)},
+  };
+
+  uint8_t frame[BENCHMARK_FRAME_SIZE];
+  for (size_t i = 0; i < sizeof(frame); ++i) {
+    frame[i] = (uint8_t)(i * 31 + 7);
+  }
+
+  // CRC-16/MODBUS check value, see https://reveng.sourceforge.io/crc-catalogue/16.htm
+  const uint8_t check[] = "123456789";
+  const uint16_t check_crc16 = 0x4B37;
+
+  int result = 0;
+  printf("%-8s %12s %14s\n", "engine", "rom (bytes)", "bytes/s");
+  for (size_t i = 0; i < sizeof(engines) / sizeof(*engines); ++i) {
+    const struct crc16_engine *const engine = &engines[i];
+    if (engine->update(MODBUS_CRC16_INIT, check, sizeof(check) - 1) != check_crc16) {
+      printf("%-8s FAILED check value\n", engine->name);
+      result = 1;
+      continue;
+    }
+
+    volatile uint16_t sink = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t j = 0; j < BENCHMARK_ITERATIONS; ++j) {
+      sink ^= engine->update(MODBUS_CRC16_INIT, frame, sizeof(frame));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    (void)sink;
+
+    const double seconds = elapsed_seconds(&start, &end);
+    const double bytes_per_second = (double)BENCHMARK_ITERATIONS * sizeof(frame) / seconds;
+    printf("%-8s %12zu %14.0f\n", engine->name, engine->rom_bytes, bytes_per_second);
+  }
+
+  return result;
+}
@@ -0,0 +1,97 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Host benchmark of the Modbus frame codec. Encodes frames for the wire and
+// decodes them again through the same codec in each framing mode, reporting
+// the frames per second and the bytes each frame takes on the wire.
+//
+// NOTE: Throughput is measured on the host, use it to compare the framing
+// modes relative to each other rather than as an absolute figure for the device.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "modbus_frame.h"
+
+#define BENCHMARK_ITERATIONS 200000
+#define BENCHMARK_BUFFER_SIZE 512
+
+struct mode {
+  const char *name;
+  MYRIOTA_ModbusFramingMode framing_mode;
+};
+
+static double elapsed_seconds(const struct timespec *const start,
+  const struct timespec *const end) {
+  return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main(void) {
+  const struct mode modes[] = {
+    {"rtu", MODBUS_FRAMING_MODE_RTU},
+    {"ascii", MODBUS_FRAMING_MODE_ASCII},
+  };
+  // The address and PDU of a read request and of a read response of 125 registers.
+  const size_t frame_sizes[] = {6, 253};
+
+  uint8_t frame[BENCHMARK_BUFFER_SIZE];
+  for (size_t i = 0; i < sizeof(frame); ++i) {
+    frame[i] = (uint8_t)(i * 31 + 7);
+  }
+
+  static uint8_t buffer[BENCHMARK_BUFFER_SIZE];
+  int result = 0;
+  printf("%-6s %6s %12s %12s %14s\n", "mode", "bytes", "wire bytes", "frames/s", "cpu (ns/frame)");
+  for (size_t i = 0; i < sizeof(modes) / sizeof(*modes); ++i) {
+    for (size_t j = 0; j < sizeof(frame_sizes) / sizeof(*frame_sizes); ++j) {
+      const size_t size = frame_sizes[j];
+      struct application_data_uint adu = {
+        .capacity = modbus_frame_capacity(modes[i].framing_mode, sizeof(buffer)),
+        .framing_mode = modes[i].framing_mode,
+        .buffer = buffer,
+      };
+
+      size_t wire_size = 0;
+      struct timespec start, end;
+      clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+      for (size_t k = 0; k < BENCHMARK_ITERATIONS; ++k) {
+        // Packing accumulates the crc16 as the frame is written.
+        memcpy(buffer, frame, size);
+        adu.size = size;
+        adu.crc16 = modbus_crc16_update(MODBUS_CRC16_INIT, buffer, size);
+        modbus_frame_encode(&adu);
+        wire_size = adu.size;
+
+        // Receiving accumulates the crc16 as the frame arrives.
+        adu.size = 0;
+        adu.crc16 = MODBUS_CRC16_INIT;
+        modbus_frame_received(&adu, buffer, wire_size);
+        result |= modbus_frame_decode(&adu) != 0 || adu.crc16 != 0;
+      }
+      clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+
+      if (result != 0 || memcmp(buffer, frame, size) != 0) {
+        printf("%-6s %6zu FAILED\n", modes[i].name, size);
+        result = 1;
+        continue;
+      }
+
+      const double seconds = elapsed_seconds(&start, &end);
+      printf("%-6s %6zu %12zu %12.0f %14.1f\n", modes[i].name, size, wire_size,
+        BENCHMARK_ITERATIONS / seconds, seconds * 1e9 / BENCHMARK_ITERATIONS);
+    }
+  }
+
+  return result;
+}
@@ -0,0 +1,169 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Host benchmark of the Modbus server. A simulated master feeds requests to the
+// server through its serial interface and checks each response. Reports the CPU
+// time from the last byte of a request to the response being written, next to
+// the inter-frame delay at the simulated baud rate, the budget a master allows
+// before a slave's silence is taken as the end of its turn.
+//
+// NOTE: CPU time is measured on the host, use it to compare changes to the
+// library rather than as an absolute figure for the device.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "modbus_crc16.h"
+#include "myriota/modbus.h"
+#include "myriota/modbus_bits.h"
+#include "myriota/modbus_server.h"
+
+#define BENCHMARK_ITERATIONS 200000
+#define BENCHMARK_BAUD_RATE 9600
+#define BENCHMARK_SERVER_ADDRESS 0x01
+
+static uint16_t holding_registers[256];
+static uint16_t input_registers[256];
+static uint32_t coils[MODBUS_BITSET_WORDS(2000)];
+
+// The simulated master, which presents a request to the server's serial
+// interface and collects the response.
+struct master {
+  uint8_t request[256];
+  size_t request_size;
+  size_t request_offset;
+  uint8_t response[256];
+  size_t response_size;
+};
+
+static struct master master;
+
+static int master_init(void *const ctx) {
+  (void)ctx;
+  return 0;
+}
+
+static void master_deinit(void *const ctx) {
+  (void)ctx;
+}
+
+static ssize_t master_read(void *const ctx, uint8_t *const buffer, const size_t count) {
+  struct master *const m = ctx;
+  const size_t available = m->request_size - m->request_offset;
+  const size_t nbytes = (count < available) ? count : available;
+  memcpy(buffer, &m->request[m->request_offset], nbytes);
+  m->request_offset += nbytes;
+  return nbytes;
+}
+
+static ssize_t master_write(void *const ctx, const uint8_t *const buffer, const size_t count) {
+  struct master *const m = ctx;
+  memcpy(&m->response[m->response_size], buffer, count);
+  m->response_size += count;
+  return count;
+}
+
+static void master_request(const uint8_t *const pdu, const size_t size) {
+  master.request[0] = BENCHMARK_SERVER_ADDRESS;
+  memcpy(&master.request[1], pdu, size);
+  const uint16_t crc16 = modbus_crc16_update(MODBUS_CRC16_INIT, master.request, size + 1);
+  master.request[size + 1] = (uint8_t)crc16;
+  master.request[size + 2] = (uint8_t)(crc16 >> 8);
+  master.request_size = size + 3;
+}
+
+struct request {
+  const char *name;
+  uint8_t pdu[32];
+  size_t size;
+};
+
+static double elapsed_seconds(const struct timespec *const start,
+  const struct timespec *const end) {
+  return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main(void) {
+  const MYRIOTA_ModbusServerRegion regions[] = {
+    {.table = MODBUS_READ_HOLDING_REGISTERS, .addr = 0x0000, .count = 256,
+      .registers = holding_registers},
+    {.table = MODBUS_READ_INPUT_REGISTERS, .addr = 0x0000, .count = 256,
+      .registers = input_registers},
+    {.table = MODBUS_READ_COILS, .addr = 0x0000, .count = 2000, .bits = coils},
+  };
+  const MYRIOTA_ModbusServer server = {
+    .address = BENCHMARK_SERVER_ADDRESS,
+    .regions = regions,
+    .regions_count = sizeof(regions) / sizeof(*regions),
+  };
+
+  const MYRIOTA_ModbusInitOptions options = {
+    .framing_mode = MODBUS_FRAMING_MODE_RTU,
+    .serial_interface =
+      {
+        .ctx = &master,
+        .init = master_init,
+        .deinit = master_deinit,
+        .read = master_read,
+        .write = master_write,
+      },
+  };
+  const MYRIOTA_ModbusHandle handle = MYRIOTA_ModbusInit(options);
+  if (MYRIOTA_ModbusEnable(handle) != MODBUS_SUCCESS) {
+    printf("Failed to enable Modbus\n");
+    return 1;
+  }
+
+  const struct request requests[] = {
+    {"read 2 registers", {0x03, 0x00, 0x00, 0x00, 0x02}, 5},
+    {"read 125 registers", {0x04, 0x00, 0x00, 0x00, 0x7D}, 5},
+    {"read 256 coils", {0x01, 0x00, 0x03, 0x01, 0x00}, 5},
+    {"write 1 register", {0x06, 0x00, 0x10, 0x12, 0x34}, 5},
+    {"write 8 registers", {0x10, 0x00, 0x10, 0x00, 0x08, 0x10}, 22},
+    {"illegal address", {0x03, 0x01, 0x00, 0x00, 0x01}, 5},
+  };
+
+  int result = 0;
+  printf("inter-frame delay at %d baud: %u us\n", BENCHMARK_BAUD_RATE,
+    (unsigned)MYRIOTA_ModbusInterFrameDelayUs(BENCHMARK_BAUD_RATE));
+  printf("%-20s %14s %14s\n", "request", "requests/s", "cpu (ns/req)");
+  for (size_t i = 0; i < sizeof(requests) / sizeof(*requests); ++i) {
+    const struct request *const request = &requests[i];
+    master_request(request->pdu, request->size);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+    for (size_t j = 0; j < BENCHMARK_ITERATIONS; ++j) {
+      master.request_offset = 0;
+      master.response_size = 0;
+      MYRIOTA_ModbusServe(handle, &server);
+    }
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+
+    // Every response must be a complete frame.
+    if (master.response_size == 0 ||
+        modbus_crc16_update(MODBUS_CRC16_INIT, master.response, master.response_size) != 0) {
+      printf("%-20s FAILED\n", request->name);
+      result = 1;
+      continue;
+    }
+
+    const double seconds = elapsed_seconds(&start, &end);
+    printf("%-20s %14.0f %14.1f\n", request->name, BENCHMARK_ITERATIONS / seconds,
+      seconds * 1e9 / BENCHMARK_ITERATIONS);
+  }
+
+  MYRIOTA_ModbusDeinit(handle);
+  return result;
+}
@@ -0,0 +1,126 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Host benchmark of complete Modbus transactions against the simulated slave.
+// Reports the transactions per second the library can process and the CPU time
+// each call spends in the library and the simulator, along with the time the
+// transaction would take on the bus at the simulated baud rate.
+//
+// NOTE: CPU time is measured on the host, use it to compare changes to the
+// library rather than as an absolute figure for the device.
+
+#include <stdio.h>
+#include <time.h>
+
+#include "modbus_sim.h"
+#include "myriota/modbus.h"
+
+#define BENCHMARK_ITERATIONS 100000
+#define BENCHMARK_BAUD_RATE 9600
+
+static bool coils[2000];
+static uint16_t holding_registers[256];
+static uint16_t input_registers[256];
+
+static uint8_t bytes[256];
+
+typedef int (*transaction_fn)(const MYRIOTA_ModbusHandle handle);
+
+struct transaction {
+  const char *name;
+  transaction_fn run;
+};
+
+static int read_2_registers(const MYRIOTA_ModbusHandle handle) {
+  return MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0x0000, 2, bytes);
+}
+
+static int read_125_registers(const MYRIOTA_ModbusHandle handle) {
+  return MYRIOTA_ModbusReadInputRegisters(handle, 0x01, 0x0000, 125, bytes);
+}
+
+static int read_256_coils(const MYRIOTA_ModbusHandle handle) {
+  return MYRIOTA_ModbusReadCoils(handle, 0x01, 0x0000, 256, bytes);
+}
+
+static int write_16_registers(const MYRIOTA_ModbusHandle handle) {
+  return MYRIOTA_ModbusWriteHoldingRegisters(handle, 0x01, 0x0010, 16, bytes);
+}
+
+static double elapsed_seconds(const struct timespec *const start,
+  const struct timespec *const end) {
+  return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main(void) {
+  const struct modbus_sim_config config = {
+    .address = 0x01,
+    .baud_rate = BENCHMARK_BAUD_RATE,
+    .response_latency_us = 5000,
+    .response_timeout_us = 1000000,
+    .coils = coils,
+    .coils_count = sizeof(coils) / sizeof(*coils),
+    .holding_registers = holding_registers,
+    .holding_registers_count = sizeof(holding_registers) / sizeof(*holding_registers),
+    .input_registers = input_registers,
+    .input_registers_count = sizeof(input_registers) / sizeof(*input_registers),
+  };
+  struct modbus_sim sim;
+  modbus_sim_init(&sim, &config);
+
+  const MYRIOTA_ModbusInitOptions options = {
+    .framing_mode = MODBUS_FRAMING_MODE_RTU,
+    .serial_interface = modbus_sim_serial_interface(&sim),
+    .response_timeout_ms = 1000,
+  };
+  const MYRIOTA_ModbusHandle handle = MYRIOTA_ModbusInit(options);
+  if (MYRIOTA_ModbusEnable(handle) != MODBUS_SUCCESS) {
+    printf("Failed to enable Modbus\n");
+    return 1;
+  }
+
+  const struct transaction transactions[] = {
+    {"read 2 registers", read_2_registers},
+    {"read 125 registers", read_125_registers},
+    {"read 256 coils", read_256_coils},
+    {"write 16 registers", write_16_registers},
+  };
+
+  int result = 0;
+  printf("%-20s %14s %14s %14s\n", "transaction", "transactions/s", "cpu (ns/call)",
+    "bus (us/call)");
+  for (size_t i = 0; i < sizeof(transactions) / sizeof(*transactions); ++i) {
+    const struct transaction *const transaction = &transactions[i];
+    if (transaction->run(handle) != MODBUS_SUCCESS) {
+      printf("%-20s FAILED\n", transaction->name);
+      result = 1;
+      continue;
+    }
+
+    const uint64_t bus_start_us = sim.now_us;
+    struct timespec start, end;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+    for (size_t j = 0; j < BENCHMARK_ITERATIONS; ++j) {
+      result |= (transaction->run(handle) != MODBUS_SUCCESS);
+    }
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+
+    const double seconds = elapsed_seconds(&start, &end);
+    const double bus_us = (double)(sim.now_us - bus_start_us) / BENCHMARK_ITERATIONS;
+    printf("%-20s %14.0f %14.1f %14.0f\n", transaction->name, BENCHMARK_ITERATIONS / seconds,
+      seconds * 1e9 / BENCHMARK_ITERATIONS, bus_us);
+  }
+
+  MYRIOTA_ModbusDeinit(handle);
+  return result;
+}
@@ -45,6 +45,7 @@ typedef enum {
   MODBUS_ERROR_IO_FAILURE,
   MODBUS_ERROR_BAD_STATE,
   MODBUS_ERROR_OVERFLOW,
+  MODBUS_ERROR_INVALID_ARGUMENT,
 } MYRIOTA_ModbusErrors;
 
 /** Modbus driver instance handle type. */
@@ -53,9 +54,58 @@ typedef uint8_t MYRIOTA_ModbusHandle;
 /** Modbus device address type. */
 typedef uint8_t MYRIOTA_ModbusDeviceAddress;
 
+/**
+ * The device address of write requests broadcast to every slave. Slaves don't
+ * respond to broadcasts, so broadcast writes succeed once the request has been
+ * sent and the slaves given the turnaround delay to process it. Reads can't be
+ * broadcast.
+ */
+#define MODBUS_BROADCAST_ADDRESS 0
+
+/** The default time given to slaves to process a broadcast request in milliseconds. */
+#define MODBUS_BROADCAST_TURNAROUND_MS_DEFAULT 100
+
 /** Modbus data (i.e. coils/registers) address type. */
 typedef uint16_t MYRIOTA_ModbusDataAddress;
 
+/** Modbus read function codes, one for each of the Modbus data tables. */
+typedef enum {
+  /** Read coils (0x01) */
+  MODBUS_READ_COILS = 0x01,
+  /** Read discrete inputs (0x02) */
+  MODBUS_READ_DISCRETE_INPUTS = 0x02,
+  /** Read holding registers (0x03) */
+  MODBUS_READ_HOLDING_REGISTERS = 0x03,
+  /** Read input registers (0x04) */
+  MODBUS_READ_INPUT_REGISTERS = 0x04,
+} MYRIOTA_ModbusReadFunction;
+
+/** Modbus write function codes usable with MYRIOTA_ModbusBeginWrite(). */
+typedef enum {
+  /** Write single coil (0x05) */
+  MODBUS_WRITE_SINGLE_COIL = 0x05,
+  /** Write single register (0x06) */
+  MODBUS_WRITE_SINGLE_REGISTER = 0x06,
+  /** Write multiple coils (0x0F) */
+  MODBUS_WRITE_MULTIPLE_COILS = 0x0F,
+  /** Write multiple registers (0x10) */
+  MODBUS_WRITE_MULTIPLE_REGISTERS = 0x10,
+} MYRIOTA_ModbusWriteFunction;
+
+/** State of an asynchronous Modbus transaction. */
+typedef enum {
+  /** No transaction has been started. */
+  MODBUS_TRANSACTION_IDLE,
+  /** The request is being written to the serial interface. */
+  MODBUS_TRANSACTION_TRANSMITTING,
+  /** The request has been sent and the response is being received. */
+  MODBUS_TRANSACTION_AWAITING,
+  /** The transaction succeeded, collect the result with MYRIOTA_ModbusComplete(). */
+  MODBUS_TRANSACTION_DONE,
+  /** The transaction failed, collect the error with MYRIOTA_ModbusComplete(). */
+  MODBUS_TRANSACTION_ERROR,
+} MYRIOTA_ModbusTransactionState;
+
 /**
  * Initialization function for the serial interface used by Modbus driver.
  *
@@ -75,14 +125,36 @@ typedef void (*MYRIOTA_ModbusSerialInterfaceDeinitFn_t)(void *const ctx);
 /**
  * Read function for the serial interface used by Modbus driver.
  *
+ * The driver requests the number of bytes it expects the response frame to
+ * contain. The read should return as soon as `count` bytes have been read, or
+ * once the line has been idle for the inter-frame delay (see
+ * MYRIOTA_ModbusInterFrameDelayUs()) after at least one byte was read, or when
+ * no byte arrives before the response timeout.
+ *
  * \param[in,out] ctx The user defined data context used by the serial interface.
  * \param[out] buffer The buffer for filling with bytes read by the serial device.
- * \param[in] count The total size of the buffer in bytes.
- * \return the number of bytes read on success, else < 0 on error.
+ * \param[in] count The number of bytes expected, which is never more than the
+ * size of the buffer.
+ * \return the number of bytes read on success (0 on timeout), else < 0 on error.
  */
 typedef ssize_t (*MYRIOTA_ModbusSerialInterfaceReadFn_t)(void *const ctx, uint8_t *const buffer,
   const size_t count);
 
+/**
+ * Non-blocking read function for the serial interface used by Modbus driver.
+ *
+ * Unlike the read function this must return immediately with the bytes that
+ * are already available, which may be none. It is only used by the
+ * asynchronous API (see MYRIOTA_ModbusPoll()).
+ *
+ * \param[in,out] ctx The user defined data context used by the serial interface.
+ * \param[out] buffer The buffer for filling with bytes read by the serial device.
+ * \param[in] count The maximum number of bytes to read.
+ * \return the number of bytes read on success (0 if none are available), else < 0 on error.
+ */
+typedef ssize_t (*MYRIOTA_ModbusSerialInterfacePollFn_t)(void *const ctx, uint8_t *const buffer,
+  const size_t count);
+
 /**
  * Write function for the serial interface used by Modbus driver.
  *
@@ -94,6 +166,16 @@ typedef ssize_t (*MYRIOTA_ModbusSerialInterfaceReadFn_t)(void *const ctx, uint8_
 typedef ssize_t (*MYRIOTA_ModbusSerialInterfaceWriteFn_t)(void *const ctx,
   const uint8_t *const buffer, const size_t count);
 
+/**
+ * Function that sets the time the serial interface's read function waits for
+ * the first byte of a response, used by adaptive timeouts.
+ *
+ * \param[in,out] ctx The user defined data context used by the serial interface.
+ * \param[in] timeout_ms The response timeout in milliseconds.
+ */
+typedef void (*MYRIOTA_ModbusSerialInterfaceSetTimeoutFn_t)(void *const ctx,
+  const uint32_t timeout_ms);
+
 /** Interface for the serial device used by the Modbus driver. */
 typedef struct {
   /** User defined data context to be used by the serial interfaces functions. */
@@ -106,16 +188,94 @@ typedef struct {
   MYRIOTA_ModbusSerialInterfaceReadFn_t read;
   /** Serial device write function. */
   MYRIOTA_ModbusSerialInterfaceWriteFn_t write;
+  /** Optional serial device non-blocking read function. */
+  MYRIOTA_ModbusSerialInterfacePollFn_t poll;
+  /** Optional serial device read timeout function. */
+  MYRIOTA_ModbusSerialInterfaceSetTimeoutFn_t set_timeout;
 } MYRIOTA_ModbusSerialInterface;
 
 /**
- * The framing mode to be used by the Modbus driver.
- * \note Only RTU framing is supported at the moment, but ASCII framing will be
- * added in the future.
+ * Millisecond tick source used by the Modbus driver, e.g. FLEX_TickGet().
+ *
+ * \return a free running millisecond counter that may wrap around.
+ */
+typedef uint32_t (*MYRIOTA_ModbusTickGetFn_t)(void);
+
+/**
+ * Millisecond delay used by the Modbus driver, e.g. FLEX_DelayMs().
+ *
+ * \param[in] ms The time to delay for in milliseconds.
+ */
+typedef void (*MYRIOTA_ModbusDelayFn_t)(const uint32_t ms);
+
+/** Maximum age of a cache entry that is read once and kept until invalidated. */
+#define MODBUS_CACHE_MAX_AGE_FOREVER UINT32_MAX
+
+/**
+ * A range of holding/input registers kept by the driver's register cache.
+ *
+ * Reads that fall entirely within a fresh entry are answered from the entry
+ * without a transaction on the bus. A read that misses refreshes the whole
+ * entry, and writes to holding registers overlapping an entry invalidate it.
+ */
+typedef struct {
+  /** The address of the slave device holding the registers. */
+  MYRIOTA_ModbusDeviceAddress slave;
+  /** MODBUS_READ_HOLDING_REGISTERS or MODBUS_READ_INPUT_REGISTERS. */
+  MYRIOTA_ModbusReadFunction function;
+  /** The address of the first register. */
+  MYRIOTA_ModbusDataAddress addr;
+  /** The number of registers, at most 125. */
+  uint16_t count;
+  /** The age in milliseconds at which the entry is read again, or MODBUS_CACHE_MAX_AGE_FOREVER. */
+  uint32_t max_age_ms;
+  /** Storage for the registers as packed in a Modbus response, `count * 2` bytes. */
+  uint8_t *bytes;
+  /** Whether bytes holds the registers, managed by the driver. */
+  bool valid;
+  /** The tick at which the registers were read, managed by the driver. */
+  uint32_t read_tick;
+} MYRIOTA_ModbusCacheEntry;
+
+/** The default lower bound of adaptive response timeouts in milliseconds. */
+#define MODBUS_ADAPTIVE_TIMEOUT_MIN_MS_DEFAULT 20
+
+/** The bit of an error in MYRIOTA_ModbusRetryPolicy::retry_on. */
+#define MODBUS_RETRY_ON(error) (1UL << (error))
+
+/**
+ * The errors retried by default, those caused by noise on the line, a slave
+ * that didn't respond or a busy slave. Errors in the request, such as illegal
+ * address exceptions, are not retried.
  */
+#define MODBUS_RETRY_ON_DEFAULT                                       \
+  (MODBUS_RETRY_ON(MODBUS_ERROR_INVALID_CRC16) |                      \
+    MODBUS_RETRY_ON(MODBUS_ERROR_MALFORMED_RESPONSE) |                \
+    MODBUS_RETRY_ON(MODBUS_ERROR_RESPONSE_FROM_WRONG_SLAVE_ADDRESS) | \
+    MODBUS_RETRY_ON(MODBUS_ERROR_IO_FAILURE) |                        \
+    MODBUS_RETRY_ON(MODBUS_ERROR_EXCEPTION_ACKNOWLEDGE) |             \
+    MODBUS_RETRY_ON(MODBUS_ERROR_EXCEPTION_SLAVE_DEVICE_BUSY))
+
+/** How the blocking read/write functions retry failed transactions. */
+typedef struct {
+  /** The number of times a failed transaction is retried, 0 never. */
+  uint8_t max_retries;
+  /** The MODBUS_RETRY_ON() bits of the errors to retry, 0 for MODBUS_RETRY_ON_DEFAULT. */
+  uint32_t retry_on;
+  /** The delay before the first retry in milliseconds, doubled for each retry after it. */
+  uint32_t backoff_ms;
+} MYRIOTA_ModbusRetryPolicy;
+
+/** The framing mode to be used by the Modbus driver. */
 typedef enum {
   /** RTU (Remote Transmission Unit) Framing */
   MODBUS_FRAMING_MODE_RTU,
+  /**
+   * ASCII Framing, where each byte is sent as two hex digits between ':' and
+   * CR LF and checked by an LRC. Frames take twice the buffer space of RTU
+   * frames, see MYRIOTA_ModbusInitOptions::adu_buffer.
+   */
+  MODBUS_FRAMING_MODE_ASCII,
 } MYRIOTA_ModbusFramingMode;
 
 /** Initialization options for Modbus driver */
@@ -124,8 +284,65 @@ typedef struct {
   MYRIOTA_ModbusFramingMode framing_mode;
   /** The Modbus driver's serial interface */
   MYRIOTA_ModbusSerialInterface serial_interface;
+  /** Millisecond tick source, required when the serial interface has a poll function. */
+  MYRIOTA_ModbusTickGetFn_t tick_get;
+  /**
+   * Time to wait for the first byte of an asynchronous response in
+   * milliseconds. Required, i.e. non-zero, when the serial interface has a poll
+   * function.
+   */
+  uint32_t response_timeout_ms;
+  /** Line idle time that ends an asynchronous response frame in milliseconds. */
+  uint32_t frame_idle_ms;
+  /**
+   * Optional storage for the instance's request/response buffers, used instead
+   * of the driver's built-in buffers. In the split buffer mode it is divided
+   * evenly between the request and the response. A response buffer smaller
+   * than 256 bytes limits the number of coils/registers per transaction, as
+   * does ASCII framing, where a buffer holds a frame of half its size.
+   */
+  uint8_t *adu_buffer;
+  /** The size of adu_buffer in bytes, at least 16 per buffer (33 with ASCII framing). */
+  size_t adu_buffer_size;
+  /**
+   * Optional register cache entries, which must remain valid until the driver
+   * is de-initialized. Requires tick_get.
+   */
+  MYRIOTA_ModbusCacheEntry *cache;
+  /** The number of cache entries. */
+  size_t cache_count;
+  /**
+   * Optional delay used to wait out the turnaround of broadcast writes, which
+   * otherwise return as soon as the request has been sent.
+   */
+  MYRIOTA_ModbusDelayFn_t delay_ms;
+  /**
+   * Time given to slaves to process a broadcast write in milliseconds, 0 for
+   * MODBUS_BROADCAST_TURNAROUND_MS_DEFAULT.
+   */
+  uint32_t broadcast_turnaround_ms;
+  /**
+   * Learn each slave's response time and derive its response timeout from it,
+   * between adaptive_timeout_min_ms and response_timeout_ms. Requires tick_get,
+   * and the serial interface's set_timeout function for the blocking API.
+   */
+  bool adaptive_timeout;
+  /** The lower bound of adaptive timeouts, 0 for MODBUS_ADAPTIVE_TIMEOUT_MIN_MS_DEFAULT. */
+  uint32_t adaptive_timeout_min_ms;
+  /** How failed transactions are retried, backing off with delay_ms. */
+  MYRIOTA_ModbusRetryPolicy retry;
 } MYRIOTA_ModbusInitOptions;
 
+/** RAM used by the Modbus driver's statically allocated state. */
+typedef struct {
+  /** Bytes used by the instance state. */
+  size_t instances;
+  /** Bytes used by the built-in request/response buffers. */
+  size_t buffers;
+  /** Bytes the built-in buffers would use with a request and a response buffer per instance. */
+  size_t buffers_split;
+} MYRIOTA_ModbusRamUsage;
+
 /**
  * Initializes a Modbus driver instance.
  *
@@ -161,6 +378,119 @@ int MYRIOTA_ModbusEnable(const MYRIOTA_ModbusHandle handle);
  */
 int MYRIOTA_ModbusDisable(const MYRIOTA_ModbusHandle handle);
 
+/**
+ * Report the RAM used by the Modbus driver.
+ *
+ * \note Buffers supplied through MYRIOTA_ModbusInitOptions are not included.
+ *
+ * \param[out] usage The RAM usage of the driver.
+ */
+void MYRIOTA_ModbusGetRamUsage(MYRIOTA_ModbusRamUsage *const usage);
+
+/**
+ * Invalidate all of the driver's register cache entries, e.g. after the slave
+ * devices have been power cycled.
+ *
+ * \param[in] handle The handle for the Modbus driver.
+ * \returns 0 on success else < 0 on error.
+ */
+int MYRIOTA_ModbusCacheInvalidate(const MYRIOTA_ModbusHandle handle);
+
+/**
+ * Get the response timeout the driver currently uses for a slave, which
+ * adapts to the slave's response time when adaptive timeouts are enabled.
+ *
+ * \param[in] handle The handle for the Modbus driver.
+ * \param[in] slave The address of the slave device.
+ * \param[out] timeout_ms The response timeout in milliseconds.
+ * \returns 0 on success else < 0 on error.
+ */
+int MYRIOTA_ModbusGetSlaveTimeout(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, uint32_t *const timeout_ms);
+
+#if defined(MODBUS_STATS) && MODBUS_STATS
+/**
+ * The number of buckets of the latency histogram, where bucket 0 counts
+ * latencies of 0ms, bucket n latencies from 2^(n-1) up to 2^n ms and the last
+ * bucket every longer latency.
+ */
+#define MODBUS_STATS_LATENCY_BUCKETS 12
+
+/** The number of exception codes counted, indexed by exception code. */
+#define MODBUS_STATS_EXCEPTION_CODES \
+  (MODBUS_ERROR_EXCEPTION_GATEWAY_TARGET_DEVICE_FAILED_TO_RESPOND + 1)
+
+/**
+ * Statistics of the transactions of a driver instance or a slave, only
+ * available when the library is built with the `modbus_stats` option.
+ *
+ * \note Latencies and bus time are measured with the `tick_get` init option,
+ * and are only recorded when it is set. Responses to asynchronous transactions
+ * are timed when they are polled.
+ */
+typedef struct {
+  /** Transactions sent on the bus, including each retry. */
+  uint32_t transactions;
+  /** Responses that failed their crc16 check. */
+  uint32_t crc_errors;
+  /** Responses that didn't arrive before the response timeout, or serial errors. */
+  uint32_t timeouts;
+  /** Responses that were truncated or didn't match the request. */
+  uint32_t malformed;
+  /** Responses from a slave other than the one addressed. */
+  uint32_t wrong_slave;
+  /** Requests or responses that didn't fit the driver's or the caller's buffers. */
+  uint32_t overflows;
+  /** Exception responses, indexed by exception code. */
+  uint32_t exceptions[MODBUS_STATS_EXCEPTION_CODES];
+  /** Log2 histogram of the time from sending a request to receiving its response. */
+  uint32_t latency_histogram[MODBUS_STATS_LATENCY_BUCKETS];
+  /** Total time the bus was busy with transactions in milliseconds. */
+  uint32_t bus_busy_ms;
+} MYRIOTA_ModbusStats;
+
+/**
+ * Take a snapshot of the statistics of all of a driver's transactions.
+ *
+ * \param[in] handle The handle for the Modbus driver.
+ * \param[out] stats The statistics.
+ * \returns 0 on success else < 0 on error.
+ */
+int MYRIOTA_ModbusGetStats(const MYRIOTA_ModbusHandle handle, MYRIOTA_ModbusStats *const stats);
+
+/**
+ * Take a snapshot of the statistics of a driver's transactions with a slave.
+ * The statistics of up to MODBUS_STATS_SLAVES_MAX slaves are kept.
+ *
+ * \param[in] handle The handle for the Modbus driver.
+ * \param[in] slave The address of the slave device.
+ * \param[out] stats The statistics.
+ * \returns 0 on success, -MODBUS_ERROR_INVALID_ARGUMENT if no statistics are
+ * kept for the slave, else < 0 on error.
+ */
+int MYRIOTA_ModbusGetSlaveStats(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, MYRIOTA_ModbusStats *const stats);
+
+/**
+ * Reset all of a driver's statistics, e.g. once they've been reported.
+ *
+ * \param[in] handle The handle for the Modbus driver.
+ * \returns 0 on success else < 0 on error.
+ */
+int MYRIOTA_ModbusResetStats(const MYRIOTA_ModbusHandle handle);
+#endif
+
+/**
+ * Get the Modbus RTU inter-frame delay (t3.5) for a given baud rate.
+ *
+ * \note A silence on the line of at least this long marks the end of a frame.
+ * For baud rates above 19200 the Modbus specification fixes the delay at 1750us.
+ *
+ * \param[in] baud_rate The baud rate of the serial interface.
+ * \return the inter-frame delay in microseconds.
+ */
+uint32_t MYRIOTA_ModbusInterFrameDelayUs(const uint32_t baud_rate);
+
 /**
  * Given a buffer of bytes packed using Modbus's byte format set the
  * value of the bit at the given index.
@@ -310,6 +640,103 @@ int MYRIOTA_ModbusWriteHoldingRegisters(const MYRIOTA_ModbusHandle handle,
   const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress addr, const size_t count,
   const uint8_t *const bytes);
 
+/**
+ * Modify the contents of a holding register using a combination of an AND mask
+ * and an OR mask, without a separate read-modify-write.
+ *
+ * \note The register is set to (current AND and_mask) OR (or_mask AND (NOT and_mask)).
+ *
+ * \param[in] handle The handle for the Modbus driver to write to.
+ * \param[in] slave The address of the slave device to write to.
+ * \param[in] addr The address of the holding register to modify.
+ * \param[in] and_mask The AND mask to apply to the register.
+ * \param[in] or_mask The OR mask to apply to the register.
+ * \return 0 on success else < 0 on error.
+ */
+int MYRIOTA_ModbusMaskWriteHoldingRegister(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress addr,
+  const uint16_t and_mask, const uint16_t or_mask);
+
+/**
+ * Write values to a list of consecutive holding registers and then read the
+ * values of a list of consecutive holding registers, in a single transaction.
+ *
+ * \param[in] handle The handle for the Modbus driver to use.
+ * \param[in] slave The address of the slave device.
+ * \param[in] read_addr The start address of the holding registers to read from.
+ * \param[in] read_count The number of holding registers to read (1 to 125).
+ * \param[out] read_bytes The buffer to fill with the values of the holding registers
+ * read, where the size of the buffer must = read_count * 2.
+ * \param[in] write_addr The start address of the holding registers to write to.
+ * \param[in] write_count The number of holding registers to write (1 to 121).
+ * \param[in] write_bytes The values to write to the holding registers, where the
+ * size of the buffer must = write_count * 2.
+ * \return 0 on success else < 0 on error.
+ */
+int MYRIOTA_ModbusReadWriteHoldingRegisters(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress read_addr,
+  const size_t read_count, uint8_t *const read_bytes, const MYRIOTA_ModbusDataAddress write_addr,
+  const size_t write_count, const uint8_t *const write_bytes);
+
+/**
+ * Start an asynchronous read of coils, discrete inputs or registers.
+ *
+ * \note The request is packed immediately, progress it with MYRIOTA_ModbusPoll()
+ * and collect the result with MYRIOTA_ModbusComplete(). The blocking functions
+ * return MODBUS_ERROR_BAD_STATE until the transaction has been completed.
+ *
+ * \param[in] handle The handle for the Modbus driver to read from.
+ * \param[in] slave The address of the slave device to read from.
+ * \param[in] function The Modbus read function to use.
+ * \param[in] addr The start address of the coils/inputs/registers to read from.
+ * \param[in] count The number of coils/inputs/registers to read.
+ * \return 0 on success else < 0 on error.
+ */
+int MYRIOTA_ModbusBeginRead(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusReadFunction function,
+  const MYRIOTA_ModbusDataAddress addr, const size_t count);
+
+/**
+ * Start an asynchronous write of coils or holding registers.
+ *
+ * \note The values are copied into the request so the buffer may be reused as
+ * soon as this returns.
+ *
+ * \param[in] handle The handle for the Modbus driver to write to.
+ * \param[in] slave The address of the slave device to write to.
+ * \param[in] function The Modbus write function to use.
+ * \param[in] addr The start address of the coils/registers to write to.
+ * \param[in] count The number of coils/registers to write.
+ * \param[in] bytes The values to write, packed as for the blocking write functions.
+ * \return 0 on success else < 0 on error.
+ */
+int MYRIOTA_ModbusBeginWrite(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusWriteFunction function,
+  const MYRIOTA_ModbusDataAddress addr, const size_t count, const uint8_t *const bytes);
+
+/**
+ * Progress the asynchronous transaction without blocking.
+ *
+ * \note If the serial interface has no poll function the response is received
+ * with the blocking read function during a single call.
+ *
+ * \param[in] handle The handle for the Modbus driver to progress.
+ * \return the MYRIOTA_ModbusTransactionState on success else < 0 on error.
+ */
+int MYRIOTA_ModbusPoll(const MYRIOTA_ModbusHandle handle);
+
+/**
+ * Collect the result of a finished asynchronous transaction and return the
+ * driver to the idle state.
+ *
+ * \param[in] handle The handle for the Modbus driver.
+ * \param[out] bytes The buffer to fill with the values read, may be NULL for writes.
+ * \param[in] size The size of the buffer.
+ * \return 0 on success else < 0 on error, including any error from the transaction.
+ */
+int MYRIOTA_ModbusComplete(const MYRIOTA_ModbusHandle handle, uint8_t *const bytes,
+  const size_t size);
+
 /**
  * \}
  */
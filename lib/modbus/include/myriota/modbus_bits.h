@@ -0,0 +1,111 @@
+/// \file modbus_bits.h Myriota Modbus Bit Ranges
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRIOTA_MODBUS_BITS_H
+#define MYRIOTA_MODBUS_BITS_H
+
+#include "myriota/modbus.h"
+
+/** \defgroup Modbus_Bits Modbus Bit Ranges
+ * Copy ranges of coils/discrete inputs between Modbus's byte packing format
+ * and the application's bitsets or `bool` arrays, 32 bits at a time.
+ *
+ * In Modbus's byte packing format bit `n` is bit `n % 8` of byte `n / 8`. In
+ * a bitset bit `n` is bit `n % 32` of word `n / 32`. Bits outside of a
+ * destination range are left unchanged.
+ * \{
+ */
+
+/** The number of `uint32_t` words in a bitset of `nbits` bits. */
+#define MODBUS_BITSET_WORDS(nbits) (((nbits) + 31) / 32)
+
+/**
+ * Copy bits from Modbus's byte packing format into a bitset.
+ *
+ * \param[in] bytes The bytes, e.g. the response of MYRIOTA_ModbusReadCoils().
+ * \param[in] offset The index of the first bit to copy from `bytes`.
+ * \param[in,out] bitset The bitset to copy the bits into.
+ * \param[in] bitset_offset The index of the first bit to copy to in `bitset`.
+ * \param[in] count The number of bits to copy.
+ */
+void MYRIOTA_ModbusBitsToBitset(const uint8_t *const bytes, const size_t offset,
+  uint32_t *const bitset, const size_t bitset_offset, const size_t count);
+
+/**
+ * Copy bits from a bitset into Modbus's byte packing format.
+ *
+ * \param[in,out] bytes The bytes, e.g. for MYRIOTA_ModbusWriteCoils().
+ * \param[in] offset The index of the first bit to copy to in `bytes`.
+ * \param[in] bitset The bitset to copy the bits from.
+ * \param[in] bitset_offset The index of the first bit to copy from `bitset`.
+ * \param[in] count The number of bits to copy.
+ */
+void MYRIOTA_ModbusBitsFromBitset(uint8_t *const bytes, const size_t offset,
+  const uint32_t *const bitset, const size_t bitset_offset, const size_t count);
+
+/**
+ * Copy bits from Modbus's byte packing format into an array of `bool`.
+ *
+ * \param[in] bytes The bytes, e.g. the response of MYRIOTA_ModbusReadCoils().
+ * \param[in] offset The index of the first bit to copy from `bytes`.
+ * \param[out] values The array of `count` values.
+ * \param[in] count The number of bits to copy.
+ */
+void MYRIOTA_ModbusBitsToBools(const uint8_t *const bytes, const size_t offset, bool *const values,
+  const size_t count);
+
+/**
+ * Copy an array of `bool` into Modbus's byte packing format.
+ *
+ * \param[in,out] bytes The bytes, e.g. for MYRIOTA_ModbusWriteCoils().
+ * \param[in] offset The index of the first bit to copy to in `bytes`.
+ * \param[in] values The array of `count` values.
+ * \param[in] count The number of bits to copy.
+ */
+void MYRIOTA_ModbusBitsFromBools(uint8_t *const bytes, const size_t offset,
+  const bool *const values, const size_t count);
+
+/**
+ * Count the bits that are set in a range of Modbus's byte packing format.
+ *
+ * \param[in] bytes The bytes.
+ * \param[in] offset The index of the first bit to count.
+ * \param[in] count The number of bits to count.
+ * \return the number of bits set.
+ */
+size_t MYRIOTA_ModbusBitsCount(const uint8_t *const bytes, const size_t offset,
+  const size_t count);
+
+/**
+ * Find the bits that differ between two bitsets, e.g. to detect the edges of
+ * coils/discrete inputs between two polls.
+ *
+ * \note Rising edges are `changed & current` and falling edges are
+ * `changed & ~current`.
+ *
+ * \param[in] previous The previous bitset.
+ * \param[in] current The current bitset.
+ * \param[out] changed Optional bitset set to the bits that differ, may be one
+ * of the inputs.
+ * \param[in] count The number of bits in the bitsets.
+ * \return the number of bits that differ.
+ */
+size_t MYRIOTA_ModbusBitsetChanged(const uint32_t *const previous, const uint32_t *const current,
+  uint32_t *const changed, const size_t count);
+
+/**
+ * \}
+ */
+
+#endif /* MYRIOTA_MODBUS_BITS_H */
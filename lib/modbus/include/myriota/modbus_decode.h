@@ -0,0 +1,241 @@
+/// \file modbus_decode.h Myriota Modbus Typed Decoding
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRIOTA_MODBUS_DECODE_H
+#define MYRIOTA_MODBUS_DECODE_H
+
+#include <string.h>
+#include "myriota/modbus.h"
+
+/** \defgroup Modbus_Decode Modbus Typed Decoding
+ * Decode coils/registers straight from a Modbus response into typed values.
+ * \{
+ */
+
+/** The types a value can be decoded to. */
+typedef enum {
+  /** A single coil or discrete input decoded to a `bool`. */
+  MODBUS_VALUE_TYPE_BOOL,
+  /** A single register decoded to a `uint16_t`. */
+  MODBUS_VALUE_TYPE_U16,
+  /** A single register decoded to an `int16_t`. */
+  MODBUS_VALUE_TYPE_I16,
+  /** Two registers decoded to a `uint32_t`. */
+  MODBUS_VALUE_TYPE_U32,
+  /** Two registers decoded to an `int32_t`. */
+  MODBUS_VALUE_TYPE_I32,
+  /** Two registers decoded to an IEEE-754 `float`. */
+  MODBUS_VALUE_TYPE_F32,
+  /** Four registers decoded to a `uint64_t`. */
+  MODBUS_VALUE_TYPE_U64,
+  /** Four registers decoded to an `int64_t`. */
+  MODBUS_VALUE_TYPE_I64,
+  /** Four registers decoded to an IEEE-754 `double`. */
+  MODBUS_VALUE_TYPE_F64,
+} MYRIOTA_ModbusValueType;
+
+/**
+ * The order of the bytes of a multi-register value, where A is the most
+ * significant byte of a 32-bit value.
+ *
+ * \note The same swaps apply to 64-bit values, e.g. CDAB sends the least
+ * significant register first. Only the byte swap applies to 16-bit values.
+ */
+typedef enum {
+  /** Big-endian, the most significant register first (Modbus convention). */
+  MODBUS_WORD_ORDER_ABCD = 0x0,
+  /** The least significant register first. */
+  MODBUS_WORD_ORDER_CDAB = 0x1,
+  /** The most significant register first, with the bytes of each register swapped. */
+  MODBUS_WORD_ORDER_BADC = 0x2,
+  /** Little-endian, the least significant byte first. */
+  MODBUS_WORD_ORDER_DCBA = 0x3,
+} MYRIOTA_ModbusWordOrder;
+
+/** A value to decode from a Modbus read response. */
+typedef struct {
+  /** The type of the value. */
+  MYRIOTA_ModbusValueType type;
+  /** The word order of a multi-register value. */
+  MYRIOTA_ModbusWordOrder word_order;
+  /** The index of the value's first coil/register relative to the start of the read. */
+  uint16_t index;
+  /**
+   * When non-zero the value is stored as a `float` equal to raw * scale + bias,
+   * otherwise the value is stored raw as its type.
+   */
+  float scale;
+  /** The bias added to a scaled value. */
+  float bias;
+  /** The offset (i.e. `offsetof()`) of the value's field in the values struct. */
+  size_t offset;
+} MYRIOTA_ModbusDecodeField;
+
+/**
+ * Decode `nwords` registers into an unsigned integer.
+ *
+ * \param[in] bytes The registers as packed in a Modbus response.
+ * \param[in] nwords The number of registers, from 1 to 4.
+ * \param[in] order The word order of the registers.
+ * \return the decoded value.
+ */
+static inline uint64_t MYRIOTA_ModbusDecodeWords(const uint8_t *const bytes, const size_t nwords,
+  const MYRIOTA_ModbusWordOrder order) {
+  const bool swap_words = (order & MODBUS_WORD_ORDER_CDAB) != 0;
+  const bool swap_bytes = (order & MODBUS_WORD_ORDER_BADC) != 0;
+  uint64_t value = 0;
+  for (size_t i = 0; i < nwords; ++i) {
+    const uint8_t *const word = &bytes[2 * (swap_words ? nwords - 1 - i : i)];
+    const uint8_t hi = swap_bytes ? word[1] : word[0];
+    const uint8_t low = swap_bytes ? word[0] : word[1];
+    value = (value << 16) | ((uint16_t)hi << 8) | (uint16_t)low;
+  }
+  return value;
+}
+
+/** Decode a register into a `uint16_t`, see MYRIOTA_ModbusDecodeWords(). */
+static inline uint16_t MYRIOTA_ModbusDecodeU16(const uint8_t *const bytes,
+  const MYRIOTA_ModbusWordOrder order) {
+  return (uint16_t)MYRIOTA_ModbusDecodeWords(bytes, 1, order);
+}
+
+/** Decode a register into an `int16_t`, see MYRIOTA_ModbusDecodeWords(). */
+static inline int16_t MYRIOTA_ModbusDecodeI16(const uint8_t *const bytes,
+  const MYRIOTA_ModbusWordOrder order) {
+  return (int16_t)MYRIOTA_ModbusDecodeU16(bytes, order);
+}
+
+/** Decode two registers into a `uint32_t`, see MYRIOTA_ModbusDecodeWords(). */
+static inline uint32_t MYRIOTA_ModbusDecodeU32(const uint8_t *const bytes,
+  const MYRIOTA_ModbusWordOrder order) {
+  return (uint32_t)MYRIOTA_ModbusDecodeWords(bytes, 2, order);
+}
+
+/** Decode two registers into an `int32_t`, see MYRIOTA_ModbusDecodeWords(). */
+static inline int32_t MYRIOTA_ModbusDecodeI32(const uint8_t *const bytes,
+  const MYRIOTA_ModbusWordOrder order) {
+  return (int32_t)MYRIOTA_ModbusDecodeU32(bytes, order);
+}
+
+/** Decode two registers into a `float`, see MYRIOTA_ModbusDecodeWords(). */
+static inline float MYRIOTA_ModbusDecodeF32(const uint8_t *const bytes,
+  const MYRIOTA_ModbusWordOrder order) {
+  const uint32_t bits = MYRIOTA_ModbusDecodeU32(bytes, order);
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+/** Decode four registers into a `uint64_t`, see MYRIOTA_ModbusDecodeWords(). */
+static inline uint64_t MYRIOTA_ModbusDecodeU64(const uint8_t *const bytes,
+  const MYRIOTA_ModbusWordOrder order) {
+  return MYRIOTA_ModbusDecodeWords(bytes, 4, order);
+}
+
+/** Decode four registers into an `int64_t`, see MYRIOTA_ModbusDecodeWords(). */
+static inline int64_t MYRIOTA_ModbusDecodeI64(const uint8_t *const bytes,
+  const MYRIOTA_ModbusWordOrder order) {
+  return (int64_t)MYRIOTA_ModbusDecodeU64(bytes, order);
+}
+
+/** Decode four registers into a `double`, see MYRIOTA_ModbusDecodeWords(). */
+static inline double MYRIOTA_ModbusDecodeF64(const uint8_t *const bytes,
+  const MYRIOTA_ModbusWordOrder order) {
+  const uint64_t bits = MYRIOTA_ModbusDecodeU64(bytes, order);
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+/**
+ * Get the number of coils/registers a value of the given type spans.
+ *
+ * \param[in] type The type of the value.
+ * \return the number of coils/registers.
+ */
+uint16_t MYRIOTA_ModbusValueTypeWidth(const MYRIOTA_ModbusValueType type);
+
+/**
+ * Decode a list of fields from the payload of a Modbus read response.
+ *
+ * \note Fields of type MODBUS_VALUE_TYPE_BOOL index coils/discrete inputs, all
+ * other types index registers.
+ *
+ * \param[in] bytes The payload of the read response.
+ * \param[in] size The size of the payload.
+ * \param[in] fields The fields to decode.
+ * \param[in] fields_count The number of fields.
+ * \param[out] values The caller's struct which the fields are decoded into.
+ * \return 0 on success else < 0 on error.
+ */
+int MYRIOTA_ModbusDecode(const uint8_t *const bytes, const size_t size,
+  const MYRIOTA_ModbusDecodeField *const fields, const size_t fields_count, void *const values);
+
+/**
+ * Read coils/registers and decode them directly from the driver's receive
+ * buffer, without an intermediate copy.
+ *
+ * \param[in] handle The handle for the Modbus driver to read from.
+ * \param[in] slave The address of the slave device to read from.
+ * \param[in] function The Modbus read function to use.
+ * \param[in] addr The start address of the coils/inputs/registers to read from.
+ * \param[in] count The number of coils/inputs/registers to read.
+ * \param[in] fields The fields to decode, indexed relative to `addr`.
+ * \param[in] fields_count The number of fields.
+ * \param[out] values The caller's struct which the fields are decoded into.
+ * \return 0 on success else < 0 on error, -MODBUS_ERROR_MALFORMED_RESPONSE if the
+ * response does not carry exactly `count` coils/inputs/registers.
+ */
+int MYRIOTA_ModbusReadDecode(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusReadFunction function,
+  const MYRIOTA_ModbusDataAddress addr, const size_t count,
+  const MYRIOTA_ModbusDecodeField *const fields, const size_t fields_count, void *const values);
+
+/**
+ * Function that decodes the payload of a read response, see
+ * MYRIOTA_ModbusReadDecodeWith().
+ *
+ * \param[in] bytes The payload of the read response.
+ * \param[out] values The caller's values the payload is decoded into.
+ */
+typedef void (*MYRIOTA_ModbusDecodeFn_t)(const uint8_t *const bytes, void *const values);
+
+/**
+ * Read coils/registers and decode them with the caller's function directly
+ * from the driver's receive buffer, e.g. the decode function generated for a
+ * register map by MODBUS_MAP_DEFINE().
+ *
+ * \param[in] handle The handle for the Modbus driver to read from.
+ * \param[in] slave The address of the slave device to read from.
+ * \param[in] function The Modbus read function to use.
+ * \param[in] addr The start address of the coils/inputs/registers to read from.
+ * \param[in] count The number of coils/inputs/registers to read.
+ * \param[in] decode The function that decodes the payload, which is only called
+ * when the read succeeds. The payload is only valid until decode returns, and
+ * decode must not start a transaction on the handle, or in the shared ADU
+ * buffer mode on any instance using the built-in buffer.
+ * \param[out] values The caller's values passed to `decode`.
+ * \return 0 on success else < 0 on error, -MODBUS_ERROR_MALFORMED_RESPONSE if the
+ * response does not carry exactly `count` coils/inputs/registers.
+ */
+int MYRIOTA_ModbusReadDecodeWith(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusReadFunction function,
+  const MYRIOTA_ModbusDataAddress addr, const size_t count, const MYRIOTA_ModbusDecodeFn_t decode,
+  void *const values);
+
+/**
+ * \}
+ */
+
+#endif /* MYRIOTA_MODBUS_DECODE_H */
@@ -0,0 +1,135 @@
+/// \file modbus_map.h Myriota Modbus Register Maps
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRIOTA_MODBUS_MAP_H
+#define MYRIOTA_MODBUS_MAP_H
+
+#include "myriota/modbus.h"
+#include "myriota/modbus_decode.h"
+
+/** \defgroup Modbus_Map Modbus Register Maps
+ * Describe a device's register map once as an X-macro and expand it at compile
+ * time into a values struct, the address and count of the read covering the
+ * map and a straight-line decode function, with no table interpreted at run
+ * time.
+ *
+ * Each entry of a map is `X(name, ctype, type, order, addr, scale, bias)`:
+ * - `name` the field of the values struct.
+ * - `ctype` the C type of the field, `float` for a scaled value.
+ * - `type` the register type, one of U16, I16, U32, I32, F32, U64, I64 or F64.
+ * - `order` the word order, one of ABCD, CDAB, BADC or DCBA.
+ * - `addr` the address of the value's first register.
+ * - `scale`, `bias` when `scale` is non-zero the field is set to
+ *   `raw * scale + bias`, otherwise to the raw value.
+ *
+ * \code
+ * #define SEN0438_MAP(X)                               \
+ *   X(humidity, float, U16, ABCD, 0x0000, 0.1f, 0.0f) \
+ *   X(temperature, float, I16, ABCD, 0x0001, 0.1f, 0.0f)
+ *
+ * MODBUS_MAP_DEFINE(sen0438, SEN0438_MAP, MODBUS_READ_HOLDING_REGISTERS)
+ *
+ * sen0438_values values;
+ * sen0438_read(handle, slave, &values);
+ * \endcode
+ *
+ * The map is read with a single request of `prefix_COUNT` registers from
+ * `prefix_ADDR`, the span of its entries. Everything generated is `static` or
+ * `static inline`, so a map that isn't read adds no code to the image.
+ * \{
+ */
+
+/** The number of registers spanned by each register type. */
+#define MODBUS_MAP_WIDTH_U16 1
+#define MODBUS_MAP_WIDTH_I16 1
+#define MODBUS_MAP_WIDTH_U32 2
+#define MODBUS_MAP_WIDTH_I32 2
+#define MODBUS_MAP_WIDTH_F32 2
+#define MODBUS_MAP_WIDTH_U64 4
+#define MODBUS_MAP_WIDTH_I64 4
+#define MODBUS_MAP_WIDTH_F64 4
+
+/** The most registers a map may span, the Modbus limit of a single read. */
+#define MODBUS_MAP_REGISTERS_MAX 125
+
+// The span of a map is found at compile time from the size of unions holding
+// an array per entry, sized by the distance to the entry's first register
+// from the end of the address space and to its last register from 0.
+#define MODBUS_MAP_FIRST_(name, ctype, type, order, addr, scale, bias) \
+  uint8_t name[0x10000 - (addr)];
+#define MODBUS_MAP_END_(name, ctype, type, order, addr, scale, bias) \
+  uint8_t name[(addr) + MODBUS_MAP_WIDTH_##type];
+#define MODBUS_MAP_FIELD_(name, ctype, type, order, addr, scale, bias) ctype name;
+#define MODBUS_MAP_DECODE_(name, ctype, type, order, addr, scale, bias)                   \
+  {                                                                                     \
+    const uint8_t *const word = &bytes[2 * ((addr) - map_addr)];                        \
+    if ((scale) != 0.0f) {                                                              \
+      values->name =                                                                    \
+        (ctype)(MYRIOTA_ModbusDecode##type(word, MODBUS_WORD_ORDER_##order) * (scale) + \
+                (bias));                                                                \
+    } else {                                                                            \
+      values->name = (ctype)MYRIOTA_ModbusDecode##type(word, MODBUS_WORD_ORDER_##order); \
+    }                                                                                   \
+  }
+
+/**
+ * Define the values struct `prefix_values`, the constants `prefix_ADDR` and
+ * `prefix_COUNT`, and the functions `prefix_decode()` and `prefix_read()` of a
+ * register map.
+ *
+ * \param prefix The prefix of the generated names.
+ * \param MAP The X-macro listing the map's entries.
+ * \param function The read function, MODBUS_READ_HOLDING_REGISTERS or
+ * MODBUS_READ_INPUT_REGISTERS.
+ */
+#define MODBUS_MAP_DEFINE(prefix, MAP, function)                                            \
+  typedef struct {                                                                          \
+    MAP(MODBUS_MAP_FIELD_)                                                                  \
+  } prefix##_values;                                                                        \
+                                                                                            \
+  enum {                                                                                    \
+    prefix##_ADDR = 0x10000 - sizeof(union { MAP(MODBUS_MAP_FIRST_) }),                     \
+    prefix##_COUNT = sizeof(union { MAP(MODBUS_MAP_END_) }) - prefix##_ADDR,                \
+  };                                                                                        \
+                                                                                            \
+  _Static_assert(prefix##_COUNT <= MODBUS_MAP_REGISTERS_MAX,                                \
+    #prefix " spans more registers than a single read");                                    \
+  _Static_assert(                                                                           \
+    (function) == MODBUS_READ_HOLDING_REGISTERS || (function) == MODBUS_READ_INPUT_REGISTERS, \
+    #prefix " must be read from registers");                                                \
+                                                                                            \
+  /* Decodes the map from the bytes of a read of prefix_COUNT registers. */                 \
+  static inline void prefix##_decode(const uint8_t *const bytes,                            \
+    prefix##_values *const values) {                                                        \
+    const uint16_t map_addr = prefix##_ADDR;                                                \
+    (void)map_addr;                                                                         \
+    MAP(MODBUS_MAP_DECODE_)                                                                 \
+  }                                                                                         \
+                                                                                            \
+  static inline void prefix##_decode_fn_(const uint8_t *const bytes, void *const values) {  \
+    prefix##_decode(bytes, values);                                                         \
+  }                                                                                         \
+                                                                                            \
+  /* Reads the map from a slave, decoding it straight from the receive buffer. */           \
+  static inline int prefix##_read(const MYRIOTA_ModbusHandle handle,                        \
+    const MYRIOTA_ModbusDeviceAddress slave, prefix##_values *const values) {               \
+    return MYRIOTA_ModbusReadDecodeWith(handle, slave, (function), prefix##_ADDR,           \
+      prefix##_COUNT, prefix##_decode_fn_, values);                                         \
+  }
+
+/**
+ * \}
+ */
+
+#endif /* MYRIOTA_MODBUS_MAP_H */
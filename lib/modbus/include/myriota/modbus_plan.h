@@ -0,0 +1,172 @@
+/// \file modbus_plan.h Myriota Modbus Poll Plans
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRIOTA_MODBUS_PLAN_H
+#define MYRIOTA_MODBUS_PLAN_H
+
+#include "myriota/modbus.h"
+#include "myriota/modbus_decode.h"
+
+/** \defgroup Modbus_Plan Modbus Poll Plans
+ * Read a list of scattered points from Modbus slaves in as few transactions as
+ * possible.
+ * \{
+ */
+
+/** A point (i.e. a value held in one or more coils/registers) to be polled. */
+typedef struct {
+  /** The address of the slave device holding the point. */
+  MYRIOTA_ModbusDeviceAddress slave;
+  /** The function used to read the point, which selects its data table. */
+  MYRIOTA_ModbusReadFunction function;
+  /** The address of the point's first coil/register. */
+  MYRIOTA_ModbusDataAddress addr;
+  /** The type of the point. */
+  MYRIOTA_ModbusValueType type;
+  /** The offset (i.e. `offsetof()`) of the point's field in the values struct. */
+  size_t offset;
+  /** The word order of a multi-register point, defaults to MODBUS_WORD_ORDER_ABCD. */
+  MYRIOTA_ModbusWordOrder word_order;
+} MYRIOTA_ModbusPoint;
+
+/** A single read request of a compiled poll plan. */
+typedef struct {
+  /** The address of the slave device to read from. */
+  MYRIOTA_ModbusDeviceAddress slave;
+  /** The function used for the read. */
+  MYRIOTA_ModbusReadFunction function;
+  /** The start address of the read. */
+  MYRIOTA_ModbusDataAddress addr;
+  /** The number of coils/registers to read. */
+  uint16_t count;
+} MYRIOTA_ModbusPlanRequest;
+
+/** A poll plan, compiled from a list of points by MYRIOTA_ModbusPlanCompile(). */
+typedef struct {
+  /** The points polled by the plan. */
+  const MYRIOTA_ModbusPoint *points;
+  /** The number of points. */
+  size_t points_count;
+  /** The read requests that cover the points. */
+  MYRIOTA_ModbusPlanRequest *requests;
+  /** The capacity of the requests array. */
+  size_t requests_max;
+  /** The number of requests in use. */
+  size_t requests_count;
+} MYRIOTA_ModbusPlan;
+
+/**
+ * Compiles a list of points into a poll plan.
+ *
+ * Points of the same slave and data table are merged into a single read
+ * request when the unused coils/registers between them is no more than `gap`,
+ * and the request stays within the Modbus limits of 125 registers or 2000
+ * coils/discrete inputs.
+ *
+ * \note The plan keeps a reference to `points` and `requests`, which must
+ * remain valid for the lifetime of the plan.
+ *
+ * \param[out] plan The plan to compile.
+ * \param[in] points The points to poll.
+ * \param[in] points_count The number of points.
+ * \param[out] requests Storage for the plan's read requests. At most
+ * `points_count` requests are needed.
+ * \param[in] requests_max The capacity of the requests storage.
+ * \param[in] gap The number of unused coils/registers that may be read in
+ * order to merge two requests.
+ * \return 0 on success else < 0 on error.
+ */
+int MYRIOTA_ModbusPlanCompile(MYRIOTA_ModbusPlan *const plan,
+  const MYRIOTA_ModbusPoint *const points, const size_t points_count,
+  MYRIOTA_ModbusPlanRequest *const requests, const size_t requests_max, const uint16_t gap);
+
+/**
+ * Executes a poll plan, decoding each point into the values struct.
+ *
+ * \param[in] handle The handle for the Modbus driver to read from.
+ * \param[in] plan The plan to execute.
+ * \param[out] values The caller's struct which the points are decoded into.
+ * \return 0 on success else < 0 on error, where the plan stops at the first
+ * request that fails.
+ */
+int MYRIOTA_ModbusPlanExecute(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusPlan *const plan, void *const values);
+
+/** A slave polled by a bus sweep. */
+typedef struct {
+  /** The compiled poll plan of the slave's points. */
+  const MYRIOTA_ModbusPlan *plan;
+  /** The caller's struct which the slave's points are decoded into. */
+  void *values;
+  /** Set to the result of executing the plan, 0 on success else < 0 on error. */
+  int result;
+} MYRIOTA_ModbusSweepSlave;
+
+/**
+ * Function that powers the slaves of a bus sweep.
+ *
+ * \param[in,out] ctx The user defined data context of the sweep.
+ * \return 0 on success else < 0 on error.
+ */
+typedef int (*MYRIOTA_ModbusSweepPowerOnFn_t)(void *const ctx);
+
+/**
+ * Function that removes power from the slaves of a bus sweep.
+ *
+ * \param[in,out] ctx The user defined data context of the sweep.
+ */
+typedef void (*MYRIOTA_ModbusSweepPowerOffFn_t)(void *const ctx);
+
+/** Options of a bus sweep. */
+typedef struct {
+  /** User defined data context passed to the power functions. */
+  void *ctx;
+  /** Optional function that powers the slaves, e.g. with FLEX_PowerOutInit(). */
+  MYRIOTA_ModbusSweepPowerOnFn_t power_on;
+  /** Optional function that removes power from the slaves, e.g. with FLEX_PowerOutDeinit(). */
+  MYRIOTA_ModbusSweepPowerOffFn_t power_off;
+  /** Time for the slaves to start up once powered in milliseconds. */
+  uint32_t stabilization_ms;
+  /** Silence left on the bus between transactions in milliseconds, at least t3.5. */
+  uint32_t inter_frame_ms;
+} MYRIOTA_ModbusSweepOptions;
+
+/**
+ * Polls a list of slaves in a single power-up window.
+ *
+ * The slaves are powered and the driver enabled once, then every slave's plan
+ * is executed back to back, leaving `inter_frame_ms` of silence between
+ * transactions, before the driver is disabled and the slaves powered off.
+ * A slave that fails doesn't stop the sweep, its error is recorded in its
+ * `result`.
+ *
+ * \note Delays are waited out with the driver's `delay_ms` init option. A
+ * driver that is already enabled is left enabled.
+ *
+ * \param[in] handle The handle for the Modbus driver to sweep the bus with.
+ * \param[in] options The sweep options.
+ * \param[in,out] slaves The slaves to poll.
+ * \param[in] slaves_count The number of slaves.
+ * \return 0 when every slave was polled successfully, else < 0 with the
+ * first error.
+ */
+int MYRIOTA_ModbusSweep(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusSweepOptions *const options, MYRIOTA_ModbusSweepSlave *const slaves,
+  const size_t slaves_count);
+
+/**
+ * \}
+ */
+
+#endif /* MYRIOTA_MODBUS_PLAN_H */
@@ -0,0 +1,115 @@
+/// \file modbus_server.h Myriota Modbus Server
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRIOTA_MODBUS_SERVER_H
+#define MYRIOTA_MODBUS_SERVER_H
+
+#include "myriota/modbus.h"
+
+/** \defgroup Modbus_Server Modbus Server
+ * Answer requests from a Modbus master (e.g. a PLC) from a table of regions of
+ * coils/registers, each backed by the application's memory or callbacks.
+ * \{
+ */
+
+/**
+ * Function that reads coils/registers of a server region.
+ *
+ * \param[in,out] ctx The user defined data context of the region.
+ * \param[in] addr The address of the first coil/register to read.
+ * \param[in] count The number of coils/registers to read.
+ * \param[out] bytes The values to respond with in Modbus's byte packing format,
+ * i.e. big-endian registers or bit packed coils/discrete inputs.
+ * \return 0 on success else < 0 with the exception code to respond with.
+ */
+typedef int (*MYRIOTA_ModbusServerReadFn_t)(void *const ctx,
+  const MYRIOTA_ModbusDataAddress addr, const uint16_t count, uint8_t *const bytes);
+
+/**
+ * Function that writes coils/registers of a server region.
+ *
+ * \param[in,out] ctx The user defined data context of the region.
+ * \param[in] addr The address of the first coil/register to write.
+ * \param[in] count The number of coils/registers to write.
+ * \param[in] bytes The values written in Modbus's byte packing format.
+ * \return 0 on success else < 0 with the exception code to respond with.
+ */
+typedef int (*MYRIOTA_ModbusServerWriteFn_t)(void *const ctx,
+  const MYRIOTA_ModbusDataAddress addr, const uint16_t count, const uint8_t *const bytes);
+
+/**
+ * A range of coils/registers answered by a server.
+ *
+ * A region is backed either by the application's memory or by callbacks, the
+ * callbacks taking precedence. A region without a write callback or memory is
+ * read only.
+ */
+typedef struct {
+  /** The data table of the region, selected by its read function. */
+  MYRIOTA_ModbusReadFunction table;
+  /** The address of the region's first coil/register. */
+  MYRIOTA_ModbusDataAddress addr;
+  /** The number of coils/registers in the region. */
+  uint16_t count;
+  /** The memory of a register table region, `count` registers in native byte order. */
+  uint16_t *registers;
+  /** The memory of a coil/discrete input region, a bitset (see modbus_bits.h) of `count` bits. */
+  uint32_t *bits;
+  /** User defined data context passed to the callbacks. */
+  void *ctx;
+  /** Optional function that reads the region. */
+  MYRIOTA_ModbusServerReadFn_t read;
+  /** Optional function that writes the region, only used for coils and holding registers. */
+  MYRIOTA_ModbusServerWriteFn_t write;
+} MYRIOTA_ModbusServerRegion;
+
+/** A Modbus server, i.e. the slave role of the driver. */
+typedef struct {
+  /** The address the server answers, from 1 to 247. */
+  MYRIOTA_ModbusDeviceAddress address;
+  /** The regions of coils/registers the server answers. */
+  const MYRIOTA_ModbusServerRegion *regions;
+  /** The number of regions. */
+  size_t regions_count;
+} MYRIOTA_ModbusServer;
+
+/**
+ * Receive a request and answer it.
+ *
+ * Requests for read coils/discrete inputs/holding registers/input registers,
+ * write single/multiple coils/registers, mask write register and read/write
+ * multiple registers are supported. A request must fall entirely within one
+ * region, otherwise it is answered with an illegal data address exception.
+ * Writes broadcast to address 0 are applied without a response.
+ *
+ * The request is received into, and the response packed in, the instance's
+ * buffers, so no memory is allocated. The response is sent as soon as the last
+ * byte of the request has arrived, without waiting for the line to go idle.
+ *
+ * \param[in] handle The handle for the Modbus driver to serve on.
+ * \param[in] server The server.
+ * \return 0 once a request has been answered, the negative exception code once
+ * an exception response has been sent, else < 0 on error, e.g.
+ * MODBUS_ERROR_IO_FAILURE when no request arrived before the serial
+ * interface's read timed out or MODBUS_ERROR_RESPONSE_FROM_WRONG_SLAVE_ADDRESS
+ * for a request to another slave.
+ */
+int MYRIOTA_ModbusServe(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusServer *const server);
+
+/**
+ * \}
+ */
+
+#endif /* MYRIOTA_MODBUS_SERVER_H */
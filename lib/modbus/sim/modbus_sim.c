@@ -0,0 +1,364 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "modbus_sim.h"
+#include <string.h>
+#include "modbus_crc16.h"
+
+// Bits per character on the wire: start, 8 data, parity/stop and stop.
+#define MODBUS_SIM_BITS_PER_BYTE 11
+
+enum modbus_sim_exception {
+  MODBUS_SIM_EXCEPTION_ILLEGAL_FUNCTION = 0x01,
+  MODBUS_SIM_EXCEPTION_ILLEGAL_DATA_ADDRESS = 0x02,
+  MODBUS_SIM_EXCEPTION_ILLEGAL_DATA_VALUE = 0x03,
+};
+
+static struct modbus_sim *modbus_sim_clock = NULL;
+
+static inline uint16_t load_u16(const uint8_t *const bytes) {
+  return ((uint16_t)bytes[0] << 8) | (uint16_t)bytes[1];
+}
+
+static inline void store_u16(uint8_t *const bytes, const uint16_t value) {
+  bytes[0] = (uint8_t)(value >> 8);
+  bytes[1] = (uint8_t)value;
+}
+
+static uint32_t byte_time_us(const struct modbus_sim *const sim) {
+  return (MODBUS_SIM_BITS_PER_BYTE * 1000000 + sim->config.baud_rate - 1) / sim->config.baud_rate;
+}
+
+// The time the last bit of the response byte at `offset` arrives.
+static uint64_t response_byte_arrival_us(const struct modbus_sim *const sim, const size_t offset) {
+  return sim->response_start_us + (offset + 1) * (uint64_t)byte_time_us(sim) +
+         offset * (uint64_t)sim->config.inter_byte_gap_us;
+}
+
+static void response_begin(struct modbus_sim *const sim, const uint8_t function_code) {
+  sim->response[0] = sim->config.address;
+  sim->response[1] = function_code;
+  sim->response_size = 2;
+}
+
+static void response_exception(struct modbus_sim *const sim, const uint8_t function_code,
+  const uint8_t exception_code) {
+  response_begin(sim, function_code | 0x80);
+  sim->response[sim->response_size++] = exception_code;
+}
+
+static void response_echo(struct modbus_sim *const sim, const uint8_t *const pdu,
+  const size_t nbytes) {
+  memcpy(&sim->response[sim->response_size], pdu, nbytes);
+  sim->response_size += nbytes;
+}
+
+static bool in_range(const size_t addr, const size_t count, const size_t table_count) {
+  return addr + count <= table_count;
+}
+
+// Handles the PDU of a request, filling in the response and returning 0, or
+// returning the exception code to respond with.
+static uint8_t handle_request(struct modbus_sim *const sim, const uint8_t function_code,
+  const uint8_t *const pdu, const size_t pdu_size) {
+  struct modbus_sim_config *const config = &sim->config;
+  if (pdu_size < 4) {
+    return MODBUS_SIM_EXCEPTION_ILLEGAL_DATA_VALUE;
+  }
+  const uint16_t addr = load_u16(&pdu[0]);
+  const uint16_t value = load_u16(&pdu[2]);
+
+  switch (function_code) {
+    case 0x01:
+    case 0x02: {
+      const bool *const bits = (function_code == 0x01) ? config->coils : config->discrete_inputs;
+      const size_t bits_count =
+        (function_code == 0x01) ? config->coils_count : config->discrete_inputs_count;
+      if (value == 0 || value > 2000) {
+        return MODBUS_SIM_EXCEPTION_ILLEGAL_DATA_VALUE;
+      }
+      if (!in_range(addr, value, bits_count)) {
+        return MODBUS_SIM_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+      }
+      response_begin(sim, function_code);
+      const uint8_t nbytes = (value + 8 - 1) / 8;
+      sim->response[sim->response_size++] = nbytes;
+      uint8_t *const data = &sim->response[sim->response_size];
+      memset(data, 0, nbytes);
+      for (size_t i = 0; i < value; ++i) {
+        data[i / 8] |= (uint8_t)(bits[addr + i] << (i % 8));
+      }
+      sim->response_size += nbytes;
+      return 0;
+    }
+    case 0x03:
+    case 0x04: {
+      const uint16_t *const registers =
+        (function_code == 0x03) ? config->holding_registers : config->input_registers;
+      const size_t registers_count =
+        (function_code == 0x03) ? config->holding_registers_count : config->input_registers_count;
+      if (value == 0 || value > 125) {
+        return MODBUS_SIM_EXCEPTION_ILLEGAL_DATA_VALUE;
+      }
+      if (!in_range(addr, value, registers_count)) {
+        return MODBUS_SIM_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+      }
+      response_begin(sim, function_code);
+      sim->response[sim->response_size++] = value * 2;
+      for (size_t i = 0; i < value; ++i) {
+        store_u16(&sim->response[sim->response_size], registers[addr + i]);
+        sim->response_size += 2;
+      }
+      return 0;
+    }
+    case 0x05:
+      if (value != 0xFF00 && value != 0x0000) {
+        return MODBUS_SIM_EXCEPTION_ILLEGAL_DATA_VALUE;
+      }
+      if (!in_range(addr, 1, config->coils_count)) {
+        return MODBUS_SIM_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+      }
+      config->coils[addr] = (value == 0xFF00);
+      response_begin(sim, function_code);
+      response_echo(sim, pdu, 4);
+      return 0;
+    case 0x06:
+      if (!in_range(addr, 1, config->holding_registers_count)) {
+        return MODBUS_SIM_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+      }
+      config->holding_registers[addr] = value;
+      response_begin(sim, function_code);
+      response_echo(sim, pdu, 4);
+      return 0;
+    case 0x0F: {
+      const uint8_t nbytes = (pdu_size > 4) ? pdu[4] : 0;
+      if (value == 0 || value > 1968 || nbytes != (value + 8 - 1) / 8 || pdu_size < 5u + nbytes) {
+        return MODBUS_SIM_EXCEPTION_ILLEGAL_DATA_VALUE;
+      }
+      if (!in_range(addr, value, config->coils_count)) {
+        return MODBUS_SIM_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+      }
+      for (size_t i = 0; i < value; ++i) {
+        config->coils[addr + i] = (pdu[5 + i / 8] >> (i % 8)) & 0x1;
+      }
+      response_begin(sim, function_code);
+      response_echo(sim, pdu, 4);
+      return 0;
+    }
+    case 0x10: {
+      const uint8_t nbytes = (pdu_size > 4) ? pdu[4] : 0;
+      if (value == 0 || value > 123 || nbytes != value * 2 || pdu_size < 5u + nbytes) {
+        return MODBUS_SIM_EXCEPTION_ILLEGAL_DATA_VALUE;
+      }
+      if (!in_range(addr, value, config->holding_registers_count)) {
+        return MODBUS_SIM_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+      }
+      for (size_t i = 0; i < value; ++i) {
+        config->holding_registers[addr + i] = load_u16(&pdu[5 + i * 2]);
+      }
+      response_begin(sim, function_code);
+      response_echo(sim, pdu, 4);
+      return 0;
+    }
+    case 0x16: {
+      if (pdu_size < 6) {
+        return MODBUS_SIM_EXCEPTION_ILLEGAL_DATA_VALUE;
+      }
+      if (!in_range(addr, 1, config->holding_registers_count)) {
+        return MODBUS_SIM_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+      }
+      const uint16_t and_mask = value;
+      const uint16_t or_mask = load_u16(&pdu[4]);
+      uint16_t *const reg = &config->holding_registers[addr];
+      *reg = (*reg & and_mask) | (or_mask & ~and_mask);
+      response_begin(sim, function_code);
+      response_echo(sim, pdu, 6);
+      return 0;
+    }
+    case 0x17: {
+      if (pdu_size < 9) {
+        return MODBUS_SIM_EXCEPTION_ILLEGAL_DATA_VALUE;
+      }
+      const uint16_t write_addr = load_u16(&pdu[4]);
+      const uint16_t write_count = load_u16(&pdu[6]);
+      const uint8_t nbytes = pdu[8];
+      if (value == 0 || value > 125 || write_count == 0 || write_count > 121 ||
+          nbytes != write_count * 2 || pdu_size < 9u + nbytes) {
+        return MODBUS_SIM_EXCEPTION_ILLEGAL_DATA_VALUE;
+      }
+      if (!in_range(addr, value, config->holding_registers_count) ||
+          !in_range(write_addr, write_count, config->holding_registers_count)) {
+        return MODBUS_SIM_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+      }
+      for (size_t i = 0; i < write_count; ++i) {
+        config->holding_registers[write_addr + i] = load_u16(&pdu[9 + i * 2]);
+      }
+      response_begin(sim, function_code);
+      sim->response[sim->response_size++] = value * 2;
+      for (size_t i = 0; i < value; ++i) {
+        store_u16(&sim->response[sim->response_size], config->holding_registers[addr + i]);
+        sim->response_size += 2;
+      }
+      return 0;
+    }
+    default:
+      return MODBUS_SIM_EXCEPTION_ILLEGAL_FUNCTION;
+  }
+}
+
+static void process_request(struct modbus_sim *const sim) {
+  const uint8_t *const request = sim->request;
+  const size_t size = sim->request_size;
+  sim->request_size = 0;
+  sim->response_size = 0;
+  sim->response_offset = 0;
+  ++sim->requests;
+
+  const MYRIOTA_ModbusDeviceAddress address = request[0];
+  if (address != sim->config.address && address != 0) {
+    return;
+  }
+
+  if (sim->config.no_response_every != 0 && sim->requests % sim->config.no_response_every == 0) {
+    return;
+  }
+
+  const uint8_t function_code = request[1];
+  if (sim->config.exception_code != 0) {
+    response_exception(sim, function_code, sim->config.exception_code);
+  } else {
+    const uint8_t exception_code = handle_request(sim, function_code, &request[2], size - 4);
+    if (exception_code != 0) {
+      response_exception(sim, function_code, exception_code);
+    }
+  }
+
+  // Broadcast requests are acted on but never answered.
+  if (address == 0) {
+    sim->response_size = 0;
+    return;
+  }
+
+  const uint16_t crc16 = modbus_crc16_update(MODBUS_CRC16_INIT, sim->response, sim->response_size);
+  sim->response[sim->response_size++] = (uint8_t)crc16;
+  sim->response[sim->response_size++] = (uint8_t)(crc16 >> 8);
+  ++sim->responses;
+  if (sim->config.crc_error_every != 0 && sim->responses % sim->config.crc_error_every == 0) {
+    sim->response[sim->response_size - 1] ^= 0x01;
+  }
+  sim->response_start_us = sim->now_us + sim->config.response_latency_us;
+}
+
+static int sim_serial_init(void *const ctx) {
+  (void)ctx;
+  return 0;
+}
+
+static void sim_serial_deinit(void *const ctx) {
+  (void)ctx;
+}
+
+static ssize_t sim_serial_write(void *const ctx, const uint8_t *const buffer, const size_t count) {
+  struct modbus_sim *const sim = ctx;
+  const size_t nbytes = (count < MODBUS_SIM_FRAME_MAX - sim->request_size) ?
+                          count :
+                          MODBUS_SIM_FRAME_MAX - sim->request_size;
+  memcpy(&sim->request[sim->request_size], buffer, nbytes);
+  sim->request_size += nbytes;
+  sim->now_us += nbytes * (uint64_t)byte_time_us(sim);
+
+  // A request is complete once the crc16 over it leaves a remainder of zero.
+  if (sim->request_size >= 4) {
+    if (modbus_crc16_update(MODBUS_CRC16_INIT, sim->request, sim->request_size) == 0) {
+      process_request(sim);
+    } else if (sim->request_size == MODBUS_SIM_FRAME_MAX) {
+      ++sim->bad_requests;
+      sim->request_size = 0;
+    }
+  }
+
+  return nbytes;
+}
+
+static ssize_t sim_serial_read(void *const ctx, uint8_t *const buffer, const size_t count) {
+  struct modbus_sim *const sim = ctx;
+  const uint32_t idle_us = MYRIOTA_ModbusInterFrameDelayUs(sim->config.baud_rate);
+
+  if (sim->response_offset >= sim->response_size ||
+      response_byte_arrival_us(sim, sim->response_offset) >
+        sim->now_us + sim->config.response_timeout_us) {
+    sim->now_us += sim->config.response_timeout_us;
+    return 0;
+  }
+
+  // Receive bytes as they arrive, stopping early if the line goes idle.
+  size_t nbytes = 0;
+  while (nbytes < count && sim->response_offset < sim->response_size) {
+    const uint64_t arrival_us = response_byte_arrival_us(sim, sim->response_offset);
+    if (nbytes > 0 && arrival_us > sim->now_us && arrival_us - sim->now_us > idle_us) {
+      break;
+    }
+    if (arrival_us > sim->now_us) {
+      sim->now_us = arrival_us;
+    }
+    buffer[nbytes++] = sim->response[sim->response_offset++];
+  }
+
+  if (nbytes < count) {
+    sim->now_us += idle_us;
+  }
+
+  return nbytes;
+}
+
+static ssize_t sim_serial_poll(void *const ctx, uint8_t *const buffer, const size_t count) {
+  struct modbus_sim *const sim = ctx;
+  size_t nbytes = 0;
+  while (nbytes < count && sim->response_offset < sim->response_size &&
+         response_byte_arrival_us(sim, sim->response_offset) <= sim->now_us) {
+    buffer[nbytes++] = sim->response[sim->response_offset++];
+  }
+  return nbytes;
+}
+
+static void sim_serial_set_timeout(void *const ctx, const uint32_t timeout_ms) {
+  struct modbus_sim *const sim = ctx;
+  sim->config.response_timeout_us = timeout_ms * 1000;
+}
+
+void modbus_sim_init(struct modbus_sim *const sim, const struct modbus_sim_config *const config) {
+  memset(sim, 0, sizeof(*sim));
+  sim->config = *config;
+  modbus_sim_clock = sim;
+}
+
+MYRIOTA_ModbusSerialInterface modbus_sim_serial_interface(struct modbus_sim *const sim) {
+  const MYRIOTA_ModbusSerialInterface serial_interface = {
+    .ctx = sim,
+    .init = sim_serial_init,
+    .deinit = sim_serial_deinit,
+    .read = sim_serial_read,
+    .write = sim_serial_write,
+    .poll = sim_serial_poll,
+    .set_timeout = sim_serial_set_timeout,
+  };
+  return serial_interface;
+}
+
+uint32_t modbus_sim_tick_get(void) {
+  return (modbus_sim_clock != NULL) ? (uint32_t)(modbus_sim_clock->now_us / 1000) : 0;
+}
+
+void modbus_sim_advance(struct modbus_sim *const sim, const uint32_t us) {
+  sim->now_us += us;
+}
@@ -0,0 +1,114 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// A simulated Modbus RTU slave for exercising the Modbus library on the build
+// machine. The simulator is connected to the library as its serial interface,
+// so requests written by the library are answered from the simulator's
+// register maps. Time on the simulated bus is kept by a virtual clock, which
+// advances as bytes are sent and received rather than with the host's clock.
+
+#ifndef MYRIOTA_MODBUS_SIM_H
+#define MYRIOTA_MODBUS_SIM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "myriota/modbus.h"
+
+#define MODBUS_SIM_FRAME_MAX 256
+
+struct modbus_sim_config {
+  // The address the simulated slave responds to.
+  MYRIOTA_ModbusDeviceAddress address;
+  // The baud rate, which sets the time a byte takes on the bus.
+  uint32_t baud_rate;
+  // The time from the end of a request to the start of its response.
+  uint32_t response_latency_us;
+  // Additional silence between each byte of a response.
+  uint32_t inter_byte_gap_us;
+  // The time a blocking read waits for the first byte of a response.
+  uint32_t response_timeout_us;
+
+  // The register maps, any of which may be NULL with a count of 0.
+  bool *coils;
+  size_t coils_count;
+  bool *discrete_inputs;
+  size_t discrete_inputs_count;
+  uint16_t *holding_registers;
+  size_t holding_registers_count;
+  uint16_t *input_registers;
+  size_t input_registers_count;
+
+  // Corrupt the crc16 of every nth response, 0 never.
+  uint32_t crc_error_every;
+  // Don't respond to every nth request, 0 never.
+  uint32_t no_response_every;
+  // Respond to every request with this exception code, 0 never.
+  uint8_t exception_code;
+};
+
+struct modbus_sim {
+  struct modbus_sim_config config;
+  // The virtual clock.
+  uint64_t now_us;
+
+  uint8_t request[MODBUS_SIM_FRAME_MAX];
+  size_t request_size;
+
+  uint8_t response[MODBUS_SIM_FRAME_MAX];
+  size_t response_size;
+  size_t response_offset;
+  uint64_t response_start_us;
+
+  // Counters of the simulator's activity.
+  uint32_t requests;
+  uint32_t responses;
+  uint32_t bad_requests;
+};
+
+/**
+ * Initialize a simulator and make it the source of modbus_sim_tick_get().
+ *
+ * \param[out] sim The simulator to initialize.
+ * \param[in] config The simulated slave's configuration.
+ */
+void modbus_sim_init(struct modbus_sim *const sim, const struct modbus_sim_config *const config);
+
+/**
+ * Get a serial interface connected to the simulator, including a non-blocking
+ * poll function for the asynchronous API and a set_timeout function that sets
+ * the simulator's response_timeout_us.
+ *
+ * \param[in] sim The simulator to connect to.
+ * \return the serial interface.
+ */
+MYRIOTA_ModbusSerialInterface modbus_sim_serial_interface(struct modbus_sim *const sim);
+
+/**
+ * Millisecond tick source driven by the virtual clock of the most recently
+ * initialized simulator, for the `tick_get` init option.
+ *
+ * \return the virtual time in milliseconds.
+ */
+uint32_t modbus_sim_tick_get(void);
+
+/**
+ * Advance the virtual clock, e.g. between calls to MYRIOTA_ModbusPoll().
+ *
+ * \param[in,out] sim The simulator.
+ * \param[in] us The time to advance by in microseconds.
+ */
+void modbus_sim_advance(struct modbus_sim *const sim, const uint32_t us);
+
+#endif /* MYRIOTA_MODBUS_SIM_H */
@@ -13,25 +13,18 @@
 
 #include "myriota/modbus.h"
 #include <string.h>
-
-// NOTE: you can provide your own assert
-#ifndef MODBUS_ASSERT
-#include <stdio.h>
-#define MODBUS_ASSERT(cond)                          \
-  do {                                               \
-    if (!(cond)) {                                   \
-      printf("Assert @%s:%d\n", __FILE__, __LINE__); \
-      while (1) {                                    \
-      }                                              \
-    }                                                \
-  } while (0)
-#endif
-#define MODBUS_UNREACHABLE MODBUS_ASSERT(false)
-#define MODBUS_ARRAY_SIZE(array) (sizeof(array) / sizeof(*array))
-
+#include "modbus_crc16.h"
+#include "modbus_frame.h"
+#include "modbus_internal.h"
+#include "modbus_pdu.h"
+
+// The largest ADU, override to shrink the built-in buffers when every slave's
+// responses are known to be smaller.
+#ifndef MODBUS_ADU_BUFFER_SIZE
 #define MODBUS_ADU_BUFFER_SIZE 256
-// ADU has at least a slave address, a PDU with a function code, and a crc16.
-#define MODBUS_ADU_MIN_SIZE 4
+#endif
+// A buffer must at least hold the fixed size requests and responses.
+#define MODBUS_ADU_BUFFER_MIN_SIZE 16
 // PDU is at maximum the max size of the ADU minus the slave address and the crc16.
 #define MODBUS_PDU_MAX_SIZE (MODBUS_ADU_BUFFER_SIZE - 3)
 
@@ -40,57 +33,124 @@
 #define MODBUS_INSTANCE_MAX 1
 #endif
 
-// TODO: Add support for unsupported commands
-enum modbus_function_code {
-  MODBUS_FUNCTION_CODE_READ_COILS = 0x01,
-  MODBUS_FUNCTION_CODE_READ_DISCRETE_INPUTS = 0x02,
-  MODBUS_FUNCTION_CODE_READ_HOLDING_REGISTERS = 0x03,
-  MODBUS_FUNCTION_CODE_READ_INPUT_REGISTERS = 0x04,
-  MODBUS_FUNCTION_CODE_WRITE_SINGLE_COIL = 0x05,
-  MODBUS_FUNCTION_CODE_WRITE_SINGLE_REGISTER = 0x06,
-  // MODBUS_FUNCTION_CODE_READ_EXCEPTION_STATUS = 0x07,
-  // MODBUS_FUNCTION_CODE_DIAGNOSTICS = 0x08,
-  // MODBUS_FUNCTION_CODE_COMM_EVENT_COUNTER = 0x0B,
-  // MODBUS_FUNCTION_CODE_COMM_EVENT_LOG = 0x0C,
-  MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_COILS = 0x0F,
-  MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_REGISTERS = 0x10,
-  // MODBUS_FUNCTION_CODE_REPORT_SLAVE_ID = 0x11,
-  // MODBUS_FUNCTION_CODE_READ_FILE_RECORD = 0x14,
-  // MODBUS_FUNCTION_CODE_WRITE_FILE_RECORD = 0x15,
-  // MODBUS_FUNCTION_CODE_MASK_WRITE_REGISTER = 0x16,
-  // MODBUS_FUNCTION_CODE_READ_WRITE_MULTIPLE_REGISTERS = 0x17,
-  // MODBUS_FUNCTION_CODE_READ_FIFO_QUEUE = 0x18,
-  // MODBUS_FUNCTION_CODE_ENCAPSULATED_INTERFACE_TRANSPORT = 0x2B,
-  MODBUS_FUNCTION_CODE_ERROR_BASE = 0x80,
-};
+// The number of slaves per instance whose response times are tracked for
+// adaptive timeouts, the least recently added is replaced when it is full.
+#ifndef MODBUS_TRACKED_SLAVES_MAX
+#define MODBUS_TRACKED_SLAVES_MAX 4
+#endif
+// A slave's timeout is doubled after each timeout, up to 2^MODBUS_BACKOFF_SHIFT_MAX times.
+#define MODBUS_BACKOFF_SHIFT_MAX 4
+
+// Transaction statistics, see MYRIOTA_ModbusStats. Compiled out by default.
+#ifndef MODBUS_STATS
+#define MODBUS_STATS 0
+#endif
+// The number of slaves per instance whose statistics are kept, the least
+// recently added is replaced when it is full.
+#ifndef MODBUS_STATS_SLAVES_MAX
+#define MODBUS_STATS_SLAVES_MAX 4
+#endif
+
+// How the built-in ADU buffers are allocated:
+// * split, a transmit and a receive buffer per instance,
+// * half duplex, a single buffer per instance holding the request and then the response,
+// * shared, a single buffer for all instances, so only one can have a transaction outstanding.
+#define MODBUS_ADU_BUFFER_SPLIT 1
+#define MODBUS_ADU_BUFFER_HALF_DUPLEX 2
+#define MODBUS_ADU_BUFFER_SHARED 3
+
+#ifndef MODBUS_ADU_BUFFER_MODE
+#define MODBUS_ADU_BUFFER_MODE MODBUS_ADU_BUFFER_SPLIT
+#endif
 
-// enum modbus_encapsulated_interface_type {
-//   MODBUS_ENCAPSULATED_INTERFACE_TYPE_CANOPEN_GENERAL_REFERENCE_REQUEST_AND_RESPONSE_PDU = 0x0D,
-//   MODBUS_ENCAPSULATED_INTERFACE_TYPE_READ_DEVICE_IDENTIFICATION = 0x0E,
-// };
+#if MODBUS_ADU_BUFFER_MODE == MODBUS_ADU_BUFFER_SPLIT
+#define MODBUS_ADU_BUFFERS_PER_INSTANCE 2
+#define MODBUS_ADU_BUFFER_INSTANCES MODBUS_INSTANCE_MAX
+#elif MODBUS_ADU_BUFFER_MODE == MODBUS_ADU_BUFFER_HALF_DUPLEX
+#define MODBUS_ADU_BUFFERS_PER_INSTANCE 1
+#define MODBUS_ADU_BUFFER_INSTANCES MODBUS_INSTANCE_MAX
+#elif MODBUS_ADU_BUFFER_MODE == MODBUS_ADU_BUFFER_SHARED
+#define MODBUS_ADU_BUFFERS_PER_INSTANCE 1
+#define MODBUS_ADU_BUFFER_INSTANCES 1
+#else
+#error "Unknown MODBUS_ADU_BUFFER_MODE"
+#endif
 
-struct protocol_data_unit_parser {
+// State of a transaction started with one of the MYRIOTA_ModbusBegin* functions.
+struct modbus_transaction {
+  MYRIOTA_ModbusTransactionState state;
+  MYRIOTA_ModbusDeviceAddress slave_address;
   enum modbus_function_code function_code;
-  const uint8_t *ptr;
-  const uint8_t *end;
+  size_t count;
+  size_t expected_size;
+  size_t tx_offset;
+  uint32_t start_tick;
+  uint32_t last_rx_tick;
+  uint32_t timeout_ms;
+  int result;
+  const uint8_t *payload;
+  size_t payload_size;
+};
+
+// Response time statistics of a slave, estimated as in RFC 6298 with the
+// smoothed response time scaled by 8 and its mean deviation scaled by 4.
+struct modbus_slave_timing {
+  bool valid;
+  MYRIOTA_ModbusDeviceAddress slave_address;
+  uint8_t backoff_shift;
+  uint32_t srtt_x8;
+  uint32_t rttvar_x4;
+};
+
+#if MODBUS_STATS
+struct modbus_slave_stats {
+  bool valid;
+  MYRIOTA_ModbusDeviceAddress slave_address;
+  MYRIOTA_ModbusStats stats;
 };
 
-struct application_data_uint {
-  size_t size;
-  uint8_t buffer[MODBUS_ADU_BUFFER_SIZE];
+// Statistics of an instance, and the timing of the transaction in progress.
+struct modbus_stats {
+  MYRIOTA_ModbusStats stats;
+  struct modbus_slave_stats slave_stats[MODBUS_STATS_SLAVES_MAX];
+  size_t slave_stats_next;
+  bool active;
+  bool sent;
+  uint32_t start_tick;
+  uint32_t sent_tick;
 };
+#endif
 
 struct modbus_instance {
   bool initialized;
   bool enabled;
   MYRIOTA_ModbusFramingMode framing_mode;
   MYRIOTA_ModbusSerialInterface serial_interface;
+  MYRIOTA_ModbusTickGetFn_t tick_get;
+  uint32_t response_timeout_ms;
+  uint32_t frame_idle_ms;
+  bool adaptive_timeout;
+  uint32_t adaptive_timeout_min_ms;
+  MYRIOTA_ModbusRetryPolicy retry;
+  struct modbus_slave_timing slave_timings[MODBUS_TRACKED_SLAVES_MAX];
+  size_t slave_timings_next;
+  struct modbus_transaction transaction;
+#if MODBUS_STATS
+  struct modbus_stats stats;
+#endif
+  MYRIOTA_ModbusCacheEntry *cache;
+  size_t cache_count;
+  MYRIOTA_ModbusDelayFn_t delay_ms;
+  uint32_t broadcast_turnaround_ms;
   struct application_data_uint adu_tx;
   struct application_data_uint adu_rx;
 };
 
 static struct modbus_instance modbus_instances[MODBUS_INSTANCE_MAX] = {0};
 
+static uint8_t modbus_adu_buffers[MODBUS_ADU_BUFFER_INSTANCES * MODBUS_ADU_BUFFERS_PER_INSTANCE *
+                                  MODBUS_ADU_BUFFER_SIZE];
+
 static struct modbus_instance *get_modbus_instance(const MYRIOTA_ModbusHandle handle) {
   if (handle == 0) {
     return NULL;
@@ -109,189 +169,335 @@ static struct modbus_instance *get_modbus_instance(const MYRIOTA_ModbusHandle ha
   return instance;
 }
 
-static uint16_t modbus_calulate_crc16(const uint8_t *const buffer, const size_t size) {
-  static const uint16_t lut[] = {0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
-    0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440, 0xCC01, 0x0CC0, 0x0D80, 0xCD41,
-    0x0F00, 0xCFC1, 0xCE81, 0x0E40, 0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
-    0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40, 0x1E00, 0xDEC1, 0xDF81, 0x1F40,
-    0xDD01, 0x1DC0, 0x1C80, 0xDC41, 0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
-    0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040, 0xF001, 0x30C0, 0x3180, 0xF141,
-    0x3300, 0xF3C1, 0xF281, 0x3240, 0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
-    0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41, 0xFA01, 0x3AC0, 0x3B80, 0xFB41,
-    0x3900, 0xF9C1, 0xF881, 0x3840, 0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
-    0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40, 0xE401, 0x24C0, 0x2580, 0xE541,
-    0x2700, 0xE7C1, 0xE681, 0x2640, 0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
-    0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240, 0x6600, 0xA6C1, 0xA781, 0x6740,
-    0xA501, 0x65C0, 0x6480, 0xA441, 0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
-    0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840, 0x7800, 0xB8C1, 0xB981, 0x7940,
-    0xBB01, 0x7BC0, 0x7A80, 0xBA41, 0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
-    0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640, 0x7200, 0xB2C1, 0xB381, 0x7340,
-    0xB101, 0x71C0, 0x7080, 0xB041, 0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
-    0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440, 0x9C01, 0x5CC0, 0x5D80, 0x9D41,
-    0x5F00, 0x9FC1, 0x9E81, 0x5E40, 0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
-    0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40, 0x4E00, 0x8EC1, 0x8F81, 0x4F40,
-    0x8D01, 0x4DC0, 0x4C80, 0x8C41, 0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
-    0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040};
-  uint16_t crc = 0xFFFF;
-  for (size_t i = 0; i < size; ++i) {
-    const uint8_t xor = buffer[i] ^ crc;
-    crc >>= 8;
-    crc ^= lut[xor];
-  }
-  return crc;
-}
-
-static inline uint8_t hi_u16(const uint16_t value) {
-  return (uint8_t)(value >> 8);
-}
-
-static inline uint8_t low_u16(const uint16_t value) {
-  return (uint8_t)value;
-}
-
-static inline uint16_t merge_u16(const uint8_t hi, const uint8_t low) {
-  return ((uint16_t)hi << 8) | (uint16_t)low;
-}
-
-static inline bool is_read_function_code(const enum modbus_function_code function_code) {
-  return function_code == MODBUS_FUNCTION_CODE_READ_COILS ||
-         function_code == MODBUS_FUNCTION_CODE_READ_DISCRETE_INPUTS ||
-         function_code == MODBUS_FUNCTION_CODE_READ_HOLDING_REGISTERS ||
-         function_code == MODBUS_FUNCTION_CODE_READ_INPUT_REGISTERS;
-}
-
-static inline bool is_read_register(const enum modbus_function_code function_code) {
-  return function_code == MODBUS_FUNCTION_CODE_READ_HOLDING_REGISTERS ||
-         function_code == MODBUS_FUNCTION_CODE_READ_INPUT_REGISTERS;
-}
-
-static inline bool is_write_function_code(const enum modbus_function_code function_code) {
-  return function_code == MODBUS_FUNCTION_CODE_WRITE_SINGLE_COIL ||
-         function_code == MODBUS_FUNCTION_CODE_WRITE_SINGLE_REGISTER ||
-         function_code == MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_COILS ||
-         function_code == MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_REGISTERS;
+// An instance can start a transaction when it is enabled and no asynchronous
+// transaction is outstanding, on any instance when the buffer is shared.
+static inline bool modbus_is_ready(const struct modbus_instance *const instance) {
+  if (!instance->enabled) {
+    return false;
+  }
+
+#if MODBUS_ADU_BUFFER_MODE == MODBUS_ADU_BUFFER_SHARED
+  for (size_t i = 0; i < MODBUS_ARRAY_SIZE(modbus_instances); ++i) {
+    if (modbus_instances[i].transaction.state != MODBUS_TRANSACTION_IDLE) {
+      return false;
+    }
+  }
+  return true;
+#else
+  return instance->transaction.state == MODBUS_TRANSACTION_IDLE;
+#endif
 }
 
-static inline bool is_write_multiple(const enum modbus_function_code function_code) {
-  return function_code == MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_COILS ||
-         function_code == MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_REGISTERS;
+static size_t modbus_write_request_size(const enum modbus_function_code function_code,
+  const size_t count) {
+  // A slave address, a function code, an address, (a quantity and a byte count,)
+  // the values and a crc16.
+  const size_t nbytes = (is_write_multiple_coil(function_code)) ? (count + 8 - 1) / 8 : count * 2;
+  return is_write_multiple(function_code) ? 9 + nbytes : 6 + nbytes;
+}
+
+static size_t modbus_expected_response_size(const enum modbus_function_code function_code,
+  const size_t count) {
+  if (is_read_register(function_code)) {
+    return MODBUS_ADU_READ_RESPONSE_SIZE(count * 2);
+  }
+  if (is_read_function_code(function_code)) {
+    return MODBUS_ADU_READ_RESPONSE_SIZE((count + 8 - 1) / 8);
+  }
+  if (function_code == MODBUS_FUNCTION_CODE_MASK_WRITE_REGISTER) {
+    return MODBUS_ADU_MASK_WRITE_RESPONSE_SIZE;
+  }
+  return MODBUS_ADU_WRITE_RESPONSE_SIZE;
+}
+
+// Returns the size of the frame being received given the bytes received so far.
+// Until the header has arrived the expected response size is assumed.
+static size_t modbus_response_frame_size(const struct application_data_uint *const adu,
+  const size_t expected_size) {
+  if (adu->size < 3) {
+    return expected_size;
+  }
+
+  const enum modbus_function_code function_code = adu->buffer[1];
+  if (function_code & MODBUS_FUNCTION_CODE_ERROR_BASE) {
+    return MODBUS_ADU_EXCEPTION_SIZE;
+  }
+
+  if (is_byte_count_response(function_code)) {
+    const size_t size = MODBUS_ADU_READ_RESPONSE_SIZE(adu->buffer[2]);
+    return (size > adu->capacity) ? adu->capacity : size;
+  }
+
+  return expected_size;
+}
+
+// Returns the size of the request being received given the bytes received so
+// far, or the capacity of the buffer for requests of an unsupported function
+// which end when the line goes idle.
+static size_t modbus_request_frame_size(const struct application_data_uint *const adu,
+  const size_t expected_size) {
+  if (adu->size < 2) {
+    return expected_size;
+  }
+
+  size_t size = adu->capacity;
+  const enum modbus_function_code function_code = adu->buffer[1];
+  if (is_read_function_code(function_code) ||
+      function_code == MODBUS_FUNCTION_CODE_WRITE_SINGLE_COIL ||
+      function_code == MODBUS_FUNCTION_CODE_WRITE_SINGLE_REGISTER) {
+    size = MODBUS_ADU_REQUEST_MIN_SIZE;
+  } else if (function_code == MODBUS_FUNCTION_CODE_MASK_WRITE_REGISTER) {
+    size = MODBUS_ADU_MASK_WRITE_RESPONSE_SIZE;
+  } else if (is_write_multiple(function_code)) {
+    size = MODBUS_ADU_WRITE_MULTIPLE_REQUEST_SIZE(adu->size > 6 ? adu->buffer[6] : 0);
+  } else if (function_code == MODBUS_FUNCTION_CODE_READ_WRITE_MULTIPLE_REGISTERS) {
+    size = MODBUS_ADU_READ_WRITE_REQUEST_SIZE(adu->size > 10 ? adu->buffer[10] : 0);
+  }
+
+  return (size > adu->capacity) ? adu->capacity : size;
 }
 
-static inline bool is_write_multiple_coil(const enum modbus_function_code function_code) {
-  return function_code == MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_COILS;
+#if MODBUS_STATS
+static uint8_t modbus_stats_latency_bucket(const uint32_t latency_ms) {
+  uint8_t bucket = 0;
+  for (uint32_t ms = latency_ms; ms > 0 && bucket < MODBUS_STATS_LATENCY_BUCKETS - 1; ms >>= 1) {
+    ++bucket;
+  }
+  return bucket;
 }
 
-static inline enum modbus_function_code get_error_function_code(
-  const enum modbus_function_code function_code) {
-  return function_code | MODBUS_FUNCTION_CODE_ERROR_BASE;
+static void modbus_stats_add(MYRIOTA_ModbusStats *const stats,
+  const struct modbus_stats *const timing, const int result, const uint32_t end_tick) {
+  if (timing->active) {
+    ++stats->transactions;
+  }
+  if (timing->active && timing->sent) {
+    stats->bus_busy_ms += end_tick - timing->start_tick;
+    if (result != -MODBUS_ERROR_IO_FAILURE) {
+      ++stats->latency_histogram[modbus_stats_latency_bucket(end_tick - timing->sent_tick)];
+    }
+  }
+
+  switch (-result) {
+    case MODBUS_SUCCESS:
+      break;
+    case MODBUS_ERROR_INVALID_CRC16:
+      ++stats->crc_errors;
+      break;
+    case MODBUS_ERROR_IO_FAILURE:
+      ++stats->timeouts;
+      break;
+    case MODBUS_ERROR_MALFORMED_RESPONSE:
+      ++stats->malformed;
+      break;
+    case MODBUS_ERROR_RESPONSE_FROM_WRONG_SLAVE_ADDRESS:
+      ++stats->wrong_slave;
+      break;
+    case MODBUS_ERROR_OVERFLOW:
+      ++stats->overflows;
+      break;
+    default:
+      if (-result > 0 && -result < MODBUS_STATS_EXCEPTION_CODES) {
+        ++stats->exceptions[-result];
+      }
+      break;
+  }
 }
 
-static inline void application_data_unit_pack_u8(struct application_data_uint *const adu,
-  const uint8_t value) {
-  MODBUS_ASSERT(adu != NULL);
-  MODBUS_ASSERT(adu->size < MODBUS_ADU_BUFFER_SIZE);
-  adu->buffer[adu->size++] = value;
+static MYRIOTA_ModbusStats *modbus_slave_stats_find(struct modbus_instance *const instance,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const bool add) {
+  struct modbus_stats *const stats = &instance->stats;
+  for (size_t i = 0; i < MODBUS_ARRAY_SIZE(stats->slave_stats); ++i) {
+    if (stats->slave_stats[i].valid && stats->slave_stats[i].slave_address == slave_address) {
+      return &stats->slave_stats[i].stats;
+    }
+  }
+  if (!add) {
+    return NULL;
+  }
+
+  struct modbus_slave_stats *const slave_stats = &stats->slave_stats[stats->slave_stats_next];
+  stats->slave_stats_next = (stats->slave_stats_next + 1) % MODBUS_ARRAY_SIZE(stats->slave_stats);
+  *slave_stats = (struct modbus_slave_stats){.valid = true, .slave_address = slave_address};
+  return &slave_stats->stats;
 }
 
-static inline void application_data_unit_pack_u16(struct application_data_uint *const adu,
-  const uint16_t value) {
-  MODBUS_ASSERT(adu != NULL);
-  MODBUS_ASSERT((adu->size + 1) < MODBUS_ADU_BUFFER_SIZE);
-  adu->buffer[adu->size++] = hi_u16(value);
-  adu->buffer[adu->size++] = low_u16(value);
+// Starts timing a transaction as its request is sent.
+static void modbus_stats_begin(struct modbus_instance *const instance) {
+  struct modbus_stats *const stats = &instance->stats;
+  stats->active = true;
+  stats->sent = false;
+  if (instance->tick_get != NULL) {
+    stats->start_tick = instance->tick_get();
+  }
 }
 
-static inline void application_data_unit_pack_crc16(struct application_data_uint *const adu,
-  const uint16_t crc) {
-  MODBUS_ASSERT(adu != NULL);
-  MODBUS_ASSERT((adu->size + 1) < MODBUS_ADU_BUFFER_SIZE);
-  adu->buffer[adu->size++] = low_u16(crc);
-  adu->buffer[adu->size++] = hi_u16(crc);
+static void modbus_stats_sent(struct modbus_instance *const instance) {
+  struct modbus_stats *const stats = &instance->stats;
+  if (instance->tick_get != NULL) {
+    stats->sent = true;
+    stats->sent_tick = instance->tick_get();
+  }
 }
 
-static inline void application_data_unit_pack_bytes(struct application_data_uint *const adu,
-  const uint8_t *const bytes, const size_t nbytes) {
-  MODBUS_ASSERT(adu != NULL);
-  MODBUS_ASSERT((adu->size + nbytes) <= MODBUS_ADU_BUFFER_SIZE);
-  memcpy(&adu->buffer[adu->size], bytes, nbytes);
-  adu->size += nbytes;
+// Records the result of an attempt at a transaction, which may have failed
+// before anything was sent.
+static void modbus_stats_end(struct modbus_instance *const instance,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const int result) {
+  struct modbus_stats *const stats = &instance->stats;
+  const uint32_t end_tick = (instance->tick_get != NULL) ? instance->tick_get() : 0;
+  modbus_stats_add(&stats->stats, stats, result, end_tick);
+  modbus_stats_add(modbus_slave_stats_find(instance, slave_address, true), stats, result, end_tick);
+  stats->active = false;
 }
 
-static void begin_application_data_unit_pack(struct application_data_uint *const adu,
-  const MYRIOTA_ModbusDeviceAddress slave_address, const enum modbus_function_code function_code) {
-  MODBUS_ASSERT(adu != NULL);
+// Records the result of an attempt at a blocking transaction.
+static void modbus_stats_attempt(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const int result) {
+  struct modbus_instance *const instance = get_modbus_instance(handle);
+  if (instance != NULL) {
+    modbus_stats_end(instance, slave_address, result);
+  }
+}
+#else
+static inline void modbus_stats_begin(struct modbus_instance *const instance) {
+  (void)instance;
+}
+
+static inline void modbus_stats_sent(struct modbus_instance *const instance) {
+  (void)instance;
+}
+
+static inline void modbus_stats_end(struct modbus_instance *const instance,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const int result) {
+  (void)instance;
+  (void)slave_address;
+  (void)result;
+}
+
+static inline void modbus_stats_attempt(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const int result) {
+  (void)handle;
+  (void)slave_address;
+  (void)result;
+}
+#endif
+
+static struct modbus_slave_timing *modbus_slave_timing_find(
+  struct modbus_instance *const instance, const MYRIOTA_ModbusDeviceAddress slave_address) {
+  for (size_t i = 0; i < MODBUS_ARRAY_SIZE(instance->slave_timings); ++i) {
+    struct modbus_slave_timing *const timing = &instance->slave_timings[i];
+    if (timing->valid && timing->slave_address == slave_address) {
+      return timing;
+    }
+  }
+  return NULL;
+}
+
+// Returns the response timeout for a slave, the configured worst case until
+// the slave's response time has been measured.
+static uint32_t modbus_response_timeout_ms(struct modbus_instance *const instance,
+  const MYRIOTA_ModbusDeviceAddress slave_address) {
+  const uint32_t max_ms = instance->response_timeout_ms;
+  const struct modbus_slave_timing *const timing =
+    instance->adaptive_timeout ? modbus_slave_timing_find(instance, slave_address) : NULL;
+  if (timing == NULL) {
+    return max_ms;
+  }
+
+  uint32_t timeout_ms = (timing->srtt_x8 >> 3) + timing->rttvar_x4;
+  if (timeout_ms < instance->adaptive_timeout_min_ms) {
+    timeout_ms = instance->adaptive_timeout_min_ms;
+  }
+  timeout_ms <<= timing->backoff_shift;
+  return (timeout_ms < max_ms) ? timeout_ms : max_ms;
+}
+
+static void modbus_slave_timing_sample(struct modbus_instance *const instance,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const uint32_t rtt_ms) {
+  struct modbus_slave_timing *timing = modbus_slave_timing_find(instance, slave_address);
+  if (timing == NULL) {
+    timing = &instance->slave_timings[instance->slave_timings_next];
+    instance->slave_timings_next =
+      (instance->slave_timings_next + 1) % MODBUS_ARRAY_SIZE(instance->slave_timings);
+    *timing = (struct modbus_slave_timing){
+      .valid = true,
+      .slave_address = slave_address,
+      .srtt_x8 = rtt_ms << 3,
+      .rttvar_x4 = rtt_ms << 1,
+    };
+    return;
+  }
+
+  const int32_t error = (int32_t)rtt_ms - (int32_t)(timing->srtt_x8 >> 3);
+  const int32_t deviation = (error < 0) ? -error : error;
+  timing->srtt_x8 = (uint32_t)((int32_t)timing->srtt_x8 + error);
+  timing->rttvar_x4 =
+    (uint32_t)((int32_t)timing->rttvar_x4 + deviation - (int32_t)(timing->rttvar_x4 >> 2));
+  timing->backoff_shift = 0;
+}
+
+// Backs off a slave's timeout after it failed to respond in time.
+static void modbus_slave_timing_timeout(struct modbus_instance *const instance,
+  const MYRIOTA_ModbusDeviceAddress slave_address) {
+  struct modbus_slave_timing *const timing = modbus_slave_timing_find(instance, slave_address);
+  if (timing != NULL && timing->backoff_shift < MODBUS_BACKOFF_SHIFT_MAX) {
+    ++timing->backoff_shift;
+  }
+}
+
+static int modbus_receive_frame(struct modbus_instance *const instance, const size_t expected_size,
+  const modbus_frame_size_fn frame_size_fn) {
+  MODBUS_ASSERT(instance != NULL);
+  const MYRIOTA_ModbusSerialInterface *const serial = &instance->serial_interface;
+  struct application_data_uint *const adu = &instance->adu_rx;
+  MODBUS_ASSERT(expected_size <= adu->capacity);
+
+  // Only ask the serial interface for the bytes still missing from the frame so
+  // the transaction completes as soon as the last byte arrives. A short read
+  // means the line went idle (or timed out) and the frame is over, as does the
+  // CR LF ending an ASCII frame.
   adu->size = 0;
-  application_data_unit_pack_u8(adu, slave_address);
-  application_data_unit_pack_u8(adu, function_code);
-}
-
-static void end_application_data_unit_pack(struct application_data_uint *const adu) {
-  MODBUS_ASSERT(adu != NULL);
-  const uint16_t crc16 = modbus_calulate_crc16(adu->buffer, adu->size);
-  application_data_unit_pack_crc16(adu, crc16);
-}
-
-static uint8_t protocol_data_unit_unpack_u8(struct protocol_data_unit_parser *const parser) {
-  MODBUS_ASSERT(parser != NULL);
-  MODBUS_ASSERT(parser->ptr < parser->end);
-  const uint8_t value = parser->ptr[0];
-  ++parser->ptr;
-  return value;
-}
-
-static int protocol_data_unit_parser(const struct application_data_uint *const adu,
-  const MYRIOTA_ModbusDeviceAddress slave_address_out,
-  const enum modbus_function_code function_code, struct protocol_data_unit_parser *const parser) {
-  MODBUS_ASSERT(adu != NULL);
-  MODBUS_ASSERT(parser != NULL);
-  MODBUS_ASSERT(adu->size >= MODBUS_ADU_MIN_SIZE);
-
-  // Application Data Unit (ADU)/(Protocol Data Unit (PDU) Packing Diagram
-  // | 0     | Slave Address |
-  // | 1     | Function Code |
-  // | 2*    | PDU Payload   |
-  // | N - 2 | CRC16 High    |
-  // | N - 1 | CRC16 Low     |
-  // Where N is the size of the ADU packet.
-  // * The PDU payload will be at index 2 if it exist. If the message doesn't
-  // have a payload, then index 2 will be the CRC16 High.
-  const MYRIOTA_ModbusDeviceAddress slave_address_in = adu->buffer[0];
-  parser->function_code = adu->buffer[1];
-  parser->ptr = &adu->buffer[2];
-  parser->end = parser->ptr + (adu->size - MODBUS_ADU_MIN_SIZE);
-
-  const uint8_t packed_crc16_high = adu->buffer[adu->size - 1];
-  const uint8_t packed_crc16_low = adu->buffer[adu->size - 2];
-  const uint16_t packed_crc16 = merge_u16(packed_crc16_high, packed_crc16_low);
-
-  const size_t size = adu->size - 2;
-  const uint16_t calculated_crc16 = modbus_calulate_crc16(adu->buffer, size);
-  if (packed_crc16 != calculated_crc16) {
-    return -MODBUS_ERROR_INVALID_CRC16;
-  }
-
-  if (slave_address_out != slave_address_in) {
-    return -MODBUS_ERROR_RESPONSE_FROM_WRONG_SLAVE_ADDRESS;
-  }
-
-  // Exception Responses
-  // | 1 | Function Code with Most Significant Bit set |
-  // | 2 | Exception code                              |
-  if (parser->function_code != function_code) {
-    if (parser->function_code == get_error_function_code(function_code)) {
-      const uint8_t exception_code = protocol_data_unit_unpack_u8(parser);
-      return -exception_code;
+  adu->crc16 = MODBUS_CRC16_INIT;
+  size_t frame_size = modbus_frame_wire_size(adu, expected_size);
+  while (adu->size < frame_size) {
+    const size_t requested = frame_size - adu->size;
+    uint8_t *const received = &adu->buffer[adu->size];
+    const ssize_t nbytes = serial->read(serial->ctx, received, requested);
+    if (nbytes < 0) {
+      return -MODBUS_ERROR_IO_FAILURE;
+    }
+    const size_t nreceived = ((size_t)nbytes > requested) ? requested : (size_t)nbytes;
+    modbus_frame_received(adu, received, nreceived);
+    if (nreceived < requested || modbus_frame_is_complete(adu)) {
+      break;
     }
+    frame_size = modbus_frame_size(adu, expected_size, frame_size_fn);
+  }
+
+  if (adu->size == 0) {
+    return -MODBUS_ERROR_IO_FAILURE;
+  }
+
+  const int result = modbus_frame_decode(adu);
+  if (result != MODBUS_SUCCESS) {
+    return result;
+  }
+
+  if (adu->size < MODBUS_ADU_MIN_SIZE) {
     return -MODBUS_ERROR_MALFORMED_RESPONSE;
   }
 
   return MODBUS_SUCCESS;
 }
 
-static int modbus_transmit(struct modbus_instance *const instance) {
+static int modbus_receive(struct modbus_instance *const instance, const size_t expected_size) {
+  return modbus_receive_frame(instance, expected_size, modbus_response_frame_size);
+}
+
+static int modbus_write_frame(struct modbus_instance *const instance) {
   MODBUS_ASSERT(instance != NULL);
   const MYRIOTA_ModbusSerialInterface *const serial = &instance->serial_interface;
-
   const uint8_t *tx_buffer = instance->adu_tx.buffer;
   size_t tx_nbytes = instance->adu_tx.size;
   while (tx_nbytes > 0) {
@@ -303,44 +509,91 @@ static int modbus_transmit(struct modbus_instance *const instance) {
     tx_buffer += nbytes;
   }
 
-  const ssize_t rx_nbytes =
-    serial->read(serial->ctx, instance->adu_rx.buffer, MODBUS_ADU_BUFFER_SIZE);
-  if (rx_nbytes <= 0) {
-    return -MODBUS_ERROR_IO_FAILURE;
+  return MODBUS_SUCCESS;
+}
+
+static int modbus_send(struct modbus_instance *const instance) {
+  modbus_stats_begin(instance);
+  const int result = modbus_write_frame(instance);
+  if (result != MODBUS_SUCCESS) {
+    return result;
   }
-  instance->adu_rx.size = rx_nbytes;
+  modbus_stats_sent(instance);
 
   return MODBUS_SUCCESS;
 }
 
-static int modbus_read(const MYRIOTA_ModbusHandle handle,
-  const MYRIOTA_ModbusDeviceAddress slave_address, const enum modbus_function_code function_code,
-  const MYRIOTA_ModbusDataAddress data_address, const size_t count, uint8_t *const bytes) {
-  MODBUS_ASSERT(is_read_function_code(function_code) == true);
-  MODBUS_ASSERT(bytes != NULL);
+static int modbus_transmit(struct modbus_instance *const instance, const size_t expected_size) {
+  // The request may be overwritten by the response, so note who it's for first.
+  const MYRIOTA_ModbusDeviceAddress slave_address = instance->adu_tx.buffer[0];
+  const MYRIOTA_ModbusSerialInterface *const serial = &instance->serial_interface;
+  if (instance->adaptive_timeout && serial->set_timeout != NULL) {
+    serial->set_timeout(serial->ctx, modbus_response_timeout_ms(instance, slave_address));
+  }
 
-  struct modbus_instance *instance = get_modbus_instance(handle);
-  if (instance == NULL) {
-    return -MODBUS_ERROR_INVALID_HANDLE;
+  const int result = modbus_send(instance);
+  if (result != MODBUS_SUCCESS) {
+    return result;
   }
 
-  if (!instance->enabled) {
-    return -MODBUS_ERROR_BAD_STATE;
+  if (!instance->adaptive_timeout) {
+    return modbus_receive(instance, expected_size);
   }
 
-  // For `read commands` packing descriptions see section 6.1, 6.2, 6.3, 6.4
-  // of https://modbus.org/docs/Modbus_Application_Protocol_V1_1b.pdf.
-  struct application_data_uint *const adu_tx = &instance->adu_tx;
-  begin_application_data_unit_pack(adu_tx, slave_address, function_code);
-  application_data_unit_pack_u16(adu_tx, data_address);
-  application_data_unit_pack_u16(adu_tx, count);
-  end_application_data_unit_pack(adu_tx);
+  const uint32_t start_tick = instance->tick_get();
+  const int receive_result = modbus_receive(instance, expected_size);
+  if (instance->adu_rx.size > 0) {
+    modbus_slave_timing_sample(instance, slave_address, instance->tick_get() - start_tick);
+  } else {
+    modbus_slave_timing_timeout(instance, slave_address);
+  }
+  return receive_result;
+}
 
-  const int transmit_result = modbus_transmit(instance);
-  if (transmit_result != MODBUS_SUCCESS) {
-    return transmit_result;
+// Returns whether a failed attempt at a transaction should be retried, after
+// waiting out the backoff.
+static bool modbus_should_retry(const MYRIOTA_ModbusHandle handle, const int result,
+  const uint8_t attempt) {
+  const struct modbus_instance *const instance = get_modbus_instance(handle);
+  if (instance == NULL || result >= 0 || attempt >= instance->retry.max_retries) {
+    return false;
+  }
+
+  const uint32_t error = -result;
+  if (error >= 32 || (instance->retry.retry_on & MODBUS_RETRY_ON(error)) == 0) {
+    return false;
+  }
+
+  if (instance->delay_ms != NULL && instance->retry.backoff_ms > 0) {
+    const uint8_t shift = (attempt < MODBUS_BACKOFF_SHIFT_MAX) ? attempt : MODBUS_BACKOFF_SHIFT_MAX;
+    instance->delay_ms(instance->retry.backoff_ms << shift);
+  }
+
+  return true;
+}
+
+static int modbus_broadcast_wait(const struct modbus_instance *const instance) {
+  if (instance->delay_ms != NULL) {
+    instance->delay_ms(instance->broadcast_turnaround_ms);
+  }
+  return MODBUS_SUCCESS;
+}
+
+// Slaves don't respond to a broadcast, so rather than waiting for a response
+// give them the turnaround delay to process the request.
+static int modbus_broadcast(struct modbus_instance *const instance) {
+  const int result = modbus_send(instance);
+  if (result != MODBUS_SUCCESS) {
+    return result;
   }
 
+  return modbus_broadcast_wait(instance);
+}
+
+// Parses the byte count and data of a received read response.
+static int modbus_parse_read_response(const struct modbus_instance *const instance,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const enum modbus_function_code function_code,
+  const size_t count, const uint8_t **const payload, size_t *const payload_size) {
   struct protocol_data_unit_parser parser = {0};
   const int parser_result =
     protocol_data_unit_parser(&instance->adu_rx, slave_address, function_code, &parser);
@@ -348,6 +601,10 @@ static int modbus_read(const MYRIOTA_ModbusHandle handle,
     return parser_result;
   }
 
+  if (parser.ptr >= parser.end) {
+    return -MODBUS_ERROR_MALFORMED_RESPONSE;
+  }
+
   const uint8_t nbytes = protocol_data_unit_unpack_u8(&parser);
   const bool read_register_overflow = is_read_register(function_code) && (nbytes > count * 2);
   const bool read_coil_overflow =
@@ -356,29 +613,50 @@ static int modbus_read(const MYRIOTA_ModbusHandle handle,
     return -MODBUS_ERROR_OVERFLOW;
   }
 
-  memcpy(bytes, parser.ptr, nbytes);
+  if (nbytes > (size_t)(parser.end - parser.ptr)) {
+    return -MODBUS_ERROR_MALFORMED_RESPONSE;
+  }
+
+  *payload = parser.ptr;
+  *payload_size = nbytes;
 
   return MODBUS_SUCCESS;
 }
 
-static int modbus_write(const MYRIOTA_ModbusHandle handle,
+// Transmits the packed request and parses the byte count and data of the response.
+static int modbus_read_response(struct modbus_instance *const instance,
   const MYRIOTA_ModbusDeviceAddress slave_address, const enum modbus_function_code function_code,
-  const MYRIOTA_ModbusDataAddress data_address, const size_t count, const uint8_t *const bytes) {
-  MODBUS_ASSERT(is_write_function_code(function_code) == true);
-  MODBUS_ASSERT(bytes != NULL);
-
-  struct modbus_instance *instance = get_modbus_instance(handle);
-  if (instance == NULL) {
-    return -MODBUS_ERROR_INVALID_HANDLE;
+  const size_t count, const uint8_t **const payload, size_t *const payload_size) {
+  const size_t expected_size = modbus_expected_response_size(function_code, count);
+  if (expected_size > instance->adu_rx.capacity) {
+    return -MODBUS_ERROR_OVERFLOW;
   }
 
-  if (!instance->enabled) {
-    return -MODBUS_ERROR_BAD_STATE;
+  const int transmit_result = modbus_transmit(instance, expected_size);
+  if (transmit_result != MODBUS_SUCCESS) {
+    return transmit_result;
   }
 
+  return modbus_parse_read_response(instance, slave_address, function_code, count, payload,
+    payload_size);
+}
+
+static void modbus_pack_read_request(struct application_data_uint *const adu_tx,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const enum modbus_function_code function_code,
+  const MYRIOTA_ModbusDataAddress data_address, const size_t count) {
+  // For `read commands` packing descriptions see section 6.1, 6.2, 6.3, 6.4
+  // of https://modbus.org/docs/Modbus_Application_Protocol_V1_1b.pdf.
+  begin_application_data_unit_pack(adu_tx, slave_address, function_code);
+  application_data_unit_pack_u16(adu_tx, data_address);
+  application_data_unit_pack_u16(adu_tx, count);
+  end_application_data_unit_pack(adu_tx);
+}
+
+static void modbus_pack_write_request(struct application_data_uint *const adu_tx,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const enum modbus_function_code function_code,
+  const MYRIOTA_ModbusDataAddress data_address, const size_t count, const uint8_t *const bytes) {
   // For `write commands` packing descriptions see section 6.5, 6.6, 6.11, 6.12
   // of https://modbus.org/docs/Modbus_Application_Protocol_V1_1b.pdf.
-  struct application_data_uint *const adu_tx = &instance->adu_tx;
   begin_application_data_unit_pack(adu_tx, slave_address, function_code);
   application_data_unit_pack_u16(adu_tx, data_address);
   const uint8_t nbytes = (is_write_multiple_coil(function_code)) ? (count + 8 - 1) / 8 : count * 2;
@@ -388,12 +666,10 @@ static int modbus_write(const MYRIOTA_ModbusHandle handle,
   }
   application_data_unit_pack_bytes(adu_tx, bytes, nbytes);
   end_application_data_unit_pack(adu_tx);
+}
 
-  const int transmit_result = modbus_transmit(instance);
-  if (transmit_result != MODBUS_SUCCESS) {
-    return transmit_result;
-  }
-
+static int modbus_parse_write_response(const struct modbus_instance *const instance,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const enum modbus_function_code function_code) {
   struct protocol_data_unit_parser parser = {0};
   const int parser_result =
     protocol_data_unit_parser(&instance->adu_rx, slave_address, function_code, &parser);
@@ -405,138 +681,967 @@ static int modbus_write(const MYRIOTA_ModbusHandle handle,
   return MODBUS_SUCCESS;
 }
 
-MYRIOTA_ModbusHandle MYRIOTA_ModbusInit(const MYRIOTA_ModbusInitOptions options) {
-  MYRIOTA_ModbusHandle result = -MODBUS_ERROR_INVALID_HANDLE;
-  for (size_t i = 0; i < MODBUS_ARRAY_SIZE(modbus_instances); ++i) {
-    if (modbus_instances[i].initialized == false) {
-      modbus_instances[i].initialized = true;
-      modbus_instances[i].framing_mode = options.framing_mode;
-      modbus_instances[i].serial_interface = options.serial_interface;
-      result = i + 1;
-    }
+static inline bool is_write_register(const enum modbus_function_code function_code) {
+  return function_code == MODBUS_FUNCTION_CODE_WRITE_SINGLE_REGISTER ||
+         function_code == MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_REGISTERS;
+}
+
+static bool modbus_cache_entry_is_valid(const MYRIOTA_ModbusCacheEntry *const entry) {
+  const enum modbus_function_code function_code = (enum modbus_function_code)entry->function;
+  return is_read_register(function_code) && entry->count > 0 &&
+         entry->count <= MODBUS_READ_REGISTERS_MAX && entry->bytes != NULL &&
+         (uint32_t)entry->addr + entry->count <= UINT16_MAX + 1;
+}
+
+static bool modbus_cache_entry_is_fresh(const struct modbus_instance *const instance,
+  const MYRIOTA_ModbusCacheEntry *const entry) {
+  if (!entry->valid) {
+    return false;
   }
-  return result;
+  if (entry->max_age_ms == MODBUS_CACHE_MAX_AGE_FOREVER) {
+    return true;
+  }
+  return (uint32_t)(instance->tick_get() - entry->read_tick) < entry->max_age_ms;
 }
 
-void MYRIOTA_ModbusDeinit(const MYRIOTA_ModbusHandle handle) {
-  struct modbus_instance *instance = get_modbus_instance(handle);
-  if (instance != NULL && instance->initialized == true) {
-    if (instance->enabled) {
-      instance->serial_interface.deinit(instance->serial_interface.ctx);
+// Returns the cache entry holding all of the registers of a read, else NULL.
+static MYRIOTA_ModbusCacheEntry *modbus_cache_find(const struct modbus_instance *const instance,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const enum modbus_function_code function_code,
+  const MYRIOTA_ModbusDataAddress data_address, const size_t count) {
+  for (size_t i = 0; i < instance->cache_count; ++i) {
+    MYRIOTA_ModbusCacheEntry *const entry = &instance->cache[i];
+    if (entry->slave == slave_address && entry->function == (uint8_t)function_code &&
+        data_address >= entry->addr &&
+        (uint32_t)data_address + count <= (uint32_t)entry->addr + entry->count) {
+      return entry;
     }
-    instance->enabled = false;
-    instance->initialized = false;
   }
+  return NULL;
 }
 
-int MYRIOTA_ModbusEnable(const MYRIOTA_ModbusHandle handle) {
-  struct modbus_instance *instance = get_modbus_instance(handle);
-  if (instance == NULL) {
-    return -MODBUS_ERROR_INVALID_HANDLE;
+// Invalidates the cache entries of holding registers overlapping a write,
+// which reaches every slave when broadcast.
+static void modbus_cache_invalidate(struct modbus_instance *const instance,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const MYRIOTA_ModbusDataAddress data_address,
+  const size_t count) {
+  for (size_t i = 0; i < instance->cache_count; ++i) {
+    MYRIOTA_ModbusCacheEntry *const entry = &instance->cache[i];
+    const bool same_slave = slave_address == 0 || entry->slave == slave_address;
+    const bool overlaps = (uint32_t)data_address < (uint32_t)entry->addr + entry->count &&
+                          (uint32_t)entry->addr < (uint32_t)data_address + count;
+    if (entry->function == MODBUS_READ_HOLDING_REGISTERS && same_slave && overlaps) {
+      entry->valid = false;
+    }
   }
+}
 
-  if (instance->enabled) {
-    return -MODBUS_ERROR_BAD_STATE;
+// Reads all of an entry's registers into the entry.
+static int modbus_cache_refresh(struct modbus_instance *const instance,
+  MYRIOTA_ModbusCacheEntry *const entry) {
+  const enum modbus_function_code function_code = (enum modbus_function_code)entry->function;
+  entry->valid = false;
+  modbus_pack_read_request(&instance->adu_tx, entry->slave, function_code, entry->addr,
+    entry->count);
+
+  const uint8_t *payload = NULL;
+  size_t nbytes = 0;
+  const int result =
+    modbus_read_response(instance, entry->slave, function_code, entry->count, &payload, &nbytes);
+  if (result != MODBUS_SUCCESS) {
+    return result;
   }
 
-  if (instance->serial_interface.init(instance->serial_interface.ctx) < 0) {
-    return -MODBUS_ERROR_IO_FAILURE;
+  if (nbytes != (size_t)entry->count * 2) {
+    return -MODBUS_ERROR_MALFORMED_RESPONSE;
   }
-  instance->enabled = true;
+
+  memcpy(entry->bytes, payload, nbytes);
+  entry->valid = true;
+  entry->read_tick = instance->tick_get();
 
   return MODBUS_SUCCESS;
 }
 
-int MYRIOTA_ModbusDisable(const MYRIOTA_ModbusHandle handle) {
+static int modbus_read_payload_attempt(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const MYRIOTA_ModbusReadFunction function,
+  const MYRIOTA_ModbusDataAddress data_address, const size_t count, const uint8_t **const payload,
+  size_t *const payload_size) {
+  const enum modbus_function_code function_code = (enum modbus_function_code)function;
+  MODBUS_ASSERT(is_read_function_code(function_code) == true);
+  MODBUS_ASSERT(payload != NULL);
+  MODBUS_ASSERT(payload_size != NULL);
+
   struct modbus_instance *instance = get_modbus_instance(handle);
   if (instance == NULL) {
     return -MODBUS_ERROR_INVALID_HANDLE;
   }
 
-  if (!instance->enabled) {
+  if (slave_address == MODBUS_BROADCAST_ADDRESS) {
+    return -MODBUS_ERROR_INVALID_ARGUMENT;
+  }
+
+  if (!modbus_is_ready(instance)) {
     return -MODBUS_ERROR_BAD_STATE;
   }
 
-  instance->serial_interface.deinit(instance->serial_interface.ctx);
-  instance->enabled = false;
+  MYRIOTA_ModbusCacheEntry *const entry =
+    modbus_cache_find(instance, slave_address, function_code, data_address, count);
+  if (entry != NULL) {
+    if (!modbus_cache_entry_is_fresh(instance, entry)) {
+      const int result = modbus_cache_refresh(instance, entry);
+      if (result != MODBUS_SUCCESS) {
+        return result;
+      }
+    }
+    *payload = &entry->bytes[(data_address - entry->addr) * 2];
+    *payload_size = count * 2;
+    return MODBUS_SUCCESS;
+  }
 
-  return MODBUS_SUCCESS;
+  modbus_pack_read_request(&instance->adu_tx, slave_address, function_code, data_address, count);
+
+  return modbus_read_response(instance, slave_address, function_code, count, payload,
+    payload_size);
 }
 
-void MYRIOTA_ModbusBytesSetBit(uint8_t *const bytes, const size_t count, const uint8_t bit_index,
-  const bool value) {
-  const uint8_t byte_index = bit_index / 8;
-  MODBUS_ASSERT(byte_index < count);
+int modbus_read_payload(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const MYRIOTA_ModbusReadFunction function,
+  const MYRIOTA_ModbusDataAddress data_address, const size_t count, const uint8_t **const payload,
+  size_t *const payload_size) {
+  int result = MODBUS_SUCCESS;
+  uint8_t attempt = 0;
+  do {
+    result = modbus_read_payload_attempt(handle, slave_address, function, data_address, count,
+      payload, payload_size);
+    modbus_stats_attempt(handle, slave_address, result);
+  } while (modbus_should_retry(handle, result, attempt++));
+  return result;
+}
 
-  const uint8_t bit_offset = bit_index % 8;
-  const uint8_t mask = (0x1 << bit_offset);
-  if (value) {
-    bytes[byte_index] |= mask;
-  } else {
-    bytes[byte_index] &= ~mask;
+int modbus_delay(const MYRIOTA_ModbusHandle handle, const uint32_t ms) {
+  const struct modbus_instance *const instance = get_modbus_instance(handle);
+  if (instance == NULL) {
+    return -MODBUS_ERROR_INVALID_HANDLE;
+  }
+
+  if (instance->delay_ms != NULL && ms > 0) {
+    instance->delay_ms(ms);
   }
+
+  return MODBUS_SUCCESS;
 }
 
-void MYRIOTA_ModbusBytesGetBit(const uint8_t *const bytes, const size_t count,
+static int modbus_read(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const enum modbus_function_code function_code,
+  const MYRIOTA_ModbusDataAddress data_address, const size_t count, uint8_t *const bytes) {
+  MODBUS_ASSERT(bytes != NULL);
+
+  const uint8_t *payload = NULL;
+  size_t nbytes = 0;
+  const int result = modbus_read_payload(handle, slave_address,
+    (MYRIOTA_ModbusReadFunction)function_code, data_address, count, &payload, &nbytes);
+  if (result != MODBUS_SUCCESS) {
+    return result;
+  }
+
+  memcpy(bytes, payload, nbytes);
+
+  return MODBUS_SUCCESS;
+}
+
+static int modbus_write_attempt(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const enum modbus_function_code function_code,
+  const MYRIOTA_ModbusDataAddress data_address, const size_t count, const uint8_t *const bytes) {
+  MODBUS_ASSERT(is_write_function_code(function_code) == true);
+  MODBUS_ASSERT(bytes != NULL);
+
+  struct modbus_instance *instance = get_modbus_instance(handle);
+  if (instance == NULL) {
+    return -MODBUS_ERROR_INVALID_HANDLE;
+  }
+
+  if (!modbus_is_ready(instance)) {
+    return -MODBUS_ERROR_BAD_STATE;
+  }
+
+  if (modbus_write_request_size(function_code, count) > instance->adu_tx.capacity) {
+    return -MODBUS_ERROR_OVERFLOW;
+  }
+
+  if (is_write_register(function_code)) {
+    modbus_cache_invalidate(instance, slave_address, data_address, count);
+  }
+
+  modbus_pack_write_request(&instance->adu_tx, slave_address, function_code, data_address, count,
+    bytes);
+
+  if (slave_address == MODBUS_BROADCAST_ADDRESS) {
+    return modbus_broadcast(instance);
+  }
+
+  const size_t expected_size = modbus_expected_response_size(function_code, count);
+  const int transmit_result = modbus_transmit(instance, expected_size);
+  if (transmit_result != MODBUS_SUCCESS) {
+    return transmit_result;
+  }
+
+  return modbus_parse_write_response(instance, slave_address, function_code);
+}
+
+static int modbus_write(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const enum modbus_function_code function_code,
+  const MYRIOTA_ModbusDataAddress data_address, const size_t count, const uint8_t *const bytes) {
+  int result = MODBUS_SUCCESS;
+  uint8_t attempt = 0;
+  do {
+    result = modbus_write_attempt(handle, slave_address, function_code, data_address, count, bytes);
+    modbus_stats_attempt(handle, slave_address, result);
+  } while (modbus_should_retry(handle, result, attempt++));
+  return result;
+}
+
+static int modbus_mask_write_attempt(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const MYRIOTA_ModbusDataAddress data_address,
+  const uint16_t and_mask, const uint16_t or_mask) {
+  struct modbus_instance *instance = get_modbus_instance(handle);
+  if (instance == NULL) {
+    return -MODBUS_ERROR_INVALID_HANDLE;
+  }
+
+  if (!modbus_is_ready(instance)) {
+    return -MODBUS_ERROR_BAD_STATE;
+  }
+
+  // For `mask write register` packing descriptions see section 6.16
+  // of https://modbus.org/docs/Modbus_Application_Protocol_V1_1b.pdf.
+  modbus_cache_invalidate(instance, slave_address, data_address, 1);
+
+  const enum modbus_function_code function_code = MODBUS_FUNCTION_CODE_MASK_WRITE_REGISTER;
+  struct application_data_uint *const adu_tx = &instance->adu_tx;
+  begin_application_data_unit_pack(adu_tx, slave_address, function_code);
+  application_data_unit_pack_u16(adu_tx, data_address);
+  application_data_unit_pack_u16(adu_tx, and_mask);
+  application_data_unit_pack_u16(adu_tx, or_mask);
+  end_application_data_unit_pack(adu_tx);
+
+  if (slave_address == MODBUS_BROADCAST_ADDRESS) {
+    return modbus_broadcast(instance);
+  }
+
+  const size_t expected_size = modbus_expected_response_size(function_code, 1);
+  const int transmit_result = modbus_transmit(instance, expected_size);
+  if (transmit_result != MODBUS_SUCCESS) {
+    return transmit_result;
+  }
+
+  struct protocol_data_unit_parser parser = {0};
+  const int parser_result =
+    protocol_data_unit_parser(&instance->adu_rx, slave_address, function_code, &parser);
+  if (parser_result != MODBUS_SUCCESS) {
+    return parser_result;
+  }
+
+  // The response is an echo of the request.
+  if (parser.end - parser.ptr != 6) {
+    return -MODBUS_ERROR_MALFORMED_RESPONSE;
+  }
+  const uint8_t *const echo = parser.ptr;
+  if (merge_u16(echo[0], echo[1]) != data_address || merge_u16(echo[2], echo[3]) != and_mask ||
+      merge_u16(echo[4], echo[5]) != or_mask) {
+    return -MODBUS_ERROR_MALFORMED_RESPONSE;
+  }
+
+  return MODBUS_SUCCESS;
+}
+
+static int modbus_mask_write(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const MYRIOTA_ModbusDataAddress data_address,
+  const uint16_t and_mask, const uint16_t or_mask) {
+  int result = MODBUS_SUCCESS;
+  uint8_t attempt = 0;
+  do {
+    result = modbus_mask_write_attempt(handle, slave_address, data_address, and_mask, or_mask);
+    modbus_stats_attempt(handle, slave_address, result);
+  } while (modbus_should_retry(handle, result, attempt++));
+  return result;
+}
+
+static int modbus_read_write_attempt(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const MYRIOTA_ModbusDataAddress read_address,
+  const size_t read_count, uint8_t *const read_bytes, const MYRIOTA_ModbusDataAddress write_address,
+  const size_t write_count, const uint8_t *const write_bytes) {
+  MODBUS_ASSERT(read_bytes != NULL);
+  MODBUS_ASSERT(write_bytes != NULL);
+
+  struct modbus_instance *instance = get_modbus_instance(handle);
+  if (instance == NULL) {
+    return -MODBUS_ERROR_INVALID_HANDLE;
+  }
+
+  if (!modbus_is_ready(instance)) {
+    return -MODBUS_ERROR_BAD_STATE;
+  }
+
+  if (slave_address == MODBUS_BROADCAST_ADDRESS || read_count == 0 ||
+      read_count > MODBUS_READ_WRITE_READ_REGISTERS_MAX ||
+      write_count == 0 || write_count > MODBUS_READ_WRITE_WRITE_REGISTERS_MAX) {
+    return -MODBUS_ERROR_INVALID_ARGUMENT;
+  }
+
+  // For `read/write multiple registers` packing descriptions see section 6.17
+  // of https://modbus.org/docs/Modbus_Application_Protocol_V1_1b.pdf. The write
+  // is performed before the read.
+  const enum modbus_function_code function_code =
+    MODBUS_FUNCTION_CODE_READ_WRITE_MULTIPLE_REGISTERS;
+  const uint8_t write_nbytes = write_count * 2;
+  struct application_data_uint *const adu_tx = &instance->adu_tx;
+  if (13 + (size_t)write_nbytes > adu_tx->capacity) {
+    return -MODBUS_ERROR_OVERFLOW;
+  }
+
+  modbus_cache_invalidate(instance, slave_address, write_address, write_count);
+
+  begin_application_data_unit_pack(adu_tx, slave_address, function_code);
+  application_data_unit_pack_u16(adu_tx, read_address);
+  application_data_unit_pack_u16(adu_tx, read_count);
+  application_data_unit_pack_u16(adu_tx, write_address);
+  application_data_unit_pack_u16(adu_tx, write_count);
+  application_data_unit_pack_u8(adu_tx, write_nbytes);
+  application_data_unit_pack_bytes(adu_tx, write_bytes, write_nbytes);
+  end_application_data_unit_pack(adu_tx);
+
+  const uint8_t *payload = NULL;
+  size_t nbytes = 0;
+  const int result = modbus_read_response(instance, slave_address, function_code, read_count,
+    &payload, &nbytes);
+  if (result != MODBUS_SUCCESS) {
+    return result;
+  }
+
+  memcpy(read_bytes, payload, nbytes);
+
+  return MODBUS_SUCCESS;
+}
+
+static int modbus_read_write(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const MYRIOTA_ModbusDataAddress read_address,
+  const size_t read_count, uint8_t *const read_bytes, const MYRIOTA_ModbusDataAddress write_address,
+  const size_t write_count, const uint8_t *const write_bytes) {
+  int result = MODBUS_SUCCESS;
+  uint8_t attempt = 0;
+  do {
+    result = modbus_read_write_attempt(handle, slave_address, read_address, read_count,
+      read_bytes, write_address, write_count, write_bytes);
+    modbus_stats_attempt(handle, slave_address, result);
+  } while (modbus_should_retry(handle, result, attempt++));
+  return result;
+}
+
+static void modbus_transaction_finish(struct modbus_instance *const instance, const int result) {
+  struct modbus_transaction *const transaction = &instance->transaction;
+  transaction->result = result;
+  if (result == MODBUS_SUCCESS && transaction->slave_address != MODBUS_BROADCAST_ADDRESS) {
+    if (is_byte_count_response(transaction->function_code)) {
+      transaction->result = modbus_parse_read_response(instance, transaction->slave_address,
+        transaction->function_code, transaction->count, &transaction->payload,
+        &transaction->payload_size);
+    } else {
+      transaction->result = modbus_parse_write_response(instance, transaction->slave_address,
+        transaction->function_code);
+    }
+  }
+  transaction->state = (transaction->result == MODBUS_SUCCESS) ? MODBUS_TRANSACTION_DONE :
+                                                                 MODBUS_TRANSACTION_ERROR;
+  modbus_stats_end(instance, transaction->slave_address, transaction->result);
+}
+
+static void modbus_transaction_begin(struct modbus_instance *const instance,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const enum modbus_function_code function_code,
+  const size_t count) {
+  struct modbus_transaction *const transaction = &instance->transaction;
+  transaction->state = MODBUS_TRANSACTION_TRANSMITTING;
+  transaction->slave_address = slave_address;
+  transaction->function_code = function_code;
+  transaction->count = count;
+  transaction->expected_size = modbus_expected_response_size(function_code, count);
+  transaction->tx_offset = 0;
+  transaction->result = MODBUS_SUCCESS;
+  transaction->payload = NULL;
+  transaction->payload_size = 0;
+  modbus_stats_begin(instance);
+}
+
+static void modbus_transaction_transmit(struct modbus_instance *const instance) {
+  struct modbus_transaction *const transaction = &instance->transaction;
+  const MYRIOTA_ModbusSerialInterface *const serial = &instance->serial_interface;
+  const struct application_data_uint *const adu_tx = &instance->adu_tx;
+
+  // Write whatever the serial interface accepts, the rest is left for the next poll.
+  const size_t tx_nbytes = adu_tx->size - transaction->tx_offset;
+  const ssize_t nbytes =
+    serial->write(serial->ctx, &adu_tx->buffer[transaction->tx_offset], tx_nbytes);
+  if (nbytes < 0) {
+    modbus_transaction_finish(instance, -MODBUS_ERROR_IO_FAILURE);
+    return;
+  }
+  transaction->tx_offset += ((size_t)nbytes > tx_nbytes) ? tx_nbytes : (size_t)nbytes;
+  if (transaction->tx_offset < adu_tx->size) {
+    return;
+  }
+  modbus_stats_sent(instance);
+
+  instance->adu_rx.size = 0;
+  instance->adu_rx.crc16 = MODBUS_CRC16_INIT;
+  if (instance->tick_get != NULL) {
+    transaction->start_tick = instance->tick_get();
+    transaction->last_rx_tick = transaction->start_tick;
+  }
+  transaction->timeout_ms = modbus_response_timeout_ms(instance, transaction->slave_address);
+  transaction->state = MODBUS_TRANSACTION_AWAITING;
+}
+
+static void modbus_transaction_receive(struct modbus_instance *const instance) {
+  struct modbus_transaction *const transaction = &instance->transaction;
+  const MYRIOTA_ModbusSerialInterface *const serial = &instance->serial_interface;
+  struct application_data_uint *const adu = &instance->adu_rx;
+
+  // A broadcast is done once the slaves have had the turnaround delay to process it.
+  if (transaction->slave_address == MODBUS_BROADCAST_ADDRESS) {
+    if (instance->tick_get == NULL) {
+      modbus_transaction_finish(instance, modbus_broadcast_wait(instance));
+    } else if ((uint32_t)(instance->tick_get() - transaction->start_tick) >=
+               instance->broadcast_turnaround_ms) {
+      modbus_transaction_finish(instance, MODBUS_SUCCESS);
+    }
+    return;
+  }
+
+  // Without a non-blocking read the response is received in a single poll.
+  if (serial->poll == NULL) {
+    modbus_transaction_finish(instance, modbus_receive(instance, transaction->expected_size));
+    return;
+  }
+
+  const uint32_t now_tick = instance->tick_get();
+  size_t frame_size =
+    modbus_frame_size(adu, transaction->expected_size, modbus_response_frame_size);
+  while (adu->size < frame_size && !modbus_frame_is_complete(adu)) {
+    const size_t requested = frame_size - adu->size;
+    uint8_t *const received = &adu->buffer[adu->size];
+    const ssize_t nbytes = serial->poll(serial->ctx, received, requested);
+    if (nbytes < 0) {
+      modbus_transaction_finish(instance, -MODBUS_ERROR_IO_FAILURE);
+      return;
+    }
+    const size_t nreceived = ((size_t)nbytes > requested) ? requested : (size_t)nbytes;
+    if (nreceived > 0) {
+      modbus_frame_received(adu, received, nreceived);
+      transaction->last_rx_tick = now_tick;
+    }
+    if (nreceived < requested) {
+      break;
+    }
+    frame_size = modbus_frame_size(adu, transaction->expected_size, modbus_response_frame_size);
+  }
+
+  // The frame is over once it is complete, or when the line goes idle part way
+  // through it. Tick arithmetic is unsigned so it is safe across wrap around.
+  const bool complete = adu->size >= frame_size || modbus_frame_is_complete(adu);
+  const uint32_t idle_ms = now_tick - transaction->last_rx_tick;
+  const uint32_t waited_ms = now_tick - transaction->start_tick;
+  const bool idle = adu->size > 0 && idle_ms > instance->frame_idle_ms;
+  const bool timeout = adu->size == 0 && waited_ms >= transaction->timeout_ms;
+  if (instance->adaptive_timeout && (complete || idle)) {
+    modbus_slave_timing_sample(instance, transaction->slave_address,
+      transaction->last_rx_tick - transaction->start_tick);
+  } else if (instance->adaptive_timeout && timeout) {
+    modbus_slave_timing_timeout(instance, transaction->slave_address);
+  }
+
+  if (complete || idle) {
+    int result = modbus_frame_decode(adu);
+    if (result == MODBUS_SUCCESS && adu->size < MODBUS_ADU_MIN_SIZE) {
+      result = -MODBUS_ERROR_MALFORMED_RESPONSE;
+    }
+    modbus_transaction_finish(instance, result);
+  } else if (timeout) {
+    modbus_transaction_finish(instance, -MODBUS_ERROR_IO_FAILURE);
+  }
+}
+
+static void modbus_instance_buffers_init(struct modbus_instance *const instance,
+  const size_t index, const MYRIOTA_ModbusInitOptions *const options) {
+  const size_t instance_buffer_size = MODBUS_ADU_BUFFERS_PER_INSTANCE * MODBUS_ADU_BUFFER_SIZE;
+  const size_t buffer_index = index % MODBUS_ADU_BUFFER_INSTANCES;
+  uint8_t *buffer = &modbus_adu_buffers[buffer_index * instance_buffer_size];
+  size_t size = instance_buffer_size;
+  if (options->adu_buffer != NULL) {
+    buffer = options->adu_buffer;
+    size = options->adu_buffer_size;
+  }
+
+  const size_t buffer_size = size / MODBUS_ADU_BUFFERS_PER_INSTANCE;
+  const size_t capacity = modbus_frame_capacity(options->framing_mode, buffer_size);
+  instance->adu_tx = (struct application_data_uint){
+    .capacity = capacity,
+    .framing_mode = options->framing_mode,
+    .buffer = buffer,
+  };
+  instance->adu_rx = (struct application_data_uint){
+    .capacity = capacity,
+    .framing_mode = options->framing_mode,
+    .buffer = &buffer[(MODBUS_ADU_BUFFERS_PER_INSTANCE - 1) * buffer_size],
+  };
+}
+
+MYRIOTA_ModbusHandle MYRIOTA_ModbusInit(const MYRIOTA_ModbusInitOptions options) {
+  if (options.framing_mode != MODBUS_FRAMING_MODE_RTU &&
+      options.framing_mode != MODBUS_FRAMING_MODE_ASCII) {
+    return 0;
+  }
+
+  const size_t buffer_min_size = (options.framing_mode == MODBUS_FRAMING_MODE_ASCII) ?
+                                   2 * MODBUS_ADU_BUFFER_MIN_SIZE + 1 :
+                                   MODBUS_ADU_BUFFER_MIN_SIZE;
+  if (options.adu_buffer != NULL &&
+      options.adu_buffer_size < MODBUS_ADU_BUFFERS_PER_INSTANCE * buffer_min_size) {
+    return 0;
+  }
+
+  if (options.cache_count > 0 && (options.cache == NULL || options.tick_get == NULL)) {
+    return 0;
+  }
+
+  if (options.adaptive_timeout && (options.tick_get == NULL || options.response_timeout_ms == 0)) {
+    return 0;
+  }
+
+  // A zero timeout would end every asynchronous response on its first empty poll.
+  if (options.serial_interface.poll != NULL && options.response_timeout_ms == 0) {
+    return 0;
+  }
+  for (size_t i = 0; i < options.cache_count; ++i) {
+    if (!modbus_cache_entry_is_valid(&options.cache[i])) {
+      return 0;
+    }
+  }
+
+  MYRIOTA_ModbusHandle result = -MODBUS_ERROR_INVALID_HANDLE;
+  for (size_t i = 0; i < MODBUS_ARRAY_SIZE(modbus_instances); ++i) {
+    if (modbus_instances[i].initialized == false) {
+      modbus_instances[i].initialized = true;
+      modbus_instances[i].framing_mode = options.framing_mode;
+      modbus_instances[i].serial_interface = options.serial_interface;
+      modbus_instances[i].tick_get = options.tick_get;
+      modbus_instances[i].response_timeout_ms = options.response_timeout_ms;
+      modbus_instances[i].frame_idle_ms = options.frame_idle_ms;
+      modbus_instances[i].transaction.state = MODBUS_TRANSACTION_IDLE;
+      modbus_instance_buffers_init(&modbus_instances[i], i, &options);
+      modbus_instances[i].adaptive_timeout = options.adaptive_timeout;
+      modbus_instances[i].adaptive_timeout_min_ms = (options.adaptive_timeout_min_ms != 0) ?
+                                                      options.adaptive_timeout_min_ms :
+                                                      MODBUS_ADAPTIVE_TIMEOUT_MIN_MS_DEFAULT;
+      modbus_instances[i].retry = options.retry;
+      if (modbus_instances[i].retry.retry_on == 0) {
+        modbus_instances[i].retry.retry_on = MODBUS_RETRY_ON_DEFAULT;
+      }
+      memset(modbus_instances[i].slave_timings, 0, sizeof(modbus_instances[i].slave_timings));
+#if MODBUS_STATS
+      memset(&modbus_instances[i].stats, 0, sizeof(modbus_instances[i].stats));
+#endif
+      modbus_instances[i].slave_timings_next = 0;
+      modbus_instances[i].delay_ms = options.delay_ms;
+      modbus_instances[i].broadcast_turnaround_ms = (options.broadcast_turnaround_ms != 0) ?
+                                                      options.broadcast_turnaround_ms :
+                                                      MODBUS_BROADCAST_TURNAROUND_MS_DEFAULT;
+      modbus_instances[i].cache = options.cache;
+      modbus_instances[i].cache_count = options.cache_count;
+      for (size_t j = 0; j < options.cache_count; ++j) {
+        options.cache[j].valid = false;
+      }
+      result = i + 1;
+      break;
+    }
+  }
+  return result;
+}
+
+void MYRIOTA_ModbusDeinit(const MYRIOTA_ModbusHandle handle) {
+  struct modbus_instance *instance = get_modbus_instance(handle);
+  if (instance != NULL && instance->initialized == true) {
+    if (instance->enabled) {
+      instance->serial_interface.deinit(instance->serial_interface.ctx);
+    }
+    instance->enabled = false;
+    instance->initialized = false;
+    instance->transaction.state = MODBUS_TRANSACTION_IDLE;
+    instance->cache = NULL;
+    instance->cache_count = 0;
+  }
+}
+
+int MYRIOTA_ModbusEnable(const MYRIOTA_ModbusHandle handle) {
+  struct modbus_instance *instance = get_modbus_instance(handle);
+  if (instance == NULL) {
+    return -MODBUS_ERROR_INVALID_HANDLE;
+  }
+
+  if (instance->enabled) {
+    return -MODBUS_ERROR_BAD_STATE;
+  }
+
+  if (instance->serial_interface.init(instance->serial_interface.ctx) < 0) {
+    return -MODBUS_ERROR_IO_FAILURE;
+  }
+  instance->enabled = true;
+
+  return MODBUS_SUCCESS;
+}
+
+int MYRIOTA_ModbusDisable(const MYRIOTA_ModbusHandle handle) {
+  struct modbus_instance *instance = get_modbus_instance(handle);
+  if (instance == NULL) {
+    return -MODBUS_ERROR_INVALID_HANDLE;
+  }
+
+  if (!instance->enabled) {
+    return -MODBUS_ERROR_BAD_STATE;
+  }
+
+  instance->serial_interface.deinit(instance->serial_interface.ctx);
+  instance->enabled = false;
+  instance->transaction.state = MODBUS_TRANSACTION_IDLE;
+
+  return MODBUS_SUCCESS;
+}
+
+void MYRIOTA_ModbusGetRamUsage(MYRIOTA_ModbusRamUsage *const usage) {
+  MODBUS_ASSERT(usage != NULL);
+  usage->instances = sizeof(modbus_instances);
+  usage->buffers = sizeof(modbus_adu_buffers);
+  usage->buffers_split = MODBUS_INSTANCE_MAX * 2 * MODBUS_ADU_BUFFER_SIZE;
+}
+
+int MYRIOTA_ModbusCacheInvalidate(const MYRIOTA_ModbusHandle handle) {
+  struct modbus_instance *instance = get_modbus_instance(handle);
+  if (instance == NULL) {
+    return -MODBUS_ERROR_INVALID_HANDLE;
+  }
+
+  for (size_t i = 0; i < instance->cache_count; ++i) {
+    instance->cache[i].valid = false;
+  }
+
+  return MODBUS_SUCCESS;
+}
+
+int MYRIOTA_ModbusGetSlaveTimeout(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, uint32_t *const timeout_ms) {
+  MODBUS_ASSERT(timeout_ms != NULL);
+  struct modbus_instance *instance = get_modbus_instance(handle);
+  if (instance == NULL) {
+    return -MODBUS_ERROR_INVALID_HANDLE;
+  }
+
+  *timeout_ms = modbus_response_timeout_ms(instance, slave);
+
+  return MODBUS_SUCCESS;
+}
+
+#if MODBUS_STATS
+int MYRIOTA_ModbusGetStats(const MYRIOTA_ModbusHandle handle, MYRIOTA_ModbusStats *const stats) {
+  MODBUS_ASSERT(stats != NULL);
+  const struct modbus_instance *const instance = get_modbus_instance(handle);
+  if (instance == NULL) {
+    return -MODBUS_ERROR_INVALID_HANDLE;
+  }
+
+  *stats = instance->stats.stats;
+
+  return MODBUS_SUCCESS;
+}
+
+int MYRIOTA_ModbusGetSlaveStats(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, MYRIOTA_ModbusStats *const stats) {
+  MODBUS_ASSERT(stats != NULL);
+  struct modbus_instance *const instance = get_modbus_instance(handle);
+  if (instance == NULL) {
+    return -MODBUS_ERROR_INVALID_HANDLE;
+  }
+
+  const MYRIOTA_ModbusStats *const slave_stats = modbus_slave_stats_find(instance, slave, false);
+  if (slave_stats == NULL) {
+    return -MODBUS_ERROR_INVALID_ARGUMENT;
+  }
+  *stats = *slave_stats;
+
+  return MODBUS_SUCCESS;
+}
+
+int MYRIOTA_ModbusResetStats(const MYRIOTA_ModbusHandle handle) {
+  struct modbus_instance *const instance = get_modbus_instance(handle);
+  if (instance == NULL) {
+    return -MODBUS_ERROR_INVALID_HANDLE;
+  }
+
+  // Keep the timing of a transaction in progress.
+  struct modbus_stats *const stats = &instance->stats;
+  memset(&stats->stats, 0, sizeof(stats->stats));
+  memset(stats->slave_stats, 0, sizeof(stats->slave_stats));
+  stats->slave_stats_next = 0;
+
+  return MODBUS_SUCCESS;
+}
+#endif
+
+uint32_t MYRIOTA_ModbusInterFrameDelayUs(const uint32_t baud_rate) {
+  MODBUS_ASSERT(baud_rate > 0);
+
+  // See section 2.5.1.1 of
+  // https://modbus.org/docs/Modbus_over_serial_line_V1_02.pdf. A character is
+  // 11 bits on the wire (start, 8 data, parity/stop, stop).
+  if (baud_rate > 19200) {
+    return 1750;
+  }
+  const uint32_t us_per_3_5_chars = 38500000;  // 3.5 characters * 11 bits * 1000000us
+  return (us_per_3_5_chars + baud_rate - 1) / baud_rate;
+}
+
+void MYRIOTA_ModbusBytesSetBit(uint8_t *const bytes, const size_t count, const uint8_t bit_index,
+  const bool value) {
+  const uint8_t byte_index = bit_index / 8;
+  MODBUS_ASSERT(byte_index < count);
+
+  const uint8_t bit_offset = bit_index % 8;
+  const uint8_t mask = (0x1 << bit_offset);
+  if (value) {
+    bytes[byte_index] |= mask;
+  } else {
+    bytes[byte_index] &= ~mask;
+  }
+}
+
+void MYRIOTA_ModbusBytesGetBit(const uint8_t *const bytes, const size_t count,
   const uint8_t bit_index, bool *const value) {
   const uint8_t byte_index = bit_index / 8;
   MODBUS_ASSERT(byte_index < count);
 
-  const uint8_t bit_offset = bit_index % 8;
-  const uint8_t mask = (0x1 << bit_offset);
-  *value = ((bytes[byte_index] & mask) > 0);
-}
+  const uint8_t bit_offset = bit_index % 8;
+  const uint8_t mask = (0x1 << bit_offset);
+  *value = ((bytes[byte_index] & mask) > 0);
+}
+
+int MYRIOTA_ModbusReadCoils(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress addr, const size_t count,
+  uint8_t *const bytes) {
+  return modbus_read(handle, slave, MODBUS_FUNCTION_CODE_READ_COILS, addr, count, bytes);
+}
+
+int MYRIOTA_ModbusReadDiscreteInputs(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress addr, const size_t count,
+  uint8_t *const bytes) {
+  return modbus_read(handle, slave, MODBUS_FUNCTION_CODE_READ_DISCRETE_INPUTS, addr, count, bytes);
+}
+
+int MYRIOTA_ModbusReadHoldingRegisters(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress addr, const size_t count,
+  uint8_t *const bytes) {
+  return modbus_read(handle, slave, MODBUS_FUNCTION_CODE_READ_HOLDING_REGISTERS, addr, count,
+    bytes);
+}
+
+int MYRIOTA_ModbusReadInputRegisters(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress addr, const size_t count,
+  uint8_t *const bytes) {
+  return modbus_read(handle, slave, MODBUS_FUNCTION_CODE_READ_INPUT_REGISTERS, addr, count, bytes);
+}
+
+int MYRIOTA_ModbusWriteCoil(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress addr,
+  const uint16_t word) {
+  const uint8_t *const bytes = (const uint8_t *const)&word;
+  return modbus_write(handle, slave, MODBUS_FUNCTION_CODE_WRITE_SINGLE_COIL, addr, 1, bytes);
+}
+
+int MYRIOTA_ModbusWriteHoldingRegister(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress addr,
+  const uint16_t word) {
+  const uint8_t *const bytes = (const uint8_t *const)&word;
+  return modbus_write(handle, slave, MODBUS_FUNCTION_CODE_WRITE_SINGLE_REGISTER, addr, 1, bytes);
+}
+
+int MYRIOTA_ModbusWriteCoils(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress addr, const size_t count,
+  const uint8_t *const bytes) {
+  return modbus_write(handle, slave, MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_COILS, addr, count, bytes);
+}
+
+int MYRIOTA_ModbusWriteHoldingRegisters(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress addr, const size_t count,
+  const uint8_t *const bytes) {
+  return modbus_write(handle, slave, MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_REGISTERS, addr, count,
+    bytes);
+}
+
+int MYRIOTA_ModbusMaskWriteHoldingRegister(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress addr,
+  const uint16_t and_mask, const uint16_t or_mask) {
+  return modbus_mask_write(handle, slave, addr, and_mask, or_mask);
+}
+
+int MYRIOTA_ModbusReadWriteHoldingRegisters(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress read_addr,
+  const size_t read_count, uint8_t *const read_bytes, const MYRIOTA_ModbusDataAddress write_addr,
+  const size_t write_count, const uint8_t *const write_bytes) {
+  return modbus_read_write(handle, slave, read_addr, read_count, read_bytes, write_addr,
+    write_count, write_bytes);
+}
+
+int MYRIOTA_ModbusBeginRead(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusReadFunction function,
+  const MYRIOTA_ModbusDataAddress addr, const size_t count) {
+  const enum modbus_function_code function_code = (enum modbus_function_code)function;
+  if (!is_read_function_code(function_code)) {
+    return -MODBUS_ERROR_INVALID_ARGUMENT;
+  }
+
+  struct modbus_instance *instance = get_modbus_instance(handle);
+  if (instance == NULL) {
+    return -MODBUS_ERROR_INVALID_HANDLE;
+  }
+
+  if (!modbus_is_ready(instance)) {
+    return -MODBUS_ERROR_BAD_STATE;
+  }
+
+  if (instance->serial_interface.poll != NULL && instance->tick_get == NULL) {
+    return -MODBUS_ERROR_INVALID_ARGUMENT;
+  }
+
+  if (slave == MODBUS_BROADCAST_ADDRESS) {
+    return -MODBUS_ERROR_INVALID_ARGUMENT;
+  }
+
+  if (modbus_expected_response_size(function_code, count) > instance->adu_rx.capacity) {
+    modbus_stats_end(instance, slave, -MODBUS_ERROR_OVERFLOW);
+    return -MODBUS_ERROR_OVERFLOW;
+  }
+
+  modbus_pack_read_request(&instance->adu_tx, slave, function_code, addr, count);
+  modbus_transaction_begin(instance, slave, function_code, count);
+
+  return MODBUS_SUCCESS;
+}
+
+int MYRIOTA_ModbusBeginWrite(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusWriteFunction function,
+  const MYRIOTA_ModbusDataAddress addr, const size_t count, const uint8_t *const bytes) {
+  MODBUS_ASSERT(bytes != NULL);
+  const enum modbus_function_code function_code = (enum modbus_function_code)function;
+  if (!is_write_function_code(function_code)) {
+    return -MODBUS_ERROR_INVALID_ARGUMENT;
+  }
+
+  struct modbus_instance *instance = get_modbus_instance(handle);
+  if (instance == NULL) {
+    return -MODBUS_ERROR_INVALID_HANDLE;
+  }
+
+  if (!modbus_is_ready(instance)) {
+    return -MODBUS_ERROR_BAD_STATE;
+  }
+
+  if (instance->serial_interface.poll != NULL && instance->tick_get == NULL) {
+    return -MODBUS_ERROR_INVALID_ARGUMENT;
+  }
 
-int MYRIOTA_ModbusReadCoils(const MYRIOTA_ModbusHandle handle,
-  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress addr, const size_t count,
-  uint8_t *const bytes) {
-  return modbus_read(handle, slave, MODBUS_FUNCTION_CODE_READ_COILS, addr, count, bytes);
-}
+  if (modbus_write_request_size(function_code, count) > instance->adu_tx.capacity) {
+    modbus_stats_end(instance, slave, -MODBUS_ERROR_OVERFLOW);
+    return -MODBUS_ERROR_OVERFLOW;
+  }
 
-int MYRIOTA_ModbusReadDiscreteInputs(const MYRIOTA_ModbusHandle handle,
-  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress addr, const size_t count,
-  uint8_t *const bytes) {
-  return modbus_read(handle, slave, MODBUS_FUNCTION_CODE_READ_DISCRETE_INPUTS, addr, count, bytes);
-}
+  if (is_write_register(function_code)) {
+    modbus_cache_invalidate(instance, slave, addr, count);
+  }
 
-int MYRIOTA_ModbusReadHoldingRegisters(const MYRIOTA_ModbusHandle handle,
-  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress addr, const size_t count,
-  uint8_t *const bytes) {
-  return modbus_read(handle, slave, MODBUS_FUNCTION_CODE_READ_HOLDING_REGISTERS, addr, count,
-    bytes);
-}
+  modbus_pack_write_request(&instance->adu_tx, slave, function_code, addr, count, bytes);
+  modbus_transaction_begin(instance, slave, function_code, count);
 
-int MYRIOTA_ModbusReadInputRegisters(const MYRIOTA_ModbusHandle handle,
-  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress addr, const size_t count,
-  uint8_t *const bytes) {
-  return modbus_read(handle, slave, MODBUS_FUNCTION_CODE_READ_INPUT_REGISTERS, addr, count, bytes);
+  return MODBUS_SUCCESS;
 }
 
-int MYRIOTA_ModbusWriteCoil(const MYRIOTA_ModbusHandle handle,
-  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress addr,
-  const uint16_t word) {
-  const uint8_t *const bytes = (const uint8_t *const)&word;
-  return modbus_write(handle, slave, MODBUS_FUNCTION_CODE_WRITE_SINGLE_COIL, addr, 1, bytes);
+int MYRIOTA_ModbusPoll(const MYRIOTA_ModbusHandle handle) {
+  struct modbus_instance *instance = get_modbus_instance(handle);
+  if (instance == NULL) {
+    return -MODBUS_ERROR_INVALID_HANDLE;
+  }
+
+  switch (instance->transaction.state) {
+    case MODBUS_TRANSACTION_TRANSMITTING:
+      modbus_transaction_transmit(instance);
+      break;
+    case MODBUS_TRANSACTION_AWAITING:
+      modbus_transaction_receive(instance);
+      break;
+    case MODBUS_TRANSACTION_IDLE:
+    case MODBUS_TRANSACTION_DONE:
+    case MODBUS_TRANSACTION_ERROR:
+      break;
+  }
+
+  return instance->transaction.state;
 }
 
-int MYRIOTA_ModbusWriteHoldingRegister(const MYRIOTA_ModbusHandle handle,
-  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress addr,
-  const uint16_t word) {
-  const uint8_t *const bytes = (const uint8_t *const)&word;
-  return modbus_write(handle, slave, MODBUS_FUNCTION_CODE_WRITE_SINGLE_REGISTER, addr, 1, bytes);
+int MYRIOTA_ModbusComplete(const MYRIOTA_ModbusHandle handle, uint8_t *const bytes,
+  const size_t size) {
+  struct modbus_instance *instance = get_modbus_instance(handle);
+  if (instance == NULL) {
+    return -MODBUS_ERROR_INVALID_HANDLE;
+  }
+
+  struct modbus_transaction *const transaction = &instance->transaction;
+  if (transaction->state != MODBUS_TRANSACTION_DONE &&
+      transaction->state != MODBUS_TRANSACTION_ERROR) {
+    return -MODBUS_ERROR_BAD_STATE;
+  }
+
+  int result = transaction->result;
+  if (result == MODBUS_SUCCESS && transaction->payload_size > 0) {
+    if (bytes == NULL || size < transaction->payload_size) {
+      result = -MODBUS_ERROR_OVERFLOW;
+    } else {
+      memcpy(bytes, transaction->payload, transaction->payload_size);
+    }
+  }
+  transaction->state = MODBUS_TRANSACTION_IDLE;
+
+  return result;
 }
 
-int MYRIOTA_ModbusWriteCoils(const MYRIOTA_ModbusHandle handle,
-  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress addr, const size_t count,
-  const uint8_t *const bytes) {
-  return modbus_write(handle, slave, MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_COILS, addr, count, bytes);
+int modbus_request_receive(const MYRIOTA_ModbusHandle handle,
+  const struct application_data_uint **const request,
+  struct application_data_uint **const response) {
+  struct modbus_instance *instance = get_modbus_instance(handle);
+  if (instance == NULL) {
+    return -MODBUS_ERROR_INVALID_HANDLE;
+  }
+
+  if (!modbus_is_ready(instance)) {
+    return -MODBUS_ERROR_BAD_STATE;
+  }
+
+  *request = &instance->adu_rx;
+  *response = &instance->adu_tx;
+  return modbus_receive_frame(instance, MODBUS_ADU_REQUEST_MIN_SIZE, modbus_request_frame_size);
 }
 
-int MYRIOTA_ModbusWriteHoldingRegisters(const MYRIOTA_ModbusHandle handle,
-  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusDataAddress addr, const size_t count,
-  const uint8_t *const bytes) {
-  return modbus_write(handle, slave, MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_REGISTERS, addr, count,
-    bytes);
+int modbus_response_send(const MYRIOTA_ModbusHandle handle) {
+  struct modbus_instance *instance = get_modbus_instance(handle);
+  if (instance == NULL) {
+    return -MODBUS_ERROR_INVALID_HANDLE;
+  }
+
+  return modbus_write_frame(instance);
 }
 
 #ifdef MYRIOTA_MODBUS_UNIT_TESTS
@@ -552,13 +1657,1148 @@ int MYRIOTA_ModbusWriteHoldingRegisters(const MYRIOTA_ModbusHandle handle,
  */
 #include <cmocka.h>
 
-static void test_x(void **state) {
+#include "myriota/modbus_bits.h"
+#include "myriota/modbus_decode.h"
+#include "myriota/modbus_map.h"
+#include "modbus_sim.h"
+#include "myriota/modbus_plan.h"
+
+struct test_serial {
+  const uint8_t *rx;
+  size_t rx_size;
+  size_t rx_offset;
+  size_t rx_available;
+  size_t read_calls;
+  size_t last_read_count;
+  uint8_t tx[MODBUS_ADU_BUFFER_SIZE];
+  size_t tx_size;
+};
+
+static struct test_serial test_serial = {0};
+
+static uint16_t modbus_calulate_crc16(const uint8_t *const buffer, const size_t size) {
+  return modbus_crc16_update(MODBUS_CRC16_INIT, buffer, size);
+}
+
+static int test_serial_init(void *const ctx) {
+  (void)ctx;
+  return 0;
+}
+
+static void test_serial_deinit(void *const ctx) {
+  (void)ctx;
+}
+
+static ssize_t test_serial_read(void *const ctx, uint8_t *const buffer, const size_t count) {
+  struct test_serial *const serial = ctx;
+  const size_t available = serial->rx_size - serial->rx_offset;
+  const size_t nbytes = (count < available) ? count : available;
+  memcpy(buffer, &serial->rx[serial->rx_offset], nbytes);
+  serial->rx_offset += nbytes;
+  serial->last_read_count = count;
+  ++serial->read_calls;
+  return nbytes;
+}
+
+static ssize_t test_serial_poll(void *const ctx, uint8_t *const buffer, const size_t count) {
+  struct test_serial *const serial = ctx;
+  const size_t available = serial->rx_available - serial->rx_offset;
+  const size_t nbytes = (count < available) ? count : available;
+  memcpy(buffer, &serial->rx[serial->rx_offset], nbytes);
+  serial->rx_offset += nbytes;
+  return nbytes;
+}
+
+static uint32_t test_ticks = 0;
+
+static uint32_t test_tick_get(void) {
+  return test_ticks;
+}
+
+static ssize_t test_serial_write(void *const ctx, const uint8_t *const buffer, const size_t count) {
+  struct test_serial *const serial = ctx;
+  if (serial != NULL && serial->tx_size + count <= sizeof(serial->tx)) {
+    memcpy(&serial->tx[serial->tx_size], buffer, count);
+    serial->tx_size += count;
+  }
+  return count;
+}
+
+static MYRIOTA_ModbusHandle test_modbus_setup(const uint8_t *const rx, const size_t rx_size) {
+  test_serial = (struct test_serial){.rx = rx, .rx_size = rx_size};
+  const MYRIOTA_ModbusInitOptions options = {
+    .framing_mode = MODBUS_FRAMING_MODE_RTU,
+    .serial_interface =
+      {
+        .ctx = &test_serial,
+        .init = test_serial_init,
+        .deinit = test_serial_deinit,
+        .read = test_serial_read,
+        .write = test_serial_write,
+      },
+  };
+  const MYRIOTA_ModbusHandle handle = MYRIOTA_ModbusInit(options);
+  assert_int_equal(MYRIOTA_ModbusEnable(handle), MODBUS_SUCCESS);
+  return handle;
+}
+
+static void test_append_crc16(uint8_t *const frame, const size_t size) {
+  const uint16_t crc16 = modbus_calulate_crc16(frame, size);
+  frame[size] = low_u16(crc16);
+  frame[size + 1] = hi_u16(crc16);
+}
+
+static void test_read_returns_on_expected_length(void **state) {
+  (void)state;
+  uint8_t response[9] = {0x01, MODBUS_FUNCTION_CODE_READ_HOLDING_REGISTERS, 4, 0x01, 0x02, 0x03,
+    0x04};
+  test_append_crc16(response, 7);
+  const MYRIOTA_ModbusHandle handle = test_modbus_setup(response, sizeof(response));
+
+  uint8_t bytes[4] = {0};
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0x0000, 2, bytes),
+    MODBUS_SUCCESS);
+  assert_int_equal(test_serial.read_calls, 1);
+  assert_int_equal(test_serial.last_read_count, sizeof(response));
+  assert_memory_equal(bytes, &response[3], sizeof(bytes));
+
+  MYRIOTA_ModbusDeinit(handle);
+}
+
+static void test_read_exception_response(void **state) {
+  (void)state;
+  uint8_t response[5] = {0x01,
+    MODBUS_FUNCTION_CODE_READ_HOLDING_REGISTERS | MODBUS_FUNCTION_CODE_ERROR_BASE,
+    MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_ADDRESS};
+  test_append_crc16(response, 3);
+  const MYRIOTA_ModbusHandle handle = test_modbus_setup(response, sizeof(response));
+
+  uint8_t bytes[4] = {0};
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0x0000, 2, bytes),
+    -MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_ADDRESS);
+
+  MYRIOTA_ModbusDeinit(handle);
+}
+
+static void test_read_truncated_response(void **state) {
+  (void)state;
+  const uint8_t response[] = {0x01, MODBUS_FUNCTION_CODE_READ_HOLDING_REGISTERS};
+  const MYRIOTA_ModbusHandle handle = test_modbus_setup(response, sizeof(response));
+
+  uint8_t bytes[4] = {0};
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0x0000, 2, bytes),
+    -MODBUS_ERROR_MALFORMED_RESPONSE);
+
+  test_serial.rx_size = 0;
+  test_serial.rx_offset = 0;
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0x0000, 2, bytes),
+    -MODBUS_ERROR_IO_FAILURE);
+
+  MYRIOTA_ModbusDeinit(handle);
+}
+
+static void test_inter_frame_delay(void **state) {
+  (void)state;
+  assert_int_equal(MYRIOTA_ModbusInterFrameDelayUs(9600), 4011);
+  assert_int_equal(MYRIOTA_ModbusInterFrameDelayUs(19200), 2006);
+  assert_int_equal(MYRIOTA_ModbusInterFrameDelayUs(115200), 1750);
+}
+
+static void test_crc16_engines(void **state) {
+  (void)state;
+  // CRC-16/MODBUS check value, see https://reveng.sourceforge.io/crc-catalogue/16.htm
+  const uint8_t check[] = "123456789";
+  const size_t size = sizeof(check) - 1;
+  assert_int_equal(modbus_crc16_update_nibble(MODBUS_CRC16_INIT, check, size), 0x4B37);
+  assert_int_equal(modbus_crc16_update_byte(MODBUS_CRC16_INIT, check, size), 0x4B37);
+  assert_int_equal(modbus_crc16_update_slice4(MODBUS_CRC16_INIT, check, size), 0x4B37);
+  assert_int_equal(modbus_calulate_crc16(check, size), 0x4B37);
+}
+
+static void test_read_invalid_crc16(void **state) {
+  (void)state;
+  uint8_t response[9] = {0x01, MODBUS_FUNCTION_CODE_READ_HOLDING_REGISTERS, 4, 0x01, 0x02, 0x03,
+    0x04};
+  test_append_crc16(response, 7);
+  response[4] ^= 0x10;
+  const MYRIOTA_ModbusHandle handle = test_modbus_setup(response, sizeof(response));
+
+  uint8_t bytes[4] = {0};
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0x0000, 2, bytes),
+    -MODBUS_ERROR_INVALID_CRC16);
+
+  MYRIOTA_ModbusDeinit(handle);
+}
+
+static void test_pack_streaming_crc16(void **state) {
+  (void)state;
+  const uint8_t bytes[] = {0x12, 0x34, 0x56, 0x78};
+  uint8_t buffer[16];
+  struct application_data_uint adu = {.capacity = sizeof(buffer), .buffer = buffer};
+  begin_application_data_unit_pack(&adu, 0x11, MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_REGISTERS);
+  application_data_unit_pack_u16(&adu, 0x0001);
+  application_data_unit_pack_u16(&adu, 2);
+  application_data_unit_pack_u8(&adu, sizeof(bytes));
+  application_data_unit_pack_bytes(&adu, bytes, sizeof(bytes));
+  const uint16_t crc16 = modbus_calulate_crc16(adu.buffer, adu.size);
+  end_application_data_unit_pack(&adu);
+
+  assert_int_equal(merge_u16(adu.buffer[adu.size - 1], adu.buffer[adu.size - 2]), crc16);
+  assert_int_equal(modbus_calulate_crc16(adu.buffer, adu.size), 0);
+}
+
+static void test_plan_compile_merges_requests(void **state) {
+  (void)state;
+  const MYRIOTA_ModbusPoint points[] = {
+    {0x01, MODBUS_READ_HOLDING_REGISTERS, 200, MODBUS_VALUE_TYPE_U16, 0, MODBUS_WORD_ORDER_ABCD},
+    {0x01, MODBUS_READ_HOLDING_REGISTERS, 4, MODBUS_VALUE_TYPE_F32, 0, MODBUS_WORD_ORDER_ABCD},
+    {0x01, MODBUS_READ_COILS, 3, MODBUS_VALUE_TYPE_BOOL, 0, MODBUS_WORD_ORDER_ABCD},
+    {0x01, MODBUS_READ_HOLDING_REGISTERS, 0, MODBUS_VALUE_TYPE_I16, 0, MODBUS_WORD_ORDER_ABCD},
+    {0x02, MODBUS_READ_HOLDING_REGISTERS, 2, MODBUS_VALUE_TYPE_U16, 0, MODBUS_WORD_ORDER_ABCD},
+    {0x01, MODBUS_READ_HOLDING_REGISTERS, 10, MODBUS_VALUE_TYPE_U32, 0, MODBUS_WORD_ORDER_ABCD},
+  };
+  MYRIOTA_ModbusPlanRequest requests[MODBUS_ARRAY_SIZE(points)];
+  MYRIOTA_ModbusPlan plan = {0};
+
+  assert_int_equal(MYRIOTA_ModbusPlanCompile(&plan, points, MODBUS_ARRAY_SIZE(points), requests,
+                     MODBUS_ARRAY_SIZE(requests), 4),
+    MODBUS_SUCCESS);
+  assert_int_equal(plan.requests_count, 4);
+  assert_int_equal(requests[0].function, MODBUS_READ_COILS);
+  assert_int_equal(requests[1].addr, 0);
+  assert_int_equal(requests[1].count, 12);
+  assert_int_equal(requests[2].addr, 200);
+  assert_int_equal(requests[3].slave, 0x02);
+
+  const MYRIOTA_ModbusPoint bad_point = {0x01, MODBUS_READ_COILS, 0, MODBUS_VALUE_TYPE_U16, 0,
+    MODBUS_WORD_ORDER_ABCD};
+  assert_int_equal(MYRIOTA_ModbusPlanCompile(&plan, &bad_point, 1, requests, 1, 0),
+    -MODBUS_ERROR_INVALID_ARGUMENT);
+}
+
+static void test_plan_execute_decodes_points(void **state) {
+  (void)state;
+  struct values {
+    int16_t temperature;
+    float flow;
+    uint32_t total;
+  } values = {0};
+  const MYRIOTA_ModbusPoint points[] = {
+    {0x01, MODBUS_READ_HOLDING_REGISTERS, 0, MODBUS_VALUE_TYPE_I16,
+      offsetof(struct values, temperature), MODBUS_WORD_ORDER_ABCD},
+    {0x01, MODBUS_READ_HOLDING_REGISTERS, 2, MODBUS_VALUE_TYPE_F32, offsetof(struct values, flow),
+      MODBUS_WORD_ORDER_ABCD},
+    {0x01, MODBUS_READ_HOLDING_REGISTERS, 4, MODBUS_VALUE_TYPE_U32,
+      offsetof(struct values, total), MODBUS_WORD_ORDER_CDAB},
+  };
+  MYRIOTA_ModbusPlanRequest requests[MODBUS_ARRAY_SIZE(points)];
+  MYRIOTA_ModbusPlan plan = {0};
+  assert_int_equal(MYRIOTA_ModbusPlanCompile(&plan, points, MODBUS_ARRAY_SIZE(points), requests,
+                     MODBUS_ARRAY_SIZE(requests), 1),
+    MODBUS_SUCCESS);
+  assert_int_equal(plan.requests_count, 1);
+
+  // 6 registers: -2, unused, 1.5f, 0x56781234 (low word first)
+  uint8_t response[17] = {0x01, MODBUS_FUNCTION_CODE_READ_HOLDING_REGISTERS, 12, 0xFF, 0xFE, 0x00,
+    0x00, 0x3F, 0xC0, 0x00, 0x00, 0x12, 0x34, 0x56, 0x78};
+  test_append_crc16(response, 15);
+  const MYRIOTA_ModbusHandle handle = test_modbus_setup(response, sizeof(response));
+
+  assert_int_equal(MYRIOTA_ModbusPlanExecute(handle, &plan, &values), MODBUS_SUCCESS);
+  assert_int_equal(values.temperature, -2);
+  assert_true(values.flow == 1.5f);
+  assert_int_equal(values.total, 0x56781234);
+
+  MYRIOTA_ModbusDeinit(handle);
+}
+
+static void test_mask_write_register(void **state) {
+  (void)state;
+  uint8_t response[10] = {0x01, MODBUS_FUNCTION_CODE_MASK_WRITE_REGISTER, 0x00, 0x04, 0x00, 0xF2,
+    0x00, 0x25};
+  test_append_crc16(response, 8);
+  const MYRIOTA_ModbusHandle handle = test_modbus_setup(response, sizeof(response));
+
+  assert_int_equal(MYRIOTA_ModbusMaskWriteHoldingRegister(handle, 0x01, 0x0004, 0x00F2, 0x0025),
+    MODBUS_SUCCESS);
+  assert_int_equal(test_serial.last_read_count, sizeof(response));
+
+  test_serial.rx_offset = 0;
+  assert_int_equal(MYRIOTA_ModbusMaskWriteHoldingRegister(handle, 0x01, 0x0004, 0x00F2, 0x0026),
+    -MODBUS_ERROR_MALFORMED_RESPONSE);
+
+  MYRIOTA_ModbusDeinit(handle);
+}
+
+static void test_read_write_registers(void **state) {
+  (void)state;
+  uint8_t response[11] = {0x01, MODBUS_FUNCTION_CODE_READ_WRITE_MULTIPLE_REGISTERS, 6, 0x00, 0xFE,
+    0x0A, 0xCD, 0x00, 0x01};
+  test_append_crc16(response, 9);
+  const MYRIOTA_ModbusHandle handle = test_modbus_setup(response, sizeof(response));
+
+  const uint8_t write_bytes[] = {0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF};
+  uint8_t read_bytes[6] = {0};
+  assert_int_equal(MYRIOTA_ModbusReadWriteHoldingRegisters(handle, 0x01, 0x0003, 3, read_bytes,
+                     0x000E, 3, write_bytes),
+    MODBUS_SUCCESS);
+  assert_memory_equal(read_bytes, &response[3], sizeof(read_bytes));
+  assert_int_equal(test_serial.last_read_count, sizeof(response));
+
+  MYRIOTA_ModbusDeinit(handle);
+}
+
+static MYRIOTA_ModbusHandle test_modbus_async_setup(const uint8_t *const rx, const size_t rx_size) {
+  test_serial = (struct test_serial){.rx = rx, .rx_size = rx_size};
+  test_ticks = UINT32_MAX - 10;
+  const MYRIOTA_ModbusInitOptions options = {
+    .framing_mode = MODBUS_FRAMING_MODE_RTU,
+    .serial_interface =
+      {
+        .ctx = &test_serial,
+        .init = test_serial_init,
+        .deinit = test_serial_deinit,
+        .read = test_serial_read,
+        .write = test_serial_write,
+        .poll = test_serial_poll,
+      },
+    .tick_get = test_tick_get,
+    .response_timeout_ms = 100,
+    .frame_idle_ms = 4,
+  };
+  const MYRIOTA_ModbusHandle handle = MYRIOTA_ModbusInit(options);
+  assert_int_equal(MYRIOTA_ModbusEnable(handle), MODBUS_SUCCESS);
+  return handle;
+}
+
+static void test_async_read(void **state) {
+  (void)state;
+  uint8_t response[9] = {0x01, MODBUS_FUNCTION_CODE_READ_HOLDING_REGISTERS, 4, 0x01, 0x02, 0x03,
+    0x04};
+  test_append_crc16(response, 7);
+  const MYRIOTA_ModbusHandle handle = test_modbus_async_setup(response, sizeof(response));
+
+  uint8_t bytes[4] = {0};
+  assert_int_equal(MYRIOTA_ModbusBeginRead(handle, 0x01, MODBUS_READ_HOLDING_REGISTERS, 0x0000, 2),
+    MODBUS_SUCCESS);
+  assert_int_equal(MYRIOTA_ModbusBeginRead(handle, 0x01, MODBUS_READ_HOLDING_REGISTERS, 0x0000, 2),
+    -MODBUS_ERROR_BAD_STATE);
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0x0000, 2, bytes),
+    -MODBUS_ERROR_BAD_STATE);
+  assert_int_equal(MYRIOTA_ModbusComplete(handle, bytes, sizeof(bytes)), -MODBUS_ERROR_BAD_STATE);
+
+  assert_int_equal(MYRIOTA_ModbusPoll(handle), MODBUS_TRANSACTION_AWAITING);
+  assert_int_equal(MYRIOTA_ModbusPoll(handle), MODBUS_TRANSACTION_AWAITING);
+
+  // The response trickles in across polls and across a tick wrap around.
+  test_serial.rx_available = 5;
+  test_ticks += 20;
+  assert_int_equal(MYRIOTA_ModbusPoll(handle), MODBUS_TRANSACTION_AWAITING);
+  test_serial.rx_available = sizeof(response);
+  test_ticks += 2;
+  assert_int_equal(MYRIOTA_ModbusPoll(handle), MODBUS_TRANSACTION_DONE);
+  assert_int_equal(test_serial.read_calls, 0);
+
+  assert_int_equal(MYRIOTA_ModbusComplete(handle, bytes, sizeof(bytes)), MODBUS_SUCCESS);
+  assert_memory_equal(bytes, &response[3], sizeof(bytes));
+  assert_int_equal(MYRIOTA_ModbusPoll(handle), MODBUS_TRANSACTION_IDLE);
+
+  MYRIOTA_ModbusDeinit(handle);
+}
+
+static void test_async_timeout_and_idle(void **state) {
+  (void)state;
+  uint8_t response[9] = {0x01, MODBUS_FUNCTION_CODE_READ_HOLDING_REGISTERS, 4, 0x01, 0x02, 0x03,
+    0x04};
+  test_append_crc16(response, 7);
+  const MYRIOTA_ModbusHandle handle = test_modbus_async_setup(response, sizeof(response));
+
+  const uint8_t value[2] = {0x00, 0x01};
+  assert_int_equal(MYRIOTA_ModbusBeginWrite(handle, 0x01, MODBUS_WRITE_SINGLE_REGISTER, 0x0000, 1,
+                     value),
+    MODBUS_SUCCESS);
+  assert_int_equal(MYRIOTA_ModbusPoll(handle), MODBUS_TRANSACTION_AWAITING);
+  test_ticks += 99;
+  assert_int_equal(MYRIOTA_ModbusPoll(handle), MODBUS_TRANSACTION_AWAITING);
+  test_ticks += 1;
+  assert_int_equal(MYRIOTA_ModbusPoll(handle), MODBUS_TRANSACTION_ERROR);
+  assert_int_equal(MYRIOTA_ModbusComplete(handle, NULL, 0), -MODBUS_ERROR_IO_FAILURE);
+
+  // A frame that stops part way through ends once the line has been idle.
+  uint8_t bytes[4] = {0};
+  assert_int_equal(MYRIOTA_ModbusBeginRead(handle, 0x01, MODBUS_READ_HOLDING_REGISTERS, 0x0000, 2),
+    MODBUS_SUCCESS);
+  assert_int_equal(MYRIOTA_ModbusPoll(handle), MODBUS_TRANSACTION_AWAITING);
+  test_serial.rx_available = 6;
+  assert_int_equal(MYRIOTA_ModbusPoll(handle), MODBUS_TRANSACTION_AWAITING);
+  test_ticks += 5;
+  assert_int_equal(MYRIOTA_ModbusPoll(handle), MODBUS_TRANSACTION_ERROR);
+  assert_int_equal(MYRIOTA_ModbusComplete(handle, bytes, sizeof(bytes)),
+    -MODBUS_ERROR_INVALID_CRC16);
+
+  MYRIOTA_ModbusDeinit(handle);
+}
+
+static void test_async_requires_response_timeout(void **state) {
+  (void)state;
+  test_serial = (struct test_serial){0};
+  MYRIOTA_ModbusInitOptions options = {
+    .framing_mode = MODBUS_FRAMING_MODE_RTU,
+    .serial_interface =
+      {
+        .ctx = &test_serial,
+        .init = test_serial_init,
+        .deinit = test_serial_deinit,
+        .read = test_serial_read,
+        .write = test_serial_write,
+        .poll = test_serial_poll,
+      },
+    .tick_get = test_tick_get,
+  };
+  assert_int_equal(MYRIOTA_ModbusInit(options), 0);
+
+  // Without a poll function the response is read with the blocking read's timeout.
+  options.serial_interface.poll = NULL;
+  const MYRIOTA_ModbusHandle handle = MYRIOTA_ModbusInit(options);
+  assert_true(handle > 0);
+  MYRIOTA_ModbusDeinit(handle);
+}
+
+static void test_decode_word_orders(void **state) {
+  (void)state;
+  const uint8_t abcd[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08};
+  assert_int_equal(MYRIOTA_ModbusDecodeU16(abcd, MODBUS_WORD_ORDER_ABCD), 0x0102);
+  assert_int_equal(MYRIOTA_ModbusDecodeU16(abcd, MODBUS_WORD_ORDER_BADC), 0x0201);
+  assert_int_equal(MYRIOTA_ModbusDecodeU32(abcd, MODBUS_WORD_ORDER_ABCD), 0x01020304);
+  assert_int_equal(MYRIOTA_ModbusDecodeU32(abcd, MODBUS_WORD_ORDER_CDAB), 0x03040102);
+  assert_int_equal(MYRIOTA_ModbusDecodeU32(abcd, MODBUS_WORD_ORDER_BADC), 0x02010403);
+  assert_int_equal(MYRIOTA_ModbusDecodeU32(abcd, MODBUS_WORD_ORDER_DCBA), 0x04030201);
+  assert_true(MYRIOTA_ModbusDecodeU64(abcd, MODBUS_WORD_ORDER_ABCD) == 0x0102030405060708);
+  assert_true(MYRIOTA_ModbusDecodeU64(abcd, MODBUS_WORD_ORDER_CDAB) == 0x0708050603040102);
+  assert_true(MYRIOTA_ModbusDecodeU64(abcd, MODBUS_WORD_ORDER_DCBA) == 0x0807060504030201);
+
+  const uint8_t f32[] = {0x00, 0x00, 0x3F, 0xC0};  // 1.5f in CDAB order
+  assert_true(MYRIOTA_ModbusDecodeF32(f32, MODBUS_WORD_ORDER_CDAB) == 1.5f);
+  const uint8_t i16[] = {0xFF, 0x9C};
+  assert_int_equal(MYRIOTA_ModbusDecodeI16(i16, MODBUS_WORD_ORDER_ABCD), -100);
+}
+
+static void test_read_decode_fields(void **state) {
+  (void)state;
+  uint8_t response[19] = {0x01, MODBUS_FUNCTION_CODE_READ_INPUT_REGISTERS, 14, 0xFF, 0x9C, 0x00,
+    0x00, 0x3F, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00};
+  test_append_crc16(response, 17);
+  const MYRIOTA_ModbusHandle handle = test_modbus_setup(response, sizeof(response));
+
+  struct values {
+    float temperature;
+    float flow;
+    int64_t total;
+  } values = {0};
+  const MYRIOTA_ModbusDecodeField fields[] = {
+    {MODBUS_VALUE_TYPE_I16, MODBUS_WORD_ORDER_ABCD, 0, 0.1f, -10.0f,
+      offsetof(struct values, temperature)},
+    {MODBUS_VALUE_TYPE_F32, MODBUS_WORD_ORDER_CDAB, 1, 0.0f, 0.0f, offsetof(struct values, flow)},
+    {MODBUS_VALUE_TYPE_I64, MODBUS_WORD_ORDER_ABCD, 3, 0.0f, 0.0f, offsetof(struct values, total)},
+  };
+  assert_int_equal(MYRIOTA_ModbusReadDecode(handle, 0x01, MODBUS_READ_INPUT_REGISTERS, 0x0000, 7,
+                     fields, MODBUS_ARRAY_SIZE(fields), &values),
+    MODBUS_SUCCESS);
+  assert_true(values.temperature > -20.01f && values.temperature < -19.99f);
+  assert_true(values.flow == 1.5f);
+  assert_true(values.total == 256);
+
+  // Fields outside of the payload are rejected.
+  const MYRIOTA_ModbusDecodeField outside = {MODBUS_VALUE_TYPE_U32, MODBUS_WORD_ORDER_ABCD, 6,
+    0.0f, 0.0f, 0};
+  assert_int_equal(MYRIOTA_ModbusDecode(&response[3], 14, &outside, 1, &values),
+    -MODBUS_ERROR_OVERFLOW);
+
+  MYRIOTA_ModbusDeinit(handle);
+}
+
+static void test_caller_supplied_buffer(void **state) {
+  (void)state;
+  uint8_t response[9] = {0x01, MODBUS_FUNCTION_CODE_READ_HOLDING_REGISTERS, 4, 0x01, 0x02, 0x03,
+    0x04};
+  test_append_crc16(response, 7);
+  test_serial = (struct test_serial){.rx = response, .rx_size = sizeof(response)};
+
+  uint8_t adu_buffer[MODBUS_ADU_BUFFERS_PER_INSTANCE * MODBUS_ADU_BUFFER_MIN_SIZE];
+  MYRIOTA_ModbusInitOptions options = {
+    .framing_mode = MODBUS_FRAMING_MODE_RTU,
+    .serial_interface =
+      {
+        .ctx = &test_serial,
+        .init = test_serial_init,
+        .deinit = test_serial_deinit,
+        .read = test_serial_read,
+        .write = test_serial_write,
+      },
+    .adu_buffer = adu_buffer,
+    .adu_buffer_size = sizeof(adu_buffer) - 1,
+  };
+  assert_int_equal(MYRIOTA_ModbusInit(options), 0);
+  options.adu_buffer_size = sizeof(adu_buffer);
+  const MYRIOTA_ModbusHandle handle = MYRIOTA_ModbusInit(options);
+  assert_int_equal(MYRIOTA_ModbusEnable(handle), MODBUS_SUCCESS);
+
+  // The response of a 2 register read fits, but larger transactions don't.
+  uint8_t bytes[8] = {0};
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0x0000, 2, bytes),
+    MODBUS_SUCCESS);
+  assert_memory_equal(bytes, &response[3], 4);
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0x0000, 6, bytes),
+    -MODBUS_ERROR_OVERFLOW);
+  assert_int_equal(MYRIOTA_ModbusWriteHoldingRegisters(handle, 0x01, 0x0000, 4, bytes),
+    -MODBUS_ERROR_OVERFLOW);
+
+  MYRIOTA_ModbusDeinit(handle);
+
+  MYRIOTA_ModbusRamUsage usage = {0};
+  MYRIOTA_ModbusGetRamUsage(&usage);
+  assert_int_equal(usage.buffers,
+    MODBUS_ADU_BUFFER_INSTANCES * MODBUS_ADU_BUFFERS_PER_INSTANCE * MODBUS_ADU_BUFFER_SIZE);
+  assert_int_equal(usage.buffers_split, MODBUS_INSTANCE_MAX * 2 * MODBUS_ADU_BUFFER_SIZE);
+}
+
+static bool test_sim_coils[64];
+static uint16_t test_sim_registers[64];
+static struct modbus_sim test_sim;
+
+static void test_sim_delay_ms(const uint32_t ms) {
+  modbus_sim_advance(&test_sim, ms * 1000);
+}
+
+// Initializes the simulator and returns the options of a driver connected to it.
+static MYRIOTA_ModbusInitOptions test_sim_options(const struct modbus_sim_config *const overrides) {
+  struct modbus_sim_config config = {
+    .address = 0x01,
+    .baud_rate = 19200,
+    .response_latency_us = 2000,
+    .response_timeout_us = 100000,
+    .coils = test_sim_coils,
+    .coils_count = MODBUS_ARRAY_SIZE(test_sim_coils),
+    .holding_registers = test_sim_registers,
+    .holding_registers_count = MODBUS_ARRAY_SIZE(test_sim_registers),
+    .input_registers = test_sim_registers,
+    .input_registers_count = MODBUS_ARRAY_SIZE(test_sim_registers),
+  };
+  if (overrides != NULL) {
+    config.inter_byte_gap_us = overrides->inter_byte_gap_us;
+    config.crc_error_every = overrides->crc_error_every;
+    config.no_response_every = overrides->no_response_every;
+    config.exception_code = overrides->exception_code;
+  }
+  modbus_sim_init(&test_sim, &config);
+
+  const MYRIOTA_ModbusInitOptions options = {
+    .framing_mode = MODBUS_FRAMING_MODE_RTU,
+    .serial_interface = modbus_sim_serial_interface(&test_sim),
+    .tick_get = modbus_sim_tick_get,
+    .response_timeout_ms = 100,
+    .frame_idle_ms = 2,
+    .delay_ms = test_sim_delay_ms,
+  };
+  return options;
+}
+
+static MYRIOTA_ModbusHandle test_modbus_sim_init(const MYRIOTA_ModbusInitOptions options) {
+  const MYRIOTA_ModbusHandle handle = MYRIOTA_ModbusInit(options);
+  assert_int_equal(MYRIOTA_ModbusEnable(handle), MODBUS_SUCCESS);
+  return handle;
+}
+
+static MYRIOTA_ModbusHandle test_modbus_sim_setup(const struct modbus_sim_config *const overrides) {
+  return test_modbus_sim_init(test_sim_options(overrides));
+}
+
+static void test_sim_round_trip(void **state) {
+  (void)state;
+  const MYRIOTA_ModbusHandle handle = test_modbus_sim_setup(NULL);
+
+  const uint8_t values[] = {0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC};
+  uint8_t bytes[6] = {0};
+  assert_int_equal(MYRIOTA_ModbusWriteHoldingRegisters(handle, 0x01, 10, 3, values),
+    MODBUS_SUCCESS);
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 10, 3, bytes), MODBUS_SUCCESS);
+  assert_memory_equal(bytes, values, sizeof(values));
+  assert_int_equal(MYRIOTA_ModbusMaskWriteHoldingRegister(handle, 0x01, 10, 0xFF00, 0x00AA),
+    MODBUS_SUCCESS);
+  assert_int_equal(test_sim_registers[10], 0x12AA);
+
+  const uint8_t coils[] = {0xA5, 0x01};
+  assert_int_equal(MYRIOTA_ModbusWriteCoils(handle, 0x01, 3, 9, coils), MODBUS_SUCCESS);
+  assert_int_equal(MYRIOTA_ModbusReadCoils(handle, 0x01, 3, 9, bytes), MODBUS_SUCCESS);
+  assert_memory_equal(bytes, coils, sizeof(coils));
+
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 63, 2, bytes),
+    -MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_ADDRESS);
+
+  // Asynchronously, the response arrives as the virtual clock advances.
+  assert_int_equal(MYRIOTA_ModbusBeginRead(handle, 0x01, MODBUS_READ_INPUT_REGISTERS, 10, 3),
+    MODBUS_SUCCESS);
+  int transaction_state = MODBUS_TRANSACTION_TRANSMITTING;
+  while (transaction_state == MODBUS_TRANSACTION_TRANSMITTING ||
+         transaction_state == MODBUS_TRANSACTION_AWAITING) {
+    transaction_state = MYRIOTA_ModbusPoll(handle);
+    modbus_sim_advance(&test_sim, 250);
+  }
+  assert_int_equal(transaction_state, MODBUS_TRANSACTION_DONE);
+  assert_int_equal(MYRIOTA_ModbusComplete(handle, bytes, sizeof(bytes)), MODBUS_SUCCESS);
+  assert_int_equal(merge_u16(bytes[0], bytes[1]), 0x12AA);
+
+  MYRIOTA_ModbusDeinit(handle);
+}
+
+static void test_sim_fault_injection(void **state) {
+  (void)state;
+  uint8_t bytes[4] = {0};
+
+  struct modbus_sim_config faults = {.crc_error_every = 2};
+  MYRIOTA_ModbusHandle handle = test_modbus_sim_setup(&faults);
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0, 2, bytes), MODBUS_SUCCESS);
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0, 2, bytes),
+    -MODBUS_ERROR_INVALID_CRC16);
+  MYRIOTA_ModbusDeinit(handle);
+
+  faults = (struct modbus_sim_config){.no_response_every = 1};
+  handle = test_modbus_sim_setup(&faults);
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0, 2, bytes),
+    -MODBUS_ERROR_IO_FAILURE);
+  MYRIOTA_ModbusDeinit(handle);
+
+  faults = (struct modbus_sim_config){.exception_code = MODBUS_ERROR_EXCEPTION_SLAVE_DEVICE_BUSY};
+  handle = test_modbus_sim_setup(&faults);
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0, 2, bytes),
+    -MODBUS_ERROR_EXCEPTION_SLAVE_DEVICE_BUSY);
+  MYRIOTA_ModbusDeinit(handle);
+
+  // A gap longer than t3.5 between bytes ends the response after its first byte.
+  faults = (struct modbus_sim_config){.inter_byte_gap_us = 5000};
+  handle = test_modbus_sim_setup(&faults);
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0, 2, bytes),
+    -MODBUS_ERROR_MALFORMED_RESPONSE);
+  MYRIOTA_ModbusDeinit(handle);
+}
+
+static void test_register_cache(void **state) {
+  (void)state;
+  uint8_t constants_bytes[8];
+  uint8_t status_bytes[4];
+  MYRIOTA_ModbusCacheEntry cache[] = {
+    {
+      .slave = 0x01,
+      .function = MODBUS_READ_HOLDING_REGISTERS,
+      .addr = 0,
+      .count = 4,
+      .max_age_ms = MODBUS_CACHE_MAX_AGE_FOREVER,
+      .bytes = constants_bytes,
+    },
+    {
+      .slave = 0x01,
+      .function = MODBUS_READ_INPUT_REGISTERS,
+      .addr = 20,
+      .count = 2,
+      .max_age_ms = 1000,
+      .bytes = status_bytes,
+    },
+  };
+  for (uint16_t i = 0; i < 4; ++i) {
+    test_sim_registers[i] = i + 1;
+  }
+  MYRIOTA_ModbusInitOptions options = test_sim_options(NULL);
+  options.cache = cache;
+  options.cache_count = MODBUS_ARRAY_SIZE(cache);
+  const MYRIOTA_ModbusHandle handle = test_modbus_sim_init(options);
+
+  // The first read fills the whole entry, later reads within it skip the bus.
+  uint8_t bytes[4] = {0};
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 1, 2, bytes), MODBUS_SUCCESS);
+  assert_int_equal(test_sim.requests, 1);
+  test_sim_registers[2] = 0x1234;
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 2, 2, bytes), MODBUS_SUCCESS);
+  assert_int_equal(test_sim.requests, 1);
+  assert_int_equal(merge_u16(bytes[0], bytes[1]), 3);
+  assert_int_equal(merge_u16(bytes[2], bytes[3]), 4);
+
+  // Reads outside of an entry, or of a different table, pass through.
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 3, 2, bytes), MODBUS_SUCCESS);
+  assert_int_equal(MYRIOTA_ModbusReadInputRegisters(handle, 0x01, 0, 1, bytes), MODBUS_SUCCESS);
+  assert_int_equal(test_sim.requests, 3);
+
+  // A write overlapping the entry invalidates it.
+  const uint8_t value[] = {0x00, 0x2A};
+  assert_int_equal(MYRIOTA_ModbusWriteHoldingRegisters(handle, 0x01, 3, 1, value), MODBUS_SUCCESS);
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 2, 2, bytes), MODBUS_SUCCESS);
+  assert_int_equal(test_sim.requests, 5);
+  assert_int_equal(merge_u16(bytes[0], bytes[1]), 0x1234);
+  assert_int_equal(merge_u16(bytes[2], bytes[3]), 0x2A);
+
+  // Entries with a maximum age are read again once they expire.
+  assert_int_equal(MYRIOTA_ModbusReadInputRegisters(handle, 0x01, 20, 2, bytes), MODBUS_SUCCESS);
+  assert_int_equal(test_sim.requests, 6);
+  modbus_sim_advance(&test_sim, 500000);
+  assert_int_equal(MYRIOTA_ModbusReadInputRegisters(handle, 0x01, 21, 1, bytes), MODBUS_SUCCESS);
+  assert_int_equal(test_sim.requests, 6);
+  modbus_sim_advance(&test_sim, 600000);
+  assert_int_equal(MYRIOTA_ModbusReadInputRegisters(handle, 0x01, 20, 2, bytes), MODBUS_SUCCESS);
+  assert_int_equal(test_sim.requests, 7);
+
+  assert_int_equal(MYRIOTA_ModbusCacheInvalidate(handle), MODBUS_SUCCESS);
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0, 1, bytes), MODBUS_SUCCESS);
+  assert_int_equal(test_sim.requests, 8);
+  MYRIOTA_ModbusDeinit(handle);
+
+  // Entries the driver can't read in a single request are rejected.
+  cache[0].count = MODBUS_READ_REGISTERS_MAX + 1;
+  assert_int_equal(MYRIOTA_ModbusInit(options), 0);
+}
+
+static void test_broadcast_write(void **state) {
+  (void)state;
+  const MYRIOTA_ModbusHandle handle = test_modbus_sim_setup(NULL);
+
+  // Broadcasts aren't answered, they only wait for the turnaround delay
+  // instead of the response timeout.
+  const uint8_t values[] = {0x12, 0x34};
+  uint64_t start_us = test_sim.now_us;
+  assert_int_equal(MYRIOTA_ModbusWriteHoldingRegisters(handle, MODBUS_BROADCAST_ADDRESS, 5, 1,
+                     values),
+    MODBUS_SUCCESS);
+  assert_int_equal(test_sim_registers[5], 0x1234);
+  assert_int_equal(test_sim.responses, 0);
+  uint64_t elapsed_us = test_sim.now_us - start_us;
+  assert_true(elapsed_us >= MODBUS_BROADCAST_TURNAROUND_MS_DEFAULT * 1000);
+  assert_true(elapsed_us < (MODBUS_BROADCAST_TURNAROUND_MS_DEFAULT + 10) * 1000);
+
+  uint8_t bytes[2] = {0};
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, MODBUS_BROADCAST_ADDRESS, 5, 1,
+                     bytes),
+    -MODBUS_ERROR_INVALID_ARGUMENT);
+  assert_int_equal(MYRIOTA_ModbusBeginRead(handle, MODBUS_BROADCAST_ADDRESS,
+                     MODBUS_READ_COILS, 0, 1),
+    -MODBUS_ERROR_INVALID_ARGUMENT);
+
+  // Asynchronously, the transaction is done once the turnaround delay has passed.
+  const uint8_t coil[] = {0xFF, 0x00};
+  start_us = test_sim.now_us;
+  assert_int_equal(MYRIOTA_ModbusBeginWrite(handle, MODBUS_BROADCAST_ADDRESS,
+                     MODBUS_WRITE_SINGLE_COIL, 7, 1, coil),
+    MODBUS_SUCCESS);
+  int transaction_state = MODBUS_TRANSACTION_TRANSMITTING;
+  while (transaction_state == MODBUS_TRANSACTION_TRANSMITTING ||
+         transaction_state == MODBUS_TRANSACTION_AWAITING) {
+    transaction_state = MYRIOTA_ModbusPoll(handle);
+    modbus_sim_advance(&test_sim, 1000);
+  }
+  assert_int_equal(transaction_state, MODBUS_TRANSACTION_DONE);
+  assert_int_equal(MYRIOTA_ModbusComplete(handle, NULL, 0), MODBUS_SUCCESS);
+  assert_true(test_sim_coils[7]);
+  elapsed_us = test_sim.now_us - start_us;
+  assert_true(elapsed_us >= MODBUS_BROADCAST_TURNAROUND_MS_DEFAULT * 1000);
+  assert_true(elapsed_us < (MODBUS_BROADCAST_TURNAROUND_MS_DEFAULT + 10) * 1000);
+
+  MYRIOTA_ModbusDeinit(handle);
+}
+
+static void test_adaptive_timeout_and_retry(void **state) {
+  (void)state;
+  MYRIOTA_ModbusInitOptions options = test_sim_options(NULL);
+  options.adaptive_timeout = true;
+  options.retry = (MYRIOTA_ModbusRetryPolicy){.max_retries = 2, .backoff_ms = 10};
+  const MYRIOTA_ModbusHandle handle = test_modbus_sim_init(options);
+
+  // Until a slave has responded it gets the worst case timeout.
+  uint32_t timeout_ms = 0;
+  assert_int_equal(MYRIOTA_ModbusGetSlaveTimeout(handle, 0x01, &timeout_ms), MODBUS_SUCCESS);
+  assert_int_equal(timeout_ms, options.response_timeout_ms);
+
+  uint8_t bytes[4] = {0};
+  for (int i = 0; i < 8; ++i) {
+    assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0, 2, bytes),
+      MODBUS_SUCCESS);
+  }
+  assert_int_equal(MYRIOTA_ModbusGetSlaveTimeout(handle, 0x01, &timeout_ms), MODBUS_SUCCESS);
+  assert_int_equal(timeout_ms, MODBUS_ADAPTIVE_TIMEOUT_MIN_MS_DEFAULT);
+
+  // A slave that stops responding costs its learnt timeout, backed off after
+  // each attempt, rather than the worst case for every attempt.
+  test_sim.config.no_response_every = 1;
+  uint32_t requests = test_sim.requests;
+  uint64_t start_us = test_sim.now_us;
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0, 2, bytes),
+    -MODBUS_ERROR_IO_FAILURE);
+  assert_int_equal(test_sim.requests - requests, 3);
+  const uint64_t elapsed_ms = (test_sim.now_us - start_us) / 1000;
+  assert_true(elapsed_ms >= 20 + 10 + 40 + 20 + 80);
+  assert_true(elapsed_ms < 3 * options.response_timeout_ms);
+  test_sim.config.no_response_every = 0;
+
+  // Errors caused by noise are retried, errors in the request aren't.
+  test_sim.config.crc_error_every = test_sim.responses + 1;
+  requests = test_sim.requests;
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0, 2, bytes),
+    MODBUS_SUCCESS);
+  assert_int_equal(test_sim.requests - requests, 2);
+  test_sim.config.crc_error_every = 0;
+
+  requests = test_sim.requests;
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 63, 2, bytes),
+    -MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_ADDRESS);
+  assert_int_equal(test_sim.requests - requests, 1);
+
+  MYRIOTA_ModbusDeinit(handle);
+}
+
+static int test_power_on_count = 0;
+static int test_power_off_count = 0;
+
+static int test_power_on(void *const ctx) {
+  (void)ctx;
+  ++test_power_on_count;
+  return 0;
+}
+
+static void test_power_off(void *const ctx) {
+  (void)ctx;
+  ++test_power_off_count;
+}
+
+static void test_sweep(void **state) {
+  (void)state;
+  struct values {
+    uint16_t status;
+    uint16_t level;
+  } values[2] = {0};
+  const MYRIOTA_ModbusPoint points[][2] = {
+    {
+      {0x01, MODBUS_READ_HOLDING_REGISTERS, 0, MODBUS_VALUE_TYPE_U16,
+        offsetof(struct values, status), MODBUS_WORD_ORDER_ABCD},
+      {0x01, MODBUS_READ_INPUT_REGISTERS, 8, MODBUS_VALUE_TYPE_U16,
+        offsetof(struct values, level), MODBUS_WORD_ORDER_ABCD},
+    },
+    {
+      {0x02, MODBUS_READ_HOLDING_REGISTERS, 0, MODBUS_VALUE_TYPE_U16,
+        offsetof(struct values, status), MODBUS_WORD_ORDER_ABCD},
+      {0x02, MODBUS_READ_HOLDING_REGISTERS, 1, MODBUS_VALUE_TYPE_U16,
+        offsetof(struct values, level), MODBUS_WORD_ORDER_ABCD},
+    },
+  };
+  MYRIOTA_ModbusPlanRequest requests[2][2];
+  MYRIOTA_ModbusPlan plans[2];
+  MYRIOTA_ModbusSweepSlave slaves[2];
+  for (size_t i = 0; i < MODBUS_ARRAY_SIZE(plans); ++i) {
+    assert_int_equal(MYRIOTA_ModbusPlanCompile(&plans[i], points[i], 2, requests[i], 2, 0),
+      MODBUS_SUCCESS);
+    slaves[i] = (MYRIOTA_ModbusSweepSlave){.plan = &plans[i], .values = &values[i]};
+  }
+
+  test_sim_registers[0] = 0x0001;
+  test_sim_registers[8] = 0x0123;
+  const MYRIOTA_ModbusHandle handle = MYRIOTA_ModbusInit(test_sim_options(NULL));
+  const MYRIOTA_ModbusSweepOptions options = {
+    .power_on = test_power_on,
+    .power_off = test_power_off,
+    .stabilization_ms = 1500,
+    .inter_frame_ms = 2,
+  };
+
+  // The slaves share one power-up window, and one not responding doesn't stop the sweep.
+  test_power_on_count = test_power_off_count = 0;
+  assert_int_equal(MYRIOTA_ModbusSweep(handle, &options, slaves, MODBUS_ARRAY_SIZE(slaves)),
+    -MODBUS_ERROR_IO_FAILURE);
+  assert_int_equal(test_power_on_count, 1);
+  assert_int_equal(test_power_off_count, 1);
+  assert_int_equal(slaves[0].result, MODBUS_SUCCESS);
+  assert_int_equal(values[0].status, 0x0001);
+  assert_int_equal(values[0].level, 0x0123);
+  assert_int_equal(slaves[1].result, -MODBUS_ERROR_IO_FAILURE);
+  assert_true(test_sim.now_us >= 1500000);
+
+  // The driver is released once the sweep is done.
+  assert_int_equal(MYRIOTA_ModbusEnable(handle), MODBUS_SUCCESS);
+  MYRIOTA_ModbusDeinit(handle);
+}
+
+static void test_bit_ranges(void **state) {
+  (void)state;
+  uint8_t bytes[16];
+  for (size_t i = 0; i < sizeof(bytes); ++i) {
+    bytes[i] = (uint8_t)(0x5A ^ (i * 37));
+  }
+
+  // Copy at odd offsets on both sides, checking against the single bit API.
+  uint32_t bitset[MODBUS_BITSET_WORDS(100)];
+  memset(bitset, 0xFF, sizeof(bitset));
+  MYRIOTA_ModbusBitsToBitset(bytes, 3, bitset, 29, 70);
+  for (size_t i = 0; i < 100; ++i) {
+    bool value = true;
+    if (i >= 29 && i < 29 + 70) {
+      MYRIOTA_ModbusBytesGetBit(bytes, sizeof(bytes), i - 29 + 3, &value);
+    }
+    assert_int_equal((bitset[i / 32] >> (i % 32)) & 0x1, value);
+  }
+
+  uint8_t copy[16];
+  memset(copy, 0, sizeof(copy));
+  MYRIOTA_ModbusBitsFromBitset(copy, 3, bitset, 29, 70);
+  for (size_t i = 0; i < 8 * sizeof(copy); ++i) {
+    bool expected = false, value;
+    if (i >= 3 && i < 3 + 70) {
+      MYRIOTA_ModbusBytesGetBit(bytes, sizeof(bytes), i, &expected);
+    }
+    MYRIOTA_ModbusBytesGetBit(copy, sizeof(copy), i, &value);
+    assert_int_equal(value, expected);
+  }
+
+  bool values[45];
+  MYRIOTA_ModbusBitsToBools(bytes, 11, values, 45);
+  size_t set = 0;
+  for (size_t i = 0; i < 45; ++i) {
+    bool value;
+    MYRIOTA_ModbusBytesGetBit(bytes, sizeof(bytes), i + 11, &value);
+    assert_int_equal(values[i], value);
+    set += value;
+  }
+  assert_int_equal(MYRIOTA_ModbusBitsCount(bytes, 11, 45), set);
+
+  memset(copy, 0xFF, sizeof(copy));
+  MYRIOTA_ModbusBitsFromBools(copy, 5, values, 45);
+  assert_int_equal(copy[0] & 0x1F, 0x1F);
+  assert_int_equal(MYRIOTA_ModbusBitsCount(copy, 5, 45), set);
+  assert_int_equal(MYRIOTA_ModbusBitsCount(copy, 50, 78), 78);
+
+  // Edges between two polls, bits beyond the count are ignored.
+  const uint32_t previous[2] = {0x0000F0F0, 0xFFFFFFFF};
+  const uint32_t current[2] = {0x0000FF00, 0x00000001};
+  uint32_t changed[2];
+  assert_int_equal(MYRIOTA_ModbusBitsetChanged(previous, current, changed, 33), 8);
+  assert_int_equal(changed[0] & current[0], 0x00000F00);
+  assert_int_equal(changed[0] & ~current[0], 0x000000F0);
+  assert_int_equal(changed[1], 0);
+  assert_int_equal(MYRIOTA_ModbusBitsetChanged(previous, current, NULL, 64), 39);
+}
+
+#define TEST_SENSOR_MAP(X)                              \
+  X(humidity, float, U16, ABCD, 0x0004, 0.1f, 0.0f)     \
+  X(total, uint32_t, U32, CDAB, 0x0005, 0.0f, 0.0f)     \
+  X(temperature, float, I16, ABCD, 0x0008, 0.5f, -1.0f)
+
+MODBUS_MAP_DEFINE(test_sensor, TEST_SENSOR_MAP, MODBUS_READ_INPUT_REGISTERS)
+
+// A map that is never read, which must compile without unused warnings.
+#define TEST_UNUSED_MAP(X) X(value, int64_t, I64, DCBA, 0x0100, 0.0f, 0.0f)
+
+MODBUS_MAP_DEFINE(test_unused, TEST_UNUSED_MAP, MODBUS_READ_HOLDING_REGISTERS)
+
+static void test_register_map(void **state) {
+  (void)state;
+  assert_int_equal(test_sensor_ADDR, 0x0004);
+  assert_int_equal(test_sensor_COUNT, 5);
+  assert_int_equal(test_unused_ADDR, 0x0100);
+  assert_int_equal(test_unused_COUNT, 4);
+
+  const uint8_t bytes[] = {0x01, 0xF4, 0x56, 0x78, 0x12, 0x34, 0x00, 0x00, 0xFF, 0xFE};
+  test_sensor_values values;
+  test_sensor_decode(bytes, &values);
+  assert_float_equal(values.humidity, 50.0f, 0.001f);
+  assert_int_equal(values.total, 0x12345678);
+  assert_float_equal(values.temperature, -2.0f, 0.001f);
+
+  const MYRIOTA_ModbusHandle handle = test_modbus_sim_setup(NULL);
+  memset(&values, 0, sizeof(values));
+  test_sim_registers[4] = 0x01F4;
+  test_sim_registers[5] = 0x5678;
+  test_sim_registers[6] = 0x1234;
+  test_sim_registers[8] = 0xFFFE;
+  assert_int_equal(test_sensor_read(handle, 0x01, &values), MODBUS_SUCCESS);
+  assert_int_equal(test_sim.requests, 1);
+  assert_float_equal(values.humidity, 50.0f, 0.001f);
+  assert_int_equal(values.total, 0x12345678);
+  assert_float_equal(values.temperature, -2.0f, 0.001f);
+  assert_int_equal(test_sensor_read(handle, 0x02, &values), -MODBUS_ERROR_IO_FAILURE);
+  MYRIOTA_ModbusDeinit(handle);
+
+  // A response with a valid crc16 but fewer registers than the map spans is rejected.
+  uint8_t short_response[7] = {0x01, MODBUS_FUNCTION_CODE_READ_INPUT_REGISTERS, 2, 0x01, 0xF4};
+  test_append_crc16(short_response, 5);
+  const MYRIOTA_ModbusHandle short_handle =
+    test_modbus_setup(short_response, sizeof(short_response));
+  assert_int_equal(test_sensor_read(short_handle, 0x01, &values),
+    -MODBUS_ERROR_MALFORMED_RESPONSE);
+  MYRIOTA_ModbusDeinit(short_handle);
+}
+
+// Encodes a binary frame without its check field as a Modbus ASCII frame.
+static size_t test_ascii_frame(const uint8_t *const bytes, const size_t size, uint8_t *const frame,
+  const size_t frame_size) {
+  struct application_data_uint adu = {
+    .size = size,
+    .capacity = modbus_frame_capacity(MODBUS_FRAMING_MODE_ASCII, frame_size),
+    .framing_mode = MODBUS_FRAMING_MODE_ASCII,
+    .buffer = frame,
+  };
+  memcpy(frame, bytes, size);
+  modbus_frame_encode(&adu);
+  return adu.size;
+}
+
+static void test_ascii_framing(void **state) {
+  (void)state;
+  // The codec encodes and decodes in place.
+  uint8_t buffer[64];
+  struct application_data_uint adu = {
+    .capacity = modbus_frame_capacity(MODBUS_FRAMING_MODE_ASCII, sizeof(buffer)),
+    .framing_mode = MODBUS_FRAMING_MODE_ASCII,
+    .buffer = buffer,
+  };
+  begin_application_data_unit_pack(&adu, 0x11, MODBUS_FUNCTION_CODE_READ_HOLDING_REGISTERS);
+  application_data_unit_pack_u16(&adu, 0x006B);
+  application_data_unit_pack_u16(&adu, 0x0003);
+  end_application_data_unit_pack(&adu);
+  const char request[] = ":1103006B00037E\r\n";
+  assert_int_equal(adu.size, sizeof(request) - 1);
+  assert_memory_equal(buffer, request, adu.size);
+  assert_int_equal(modbus_frame_decode(&adu), MODBUS_SUCCESS);
+  assert_int_equal(adu.size, 8);
+  const uint8_t binary[] = {0x11, 0x03, 0x00, 0x6B, 0x00, 0x03};
+  assert_memory_equal(buffer, binary, sizeof(binary));
+
+  // Reads through the driver, where each frame ends at its CR LF.
+  const uint8_t response_bytes[] = {0x11, 0x03, 0x06, 0xAE, 0x41, 0x56, 0x52, 0x43, 0x40};
+  uint8_t response[32];
+  const size_t response_size =
+    test_ascii_frame(response_bytes, sizeof(response_bytes), response, sizeof(response));
+  const uint8_t exception_bytes[] = {0x11, 0x83, 0x02};
+  uint8_t exception[16];
+  const size_t exception_size =
+    test_ascii_frame(exception_bytes, sizeof(exception_bytes), exception, sizeof(exception));
+
+  test_serial = (struct test_serial){.rx = response, .rx_size = response_size};
+  const MYRIOTA_ModbusInitOptions options = {
+    .framing_mode = MODBUS_FRAMING_MODE_ASCII,
+    .serial_interface =
+      {
+        .ctx = &test_serial,
+        .init = test_serial_init,
+        .deinit = test_serial_deinit,
+        .read = test_serial_read,
+        .write = test_serial_write,
+      },
+  };
+  const MYRIOTA_ModbusHandle handle = MYRIOTA_ModbusInit(options);
+  assert_int_equal(MYRIOTA_ModbusEnable(handle), MODBUS_SUCCESS);
+
+  uint8_t bytes[6] = {0};
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x11, 0x006B, 3, bytes),
+    MODBUS_SUCCESS);
+  assert_memory_equal(bytes, &response_bytes[3], sizeof(bytes));
+  assert_int_equal(test_serial.tx_size, sizeof(request) - 1);
+  assert_memory_equal(test_serial.tx, request, test_serial.tx_size);
+
+  // The exception is shorter than the expected response, and ends at its CR LF
+  // once its header has been decoded.
+  test_serial = (struct test_serial){.rx = exception, .rx_size = exception_size};
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x11, 0x006B, 3, bytes),
+    -MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_ADDRESS);
+
+  response[7] = '0';
+  test_serial = (struct test_serial){.rx = response, .rx_size = response_size};
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x11, 0x006B, 3, bytes),
+    -MODBUS_ERROR_INVALID_CRC16);
+  response[0] = '!';
+  test_serial = (struct test_serial){.rx = response, .rx_size = response_size};
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x11, 0x006B, 3, bytes),
+    -MODBUS_ERROR_MALFORMED_RESPONSE);
+  MYRIOTA_ModbusDeinit(handle);
+
+  // ASCII frames need twice the buffer space.
+  MYRIOTA_ModbusInitOptions small = options;
+  small.adu_buffer = buffer;
+  small.adu_buffer_size = MODBUS_ADU_BUFFERS_PER_INSTANCE * 2 * MODBUS_ADU_BUFFER_MIN_SIZE;
+  assert_int_equal(MYRIOTA_ModbusInit(small), 0);
+}
+
+#if MODBUS_STATS
+static void test_stats(void **state) {
   (void)state;
+  const MYRIOTA_ModbusHandle handle = test_modbus_sim_setup(NULL);
+
+  uint8_t bytes[4] = {0};
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0, 2, bytes), MODBUS_SUCCESS);
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 63, 2, bytes),
+    -MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_ADDRESS);
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x02, 0, 2, bytes),
+    -MODBUS_ERROR_IO_FAILURE);
+  test_sim.config.crc_error_every = test_sim.responses + 1;
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0, 2, bytes),
+    -MODBUS_ERROR_INVALID_CRC16);
+  test_sim.config.crc_error_every = 0;
+  assert_int_equal(MYRIOTA_ModbusReadHoldingRegisters(handle, 0x01, 0, 200, bytes),
+    -MODBUS_ERROR_OVERFLOW);
+
+  MYRIOTA_ModbusStats stats;
+  assert_int_equal(MYRIOTA_ModbusGetStats(handle, &stats), MODBUS_SUCCESS);
+  assert_int_equal(stats.transactions, 4);
+  assert_int_equal(stats.exceptions[MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_ADDRESS], 1);
+  assert_int_equal(stats.timeouts, 1);
+  assert_int_equal(stats.crc_errors, 1);
+  assert_int_equal(stats.overflows, 1);
+  // 8 byte requests and 7 or 9 byte responses at 19200 baud, 2ms from the slave.
+  uint32_t responses = 0;
+  for (size_t i = 0; i < MODBUS_STATS_LATENCY_BUCKETS; ++i) {
+    responses += stats.latency_histogram[i];
+  }
+  assert_int_equal(responses, 3);
+  assert_int_equal(stats.latency_histogram[3], 3);
+  assert_true(stats.bus_busy_ms >= 100);
+
+  assert_int_equal(MYRIOTA_ModbusGetSlaveStats(handle, 0x02, &stats), MODBUS_SUCCESS);
+  assert_int_equal(stats.transactions, 1);
+  assert_int_equal(stats.timeouts, 1);
+  assert_int_equal(MYRIOTA_ModbusGetSlaveStats(handle, 0x03, &stats),
+    -MODBUS_ERROR_INVALID_ARGUMENT);
+
+  assert_int_equal(MYRIOTA_ModbusResetStats(handle), MODBUS_SUCCESS);
+  assert_int_equal(MYRIOTA_ModbusGetStats(handle, &stats), MODBUS_SUCCESS);
+  assert_int_equal(stats.transactions, 0);
+
+  MYRIOTA_ModbusDeinit(handle);
 }
+#endif
 
 int main(void) {
   const struct CMUnitTest tests[] = {
-    cmocka_unit_test(test_x),
+    cmocka_unit_test(test_read_returns_on_expected_length),
+    cmocka_unit_test(test_read_exception_response),
+    cmocka_unit_test(test_read_truncated_response),
+    cmocka_unit_test(test_inter_frame_delay),
+    cmocka_unit_test(test_crc16_engines),
+    cmocka_unit_test(test_read_invalid_crc16),
+    cmocka_unit_test(test_pack_streaming_crc16),
+    cmocka_unit_test(test_plan_compile_merges_requests),
+    cmocka_unit_test(test_plan_execute_decodes_points),
+    cmocka_unit_test(test_mask_write_register),
+    cmocka_unit_test(test_read_write_registers),
+    cmocka_unit_test(test_async_read),
+    cmocka_unit_test(test_async_timeout_and_idle),
+    cmocka_unit_test(test_async_requires_response_timeout),
+    cmocka_unit_test(test_decode_word_orders),
+    cmocka_unit_test(test_read_decode_fields),
+    cmocka_unit_test(test_caller_supplied_buffer),
+    cmocka_unit_test(test_sim_round_trip),
+    cmocka_unit_test(test_sim_fault_injection),
+    cmocka_unit_test(test_register_cache),
+    cmocka_unit_test(test_broadcast_write),
+    cmocka_unit_test(test_adaptive_timeout_and_retry),
+    cmocka_unit_test(test_sweep),
+    cmocka_unit_test(test_bit_ranges),
+    cmocka_unit_test(test_register_map),
+    cmocka_unit_test(test_ascii_framing),
+#if MODBUS_STATS
+    cmocka_unit_test(test_stats),
+#endif
   };
 
   return cmocka_run_group_tests(tests, NULL, NULL);
@@ -0,0 +1,145 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "myriota/modbus_bits.h"
+
+// Both formats are least significant bit first, so a range is copied as
+// chunks of up to 32 bits, each loaded from and stored to at most 5 bytes or 2
+// words regardless of the alignment of either side.
+#define MODBUS_BITS_CHUNK 32
+
+static inline uint32_t bits_mask(const size_t count) {
+  return count >= MODBUS_BITS_CHUNK ? UINT32_MAX : ((uint32_t)1 << count) - 1;
+}
+
+// Loads `count` (<= 32) bits starting at bit `offset` of bytes.
+static uint32_t bytes_load(const uint8_t *const bytes, const size_t offset, const size_t count) {
+  const uint8_t *const p = &bytes[offset / 8];
+  const size_t shift = offset % 8;
+  const size_t nbytes = (shift + count + 7) / 8;
+  uint64_t value = 0;
+  for (size_t i = 0; i < nbytes; ++i) {
+    value |= (uint64_t)p[i] << (8 * i);
+  }
+  return (uint32_t)(value >> shift) & bits_mask(count);
+}
+
+// Stores `count` (<= 32) bits starting at bit `offset` of bytes.
+static void bytes_store(uint8_t *const bytes, const size_t offset, const size_t count,
+  const uint32_t bits) {
+  uint8_t *const p = &bytes[offset / 8];
+  const size_t shift = offset % 8;
+  const size_t nbytes = (shift + count + 7) / 8;
+  const uint64_t mask = (uint64_t)bits_mask(count) << shift;
+  const uint64_t value = (uint64_t)bits << shift;
+  for (size_t i = 0; i < nbytes; ++i) {
+    const uint8_t byte_mask = (uint8_t)(mask >> (8 * i));
+    p[i] = (p[i] & ~byte_mask) | ((uint8_t)(value >> (8 * i)) & byte_mask);
+  }
+}
+
+// Loads `count` (<= 32) bits starting at bit `offset` of a bitset.
+static uint32_t bitset_load(const uint32_t *const bitset, const size_t offset,
+  const size_t count) {
+  const uint32_t *const p = &bitset[offset / 32];
+  const size_t shift = offset % 32;
+  uint64_t value = p[0];
+  if (shift + count > 32) {
+    value |= (uint64_t)p[1] << 32;
+  }
+  return (uint32_t)(value >> shift) & bits_mask(count);
+}
+
+// Stores `count` (<= 32) bits starting at bit `offset` of a bitset.
+static void bitset_store(uint32_t *const bitset, const size_t offset, const size_t count,
+  const uint32_t bits) {
+  uint32_t *const p = &bitset[offset / 32];
+  const size_t shift = offset % 32;
+  const uint64_t mask = (uint64_t)bits_mask(count) << shift;
+  const uint64_t value = (uint64_t)bits << shift;
+  p[0] = (p[0] & ~(uint32_t)mask) | ((uint32_t)value & (uint32_t)mask);
+  if (shift + count > 32) {
+    p[1] = (p[1] & ~(uint32_t)(mask >> 32)) | ((uint32_t)(value >> 32) & (uint32_t)(mask >> 32));
+  }
+}
+
+// Portable popcount, Cortex-M has no population count instruction.
+static inline size_t bits_popcount(uint32_t bits) {
+  bits = bits - ((bits >> 1) & 0x55555555);
+  bits = (bits & 0x33333333) + ((bits >> 2) & 0x33333333);
+  bits = (bits + (bits >> 4)) & 0x0F0F0F0F;
+  return (bits * 0x01010101) >> 24;
+}
+
+void MYRIOTA_ModbusBitsToBitset(const uint8_t *const bytes, const size_t offset,
+  uint32_t *const bitset, const size_t bitset_offset, const size_t count) {
+  for (size_t i = 0; i < count; i += MODBUS_BITS_CHUNK) {
+    const size_t n = count - i < MODBUS_BITS_CHUNK ? count - i : MODBUS_BITS_CHUNK;
+    bitset_store(bitset, bitset_offset + i, n, bytes_load(bytes, offset + i, n));
+  }
+}
+
+void MYRIOTA_ModbusBitsFromBitset(uint8_t *const bytes, const size_t offset,
+  const uint32_t *const bitset, const size_t bitset_offset, const size_t count) {
+  for (size_t i = 0; i < count; i += MODBUS_BITS_CHUNK) {
+    const size_t n = count - i < MODBUS_BITS_CHUNK ? count - i : MODBUS_BITS_CHUNK;
+    bytes_store(bytes, offset + i, n, bitset_load(bitset, bitset_offset + i, n));
+  }
+}
+
+void MYRIOTA_ModbusBitsToBools(const uint8_t *const bytes, const size_t offset, bool *const values,
+  const size_t count) {
+  for (size_t i = 0; i < count; i += MODBUS_BITS_CHUNK) {
+    const size_t n = count - i < MODBUS_BITS_CHUNK ? count - i : MODBUS_BITS_CHUNK;
+    const uint32_t bits = bytes_load(bytes, offset + i, n);
+    for (size_t j = 0; j < n; ++j) {
+      values[i + j] = (bits >> j) & 0x1;
+    }
+  }
+}
+
+void MYRIOTA_ModbusBitsFromBools(uint8_t *const bytes, const size_t offset,
+  const bool *const values, const size_t count) {
+  for (size_t i = 0; i < count; i += MODBUS_BITS_CHUNK) {
+    const size_t n = count - i < MODBUS_BITS_CHUNK ? count - i : MODBUS_BITS_CHUNK;
+    uint32_t bits = 0;
+    for (size_t j = 0; j < n; ++j) {
+      bits |= (uint32_t)values[i + j] << j;
+    }
+    bytes_store(bytes, offset + i, n, bits);
+  }
+}
+
+size_t MYRIOTA_ModbusBitsCount(const uint8_t *const bytes, const size_t offset,
+  const size_t count) {
+  size_t total = 0;
+  for (size_t i = 0; i < count; i += MODBUS_BITS_CHUNK) {
+    const size_t n = count - i < MODBUS_BITS_CHUNK ? count - i : MODBUS_BITS_CHUNK;
+    total += bits_popcount(bytes_load(bytes, offset + i, n));
+  }
+  return total;
+}
+
+size_t MYRIOTA_ModbusBitsetChanged(const uint32_t *const previous, const uint32_t *const current,
+  uint32_t *const changed, const size_t count) {
+  size_t total = 0;
+  for (size_t i = 0; i < MODBUS_BITSET_WORDS(count); ++i) {
+    const size_t n = count - i * 32 < 32 ? count - i * 32 : 32;
+    const uint32_t diff = (previous[i] ^ current[i]) & bits_mask(n);
+    total += bits_popcount(diff);
+    if (changed != NULL) {
+      changed[i] = diff;
+    }
+  }
+  return total;
+}
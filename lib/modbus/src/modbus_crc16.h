@@ -0,0 +1,66 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRIOTA_MODBUS_CRC16_H
+#define MYRIOTA_MODBUS_CRC16_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC16 engines, trading flash for speed:
+// - MODBUS_CRC_NIBBLE: 16 entry table (32 bytes), two lookups per byte.
+// - MODBUS_CRC_BYTE: 256 entry table (512 bytes), one lookup per byte.
+// - MODBUS_CRC_SLICE4: 4 x 256 entry tables (2048 bytes), four bytes per step.
+#define MODBUS_CRC_NIBBLE 1
+#define MODBUS_CRC_BYTE 2
+#define MODBUS_CRC_SLICE4 3
+
+// NOTE: Select the engine with `-Dmodbus_crc=<engine>` or by defining MODBUS_CRC_ENGINE.
+#ifndef MODBUS_CRC_ENGINE
+#define MODBUS_CRC_ENGINE MODBUS_CRC_BYTE
+#endif
+
+#define MODBUS_CRC16_INIT 0xFFFF
+
+extern const uint16_t modbus_crc16_nibble_table[16];
+extern const uint16_t modbus_crc16_byte_table[256];
+extern const uint16_t modbus_crc16_slice4_table[3][256];
+
+uint16_t modbus_crc16_update_nibble(uint16_t crc, const uint8_t *const buffer, const size_t size);
+uint16_t modbus_crc16_update_byte(uint16_t crc, const uint8_t *const buffer, const size_t size);
+uint16_t modbus_crc16_update_slice4(uint16_t crc, const uint8_t *const buffer, const size_t size);
+
+static inline uint16_t modbus_crc16_update(const uint16_t crc, const uint8_t *const buffer,
+  const size_t size) {
+#if MODBUS_CRC_ENGINE == MODBUS_CRC_NIBBLE
+  return modbus_crc16_update_nibble(crc, buffer, size);
+#elif MODBUS_CRC_ENGINE == MODBUS_CRC_BYTE
+  return modbus_crc16_update_byte(crc, buffer, size);
+#elif MODBUS_CRC_ENGINE == MODBUS_CRC_SLICE4
+  return modbus_crc16_update_slice4(crc, buffer, size);
+#else
+#error "Unsupported MODBUS_CRC_ENGINE"
+#endif
+}
+
+static inline uint16_t modbus_crc16_update_u8(uint16_t crc, const uint8_t value) {
+#if MODBUS_CRC_ENGINE == MODBUS_CRC_NIBBLE
+  crc ^= value;
+  crc = (crc >> 4) ^ modbus_crc16_nibble_table[crc & 0x0F];
+  return (crc >> 4) ^ modbus_crc16_nibble_table[crc & 0x0F];
+#else
+  return (crc >> 8) ^ modbus_crc16_byte_table[(uint8_t)(crc ^ value)];
+#endif
+}
+
+#endif /* MYRIOTA_MODBUS_CRC16_H */
@@ -0,0 +1,173 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "myriota/modbus_decode.h"
+#include <string.h>
+#include "modbus_internal.h"
+
+// Stores a decoded value either raw or scaled, without assuming the alignment
+// of the field in the caller's struct.
+#define MODBUS_DECODE_STORE(field, dest, ctype, raw)               \
+  do {                                                             \
+    const ctype value = (raw);                                     \
+    if ((field)->scale != 0.0f) {                                  \
+      const float scaled = value * (field)->scale + (field)->bias; \
+      memcpy((dest), &scaled, sizeof(scaled));                     \
+    } else {                                                       \
+      memcpy((dest), &value, sizeof(value));                       \
+    }                                                              \
+  } while (0)
+
+// Reads coils/registers, failing unless the response carries every one of them,
+// as a slave may answer with a shorter byte count than requested.
+static int modbus_read_payload_exact(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusReadFunction function,
+  const MYRIOTA_ModbusDataAddress addr, const size_t count, const uint8_t **const payload,
+  size_t *const payload_size) {
+  const int result = modbus_read_payload(handle, slave, function, addr, count, payload,
+    payload_size);
+  if (result != MODBUS_SUCCESS) {
+    return result;
+  }
+
+  const bool is_bit = function == MODBUS_READ_COILS || function == MODBUS_READ_DISCRETE_INPUTS;
+  if (*payload_size != (is_bit ? (count + 8 - 1) / 8 : count * 2)) {
+    return -MODBUS_ERROR_MALFORMED_RESPONSE;
+  }
+  return MODBUS_SUCCESS;
+}
+
+uint16_t MYRIOTA_ModbusValueTypeWidth(const MYRIOTA_ModbusValueType type) {
+  switch (type) {
+    case MODBUS_VALUE_TYPE_BOOL:
+    case MODBUS_VALUE_TYPE_U16:
+    case MODBUS_VALUE_TYPE_I16:
+      return 1;
+    case MODBUS_VALUE_TYPE_U32:
+    case MODBUS_VALUE_TYPE_I32:
+    case MODBUS_VALUE_TYPE_F32:
+      return 2;
+    case MODBUS_VALUE_TYPE_U64:
+    case MODBUS_VALUE_TYPE_I64:
+    case MODBUS_VALUE_TYPE_F64:
+      return 4;
+  }
+  return 0;
+}
+
+static int decode_field(const uint8_t *const bytes, const size_t size,
+  const MYRIOTA_ModbusDecodeField *const field, uint8_t *const dest) {
+  const uint16_t width = MYRIOTA_ModbusValueTypeWidth(field->type);
+  if (width == 0) {
+    return -MODBUS_ERROR_INVALID_ARGUMENT;
+  }
+
+  if (field->type == MODBUS_VALUE_TYPE_BOOL) {
+    if ((size_t)field->index / 8 >= size) {
+      return -MODBUS_ERROR_OVERFLOW;
+    }
+    const bool bit = (bytes[field->index / 8] >> (field->index % 8)) & 0x1;
+    memcpy(dest, &bit, sizeof(bit));
+    return MODBUS_SUCCESS;
+  }
+
+  if (((size_t)field->index + width) * 2 > size) {
+    return -MODBUS_ERROR_OVERFLOW;
+  }
+
+  const uint8_t *const word = &bytes[field->index * 2];
+  const MYRIOTA_ModbusWordOrder order = field->word_order;
+  switch (field->type) {
+    case MODBUS_VALUE_TYPE_U16:
+      MODBUS_DECODE_STORE(field, dest, uint16_t, MYRIOTA_ModbusDecodeU16(word, order));
+      break;
+    case MODBUS_VALUE_TYPE_I16:
+      MODBUS_DECODE_STORE(field, dest, int16_t, MYRIOTA_ModbusDecodeI16(word, order));
+      break;
+    case MODBUS_VALUE_TYPE_U32:
+      MODBUS_DECODE_STORE(field, dest, uint32_t, MYRIOTA_ModbusDecodeU32(word, order));
+      break;
+    case MODBUS_VALUE_TYPE_I32:
+      MODBUS_DECODE_STORE(field, dest, int32_t, MYRIOTA_ModbusDecodeI32(word, order));
+      break;
+    case MODBUS_VALUE_TYPE_F32:
+      MODBUS_DECODE_STORE(field, dest, float, MYRIOTA_ModbusDecodeF32(word, order));
+      break;
+    case MODBUS_VALUE_TYPE_U64:
+      MODBUS_DECODE_STORE(field, dest, uint64_t, MYRIOTA_ModbusDecodeU64(word, order));
+      break;
+    case MODBUS_VALUE_TYPE_I64:
+      MODBUS_DECODE_STORE(field, dest, int64_t, MYRIOTA_ModbusDecodeI64(word, order));
+      break;
+    case MODBUS_VALUE_TYPE_F64:
+      MODBUS_DECODE_STORE(field, dest, double, MYRIOTA_ModbusDecodeF64(word, order));
+      break;
+    case MODBUS_VALUE_TYPE_BOOL:
+      MODBUS_UNREACHABLE;
+      break;
+  }
+
+  return MODBUS_SUCCESS;
+}
+
+int MYRIOTA_ModbusDecode(const uint8_t *const bytes, const size_t size,
+  const MYRIOTA_ModbusDecodeField *const fields, const size_t fields_count, void *const values) {
+  if (bytes == NULL || (fields_count > 0 && (fields == NULL || values == NULL))) {
+    return -MODBUS_ERROR_INVALID_ARGUMENT;
+  }
+
+  for (size_t i = 0; i < fields_count; ++i) {
+    const MYRIOTA_ModbusDecodeField *const field = &fields[i];
+    const int result = decode_field(bytes, size, field, (uint8_t *)values + field->offset);
+    if (result != MODBUS_SUCCESS) {
+      return result;
+    }
+  }
+
+  return MODBUS_SUCCESS;
+}
+
+int MYRIOTA_ModbusReadDecode(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusReadFunction function,
+  const MYRIOTA_ModbusDataAddress addr, const size_t count,
+  const MYRIOTA_ModbusDecodeField *const fields, const size_t fields_count, void *const values) {
+  const uint8_t *payload = NULL;
+  size_t payload_size = 0;
+  const int result =
+    modbus_read_payload_exact(handle, slave, function, addr, count, &payload, &payload_size);
+  if (result != MODBUS_SUCCESS) {
+    return result;
+  }
+
+  return MYRIOTA_ModbusDecode(payload, payload_size, fields, fields_count, values);
+}
+
+int MYRIOTA_ModbusReadDecodeWith(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave, const MYRIOTA_ModbusReadFunction function,
+  const MYRIOTA_ModbusDataAddress addr, const size_t count, const MYRIOTA_ModbusDecodeFn_t decode,
+  void *const values) {
+  if (decode == NULL) {
+    return -MODBUS_ERROR_INVALID_ARGUMENT;
+  }
+
+  const uint8_t *payload = NULL;
+  size_t payload_size = 0;
+  const int result =
+    modbus_read_payload_exact(handle, slave, function, addr, count, &payload, &payload_size);
+  if (result != MODBUS_SUCCESS) {
+    return result;
+  }
+
+  decode(payload, values);
+  return MODBUS_SUCCESS;
+}
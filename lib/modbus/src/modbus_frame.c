@@ -0,0 +1,151 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "modbus_frame.h"
+#include "modbus_internal.h"
+
+// The size of a binary frame's check field, a crc16 in RTU or the LRC and an
+// unused byte in ASCII.
+#define MODBUS_FRAME_CHECK_SIZE 2
+// The ASCII frame header decoded to find the size of a frame, enough to hold
+// the byte count of every request and response.
+#define MODBUS_ASCII_HEADER_SIZE 11
+
+static const char modbus_hex_digits[16] = "0123456789ABCDEF";
+
+// Returns the value of a hex digit, or 0xFF when it isn't one.
+static inline uint8_t modbus_hex_value(const uint8_t digit) {
+  if (digit >= '0' && digit <= '9') {
+    return digit - '0';
+  }
+  if (digit >= 'A' && digit <= 'F') {
+    return digit - 'A' + 10;
+  }
+  if (digit >= 'a' && digit <= 'f') {
+    return digit - 'a' + 10;
+  }
+  return 0xFF;
+}
+
+// ASCII frames are ':', two hex digits per byte of the address, PDU and LRC, and CR LF.
+static inline size_t modbus_ascii_size(const size_t size) {
+  return 1 + 2 * (size - MODBUS_FRAME_CHECK_SIZE + 1) + 2;
+}
+
+uint8_t modbus_lrc(const uint8_t *const bytes, const size_t size) {
+  uint8_t sum = 0;
+  for (size_t i = 0; i < size; ++i) {
+    sum += bytes[i];
+  }
+  return (uint8_t)-sum;
+}
+
+size_t modbus_frame_capacity(const MYRIOTA_ModbusFramingMode framing_mode, const size_t size) {
+  if (framing_mode == MODBUS_FRAMING_MODE_ASCII) {
+    return (size - 1) / 2;
+  }
+  return size;
+}
+
+size_t modbus_frame_wire_size(const struct application_data_uint *const adu, const size_t size) {
+  if (adu->framing_mode == MODBUS_FRAMING_MODE_ASCII) {
+    return modbus_ascii_size(size);
+  }
+  return size;
+}
+
+void modbus_frame_encode(struct application_data_uint *const adu) {
+  MODBUS_ASSERT(adu != NULL);
+  MODBUS_ASSERT(adu->size + MODBUS_FRAME_CHECK_SIZE <= adu->capacity);
+  uint8_t *const buffer = adu->buffer;
+  if (adu->framing_mode != MODBUS_FRAMING_MODE_ASCII) {
+    const uint16_t crc = adu->crc16;
+    buffer[adu->size++] = (uint8_t)crc;
+    buffer[adu->size++] = (uint8_t)(crc >> 8);
+    adu->crc16 = 0;
+    return;
+  }
+
+  // Each byte's digits land at or after the byte itself, so working from the
+  // end expands the frame in place.
+  const size_t nbytes = adu->size + 1;
+  buffer[adu->size] = modbus_lrc(buffer, adu->size);
+  for (size_t i = nbytes; i-- > 0;) {
+    const uint8_t value = buffer[i];
+    buffer[1 + 2 * i] = modbus_hex_digits[value >> 4];
+    buffer[2 + 2 * i] = modbus_hex_digits[value & 0x0F];
+  }
+  buffer[0] = MODBUS_ASCII_START;
+  buffer[1 + 2 * nbytes] = MODBUS_ASCII_CR;
+  buffer[2 + 2 * nbytes] = MODBUS_ASCII_LF;
+  adu->size = 3 + 2 * nbytes;
+  adu->crc16 = 0;
+}
+
+size_t modbus_frame_size(const struct application_data_uint *const adu,
+  const size_t expected_size, const modbus_frame_size_fn frame_size_fn) {
+  if (adu->framing_mode != MODBUS_FRAMING_MODE_ASCII) {
+    return frame_size_fn(adu, expected_size);
+  }
+
+  if (adu->size > 0 && adu->buffer[0] != MODBUS_ASCII_START) {
+    return adu->size;
+  }
+
+  // Size the frame from its header decoded to the side, as the digits are only
+  // decoded in place once the whole frame has arrived.
+  uint8_t header[MODBUS_ASCII_HEADER_SIZE];
+  struct application_data_uint binary = {.capacity = adu->capacity, .buffer = header};
+  while (binary.size < sizeof(header) && 2 + 2 * binary.size < adu->size) {
+    const uint8_t *const digits = &adu->buffer[1 + 2 * binary.size];
+    header[binary.size++] = (modbus_hex_value(digits[0]) << 4) | modbus_hex_value(digits[1]);
+  }
+  return modbus_ascii_size(frame_size_fn(&binary, expected_size));
+}
+
+int modbus_frame_decode(struct application_data_uint *const adu) {
+  MODBUS_ASSERT(adu != NULL);
+  if (adu->framing_mode != MODBUS_FRAMING_MODE_ASCII) {
+    return MODBUS_SUCCESS;
+  }
+
+  // The smallest frame is an address, a function code and the LRC.
+  uint8_t *const buffer = adu->buffer;
+  if (adu->size < modbus_ascii_size(4) || (adu->size - 3) % 2 != 0 ||
+      buffer[0] != MODBUS_ASCII_START || !modbus_frame_is_complete(adu)) {
+    return -MODBUS_ERROR_MALFORMED_RESPONSE;
+  }
+
+  // Each byte is decoded from digits at or after it, so working from the start
+  // decodes the frame in place.
+  const size_t nbytes = (adu->size - 3) / 2;
+  uint8_t sum = 0;
+  for (size_t i = 0; i < nbytes; ++i) {
+    const uint8_t hi = modbus_hex_value(buffer[1 + 2 * i]);
+    const uint8_t low = modbus_hex_value(buffer[2 + 2 * i]);
+    if ((hi | low) > 0x0F) {
+      return -MODBUS_ERROR_MALFORMED_RESPONSE;
+    }
+    buffer[i] = (hi << 4) | low;
+    sum += buffer[i];
+  }
+
+  // The sum of the bytes and their LRC is zero.
+  if (sum != 0) {
+    return -MODBUS_ERROR_INVALID_CRC16;
+  }
+
+  adu->size = nbytes - 1 + MODBUS_FRAME_CHECK_SIZE;
+  adu->crc16 = 0;
+  return MODBUS_SUCCESS;
+}
@@ -0,0 +1,110 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// The Modbus frame codec, shared by every framing mode. Frames are packed and
+// parsed in binary, laid out as RTU frames: the slave address, the PDU and a 2
+// byte check field. The codec converts a frame between that layout and its
+// representation on the wire in place in the ADU's buffer.
+//
+// RTU frames are sent as they are, checked by the crc16 which is accumulated
+// as the frame is packed or received. ASCII frames are sent as ':', the
+// address, PDU and LRC in hex, and CR LF, so a buffer holds frames of at most
+// half its size.
+
+#ifndef MYRIOTA_MODBUS_FRAME_H
+#define MYRIOTA_MODBUS_FRAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "modbus_crc16.h"
+#include "myriota/modbus.h"
+
+#define MODBUS_ASCII_START ':'
+#define MODBUS_ASCII_CR '\r'
+#define MODBUS_ASCII_LF '\n'
+
+struct application_data_uint {
+  size_t size;
+  // The largest binary frame the buffer holds, including its check field.
+  size_t capacity;
+  // Running crc16 of the bytes in the buffer, updated as bytes are packed or
+  // received. Once a frame's own crc16 has been appended it is zero, which
+  // decoding also sets once a frame's check has passed in the other modes.
+  uint16_t crc16;
+  MYRIOTA_ModbusFramingMode framing_mode;
+  // Unless the buffer mode is split, the transmit and receive ADUs share the
+  // same buffer as Modbus RTU is half duplex.
+  uint8_t *buffer;
+};
+
+// Returns the size of the frame being received given the bytes received so far.
+typedef size_t (*modbus_frame_size_fn)(const struct application_data_uint *const adu,
+  const size_t expected_size);
+
+/**
+ * Computes the Modbus ASCII LRC, the two's complement of the sum of the bytes.
+ */
+uint8_t modbus_lrc(const uint8_t *const bytes, const size_t size);
+
+/**
+ * Returns the capacity in binary frame bytes of a buffer of `size` bytes.
+ */
+size_t modbus_frame_capacity(const MYRIOTA_ModbusFramingMode framing_mode, const size_t size);
+
+/**
+ * Returns the size on the wire of a binary frame of `size` bytes, including its
+ * check field.
+ */
+size_t modbus_frame_wire_size(const struct application_data_uint *const adu, const size_t size);
+
+/**
+ * Appends the check field to the packed address and PDU, and encodes the frame
+ * for the wire in place.
+ */
+void modbus_frame_encode(struct application_data_uint *const adu);
+
+/**
+ * Returns the size on the wire of the frame being received given the bytes
+ * received so far, from the size of its binary frame given by `frame_size_fn`.
+ */
+size_t modbus_frame_size(const struct application_data_uint *const adu,
+  const size_t expected_size, const modbus_frame_size_fn frame_size_fn);
+
+/**
+ * Decodes a received frame in place, leaving the binary frame in the buffer.
+ *
+ * \return 0 on success, MODBUS_ERROR_INVALID_CRC16 when the frame's check
+ * fails or MODBUS_ERROR_MALFORMED_RESPONSE when it isn't a frame.
+ */
+int modbus_frame_decode(struct application_data_uint *const adu);
+
+// Accounts for bytes received at the end of the buffer.
+static inline void modbus_frame_received(struct application_data_uint *const adu,
+  const uint8_t *const received, const size_t nreceived) {
+  adu->size += nreceived;
+  if (adu->framing_mode == MODBUS_FRAMING_MODE_RTU) {
+    adu->crc16 = modbus_crc16_update(adu->crc16, received, nreceived);
+  }
+}
+
+// Returns whether the received frame has ended, which is only known from its
+// delimiters in ASCII mode.
+static inline bool modbus_frame_is_complete(const struct application_data_uint *const adu) {
+  return adu->framing_mode == MODBUS_FRAMING_MODE_ASCII && adu->size >= 3 &&
+         adu->buffer[adu->size - 2] == MODBUS_ASCII_CR &&
+         adu->buffer[adu->size - 1] == MODBUS_ASCII_LF;
+}
+
+#endif /* MYRIOTA_MODBUS_FRAME_H */
@@ -0,0 +1,95 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Interfaces shared between the Modbus library's source files. Not part of the
+// public API.
+
+#ifndef MYRIOTA_MODBUS_INTERNAL_H
+#define MYRIOTA_MODBUS_INTERNAL_H
+
+#include "myriota/modbus.h"
+
+// NOTE: you can provide your own assert
+#ifndef MODBUS_ASSERT
+#include <stdio.h>
+#define MODBUS_ASSERT(cond)                          \
+  do {                                               \
+    if (!(cond)) {                                   \
+      printf("Assert @%s:%d\n", __FILE__, __LINE__); \
+      while (1) {                                    \
+      }                                              \
+    }                                                \
+  } while (0)
+#endif
+#define MODBUS_UNREACHABLE MODBUS_ASSERT(false)
+#define MODBUS_ARRAY_SIZE(array) (sizeof(array) / sizeof(*array))
+
+// Maximum quantities of a single read request, see section 6.1 - 6.4 of
+// https://modbus.org/docs/Modbus_Application_Protocol_V1_1b.pdf.
+#define MODBUS_READ_COILS_MAX 2000
+#define MODBUS_READ_REGISTERS_MAX 125
+// Maximum quantities of a read/write multiple registers request, see section
+// 6.17 of https://modbus.org/docs/Modbus_Application_Protocol_V1_1b.pdf.
+#define MODBUS_READ_WRITE_READ_REGISTERS_MAX 125
+#define MODBUS_READ_WRITE_WRITE_REGISTERS_MAX 121
+// Maximum quantities of a write multiple request, see sections 6.11 and 6.12 of
+// https://modbus.org/docs/Modbus_Application_Protocol_V1_1b.pdf.
+#define MODBUS_WRITE_COILS_MAX 1968
+#define MODBUS_WRITE_REGISTERS_MAX 123
+
+/**
+ * Performs a read transaction without copying out the response.
+ *
+ * \param[out] payload Set to point at the response's data bytes inside the
+ * instance's receive buffer. Only valid until the next transaction on the
+ * handle, or in the shared ADU buffer mode, where every instance without its
+ * own adu_buffer receives into the same buffer, on any of those instances.
+ * \param[out] payload_size Set to the number of data bytes in the response.
+ * \return 0 on success else < 0 on error.
+ */
+int modbus_read_payload(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const MYRIOTA_ModbusReadFunction function,
+  const MYRIOTA_ModbusDataAddress data_address, const size_t count, const uint8_t **const payload,
+  size_t *const payload_size);
+
+struct application_data_uint;
+
+/**
+ * Receives a request for the server role once the instance is ready.
+ *
+ * \param[out] request Set to the instance's receive ADU, holding the binary
+ * frame of the request on success.
+ * \param[out] response Set to the instance's transmit ADU to pack the response
+ * into, which may share the request's buffer.
+ * \return 0 on success else < 0 on error.
+ */
+int modbus_request_receive(const MYRIOTA_ModbusHandle handle,
+  const struct application_data_uint **const request,
+  struct application_data_uint **const response);
+
+/**
+ * Sends the response packed into the instance's transmit ADU.
+ *
+ * \return 0 on success else < 0 on error.
+ */
+int modbus_response_send(const MYRIOTA_ModbusHandle handle);
+
+/**
+ * Waits with the instance's delay function, if it has one.
+ *
+ * \param[in] ms The time to wait in milliseconds.
+ * \return 0 on success else < 0 on error.
+ */
+int modbus_delay(const MYRIOTA_ModbusHandle handle, const uint32_t ms);
+
+#endif /* MYRIOTA_MODBUS_INTERNAL_H */
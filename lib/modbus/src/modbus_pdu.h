@@ -0,0 +1,240 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// The Modbus PDU codec, shared by the master and server roles: function codes,
+// ADU sizes, and packing and parsing binary frames, see modbus_frame.h for
+// their representation on the wire.
+
+#ifndef MYRIOTA_MODBUS_PDU_H
+#define MYRIOTA_MODBUS_PDU_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "modbus_crc16.h"
+#include "modbus_frame.h"
+#include "modbus_internal.h"
+#include "myriota/modbus.h"
+
+// ADU has at least a slave address, a PDU with a function code, and a crc16.
+#define MODBUS_ADU_MIN_SIZE 4
+// Exception response is a slave address, a function code, an exception code and a crc16.
+#define MODBUS_ADU_EXCEPTION_SIZE 5
+// Read response is a slave address, a function code, a byte count, the data and a crc16.
+#define MODBUS_ADU_READ_RESPONSE_SIZE(nbytes) (5 + (nbytes))
+// Write response is a slave address, a function code, an address, a value/quantity and a crc16.
+#define MODBUS_ADU_WRITE_RESPONSE_SIZE 8
+// Mask write response is a slave address, a function code, an address, two masks and a crc16.
+#define MODBUS_ADU_MASK_WRITE_RESPONSE_SIZE 10
+// Every supported request is at least a slave address, a function code, an
+// address, a value/quantity and a crc16.
+#define MODBUS_ADU_REQUEST_MIN_SIZE 8
+// Write multiple request is the write response's fields, a byte count, the data and a crc16.
+#define MODBUS_ADU_WRITE_MULTIPLE_REQUEST_SIZE(nbytes) (9 + (nbytes))
+// Read/write request is a slave address, a function code, two addresses and
+// quantities, a byte count, the data and a crc16.
+#define MODBUS_ADU_READ_WRITE_REQUEST_SIZE(nbytes) (13 + (nbytes))
+
+// TODO: Add support for unsupported commands
+enum modbus_function_code {
+  MODBUS_FUNCTION_CODE_READ_COILS = 0x01,
+  MODBUS_FUNCTION_CODE_READ_DISCRETE_INPUTS = 0x02,
+  MODBUS_FUNCTION_CODE_READ_HOLDING_REGISTERS = 0x03,
+  MODBUS_FUNCTION_CODE_READ_INPUT_REGISTERS = 0x04,
+  MODBUS_FUNCTION_CODE_WRITE_SINGLE_COIL = 0x05,
+  MODBUS_FUNCTION_CODE_WRITE_SINGLE_REGISTER = 0x06,
+  // MODBUS_FUNCTION_CODE_READ_EXCEPTION_STATUS = 0x07,
+  // MODBUS_FUNCTION_CODE_DIAGNOSTICS = 0x08,
+  // MODBUS_FUNCTION_CODE_COMM_EVENT_COUNTER = 0x0B,
+  // MODBUS_FUNCTION_CODE_COMM_EVENT_LOG = 0x0C,
+  MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_COILS = 0x0F,
+  MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_REGISTERS = 0x10,
+  // MODBUS_FUNCTION_CODE_REPORT_SLAVE_ID = 0x11,
+  // MODBUS_FUNCTION_CODE_READ_FILE_RECORD = 0x14,
+  // MODBUS_FUNCTION_CODE_WRITE_FILE_RECORD = 0x15,
+  MODBUS_FUNCTION_CODE_MASK_WRITE_REGISTER = 0x16,
+  MODBUS_FUNCTION_CODE_READ_WRITE_MULTIPLE_REGISTERS = 0x17,
+  // MODBUS_FUNCTION_CODE_READ_FIFO_QUEUE = 0x18,
+  // MODBUS_FUNCTION_CODE_ENCAPSULATED_INTERFACE_TRANSPORT = 0x2B,
+  MODBUS_FUNCTION_CODE_ERROR_BASE = 0x80,
+};
+
+// enum modbus_encapsulated_interface_type {
+//   MODBUS_ENCAPSULATED_INTERFACE_TYPE_CANOPEN_GENERAL_REFERENCE_REQUEST_AND_RESPONSE_PDU = 0x0D,
+//   MODBUS_ENCAPSULATED_INTERFACE_TYPE_READ_DEVICE_IDENTIFICATION = 0x0E,
+// };
+
+struct protocol_data_unit_parser {
+  enum modbus_function_code function_code;
+  const uint8_t *ptr;
+  const uint8_t *end;
+};
+
+static inline uint8_t hi_u16(const uint16_t value) {
+  return (uint8_t)(value >> 8);
+}
+
+static inline uint8_t low_u16(const uint16_t value) {
+  return (uint8_t)value;
+}
+
+static inline uint16_t merge_u16(const uint8_t hi, const uint8_t low) {
+  return ((uint16_t)hi << 8) | (uint16_t)low;
+}
+
+static inline bool is_read_function_code(const enum modbus_function_code function_code) {
+  return function_code == MODBUS_FUNCTION_CODE_READ_COILS ||
+         function_code == MODBUS_FUNCTION_CODE_READ_DISCRETE_INPUTS ||
+         function_code == MODBUS_FUNCTION_CODE_READ_HOLDING_REGISTERS ||
+         function_code == MODBUS_FUNCTION_CODE_READ_INPUT_REGISTERS;
+}
+
+static inline bool is_read_register(const enum modbus_function_code function_code) {
+  return function_code == MODBUS_FUNCTION_CODE_READ_HOLDING_REGISTERS ||
+         function_code == MODBUS_FUNCTION_CODE_READ_INPUT_REGISTERS ||
+         function_code == MODBUS_FUNCTION_CODE_READ_WRITE_MULTIPLE_REGISTERS;
+}
+
+static inline bool is_byte_count_response(const enum modbus_function_code function_code) {
+  return is_read_function_code(function_code) ||
+         function_code == MODBUS_FUNCTION_CODE_READ_WRITE_MULTIPLE_REGISTERS;
+}
+
+static inline bool is_write_function_code(const enum modbus_function_code function_code) {
+  return function_code == MODBUS_FUNCTION_CODE_WRITE_SINGLE_COIL ||
+         function_code == MODBUS_FUNCTION_CODE_WRITE_SINGLE_REGISTER ||
+         function_code == MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_COILS ||
+         function_code == MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_REGISTERS;
+}
+
+static inline bool is_write_multiple(const enum modbus_function_code function_code) {
+  return function_code == MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_COILS ||
+         function_code == MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_REGISTERS;
+}
+
+static inline bool is_write_multiple_coil(const enum modbus_function_code function_code) {
+  return function_code == MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_COILS;
+}
+
+static inline enum modbus_function_code get_error_function_code(
+  const enum modbus_function_code function_code) {
+  return function_code | MODBUS_FUNCTION_CODE_ERROR_BASE;
+}
+
+static inline void application_data_unit_pack_u8(struct application_data_uint *const adu,
+  const uint8_t value) {
+  MODBUS_ASSERT(adu != NULL);
+  MODBUS_ASSERT(adu->size < adu->capacity);
+  adu->buffer[adu->size++] = value;
+  adu->crc16 = modbus_crc16_update_u8(adu->crc16, value);
+}
+
+static inline void application_data_unit_pack_u16(struct application_data_uint *const adu,
+  const uint16_t value) {
+  MODBUS_ASSERT(adu != NULL);
+  MODBUS_ASSERT((adu->size + 1) < adu->capacity);
+  adu->buffer[adu->size++] = hi_u16(value);
+  adu->buffer[adu->size++] = low_u16(value);
+  adu->crc16 = modbus_crc16_update_u8(adu->crc16, hi_u16(value));
+  adu->crc16 = modbus_crc16_update_u8(adu->crc16, low_u16(value));
+}
+
+static inline void application_data_unit_pack_bytes(struct application_data_uint *const adu,
+  const uint8_t *const bytes, const size_t nbytes) {
+  MODBUS_ASSERT(adu != NULL);
+  MODBUS_ASSERT((adu->size + nbytes) <= adu->capacity);
+  memcpy(&adu->buffer[adu->size], bytes, nbytes);
+  adu->size += nbytes;
+  adu->crc16 = modbus_crc16_update(adu->crc16, bytes, nbytes);
+}
+
+static inline void begin_application_data_unit_pack(struct application_data_uint *const adu,
+  const MYRIOTA_ModbusDeviceAddress slave_address, const enum modbus_function_code function_code) {
+  MODBUS_ASSERT(adu != NULL);
+  adu->size = 0;
+  adu->crc16 = MODBUS_CRC16_INIT;
+  application_data_unit_pack_u8(adu, slave_address);
+  application_data_unit_pack_u8(adu, function_code);
+}
+
+static inline void end_application_data_unit_pack(struct application_data_uint *const adu) {
+  MODBUS_ASSERT(adu != NULL);
+  modbus_frame_encode(adu);
+}
+
+static inline uint8_t protocol_data_unit_unpack_u8(
+  struct protocol_data_unit_parser *const parser) {
+  MODBUS_ASSERT(parser != NULL);
+  MODBUS_ASSERT(parser->ptr < parser->end);
+  const uint8_t value = parser->ptr[0];
+  ++parser->ptr;
+  return value;
+}
+
+static inline uint16_t protocol_data_unit_unpack_u16(
+  struct protocol_data_unit_parser *const parser) {
+  MODBUS_ASSERT(parser != NULL);
+  MODBUS_ASSERT(parser->ptr + 1 < parser->end);
+  const uint16_t value = merge_u16(parser->ptr[0], parser->ptr[1]);
+  parser->ptr += 2;
+  return value;
+}
+
+static inline int protocol_data_unit_parser(const struct application_data_uint *const adu,
+  const MYRIOTA_ModbusDeviceAddress slave_address_out,
+  const enum modbus_function_code function_code, struct protocol_data_unit_parser *const parser) {
+  MODBUS_ASSERT(adu != NULL);
+  MODBUS_ASSERT(parser != NULL);
+  MODBUS_ASSERT(adu->size >= MODBUS_ADU_MIN_SIZE);
+
+  // Application Data Unit (ADU)/(Protocol Data Unit (PDU) Packing Diagram
+  // | 0     | Slave Address |
+  // | 1     | Function Code |
+  // | 2*    | PDU Payload   |
+  // | N - 2 | CRC16 High    |
+  // | N - 1 | CRC16 Low     |
+  // Where N is the size of the ADU packet.
+  // * The PDU payload will be at index 2 if it exist. If the message doesn't
+  // have a payload, then index 2 will be the CRC16 High.
+  const MYRIOTA_ModbusDeviceAddress slave_address_in = adu->buffer[0];
+  parser->function_code = adu->buffer[1];
+  parser->ptr = &adu->buffer[2];
+  parser->end = parser->ptr + (adu->size - MODBUS_ADU_MIN_SIZE);
+
+  // The crc16 was accumulated as the frame was received. Running the crc16 over
+  // a frame including its own (low byte first) crc16 leaves a remainder of zero.
+  if (adu->crc16 != 0) {
+    return -MODBUS_ERROR_INVALID_CRC16;
+  }
+
+  if (slave_address_out != slave_address_in) {
+    return -MODBUS_ERROR_RESPONSE_FROM_WRONG_SLAVE_ADDRESS;
+  }
+
+  // Exception Responses
+  // | 1 | Function Code with Most Significant Bit set |
+  // | 2 | Exception code                              |
+  if (parser->function_code != function_code) {
+    if (parser->function_code == get_error_function_code(function_code)) {
+      const uint8_t exception_code = protocol_data_unit_unpack_u8(parser);
+      return -exception_code;
+    }
+    return -MODBUS_ERROR_MALFORMED_RESPONSE;
+  }
+
+  return MODBUS_SUCCESS;
+}
+
+#endif /* MYRIOTA_MODBUS_PDU_H */
@@ -0,0 +1,262 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "myriota/modbus_plan.h"
+#include <string.h>
+#include "modbus_internal.h"
+
+static inline bool is_bit_function(const MYRIOTA_ModbusReadFunction function) {
+  return function == MODBUS_READ_COILS || function == MODBUS_READ_DISCRETE_INPUTS;
+}
+
+static inline bool is_register_function(const MYRIOTA_ModbusReadFunction function) {
+  return function == MODBUS_READ_HOLDING_REGISTERS || function == MODBUS_READ_INPUT_REGISTERS;
+}
+
+static inline uint16_t request_limit(const MYRIOTA_ModbusReadFunction function) {
+  return is_bit_function(function) ? MODBUS_READ_COILS_MAX : MODBUS_READ_REGISTERS_MAX;
+}
+
+// Returns the number of coils/registers spanned by a point, else 0 if the
+// point's type can't be read with its function.
+static uint16_t point_width(const MYRIOTA_ModbusPoint *const point) {
+  const bool is_bit_type = point->type == MODBUS_VALUE_TYPE_BOOL;
+  if (is_bit_type ? !is_bit_function(point->function) : !is_register_function(point->function)) {
+    return 0;
+  }
+  return MYRIOTA_ModbusValueTypeWidth(point->type);
+}
+
+static inline uint32_t request_end(const MYRIOTA_ModbusPlanRequest *const request) {
+  return (uint32_t)request->addr + request->count;
+}
+
+static inline bool is_same_table(const MYRIOTA_ModbusPlanRequest *const a,
+  const MYRIOTA_ModbusPlanRequest *const b) {
+  return a->slave == b->slave && a->function == b->function;
+}
+
+// Merges `other` into `request` if the merged request is within the Modbus
+// limits and the unused range between them is no more than `gap`.
+static bool request_merge(MYRIOTA_ModbusPlanRequest *const request,
+  const MYRIOTA_ModbusPlanRequest *const other, const uint16_t gap) {
+  if (!is_same_table(request, other)) {
+    return false;
+  }
+
+  const uint32_t start = (request->addr < other->addr) ? request->addr : other->addr;
+  const uint32_t end =
+    (request_end(request) > request_end(other)) ? request_end(request) : request_end(other);
+  if (end - start > request_limit(request->function)) {
+    return false;
+  }
+
+  const bool gap_before = (uint32_t)other->addr > request_end(request) &&
+                          (uint32_t)other->addr - request_end(request) > gap;
+  const bool gap_after = (uint32_t)request->addr > request_end(other) &&
+                         (uint32_t)request->addr - request_end(other) > gap;
+  if (gap_before || gap_after) {
+    return false;
+  }
+
+  request->addr = start;
+  request->count = end - start;
+  return true;
+}
+
+static bool request_less(const MYRIOTA_ModbusPlanRequest *const a,
+  const MYRIOTA_ModbusPlanRequest *const b) {
+  if (a->slave != b->slave) {
+    return a->slave < b->slave;
+  }
+  if (a->function != b->function) {
+    return a->function < b->function;
+  }
+  return a->addr < b->addr;
+}
+
+static void requests_sort(MYRIOTA_ModbusPlanRequest *const requests, const size_t count) {
+  for (size_t i = 1; i < count; ++i) {
+    const MYRIOTA_ModbusPlanRequest request = requests[i];
+    size_t j = i;
+    for (; j > 0 && request_less(&request, &requests[j - 1]); --j) {
+      requests[j] = requests[j - 1];
+    }
+    requests[j] = request;
+  }
+}
+
+int MYRIOTA_ModbusPlanCompile(MYRIOTA_ModbusPlan *const plan,
+  const MYRIOTA_ModbusPoint *const points, const size_t points_count,
+  MYRIOTA_ModbusPlanRequest *const requests, const size_t requests_max, const uint16_t gap) {
+  if (plan == NULL || (points_count > 0 && (points == NULL || requests == NULL))) {
+    return -MODBUS_ERROR_INVALID_ARGUMENT;
+  }
+
+  size_t count = 0;
+  for (size_t i = 0; i < points_count; ++i) {
+    const MYRIOTA_ModbusPoint *const point = &points[i];
+    const uint16_t width = point_width(point);
+    if (width == 0 || (uint32_t)point->addr + width > UINT16_MAX + 1) {
+      return -MODBUS_ERROR_INVALID_ARGUMENT;
+    }
+
+    const MYRIOTA_ModbusPlanRequest request = {
+      .slave = point->slave,
+      .function = point->function,
+      .addr = point->addr,
+      .count = width,
+    };
+
+    bool merged = false;
+    for (size_t j = 0; j < count && !merged; ++j) {
+      merged = request_merge(&requests[j], &request, gap);
+    }
+
+    if (!merged) {
+      if (count >= requests_max) {
+        return -MODBUS_ERROR_OVERFLOW;
+      }
+      requests[count++] = request;
+    }
+  }
+
+  // Points are merged in the order they're listed, so sort the requests and
+  // merge any neighbours that have grown to within `gap` of each other.
+  requests_sort(requests, count);
+  size_t merged_count = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (merged_count == 0 || !request_merge(&requests[merged_count - 1], &requests[i], gap)) {
+      requests[merged_count++] = requests[i];
+    }
+  }
+
+  plan->points = points;
+  plan->points_count = points_count;
+  plan->requests = requests;
+  plan->requests_max = requests_max;
+  plan->requests_count = merged_count;
+
+  return MODBUS_SUCCESS;
+}
+
+// Executes a plan, leaving `inter_frame_ms` of silence before each request
+// after the first.
+static int plan_execute(const MYRIOTA_ModbusHandle handle, const MYRIOTA_ModbusPlan *const plan,
+  void *const values, const uint32_t inter_frame_ms) {
+  if (plan == NULL || values == NULL) {
+    return -MODBUS_ERROR_INVALID_ARGUMENT;
+  }
+
+  for (size_t i = 0; i < plan->requests_count; ++i) {
+    const MYRIOTA_ModbusPlanRequest *const request = &plan->requests[i];
+    if (i > 0) {
+      modbus_delay(handle, inter_frame_ms);
+    }
+
+    const uint8_t *payload = NULL;
+    size_t payload_size = 0;
+    const int result = modbus_read_payload(handle, request->slave, request->function,
+      request->addr, request->count, &payload, &payload_size);
+    if (result != MODBUS_SUCCESS) {
+      return result;
+    }
+
+    const size_t expected_size =
+      is_bit_function(request->function) ? (request->count + 8 - 1) / 8 : request->count * 2;
+    if (payload_size < expected_size) {
+      return -MODBUS_ERROR_MALFORMED_RESPONSE;
+    }
+
+    for (size_t j = 0; j < plan->points_count; ++j) {
+      const MYRIOTA_ModbusPoint *const point = &plan->points[j];
+      const MYRIOTA_ModbusPlanRequest point_request = {
+        .slave = point->slave,
+        .function = point->function,
+        .addr = point->addr,
+        .count = point_width(point),
+      };
+      const bool in_request = is_same_table(request, &point_request) &&
+                              point_request.addr >= request->addr &&
+                              request_end(&point_request) <= request_end(request);
+      if (in_request) {
+        const MYRIOTA_ModbusDecodeField field = {
+          .type = point->type,
+          .word_order = point->word_order,
+          .index = point->addr - request->addr,
+          .offset = point->offset,
+        };
+        const int decode_result = MYRIOTA_ModbusDecode(payload, payload_size, &field, 1, values);
+        if (decode_result != MODBUS_SUCCESS) {
+          return decode_result;
+        }
+      }
+    }
+  }
+
+  return MODBUS_SUCCESS;
+}
+
+int MYRIOTA_ModbusPlanExecute(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusPlan *const plan, void *const values) {
+  return plan_execute(handle, plan, values, 0);
+}
+
+int MYRIOTA_ModbusSweep(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusSweepOptions *const options, MYRIOTA_ModbusSweepSlave *const slaves,
+  const size_t slaves_count) {
+  if (options == NULL || (slaves_count > 0 && slaves == NULL)) {
+    return -MODBUS_ERROR_INVALID_ARGUMENT;
+  }
+
+  if (options->power_on != NULL && options->power_on(options->ctx) < 0) {
+    return -MODBUS_ERROR_IO_FAILURE;
+  }
+
+  int result = modbus_delay(handle, options->stabilization_ms);
+  bool enabled = false;
+  if (result == MODBUS_SUCCESS) {
+    result = MYRIOTA_ModbusEnable(handle);
+    enabled = result == MODBUS_SUCCESS;
+    // A driver that was already enabled is left enabled.
+    if (result == -MODBUS_ERROR_BAD_STATE) {
+      result = MODBUS_SUCCESS;
+    }
+  }
+
+  const bool ready = result == MODBUS_SUCCESS;
+  for (size_t i = 0; i < slaves_count; ++i) {
+    MYRIOTA_ModbusSweepSlave *const slave = &slaves[i];
+    if (!ready) {
+      slave->result = result;
+      continue;
+    }
+
+    if (i > 0) {
+      modbus_delay(handle, options->inter_frame_ms);
+    }
+    slave->result = plan_execute(handle, slave->plan, slave->values, options->inter_frame_ms);
+    if (result == MODBUS_SUCCESS) {
+      result = slave->result;
+    }
+  }
+
+  if (enabled) {
+    MYRIOTA_ModbusDisable(handle);
+  }
+  if (options->power_off != NULL) {
+    options->power_off(options->ctx);
+  }
+
+  return result;
+}
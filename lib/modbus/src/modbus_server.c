@@ -0,0 +1,545 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "myriota/modbus_server.h"
+#include <string.h>
+#include "modbus_crc16.h"
+#include "modbus_internal.h"
+#include "modbus_pdu.h"
+#include "myriota/modbus_bits.h"
+
+static const MYRIOTA_ModbusServerRegion *modbus_server_region_find(
+  const MYRIOTA_ModbusServer *const server, const MYRIOTA_ModbusReadFunction table,
+  const MYRIOTA_ModbusDataAddress addr, const size_t count) {
+  for (size_t i = 0; i < server->regions_count; ++i) {
+    const MYRIOTA_ModbusServerRegion *const region = &server->regions[i];
+    if (region->table == table && addr >= region->addr &&
+        (uint32_t)addr + count <= (uint32_t)region->addr + region->count) {
+      return region;
+    }
+  }
+  return NULL;
+}
+
+// Returns the exception code of a callback's result, 0 on success.
+static uint8_t modbus_server_exception(const int result) {
+  if (result >= 0) {
+    return MODBUS_SUCCESS;
+  }
+  // Only the defined exception codes go on the wire, anything else is a device failure.
+  switch (-result) {
+    case MODBUS_ERROR_EXCEPTION_ILLEGAL_FUNCTION:
+    case MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_ADDRESS:
+    case MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_VALUE:
+    case MODBUS_ERROR_EXCEPTION_SLAVE_DEVICE_FAILURE:
+    case MODBUS_ERROR_EXCEPTION_ACKNOWLEDGE:
+    case MODBUS_ERROR_EXCEPTION_SLAVE_DEVICE_BUSY:
+    case MODBUS_ERROR_EXCEPTION_NEGATIVE_ACKNOWLEDGMENT:
+    case MODBUS_ERROR_EXCEPTION_MEMORY_PARITY_ERROR:
+    case MODBUS_ERROR_EXCEPTION_GATEWAY_PATH_UNAVAILABLE:
+    case MODBUS_ERROR_EXCEPTION_GATEWAY_TARGET_DEVICE_FAILED_TO_RESPOND:
+      return -result;
+    default:
+      return MODBUS_ERROR_EXCEPTION_SLAVE_DEVICE_FAILURE;
+  }
+}
+
+static uint8_t modbus_server_region_read(const MYRIOTA_ModbusServerRegion *const region,
+  const MYRIOTA_ModbusDataAddress addr, const uint16_t count, uint8_t *const bytes) {
+  const size_t offset = addr - region->addr;
+  if (region->read != NULL) {
+    return modbus_server_exception(region->read(region->ctx, addr, count, bytes));
+  }
+
+  if (region->registers != NULL) {
+    for (size_t i = 0; i < count; ++i) {
+      bytes[2 * i] = hi_u16(region->registers[offset + i]);
+      bytes[2 * i + 1] = low_u16(region->registers[offset + i]);
+    }
+    return MODBUS_SUCCESS;
+  }
+
+  if (region->bits != NULL) {
+    // The unused bits of the last byte must be zero.
+    bytes[(count - 1) / 8] = 0;
+    MYRIOTA_ModbusBitsFromBitset(bytes, 0, region->bits, offset, count);
+    return MODBUS_SUCCESS;
+  }
+
+  return MODBUS_ERROR_EXCEPTION_SLAVE_DEVICE_FAILURE;
+}
+
+static uint8_t modbus_server_region_write(const MYRIOTA_ModbusServerRegion *const region,
+  const MYRIOTA_ModbusDataAddress addr, const uint16_t count, const uint8_t *const bytes) {
+  const size_t offset = addr - region->addr;
+  if (region->write != NULL) {
+    return modbus_server_exception(region->write(region->ctx, addr, count, bytes));
+  }
+
+  if (region->registers != NULL) {
+    for (size_t i = 0; i < count; ++i) {
+      region->registers[offset + i] = merge_u16(bytes[2 * i], bytes[2 * i + 1]);
+    }
+    return MODBUS_SUCCESS;
+  }
+
+  if (region->bits != NULL) {
+    MYRIOTA_ModbusBitsToBitset(bytes, 0, region->bits, offset, count);
+    return MODBUS_SUCCESS;
+  }
+
+  return MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+}
+
+static size_t modbus_server_remaining(const struct protocol_data_unit_parser *const parser) {
+  return parser->end - parser->ptr;
+}
+
+// Reads a region straight into the response being packed.
+static uint8_t modbus_server_pack_read(struct application_data_uint *const adu,
+  const MYRIOTA_ModbusServerRegion *const region, const MYRIOTA_ModbusDataAddress addr,
+  const uint16_t count, const size_t nbytes) {
+  if (MODBUS_ADU_READ_RESPONSE_SIZE(nbytes) > adu->capacity) {
+    return MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_VALUE;
+  }
+
+  application_data_unit_pack_u8(adu, nbytes);
+  uint8_t *const data = &adu->buffer[adu->size];
+  const uint8_t exception = modbus_server_region_read(region, addr, count, data);
+  if (exception != MODBUS_SUCCESS) {
+    return exception;
+  }
+  adu->size += nbytes;
+  adu->crc16 = modbus_crc16_update(adu->crc16, data, nbytes);
+  return MODBUS_SUCCESS;
+}
+
+// Executes a request, packing its response into adu. Every field of the
+// request is parsed before the response is packed, as they may share a buffer.
+static uint8_t modbus_server_execute(struct application_data_uint *const adu,
+  const MYRIOTA_ModbusServer *const server, const MYRIOTA_ModbusDeviceAddress address,
+  struct protocol_data_unit_parser *const parser) {
+  const enum modbus_function_code function_code = parser->function_code;
+  if (function_code == MODBUS_FUNCTION_CODE_READ_WRITE_MULTIPLE_REGISTERS) {
+    if (modbus_server_remaining(parser) < 9) {
+      return MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    const uint16_t read_addr = protocol_data_unit_unpack_u16(parser);
+    const uint16_t read_count = protocol_data_unit_unpack_u16(parser);
+    const uint16_t write_addr = protocol_data_unit_unpack_u16(parser);
+    const uint16_t write_count = protocol_data_unit_unpack_u16(parser);
+    const uint8_t nbytes = protocol_data_unit_unpack_u8(parser);
+    if (read_count == 0 || read_count > MODBUS_READ_WRITE_READ_REGISTERS_MAX ||
+        write_count == 0 || write_count > MODBUS_READ_WRITE_WRITE_REGISTERS_MAX ||
+        nbytes != write_count * 2 || modbus_server_remaining(parser) < nbytes) {
+      return MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    const MYRIOTA_ModbusServerRegion *const read_region =
+      modbus_server_region_find(server, MODBUS_READ_HOLDING_REGISTERS, read_addr, read_count);
+    const MYRIOTA_ModbusServerRegion *const write_region =
+      modbus_server_region_find(server, MODBUS_READ_HOLDING_REGISTERS, write_addr, write_count);
+    if (read_region == NULL || write_region == NULL) {
+      return MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+    }
+    // The write is performed before the read.
+    const uint8_t exception =
+      modbus_server_region_write(write_region, write_addr, write_count, parser->ptr);
+    if (exception != MODBUS_SUCCESS) {
+      return exception;
+    }
+    begin_application_data_unit_pack(adu, address, function_code);
+    return modbus_server_pack_read(adu, read_region, read_addr, read_count, read_count * 2);
+  }
+
+  if (modbus_server_remaining(parser) < 4) {
+    return MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_VALUE;
+  }
+  const uint16_t addr = protocol_data_unit_unpack_u16(parser);
+  const uint16_t value = protocol_data_unit_unpack_u16(parser);
+
+  if (is_read_function_code(function_code)) {
+    const bool is_register = is_read_register(function_code);
+    if (value == 0 || value > (is_register ? MODBUS_READ_REGISTERS_MAX : MODBUS_READ_COILS_MAX)) {
+      return MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    const MYRIOTA_ModbusServerRegion *const region =
+      modbus_server_region_find(server, (MYRIOTA_ModbusReadFunction)function_code, addr, value);
+    if (region == NULL) {
+      return MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+    }
+    begin_application_data_unit_pack(adu, address, function_code);
+    return modbus_server_pack_read(adu, region, addr, value,
+      is_register ? value * 2 : (value + 8 - 1) / 8);
+  }
+
+  uint8_t exception = MODBUS_SUCCESS;
+  switch (function_code) {
+    case MODBUS_FUNCTION_CODE_WRITE_SINGLE_COIL: {
+      if (value != 0xFF00 && value != 0x0000) {
+        return MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_VALUE;
+      }
+      const MYRIOTA_ModbusServerRegion *const region =
+        modbus_server_region_find(server, MODBUS_READ_COILS, addr, 1);
+      if (region == NULL) {
+        return MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+      }
+      const uint8_t bit = (value == 0xFF00);
+      exception = modbus_server_region_write(region, addr, 1, &bit);
+      break;
+    }
+    case MODBUS_FUNCTION_CODE_WRITE_SINGLE_REGISTER: {
+      const MYRIOTA_ModbusServerRegion *const region =
+        modbus_server_region_find(server, MODBUS_READ_HOLDING_REGISTERS, addr, 1);
+      if (region == NULL) {
+        return MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+      }
+      const uint8_t bytes[2] = {hi_u16(value), low_u16(value)};
+      exception = modbus_server_region_write(region, addr, 1, bytes);
+      break;
+    }
+    case MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_COILS:
+    case MODBUS_FUNCTION_CODE_WRITE_MULTIPLE_REGISTERS: {
+      const bool is_coil = is_write_multiple_coil(function_code);
+      if (modbus_server_remaining(parser) < 1) {
+        return MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_VALUE;
+      }
+      const uint8_t nbytes = protocol_data_unit_unpack_u8(parser);
+      if (value == 0 || value > (is_coil ? MODBUS_WRITE_COILS_MAX : MODBUS_WRITE_REGISTERS_MAX) ||
+          nbytes != (is_coil ? (value + 8 - 1) / 8 : value * 2) ||
+          modbus_server_remaining(parser) < nbytes) {
+        return MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_VALUE;
+      }
+      const MYRIOTA_ModbusServerRegion *const region = modbus_server_region_find(server,
+        is_coil ? MODBUS_READ_COILS : MODBUS_READ_HOLDING_REGISTERS, addr, value);
+      if (region == NULL) {
+        return MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+      }
+      exception = modbus_server_region_write(region, addr, value, parser->ptr);
+      break;
+    }
+    case MODBUS_FUNCTION_CODE_MASK_WRITE_REGISTER: {
+      if (modbus_server_remaining(parser) < 2) {
+        return MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_VALUE;
+      }
+      const uint16_t or_mask = protocol_data_unit_unpack_u16(parser);
+      const MYRIOTA_ModbusServerRegion *const region =
+        modbus_server_region_find(server, MODBUS_READ_HOLDING_REGISTERS, addr, 1);
+      if (region == NULL) {
+        return MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+      }
+      uint8_t bytes[2];
+      exception = modbus_server_region_read(region, addr, 1, bytes);
+      if (exception != MODBUS_SUCCESS) {
+        return exception;
+      }
+      const uint16_t current = merge_u16(bytes[0], bytes[1]);
+      const uint16_t result = (current & value) | (or_mask & ~value);
+      bytes[0] = hi_u16(result);
+      bytes[1] = low_u16(result);
+      exception = modbus_server_region_write(region, addr, 1, bytes);
+      if (exception != MODBUS_SUCCESS) {
+        return exception;
+      }
+      begin_application_data_unit_pack(adu, address, function_code);
+      application_data_unit_pack_u16(adu, addr);
+      application_data_unit_pack_u16(adu, value);
+      application_data_unit_pack_u16(adu, or_mask);
+      return MODBUS_SUCCESS;
+    }
+    default:
+      return MODBUS_ERROR_EXCEPTION_ILLEGAL_FUNCTION;
+  }
+  if (exception != MODBUS_SUCCESS) {
+    return exception;
+  }
+
+  // Write responses echo the address and the value/quantity of the request.
+  begin_application_data_unit_pack(adu, address, function_code);
+  application_data_unit_pack_u16(adu, addr);
+  application_data_unit_pack_u16(adu, value);
+  return MODBUS_SUCCESS;
+}
+
+int MYRIOTA_ModbusServe(const MYRIOTA_ModbusHandle handle,
+  const MYRIOTA_ModbusServer *const server) {
+  if (server == NULL || server->address == MODBUS_BROADCAST_ADDRESS ||
+      (server->regions_count > 0 && server->regions == NULL)) {
+    return -MODBUS_ERROR_INVALID_ARGUMENT;
+  }
+
+  const struct application_data_uint *adu_rx = NULL;
+  struct application_data_uint *adu_tx = NULL;
+  int result = modbus_request_receive(handle, &adu_rx, &adu_tx);
+  if (result != MODBUS_SUCCESS) {
+    return result;
+  }
+
+  // Only the crc16 is checked, as the request may be broadcast and is for any function.
+  const MYRIOTA_ModbusDeviceAddress address = adu_rx->buffer[0];
+  struct protocol_data_unit_parser parser;
+  result = protocol_data_unit_parser(adu_rx, address, adu_rx->buffer[1], &parser);
+  if (result != MODBUS_SUCCESS) {
+    return result;
+  }
+
+  if (address != server->address && address != MODBUS_BROADCAST_ADDRESS) {
+    return -MODBUS_ERROR_RESPONSE_FROM_WRONG_SLAVE_ADDRESS;
+  }
+
+  const enum modbus_function_code function_code = parser.function_code;
+  uint8_t exception = MODBUS_ERROR_EXCEPTION_ILLEGAL_FUNCTION;
+  if (address != MODBUS_BROADCAST_ADDRESS || is_write_function_code(function_code) ||
+      function_code == MODBUS_FUNCTION_CODE_MASK_WRITE_REGISTER) {
+    exception = modbus_server_execute(adu_tx, server, address, &parser);
+  }
+
+  // Broadcasts are never answered.
+  if (address == MODBUS_BROADCAST_ADDRESS) {
+    return -exception;
+  }
+
+  if (exception != MODBUS_SUCCESS) {
+    begin_application_data_unit_pack(adu_tx, address, get_error_function_code(function_code));
+    application_data_unit_pack_u8(adu_tx, exception);
+  }
+  end_application_data_unit_pack(adu_tx);
+
+  result = modbus_response_send(handle);
+  if (result != MODBUS_SUCCESS) {
+    return result;
+  }
+
+  return -exception;
+}
+
+#ifdef MYRIOTA_MODBUS_SERVER_UNIT_TESTS
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+/*
+ * `cmocka.h` must be included after standard the above library headers.
+ * NOTE: This comment has dual purpose:
+ * 1. Document the ordering requirement.
+ * 2. Prevent `clang-format` from reordering the headers.
+ */
+#include <cmocka.h>
+
+struct test_serial {
+  const uint8_t *rx;
+  size_t rx_size;
+  size_t rx_offset;
+  uint8_t tx[256];
+  size_t tx_size;
+};
+
+static struct test_serial test_serial = {0};
+
+static int test_serial_init(void *const ctx) {
+  (void)ctx;
+  return 0;
+}
+
+static void test_serial_deinit(void *const ctx) {
+  (void)ctx;
+}
+
+static ssize_t test_serial_read(void *const ctx, uint8_t *const buffer, const size_t count) {
+  struct test_serial *const serial = ctx;
+  const size_t available = serial->rx_size - serial->rx_offset;
+  const size_t nbytes = (count < available) ? count : available;
+  memcpy(buffer, &serial->rx[serial->rx_offset], nbytes);
+  serial->rx_offset += nbytes;
+  return nbytes;
+}
+
+static ssize_t test_serial_write(void *const ctx, const uint8_t *const buffer, const size_t count) {
+  struct test_serial *const serial = ctx;
+  if (serial->tx_size + count <= sizeof(serial->tx)) {
+    memcpy(&serial->tx[serial->tx_size], buffer, count);
+    serial->tx_size += count;
+  }
+  return count;
+}
+
+static MYRIOTA_ModbusHandle test_modbus_setup(const uint8_t *const rx, const size_t rx_size) {
+  test_serial = (struct test_serial){.rx = rx, .rx_size = rx_size};
+  const MYRIOTA_ModbusInitOptions options = {
+    .framing_mode = MODBUS_FRAMING_MODE_RTU,
+    .serial_interface =
+      {
+        .ctx = &test_serial,
+        .init = test_serial_init,
+        .deinit = test_serial_deinit,
+        .read = test_serial_read,
+        .write = test_serial_write,
+      },
+  };
+  const MYRIOTA_ModbusHandle handle = MYRIOTA_ModbusInit(options);
+  assert_int_equal(MYRIOTA_ModbusEnable(handle), MODBUS_SUCCESS);
+  return handle;
+}
+
+static void test_append_crc16(uint8_t *const frame, const size_t size) {
+  const uint16_t crc16 = modbus_crc16_update(MODBUS_CRC16_INIT, frame, size);
+  frame[size] = low_u16(crc16);
+  frame[size + 1] = hi_u16(crc16);
+}
+
+static uint16_t test_server_holding[8];
+static uint32_t test_server_coils[MODBUS_BITSET_WORDS(20)];
+
+static int test_server_read_inputs(void *const ctx, const MYRIOTA_ModbusDataAddress addr,
+  const uint16_t count, uint8_t *const bytes) {
+  (void)ctx;
+  if (addr + count > 0x0102) {
+    return -MODBUS_ERROR_EXCEPTION_SLAVE_DEVICE_BUSY;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    bytes[2 * i] = 0xA0;
+    bytes[2 * i + 1] = (uint8_t)(addr + i);
+  }
+  return MODBUS_SUCCESS;
+}
+
+static void test_server(void **state) {
+  (void)state;
+  const MYRIOTA_ModbusServerRegion regions[] = {
+    {.table = MODBUS_READ_HOLDING_REGISTERS, .addr = 0x0010, .count = 8,
+      .registers = test_server_holding},
+    {.table = MODBUS_READ_COILS, .addr = 0x0000, .count = 20, .bits = test_server_coils},
+    {.table = MODBUS_READ_INPUT_REGISTERS, .addr = 0x0100, .count = 4,
+      .read = test_server_read_inputs},
+  };
+  const MYRIOTA_ModbusServer server = {.address = 0x11, .regions = regions, .regions_count = 3};
+  memset(test_server_holding, 0, sizeof(test_server_holding));
+  memset(test_server_coils, 0, sizeof(test_server_coils));
+  test_server_holding[1] = 0x1234;
+  test_server_coils[0] = 0x000A5;
+
+  // Requests back to back: read holding registers, write multiple registers,
+  // read coils, read input registers, a busy callback, an illegal address, a
+  // request for another slave and a broadcast write.
+  uint8_t rx[] = {
+    0x11, 0x03, 0x00, 0x10, 0x00, 0x02, 0, 0,
+    0x11, 0x10, 0x00, 0x12, 0x00, 0x02, 0x04, 0xBE, 0xEF, 0x00, 0x01, 0, 0,
+    0x11, 0x01, 0x00, 0x02, 0x00, 0x0A, 0, 0,
+    0x11, 0x04, 0x01, 0x00, 0x00, 0x02, 0, 0,
+    0x11, 0x04, 0x01, 0x01, 0x00, 0x02, 0, 0,
+    0x11, 0x03, 0x00, 0x16, 0x00, 0x04, 0, 0,
+    0x12, 0x03, 0x00, 0x10, 0x00, 0x02, 0, 0,
+    0x00, 0x05, 0x00, 0x13, 0xFF, 0x00, 0, 0,
+  };
+  for (size_t offset = 0; offset < sizeof(rx);) {
+    const size_t size = (rx[offset + 1] == 0x10) ? 13 : 8;
+    test_append_crc16(&rx[offset], size - 2);
+    offset += size;
+  }
+  const MYRIOTA_ModbusHandle handle = test_modbus_setup(rx, sizeof(rx));
+
+  assert_int_equal(MYRIOTA_ModbusServe(handle, &server), MODBUS_SUCCESS);
+  uint8_t read_response[9] = {0x11, 0x03, 0x04, 0x00, 0x00, 0x12, 0x34};
+  test_append_crc16(read_response, 7);
+  assert_int_equal(test_serial.tx_size, sizeof(read_response));
+  assert_memory_equal(test_serial.tx, read_response, sizeof(read_response));
+
+  test_serial.tx_size = 0;
+  assert_int_equal(MYRIOTA_ModbusServe(handle, &server), MODBUS_SUCCESS);
+  assert_int_equal(test_server_holding[2], 0xBEEF);
+  assert_int_equal(test_server_holding[3], 0x0001);
+  uint8_t write_response[8] = {0x11, 0x10, 0x00, 0x12, 0x00, 0x02};
+  test_append_crc16(write_response, 6);
+  assert_int_equal(test_serial.tx_size, sizeof(write_response));
+  assert_memory_equal(test_serial.tx, write_response, sizeof(write_response));
+
+  test_serial.tx_size = 0;
+  assert_int_equal(MYRIOTA_ModbusServe(handle, &server), MODBUS_SUCCESS);
+  assert_int_equal(test_serial.tx[2], 2);
+  assert_int_equal(test_serial.tx[3], 0x29);
+  assert_int_equal(test_serial.tx[4], 0x00);
+
+  test_serial.tx_size = 0;
+  assert_int_equal(MYRIOTA_ModbusServe(handle, &server), MODBUS_SUCCESS);
+  const uint8_t inputs[] = {0x11, 0x04, 0x04, 0xA0, 0x00, 0xA0, 0x01};
+  assert_memory_equal(test_serial.tx, inputs, sizeof(inputs));
+
+  test_serial.tx_size = 0;
+  assert_int_equal(MYRIOTA_ModbusServe(handle, &server),
+    -MODBUS_ERROR_EXCEPTION_SLAVE_DEVICE_BUSY);
+  assert_int_equal(test_serial.tx_size, MODBUS_ADU_EXCEPTION_SIZE);
+  assert_int_equal(test_serial.tx[1], 0x84);
+  assert_int_equal(test_serial.tx[2], MODBUS_ERROR_EXCEPTION_SLAVE_DEVICE_BUSY);
+
+  test_serial.tx_size = 0;
+  assert_int_equal(MYRIOTA_ModbusServe(handle, &server),
+    -MODBUS_ERROR_EXCEPTION_ILLEGAL_DATA_ADDRESS);
+  assert_int_equal(test_serial.tx[1], 0x83);
+
+  test_serial.tx_size = 0;
+  assert_int_equal(MYRIOTA_ModbusServe(handle, &server),
+    -MODBUS_ERROR_RESPONSE_FROM_WRONG_SLAVE_ADDRESS);
+  assert_int_equal(MYRIOTA_ModbusServe(handle, &server), MODBUS_SUCCESS);
+  assert_int_equal(test_serial.tx_size, 0);
+  assert_int_equal(test_server_coils[0], 0x800A5);
+
+  assert_int_equal(MYRIOTA_ModbusServe(handle, &server), -MODBUS_ERROR_IO_FAILURE);
+  MYRIOTA_ModbusDeinit(handle);
+}
+
+static int test_server_read_undefined(void *const ctx, const MYRIOTA_ModbusDataAddress addr,
+  const uint16_t count, uint8_t *const bytes) {
+  (void)count;
+  (void)bytes;
+  // 0x09 falls in the gap between the defined exception codes.
+  *(int *)ctx = (addr == 0) ? -0x09 : -MODBUS_ERROR_IO_FAILURE;
+  return *(int *)ctx;
+}
+
+static void test_server_undefined_exception(void **state) {
+  (void)state;
+  int result = 0;
+  const MYRIOTA_ModbusServerRegion regions[] = {
+    {.table = MODBUS_READ_INPUT_REGISTERS, .addr = 0x0000, .count = 4, .ctx = &result,
+      .read = test_server_read_undefined},
+  };
+  const MYRIOTA_ModbusServer server = {.address = 0x11, .regions = regions, .regions_count = 1};
+  uint8_t rx[] = {
+    0x11, 0x04, 0x00, 0x00, 0x00, 0x01, 0, 0,
+    0x11, 0x04, 0x00, 0x01, 0x00, 0x01, 0, 0,
+  };
+  test_append_crc16(&rx[0], 6);
+  test_append_crc16(&rx[8], 6);
+  const MYRIOTA_ModbusHandle handle = test_modbus_setup(rx, sizeof(rx));
+
+  // Results that aren't defined exception codes are sent as a slave device failure.
+  for (size_t i = 0; i < 2; ++i) {
+    test_serial.tx_size = 0;
+    assert_int_equal(MYRIOTA_ModbusServe(handle, &server),
+      -MODBUS_ERROR_EXCEPTION_SLAVE_DEVICE_FAILURE);
+    assert_int_equal(test_serial.tx_size, MODBUS_ADU_EXCEPTION_SIZE);
+    assert_int_equal(test_serial.tx[1], 0x84);
+    assert_int_equal(test_serial.tx[2], MODBUS_ERROR_EXCEPTION_SLAVE_DEVICE_FAILURE);
+  }
+  assert_int_equal(result, -MODBUS_ERROR_IO_FAILURE);
+  MYRIOTA_ModbusDeinit(handle);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_server),
+    cmocka_unit_test(test_server_undefined_exception),
+  };
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
+#endif /** MYRIOTA_MODBUS_SERVER_UNIT_TESTS */
@@ -0,0 +1,165 @@
+/// \file send_queue.h Myriota Managed Send Queue
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRIOTA_SEND_QUEUE_H
+#define MYRIOTA_SEND_QUEUE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** \defgroup Send_Queue Managed Send Queue Library
+ * Schedule messages with a priority, and when the message queue is full evict
+ * by policy rather than let FLEX_MessageSchedule() replace an arbitrary
+ * message: the lowest priority message first, then the oldest of those.
+ *
+ * The send queue keeps a copy of each message it has scheduled, packed back to
+ * back in a caller supplied buffer with a SEND_QUEUE_ENTRY_OVERHEAD byte
+ * header. To evict, it clears the message queue with FLEX_MessageQueueClear()
+ * and schedules the messages it keeps again, in the order they were first
+ * scheduled. Messages are taken to be sent in the order they were scheduled,
+ * and copies are released as FLEX_MessageSlotsFree() and
+ * FLEX_MessageBytesFree() show them leaving the queue.
+ *
+ * NOTE: The send queue owns the message queue. Messages scheduled elsewhere,
+ * including those saved with FLEX_MessageSave() before a reset, are cleared
+ * by the first eviction. Schedule every message through the send queue, e.g.
+ * a coalescer's by a MYRIOTA_CoalesceInterface schedule function calling
+ * MYRIOTA_SendQueueSchedule() with the send queue as its context.
+ * \{
+ */
+
+/** Error codes for the send queue. */
+typedef enum {
+  SEND_QUEUE_SUCCESS = 0,
+  SEND_QUEUE_ERROR_INVALID_ARGUMENT,
+  /** The message was dropped, as every message it would evict outranks it. */
+  SEND_QUEUE_ERROR_DROPPED,
+  /** Scheduling the message failed. */
+  SEND_QUEUE_ERROR_SCHEDULE_FAILURE,
+} MYRIOTA_SendQueueErrors;
+
+/** Message priorities, from the first evicted to the last. */
+typedef enum {
+  SEND_QUEUE_PRIORITY_LOW = 0,
+  SEND_QUEUE_PRIORITY_NORMAL,
+  SEND_QUEUE_PRIORITY_HIGH,
+  SEND_QUEUE_PRIORITY_ALARM,
+  SEND_QUEUE_PRIORITIES,
+} MYRIOTA_SendQueuePriority;
+
+/** The largest message the send queue keeps. */
+#define SEND_QUEUE_MESSAGE_SIZE_MAX 255
+
+/** The bytes each message kept takes in the buffer on top of its size. */
+#define SEND_QUEUE_ENTRY_OVERHEAD 6
+
+/** The buffer size needed to keep `count` messages of up to `size` bytes. */
+#define SEND_QUEUE_BUFFER_SIZE(count, size) ((count) * ((size) + SEND_QUEUE_ENTRY_OVERHEAD))
+
+/** The message queue, with signatures matching the FLEX API but for `schedule`. */
+typedef struct {
+  /** The user defined context passed to `schedule`. */
+  void *ctx;
+  /** Schedule a message, e.g. by calling FLEX_MessageSchedule, returning < 0 on failure. */
+  int (*schedule)(void *const ctx, const uint8_t *const message, const size_t size);
+  /** The free slots in the queue, e.g. FLEX_MessageSlotsFree. */
+  int (*slots_free)(void);
+  /** The free bytes in the queue, e.g. FLEX_MessageBytesFree. */
+  size_t (*bytes_free)(void);
+  /** Clear the queue, e.g. FLEX_MessageQueueClear. */
+  void (*clear)(void);
+} MYRIOTA_SendQueueInterface;
+
+/** Send queue counters. */
+typedef struct {
+  /** The messages scheduled. */
+  uint32_t scheduled;
+  /** The messages that have left the message queue, taken to be sent. */
+  uint32_t sent;
+  /** The times the message queue was cleared and scheduled again. */
+  uint32_t rebuilds;
+  /** The messages evicted or dropped, by priority. */
+  uint32_t dropped[SEND_QUEUE_PRIORITIES];
+  /** The bytes evicted or dropped. */
+  uint32_t dropped_bytes;
+} MYRIOTA_SendQueueStats;
+
+/** A send queue, managed by the library once initialized. */
+typedef struct {
+  /** The message queue. */
+  MYRIOTA_SendQueueInterface interface;
+  /** The copies of the messages in the message queue. */
+  uint8_t *buffer;
+  /** The size of `buffer` in bytes. */
+  size_t size;
+  /** The bytes of `buffer` in use. */
+  size_t used;
+  /** The number of messages kept. */
+  size_t count;
+  /** The total size of the messages kept. */
+  size_t message_bytes;
+  /** The slots of the message queue. */
+  int slots_max;
+  /** The bytes of the message queue. */
+  size_t bytes_max;
+  /** The counters. */
+  MYRIOTA_SendQueueStats stats;
+} MYRIOTA_SendQueue;
+
+/**
+ * Initialize a send queue. The message queue's slots and bytes are taken to
+ * be those free, so initialize it before scheduling messages, e.g. in
+ * FLEX_AppInit().
+ *
+ * \param[out] queue The send queue to initialize.
+ * \param[in] interface The message queue.
+ * \param[out] buffer The buffer to keep copies of messages in, e.g. of
+ *                    SEND_QUEUE_BUFFER_SIZE(slots, message size) bytes.
+ * \param[in] size The size of `buffer` in bytes.
+ * \return 0 on success, -SEND_QUEUE_ERROR_INVALID_ARGUMENT if an argument is invalid.
+ */
+int MYRIOTA_SendQueueInit(MYRIOTA_SendQueue *const queue,
+  const MYRIOTA_SendQueueInterface interface, uint8_t *const buffer, const size_t size);
+
+/**
+ * Schedule a message. If the message queue or the buffer is full, messages of
+ * a lower priority than it, or of the same priority and older, are evicted
+ * lowest priority first then oldest first, and the queue is rebuilt. If that
+ * doesn't make room, the message is dropped and nothing is evicted.
+ *
+ * \param[in,out] queue The send queue.
+ * \param[in] message The message.
+ * \param[in] size The size of the message, 1 to SEND_QUEUE_MESSAGE_SIZE_MAX bytes.
+ * \param[in] priority The message's priority.
+ * \param[in] now The current epoch time in seconds, e.g. FLEX_TimeGet().
+ * \return 0 on success, or < 0 on failure.
+ * \retval -SEND_QUEUE_ERROR_DROPPED: the message was dropped
+ * \retval -SEND_QUEUE_ERROR_SCHEDULE_FAILURE: the message failed to schedule
+ * \retval -SEND_QUEUE_ERROR_INVALID_ARGUMENT: an argument is invalid
+ */
+int MYRIOTA_SendQueueSchedule(MYRIOTA_SendQueue *const queue, const uint8_t *const message,
+  const size_t size, const MYRIOTA_SendQueuePriority priority, const uint32_t now);
+
+/**
+ * The number of messages in the message queue, after releasing those sent.
+ *
+ * \param[in,out] queue The send queue.
+ * \return the number of messages, 0 if `queue` is NULL.
+ */
+size_t MYRIOTA_SendQueueCount(MYRIOTA_SendQueue *const queue);
+
+/** \} */
+
+#endif /* MYRIOTA_SEND_QUEUE_H */
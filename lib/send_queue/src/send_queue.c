@@ -0,0 +1,458 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "myriota/send_queue.h"
+#include <string.h>
+
+// Each entry is the message's priority, its size, the time it was scheduled
+// (little endian) and the message.
+#define ENTRY_PRIORITY 0
+#define ENTRY_SIZE 1
+#define ENTRY_TIME 2
+#define ENTRY_MESSAGE SEND_QUEUE_ENTRY_OVERHEAD
+
+static inline size_t entry_size(const uint8_t *const entry) {
+  return SEND_QUEUE_ENTRY_OVERHEAD + entry[ENTRY_SIZE];
+}
+
+static inline uint32_t entry_time(const uint8_t *const entry) {
+  const uint8_t *const time = &entry[ENTRY_TIME];
+  return (uint32_t)time[0] | ((uint32_t)time[1] << 8) | ((uint32_t)time[2] << 16) |
+         ((uint32_t)time[3] << 24);
+}
+
+// Whether a message is evicted before another: lower priority first, then older.
+static inline bool evicted_before(const uint8_t priority, const uint32_t time,
+  const uint8_t other_priority, const uint32_t other_time) {
+  return priority < other_priority ||
+         (priority == other_priority && (int32_t)(time - other_time) < 0);
+}
+
+static void entry_append(MYRIOTA_SendQueue *const queue, const uint8_t *const message,
+  const size_t size, const MYRIOTA_SendQueuePriority priority, const uint32_t now) {
+  uint8_t *const entry = &queue->buffer[queue->used];
+  entry[ENTRY_PRIORITY] = (uint8_t)priority;
+  entry[ENTRY_SIZE] = (uint8_t)size;
+  for (size_t i = 0; i < 4; ++i) {
+    entry[ENTRY_TIME + i] = (uint8_t)(now >> (8 * i));
+  }
+  memcpy(&entry[ENTRY_MESSAGE], message, size);
+  queue->used += entry_size(entry);
+  queue->message_bytes += size;
+  ++queue->count;
+}
+
+static void entry_remove(MYRIOTA_SendQueue *const queue, const size_t offset) {
+  const size_t size = entry_size(&queue->buffer[offset]);
+  queue->message_bytes -= queue->buffer[offset + ENTRY_SIZE];
+  memmove(&queue->buffer[offset], &queue->buffer[offset + size], queue->used - offset - size);
+  queue->used -= size;
+  --queue->count;
+}
+
+static void entry_drop(MYRIOTA_SendQueue *const queue, const size_t offset) {
+  const uint8_t *const entry = &queue->buffer[offset];
+  ++queue->stats.dropped[entry[ENTRY_PRIORITY]];
+  queue->stats.dropped_bytes += entry[ENTRY_SIZE];
+  entry_remove(queue, offset);
+}
+
+// Release the copies of the messages that have left the message queue, the
+// oldest scheduled first.
+static void queue_release_sent(MYRIOTA_SendQueue *const queue) {
+  const int slots_free = queue->interface.slots_free();
+  const size_t bytes_free = queue->interface.bytes_free();
+  if (slots_free > queue->slots_max) {
+    queue->slots_max = slots_free;
+  }
+  if (bytes_free > queue->bytes_max) {
+    queue->bytes_max = bytes_free;
+  }
+
+  const size_t queued = (size_t)(queue->slots_max - (slots_free > 0 ? slots_free : 0));
+  const size_t queued_bytes = queue->bytes_max - bytes_free;
+  while (queue->count > queued || queue->message_bytes > queued_bytes) {
+    entry_remove(queue, 0);
+    ++queue->stats.sent;
+  }
+}
+
+// Whether a message of `size` bytes fits with `count` messages of
+// `message_bytes` kept in `used` bytes of the buffer.
+static bool queue_fits(const MYRIOTA_SendQueue *const queue, const size_t count,
+  const size_t message_bytes, const size_t used, const size_t size) {
+  return count < (size_t)queue->slots_max && message_bytes + size <= queue->bytes_max &&
+         used + SEND_QUEUE_ENTRY_OVERHEAD + size <= queue->size;
+}
+
+// The offset of the message evicted first.
+static size_t queue_victim(const MYRIOTA_SendQueue *const queue) {
+  size_t victim = 0;
+  for (size_t offset = 0; offset < queue->used; offset += entry_size(&queue->buffer[offset])) {
+    const uint8_t *const entry = &queue->buffer[offset];
+    const uint8_t *const best = &queue->buffer[victim];
+    if (evicted_before(entry[ENTRY_PRIORITY], entry_time(entry), best[ENTRY_PRIORITY],
+          entry_time(best))) {
+      victim = offset;
+    }
+  }
+  return victim;
+}
+
+// Clear the message queue and schedule the messages kept again, in the order
+// they were first scheduled.
+static int queue_rebuild(MYRIOTA_SendQueue *const queue) {
+  int result = SEND_QUEUE_SUCCESS;
+  queue->interface.clear();
+  ++queue->stats.rebuilds;
+  size_t offset = 0;
+  while (offset < queue->used) {
+    const uint8_t *const entry = &queue->buffer[offset];
+    if (queue->interface.schedule(queue->interface.ctx, &entry[ENTRY_MESSAGE],
+          entry[ENTRY_SIZE]) < 0) {
+      entry_drop(queue, offset);
+      result = -SEND_QUEUE_ERROR_SCHEDULE_FAILURE;
+    } else {
+      offset += entry_size(entry);
+    }
+  }
+  return result;
+}
+
+int MYRIOTA_SendQueueInit(MYRIOTA_SendQueue *const queue,
+  const MYRIOTA_SendQueueInterface interface, uint8_t *const buffer, const size_t size) {
+  if (queue == NULL || interface.schedule == NULL || interface.slots_free == NULL ||
+      interface.bytes_free == NULL || interface.clear == NULL || buffer == NULL ||
+      size <= SEND_QUEUE_ENTRY_OVERHEAD) {
+    return -SEND_QUEUE_ERROR_INVALID_ARGUMENT;
+  }
+
+  memset(queue, 0, sizeof(*queue));
+  queue->interface = interface;
+  queue->buffer = buffer;
+  queue->size = size;
+  queue->slots_max = interface.slots_free();
+  queue->bytes_max = interface.bytes_free();
+  return SEND_QUEUE_SUCCESS;
+}
+
+int MYRIOTA_SendQueueSchedule(MYRIOTA_SendQueue *const queue, const uint8_t *const message,
+  const size_t size, const MYRIOTA_SendQueuePriority priority, const uint32_t now) {
+  if (queue == NULL || message == NULL || size == 0 || size > SEND_QUEUE_MESSAGE_SIZE_MAX ||
+      priority >= SEND_QUEUE_PRIORITIES) {
+    return -SEND_QUEUE_ERROR_INVALID_ARGUMENT;
+  }
+
+  queue_release_sent(queue);
+  if (queue_fits(queue, queue->count, queue->message_bytes, queue->used, size)) {
+    if (queue->interface.schedule(queue->interface.ctx, message, size) < 0) {
+      return -SEND_QUEUE_ERROR_SCHEDULE_FAILURE;
+    }
+    entry_append(queue, message, size, priority, now);
+    ++queue->stats.scheduled;
+    return SEND_QUEUE_SUCCESS;
+  }
+
+  // Check evicting every message the new one outranks makes room before
+  // evicting any, so nothing is lost for a message that is dropped anyway.
+  size_t count = queue->count;
+  size_t message_bytes = queue->message_bytes;
+  size_t used = queue->used;
+  for (size_t offset = 0; offset < queue->used; offset += entry_size(&queue->buffer[offset])) {
+    const uint8_t *const entry = &queue->buffer[offset];
+    if (!evicted_before(priority, now, entry[ENTRY_PRIORITY], entry_time(entry)) &&
+        entry[ENTRY_PRIORITY] <= priority) {
+      --count;
+      message_bytes -= entry[ENTRY_SIZE];
+      used -= entry_size(entry);
+    }
+  }
+  if (!queue_fits(queue, count, message_bytes, used, size)) {
+    ++queue->stats.dropped[priority];
+    queue->stats.dropped_bytes += size;
+    return -SEND_QUEUE_ERROR_DROPPED;
+  }
+
+  while (!queue_fits(queue, queue->count, queue->message_bytes, queue->used, size)) {
+    entry_drop(queue, queue_victim(queue));
+  }
+  entry_append(queue, message, size, priority, now);
+  const int result = queue_rebuild(queue);
+  if (result == SEND_QUEUE_SUCCESS) {
+    ++queue->stats.scheduled;
+  }
+  return result;
+}
+
+size_t MYRIOTA_SendQueueCount(MYRIOTA_SendQueue *const queue) {
+  if (queue == NULL) {
+    return 0;
+  }
+
+  queue_release_sent(queue);
+  return queue->count;
+}
+
+#ifdef MYRIOTA_SEND_QUEUE_UNIT_TESTS
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+/*
+ * `cmocka.h` must be included after standard the above library headers.
+ * NOTE: This comment has dual purpose:
+ * 1. Document the ordering requirement.
+ * 2. Prevent `clang-format` from reordering the headers.
+ */
+#include <cmocka.h>
+
+#define TEST_SLOTS 4
+#define TEST_BYTES 80
+#define TEST_MESSAGE_SIZE 20
+#define TEST_TIME 1700000000
+
+// A message queue that replaces its oldest message when full, as
+// FLEX_MessageSchedule() replaces a queued message, and sends in order.
+static struct {
+  uint8_t messages[TEST_SLOTS][TEST_MESSAGE_SIZE];
+  size_t sizes[TEST_SLOTS];
+  size_t count;
+  uint32_t replaced;
+  uint32_t clears;
+  int result;
+} platform;
+
+static size_t platform_bytes(void) {
+  size_t bytes = 0;
+  for (size_t i = 0; i < platform.count; ++i) {
+    bytes += platform.sizes[i];
+  }
+  return bytes;
+}
+
+static void platform_send(void) {
+  memmove(platform.messages[0], platform.messages[1],
+    sizeof(platform.messages[0]) * (TEST_SLOTS - 1));
+  memmove(&platform.sizes[0], &platform.sizes[1], sizeof(platform.sizes[0]) * (TEST_SLOTS - 1));
+  --platform.count;
+}
+
+static int platform_schedule(void *const ctx, const uint8_t *const message, const size_t size) {
+  assert_true(ctx == &platform);
+  if (platform.result < 0) {
+    return platform.result;
+  }
+  if (platform.count == TEST_SLOTS || platform_bytes() + size > TEST_BYTES) {
+    ++platform.replaced;
+    platform_send();
+  }
+  memcpy(platform.messages[platform.count], message, size);
+  platform.sizes[platform.count++] = size;
+  return 0;
+}
+
+static int platform_slots_free(void) {
+  return TEST_SLOTS - platform.count;
+}
+
+static size_t platform_bytes_free(void) {
+  return TEST_BYTES - platform_bytes();
+}
+
+static void platform_clear(void) {
+  platform.count = 0;
+  ++platform.clears;
+}
+
+static const MYRIOTA_SendQueueInterface test_interface = {
+  &platform,
+  platform_schedule,
+  platform_slots_free,
+  platform_bytes_free,
+  platform_clear,
+};
+
+static uint8_t test_buffer[SEND_QUEUE_BUFFER_SIZE(TEST_SLOTS, TEST_MESSAGE_SIZE)];
+
+static void test_queue_init(MYRIOTA_SendQueue *const queue) {
+  memset(&platform, 0, sizeof(platform));
+  assert_int_equal(MYRIOTA_SendQueueInit(queue, test_interface, test_buffer, sizeof(test_buffer)),
+    SEND_QUEUE_SUCCESS);
+}
+
+// Schedules a message of `size` bytes of `tag`.
+static int test_schedule(MYRIOTA_SendQueue *const queue, const uint8_t tag, const size_t size,
+  const MYRIOTA_SendQueuePriority priority, const uint32_t now) {
+  uint8_t message[TEST_MESSAGE_SIZE];
+  memset(message, tag, size);
+  return MYRIOTA_SendQueueSchedule(queue, message, size, priority, now);
+}
+
+static void assert_platform_tags(const uint8_t *const tags, const size_t count) {
+  assert_int_equal(platform.count, count);
+  for (size_t i = 0; i < count; ++i) {
+    assert_int_equal(platform.messages[i][0], tags[i]);
+  }
+}
+
+static void test_init_arguments(void **state) {
+  (void)state;
+  MYRIOTA_SendQueue queue;
+  test_queue_init(&queue);
+  assert_int_equal(queue.slots_max, TEST_SLOTS);
+  assert_int_equal(queue.bytes_max, TEST_BYTES);
+  assert_int_equal(MYRIOTA_SendQueueCount(&queue), 0);
+
+  MYRIOTA_SendQueueInterface interface = test_interface;
+  interface.clear = NULL;
+  assert_int_equal(MYRIOTA_SendQueueInit(&queue, interface, test_buffer, sizeof(test_buffer)),
+    -SEND_QUEUE_ERROR_INVALID_ARGUMENT);
+  assert_int_equal(MYRIOTA_SendQueueInit(&queue, test_interface, test_buffer,
+                     SEND_QUEUE_ENTRY_OVERHEAD),
+    -SEND_QUEUE_ERROR_INVALID_ARGUMENT);
+
+  test_queue_init(&queue);
+  uint8_t message[SEND_QUEUE_MESSAGE_SIZE_MAX + 1] = {0};
+  assert_int_equal(MYRIOTA_SendQueueSchedule(NULL, message, 1, SEND_QUEUE_PRIORITY_LOW, 0),
+    -SEND_QUEUE_ERROR_INVALID_ARGUMENT);
+  assert_int_equal(MYRIOTA_SendQueueCount(NULL), 0);
+  assert_int_equal(MYRIOTA_SendQueueSchedule(&queue, message, 0, SEND_QUEUE_PRIORITY_LOW, 0),
+    -SEND_QUEUE_ERROR_INVALID_ARGUMENT);
+  assert_int_equal(MYRIOTA_SendQueueSchedule(&queue, message, sizeof(message),
+                     SEND_QUEUE_PRIORITY_LOW, 0),
+    -SEND_QUEUE_ERROR_INVALID_ARGUMENT);
+  assert_int_equal(MYRIOTA_SendQueueSchedule(&queue, message, 1, SEND_QUEUE_PRIORITIES, 0),
+    -SEND_QUEUE_ERROR_INVALID_ARGUMENT);
+}
+
+static void test_evicts_by_priority_then_age(void **state) {
+  (void)state;
+  MYRIOTA_SendQueue queue;
+  test_queue_init(&queue);
+
+  assert_int_equal(test_schedule(&queue, 'a', 10, SEND_QUEUE_PRIORITY_NORMAL, TEST_TIME),
+    SEND_QUEUE_SUCCESS);
+  assert_int_equal(test_schedule(&queue, 'b', 10, SEND_QUEUE_PRIORITY_LOW, TEST_TIME + 1),
+    SEND_QUEUE_SUCCESS);
+  assert_int_equal(test_schedule(&queue, 'c', 10, SEND_QUEUE_PRIORITY_LOW, TEST_TIME + 2),
+    SEND_QUEUE_SUCCESS);
+  assert_int_equal(test_schedule(&queue, 'd', 10, SEND_QUEUE_PRIORITY_HIGH, TEST_TIME + 3),
+    SEND_QUEUE_SUCCESS);
+  assert_int_equal(platform.clears, 0);
+
+  // The oldest of the lowest priority makes way, and the queue keeps its order.
+  assert_int_equal(test_schedule(&queue, 'e', 10, SEND_QUEUE_PRIORITY_ALARM, TEST_TIME + 4),
+    SEND_QUEUE_SUCCESS);
+  assert_platform_tags((const uint8_t *)"acde", 4);
+  assert_int_equal(platform.clears, 1);
+  assert_int_equal(queue.stats.dropped[SEND_QUEUE_PRIORITY_LOW], 1);
+
+  // Then the next lowest priority.
+  assert_int_equal(test_schedule(&queue, 'f', 10, SEND_QUEUE_PRIORITY_NORMAL, TEST_TIME + 5),
+    SEND_QUEUE_SUCCESS);
+  assert_platform_tags((const uint8_t *)"adef", 4);
+  assert_int_equal(test_schedule(&queue, 'g', 10, SEND_QUEUE_PRIORITY_NORMAL, TEST_TIME + 6),
+    SEND_QUEUE_SUCCESS);
+  assert_platform_tags((const uint8_t *)"defg", 4);
+  assert_int_equal(queue.stats.dropped[SEND_QUEUE_PRIORITY_LOW], 2);
+  assert_int_equal(queue.stats.dropped[SEND_QUEUE_PRIORITY_NORMAL], 1);
+
+  // A message outranked by everything queued is dropped.
+  assert_int_equal(test_schedule(&queue, 'h', 10, SEND_QUEUE_PRIORITY_LOW, TEST_TIME + 7),
+    -SEND_QUEUE_ERROR_DROPPED);
+  assert_platform_tags((const uint8_t *)"defg", 4);
+  assert_int_equal(queue.stats.dropped[SEND_QUEUE_PRIORITY_LOW], 3);
+  assert_int_equal(queue.stats.dropped_bytes, 40);
+  assert_int_equal(queue.stats.scheduled, 7);
+  assert_int_equal(platform.replaced, 0);
+}
+
+static void test_evicts_for_bytes(void **state) {
+  (void)state;
+  MYRIOTA_SendQueue queue;
+  test_queue_init(&queue);
+
+  assert_int_equal(test_schedule(&queue, 'a', 20, SEND_QUEUE_PRIORITY_LOW, TEST_TIME),
+    SEND_QUEUE_SUCCESS);
+  assert_int_equal(test_schedule(&queue, 'b', 20, SEND_QUEUE_PRIORITY_HIGH, TEST_TIME),
+    SEND_QUEUE_SUCCESS);
+  assert_int_equal(test_schedule(&queue, 'c', 20, SEND_QUEUE_PRIORITY_LOW, TEST_TIME),
+    SEND_QUEUE_SUCCESS);
+  assert_int_equal(test_schedule(&queue, 'd', 15, SEND_QUEUE_PRIORITY_HIGH, TEST_TIME),
+    SEND_QUEUE_SUCCESS);
+
+  // The oldest low priority message makes room for a larger message.
+  assert_int_equal(test_schedule(&queue, 'e', 20, SEND_QUEUE_PRIORITY_NORMAL, TEST_TIME),
+    SEND_QUEUE_SUCCESS);
+  assert_platform_tags((const uint8_t *)"bcde", 4);
+  assert_int_equal(platform_bytes(), 75);
+
+  // Messages of the same priority go before those above it.
+  assert_int_equal(test_schedule(&queue, 'f', 20, SEND_QUEUE_PRIORITY_LOW, TEST_TIME),
+    SEND_QUEUE_SUCCESS);
+  assert_platform_tags((const uint8_t *)"bdef", 4);
+  assert_int_equal(test_schedule(&queue, 'g', 20, SEND_QUEUE_PRIORITY_NORMAL, TEST_TIME),
+    SEND_QUEUE_SUCCESS);
+  assert_platform_tags((const uint8_t *)"bdeg", 4);
+
+  // Nothing is evicted for a message that can't make room.
+  const uint32_t clears = platform.clears;
+  assert_int_equal(test_schedule(&queue, 'h', 20, SEND_QUEUE_PRIORITY_LOW, TEST_TIME),
+    -SEND_QUEUE_ERROR_DROPPED);
+  assert_int_equal(platform.clears, clears);
+  assert_int_equal(platform.replaced, 0);
+}
+
+static void test_releases_sent(void **state) {
+  (void)state;
+  MYRIOTA_SendQueue queue;
+  test_queue_init(&queue);
+
+  for (uint8_t tag = 'a'; tag < 'e'; ++tag) {
+    assert_int_equal(test_schedule(&queue, tag, 10, SEND_QUEUE_PRIORITY_NORMAL, TEST_TIME),
+      SEND_QUEUE_SUCCESS);
+  }
+  platform_send();
+  platform_send();
+  assert_int_equal(MYRIOTA_SendQueueCount(&queue), 2);
+  assert_int_equal(queue.stats.sent, 2);
+
+  // Sent messages aren't scheduled again by a rebuild.
+  assert_int_equal(test_schedule(&queue, 'e', 10, SEND_QUEUE_PRIORITY_LOW, TEST_TIME),
+    SEND_QUEUE_SUCCESS);
+  assert_int_equal(test_schedule(&queue, 'f', 10, SEND_QUEUE_PRIORITY_LOW, TEST_TIME),
+    SEND_QUEUE_SUCCESS);
+  assert_int_equal(test_schedule(&queue, 'g', 10, SEND_QUEUE_PRIORITY_HIGH, TEST_TIME),
+    SEND_QUEUE_SUCCESS);
+  assert_platform_tags((const uint8_t *)"cdfg", 4);
+  assert_int_equal(queue.stats.dropped[SEND_QUEUE_PRIORITY_LOW], 1);
+
+  // A message that fails to schedule in a rebuild is dropped.
+  platform.result = -1;
+  assert_int_equal(test_schedule(&queue, 'h', 10, SEND_QUEUE_PRIORITY_HIGH, TEST_TIME),
+    -SEND_QUEUE_ERROR_SCHEDULE_FAILURE);
+  assert_int_equal(MYRIOTA_SendQueueCount(&queue), 0);
+  assert_int_equal(queue.stats.dropped[SEND_QUEUE_PRIORITY_HIGH], 2);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_init_arguments),
+    cmocka_unit_test(test_evicts_by_priority_then_age),
+    cmocka_unit_test(test_evicts_for_bytes),
+    cmocka_unit_test(test_releases_sent),
+  };
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
+#endif /** MYRIOTA_SEND_QUEUE_UNIT_TESTS */
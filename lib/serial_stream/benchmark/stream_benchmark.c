@@ -0,0 +1,150 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Host benchmark of reading newline terminated lines through the serial
+// stream, against the byte at a time loop the examples used before it, both
+// over the fake serial driver. Reports the driver reads and CPU time per
+// received byte for lines already waiting with the driver and for lines
+// arriving at 115200 baud, where each driver call costs some bus time. The
+// stream is run both busy polling and sleeping between polls, and the share of
+// the virtual time spent awake rather than in delay_ms is reported.
+//
+// NOTE: CPU time is measured on the host, use it to compare the two loops
+// rather than as an absolute figure for the device.
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "myriota/serial_stream.h"
+#include "serial_stream_fake.h"
+
+#define BENCHMARK_ITERATIONS 20000
+#define BENCHMARK_LINES 16
+#define BENCHMARK_TIMEOUT_MS 2000
+#define BENCHMARK_LINE "$GPGGA,123519,4807.038,N,01131.000,E,1,08*47\n"
+
+static struct serial_stream_fake fake;
+
+typedef int (*read_line_fn)(uint8_t *rx, size_t max);
+
+struct loop {
+  const char *name;
+  read_line_fn read_line;
+  // Whether the stream sleeps in delay_ms while it waits.
+  bool sleep;
+};
+
+// The examples' loop before the serial stream, reading a byte per driver call.
+static int read_line_bytewise(uint8_t *rx, size_t max) {
+  const MYRIOTA_SerialStreamInterface interface = serial_stream_fake_interface();
+  const uint32_t start = interface.tick_get();
+  size_t count = 0;
+  while (interface.tick_get() - start < BENCHMARK_TIMEOUT_MS) {
+    uint8_t ch;
+    if (interface.read(&ch, 1) == 1) {
+      if (ch == '\n')
+        return count;
+      rx[count++] = ch;
+      if (count == max)
+        return -1;
+    }
+  }
+  return -1;
+}
+
+static MYRIOTA_SerialStream stream;
+static uint8_t stream_buffer[SERIAL_STREAM_CAPACITY_DEFAULT];
+
+static int read_line_stream(uint8_t *rx, size_t max) {
+  return MYRIOTA_SerialStreamReadUntil(&stream, '\n', rx, max,
+    MYRIOTA_SerialStreamDeadline(&stream, BENCHMARK_TIMEOUT_MS));
+}
+
+struct scenario {
+  const char *name;
+  struct serial_stream_fake_config config;
+};
+
+static double elapsed_seconds(const struct timespec *const start,
+  const struct timespec *const end) {
+  return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static int run(const struct scenario *const scenario, const struct loop *const loop) {
+  const size_t line_size = strlen(BENCHMARK_LINE);
+  uint64_t reads = 0;
+  uint64_t bytes = 0;
+  uint64_t elapsed_us = 0;
+  uint64_t delayed_us = 0;
+  int result = 0;
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+  for (size_t i = 0; i < BENCHMARK_ITERATIONS; ++i) {
+    serial_stream_fake_init(&fake, &scenario->config);
+    MYRIOTA_SerialStreamInterface interface = serial_stream_fake_interface();
+    if (!loop->sleep) {
+      interface.delay_ms = NULL;
+    }
+    MYRIOTA_SerialStreamInit(&stream, interface, stream_buffer, sizeof(stream_buffer));
+    for (size_t j = 0; j < BENCHMARK_LINES; ++j) {
+      serial_stream_fake_receive(&fake, (const uint8_t *)BENCHMARK_LINE, line_size, 0);
+    }
+
+    uint8_t rx[128];
+    for (size_t j = 0; j < BENCHMARK_LINES; ++j) {
+      result |= (loop->read_line(rx, sizeof(rx)) != (int)line_size - 1);
+    }
+    result |= (fake.overruns != 0);
+    reads += fake.read_calls;
+    bytes += BENCHMARK_LINES * line_size;
+    elapsed_us += fake.now_us;
+    delayed_us += fake.delayed_us;
+  }
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+
+  const double seconds = elapsed_seconds(&start, &end);
+  const double awake = elapsed_us > 0 ? 100.0 * (elapsed_us - delayed_us) / elapsed_us : 100.0;
+  printf("%-12s %-14s %12.2f %14.1f %10.1f%s\n", scenario->name, loop->name,
+    (double)reads / bytes, seconds * 1e9 / bytes, awake, result ? " FAILED" : "");
+  return result;
+}
+
+int main(void) {
+  const struct scenario scenarios[] = {
+    // The line is waiting with the driver when the application reads it. The
+    // driver's buffer is large enough to hold it all.
+    {"waiting", {.baud_rate = 0, .driver_buffer_size = SERIAL_STREAM_FAKE_RX_MAX}},
+    // The line arrives as it is read.
+    {"115200 baud", {.baud_rate = 115200, .driver_buffer_size = 50, .read_cost_us = 5,
+                      .tick_cost_us = 1}},
+  };
+
+  const struct loop loops[] = {
+    {"bytewise", read_line_bytewise, false},
+    {"stream", read_line_stream, false},
+    {"stream sleep", read_line_stream, true},
+  };
+
+  int result = 0;
+  printf("%-12s %-14s %12s %14s %10s\n", "scenario", "loop", "reads/byte", "cpu (ns/byte)",
+    "awake (%)");
+  for (size_t i = 0; i < sizeof(scenarios) / sizeof(*scenarios); ++i) {
+    for (size_t j = 0; j < sizeof(loops) / sizeof(*loops); ++j) {
+      result |= run(&scenarios[i], &loops[j]);
+    }
+  }
+  return result;
+}
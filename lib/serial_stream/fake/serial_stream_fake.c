@@ -0,0 +1,141 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "serial_stream_fake.h"
+#include <string.h>
+
+// Bits per character on the wire: start, 8 data and stop.
+#define SERIAL_STREAM_FAKE_BITS_PER_BYTE 10
+
+static struct serial_stream_fake *serial_stream_fake_driver = NULL;
+
+static uint32_t byte_time_us(const struct serial_stream_fake *const fake) {
+  if (fake->config.baud_rate == 0) {
+    return 0;
+  }
+  return (SERIAL_STREAM_FAKE_BITS_PER_BYTE * 1000000 + fake->config.baud_rate - 1) /
+         fake->config.baud_rate;
+}
+
+// Move the bytes that have arrived by now into the driver's receive buffer,
+// losing those that arrive while it is full.
+static void driver_receive(struct serial_stream_fake *const fake) {
+  while (fake->rx_arrived < fake->rx_size &&
+         fake->rx_arrival_us[fake->rx_arrived] <= fake->now_us) {
+    if (fake->rx_arrived - fake->rx_read < fake->config.driver_buffer_size) {
+      ++fake->rx_arrived;
+      continue;
+    }
+
+    // Drop the byte by moving those after it down, keeping the arrival times
+    // of the bytes still on the line.
+    const size_t after = fake->rx_size - fake->rx_arrived - 1;
+    memmove(&fake->rx[fake->rx_arrived], &fake->rx[fake->rx_arrived + 1], after);
+    memmove(&fake->rx_arrival_us[fake->rx_arrived], &fake->rx_arrival_us[fake->rx_arrived + 1],
+      after * sizeof(*fake->rx_arrival_us));
+    --fake->rx_size;
+    ++fake->overruns;
+  }
+}
+
+static int fake_read(uint8_t *rx, size_t length) {
+  struct serial_stream_fake *const fake = serial_stream_fake_driver;
+  ++fake->read_calls;
+  fake->now_us += fake->config.read_cost_us;
+  driver_receive(fake);
+
+  size_t count = fake->rx_arrived - fake->rx_read;
+  if (count > length) {
+    count = length;
+  }
+  memcpy(rx, &fake->rx[fake->rx_read], count);
+  fake->rx_read += count;
+  return (int)count;
+}
+
+static int fake_write(const uint8_t *tx, size_t length) {
+  struct serial_stream_fake *const fake = serial_stream_fake_driver;
+  if (length > sizeof(fake->tx) - fake->tx_size) {
+    return -1;
+  }
+  memcpy(&fake->tx[fake->tx_size], tx, length);
+  fake->tx_size += length;
+  fake->now_us += (uint64_t)length * byte_time_us(fake);
+  return 0;
+}
+
+static uint32_t fake_tick_get(void) {
+  struct serial_stream_fake *const fake = serial_stream_fake_driver;
+  ++fake->tick_calls;
+  fake->now_us += fake->config.tick_cost_us;
+  return (uint32_t)(fake->now_us / 1000);
+}
+
+static void fake_delay_ms(const uint32_t ms) {
+  struct serial_stream_fake *const fake = serial_stream_fake_driver;
+  ++fake->delay_calls;
+  fake->now_us += (uint64_t)ms * 1000;
+  fake->delayed_us += (uint64_t)ms * 1000;
+}
+
+void serial_stream_fake_init(struct serial_stream_fake *const fake,
+  const struct serial_stream_fake_config *const config) {
+  memset(fake, 0, sizeof(*fake));
+  fake->config = *config;
+  serial_stream_fake_driver = fake;
+}
+
+MYRIOTA_SerialStreamInterface serial_stream_fake_interface(void) {
+  const MYRIOTA_SerialStreamInterface interface = {
+    .read = fake_read,
+    .write = fake_write,
+    .tick_get = fake_tick_get,
+    .delay_ms = fake_delay_ms,
+    .baud_rate = serial_stream_fake_driver->config.baud_rate,
+  };
+  return interface;
+}
+
+size_t serial_stream_fake_receive(struct serial_stream_fake *const fake,
+  const uint8_t *const bytes, const size_t size, const uint32_t delay_us) {
+  // Reclaim the bytes that have been read.
+  if (fake->rx_read > 0) {
+    memmove(fake->rx, &fake->rx[fake->rx_read], fake->rx_size - fake->rx_read);
+    memmove(fake->rx_arrival_us, &fake->rx_arrival_us[fake->rx_read],
+      (fake->rx_size - fake->rx_read) * sizeof(*fake->rx_arrival_us));
+    fake->rx_size -= fake->rx_read;
+    fake->rx_arrived -= fake->rx_read;
+    fake->rx_read = 0;
+  }
+
+  uint64_t start_us = fake->now_us;
+  if (fake->rx_size > 0 && fake->rx_arrival_us[fake->rx_size - 1] > start_us) {
+    start_us = fake->rx_arrival_us[fake->rx_size - 1];
+  }
+  start_us += delay_us;
+
+  size_t count = sizeof(fake->rx) - fake->rx_size;
+  if (count > size) {
+    count = size;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    fake->rx[fake->rx_size] = bytes[i];
+    fake->rx_arrival_us[fake->rx_size] = start_us + (i + 1) * (uint64_t)byte_time_us(fake);
+    ++fake->rx_size;
+  }
+  return count;
+}
+
+void serial_stream_fake_advance(struct serial_stream_fake *const fake, const uint32_t us) {
+  fake->now_us += us;
+}
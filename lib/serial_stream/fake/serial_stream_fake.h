@@ -0,0 +1,106 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// A fake serial driver for exercising the serial stream on the build machine.
+// Bytes queued with serial_stream_fake_receive() arrive one at a time at the
+// configured baud rate and wait in a driver receive buffer of limited size,
+// as they do with FLEX_SerialRead(). Time is kept by a virtual clock, which
+// advances as the driver is called rather than with the host's clock.
+
+#ifndef MYRIOTA_SERIAL_STREAM_FAKE_H
+#define MYRIOTA_SERIAL_STREAM_FAKE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "myriota/serial_stream.h"
+
+#define SERIAL_STREAM_FAKE_RX_MAX 4096
+#define SERIAL_STREAM_FAKE_TX_MAX 256
+
+struct serial_stream_fake_config {
+  // The baud rate, which sets the time a byte takes on the line, 0 for bytes
+  // to arrive all at once.
+  uint32_t baud_rate;
+  // The size of the driver's receive buffer, bytes arriving while it is full
+  // are lost. FLEX_SerialRead()'s buffer is 50 bytes.
+  size_t driver_buffer_size;
+  // The time each call to read takes.
+  uint32_t read_cost_us;
+  // The time each call to tick_get takes.
+  uint32_t tick_cost_us;
+};
+
+struct serial_stream_fake {
+  struct serial_stream_fake_config config;
+  // The virtual clock.
+  uint64_t now_us;
+
+  uint8_t rx[SERIAL_STREAM_FAKE_RX_MAX];
+  uint64_t rx_arrival_us[SERIAL_STREAM_FAKE_RX_MAX];
+  size_t rx_size;
+  // The number of bytes that have reached the driver's receive buffer.
+  size_t rx_arrived;
+  // The number of bytes read from the driver's receive buffer.
+  size_t rx_read;
+
+  uint8_t tx[SERIAL_STREAM_FAKE_TX_MAX];
+  size_t tx_size;
+
+  // Counters of the driver's activity.
+  uint32_t read_calls;
+  uint32_t tick_calls;
+  uint32_t delay_calls;
+  uint32_t overruns;
+  // The virtual time spent in delay_ms.
+  uint64_t delayed_us;
+};
+
+/**
+ * Initialize a fake and make it the driver behind serial_stream_fake_interface().
+ *
+ * \param[out] fake The fake to initialize.
+ * \param[in] config The fake driver's configuration.
+ */
+void serial_stream_fake_init(struct serial_stream_fake *const fake,
+  const struct serial_stream_fake_config *const config);
+
+/**
+ * The serial driver of the most recently initialized fake, including a
+ * delay_ms that advances the virtual clock and the configured baud rate.
+ *
+ * \return the driver interface.
+ */
+MYRIOTA_SerialStreamInterface serial_stream_fake_interface(void);
+
+/**
+ * Queue bytes to arrive on the line, after any already queued.
+ *
+ * \param[in,out] fake The fake.
+ * \param[in] bytes The bytes to arrive.
+ * \param[in] size The number of bytes.
+ * \param[in] delay_us The silence on the line before the first byte starts.
+ * \return the number of bytes queued, less than `size` once the fake is full.
+ */
+size_t serial_stream_fake_receive(struct serial_stream_fake *const fake,
+  const uint8_t *const bytes, const size_t size, const uint32_t delay_us);
+
+/**
+ * Advance the virtual clock.
+ *
+ * \param[in,out] fake The fake.
+ * \param[in] us The time to advance by in microseconds.
+ */
+void serial_stream_fake_advance(struct serial_stream_fake *const fake, const uint32_t us);
+
+#endif /* MYRIOTA_SERIAL_STREAM_FAKE_H */
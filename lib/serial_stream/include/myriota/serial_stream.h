@@ -0,0 +1,281 @@
+/// \file serial_stream.h Myriota Buffered Serial Stream
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRIOTA_SERIAL_STREAM_H
+#define MYRIOTA_SERIAL_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** \defgroup Serial_Stream Serial Stream Library
+ * A ring buffer over the serial driver that drains the driver's receive
+ * buffer in bulk, and the framing primitives serial protocols are built on:
+ * read until a delimiter, read exactly N bytes and read until the line goes
+ * idle.
+ *
+ * The framing primitives take an absolute deadline from
+ * MYRIOTA_SerialStreamDeadline(), so a caller reading several frames in turn
+ * can bound the time taken by all of them. A frame that is incomplete at the
+ * deadline is left in the ring buffer for the next read. When the interface
+ * has a delay_ms the primitives sleep between polls of the driver, see
+ * MYRIOTA_SerialStreamWait().
+ * \{
+ */
+
+/** Error codes for the serial stream. */
+typedef enum {
+  SERIAL_STREAM_SUCCESS = 0,
+  SERIAL_STREAM_ERROR_INVALID_ARGUMENT,
+  SERIAL_STREAM_ERROR_IO_FAILURE,
+  SERIAL_STREAM_ERROR_TIMEOUT,
+  SERIAL_STREAM_ERROR_OVERFLOW,
+} MYRIOTA_SerialStreamErrors;
+
+/** A ring buffer size that holds a maximum length Modbus RTU frame. */
+#define SERIAL_STREAM_CAPACITY_DEFAULT 256
+
+/**
+ * The size of the driver's receive buffer, that of FLEX_SerialRead(). Waits
+ * are kept short enough for half of it to arrive, so the driver doesn't
+ * overrun while the stream sleeps.
+ */
+#define SERIAL_STREAM_DRIVER_BUFFER_SIZE 50
+
+/**
+ * Non-blocking serial read, e.g. FLEX_SerialRead().
+ *
+ * \param[out] rx The buffer to read into.
+ * \param[in] length The size of the buffer.
+ * \return the number of bytes read, or < 0 on failure.
+ */
+typedef int (*MYRIOTA_SerialStreamReadFn_t)(uint8_t *rx, size_t length);
+
+/**
+ * Serial write, e.g. FLEX_SerialWrite().
+ *
+ * \param[in] tx The bytes to write.
+ * \param[in] length The number of bytes to write.
+ * \return 0 on success, or < 0 on failure.
+ */
+typedef int (*MYRIOTA_SerialStreamWriteFn_t)(const uint8_t *tx, size_t length);
+
+/**
+ * Millisecond tick source, e.g. FLEX_TickGet().
+ *
+ * \return a free running millisecond counter that may wrap around.
+ */
+typedef uint32_t (*MYRIOTA_SerialStreamTickGetFn_t)(void);
+
+/**
+ * Millisecond delay, e.g. FLEX_DelayMs().
+ *
+ * \param[in] ms The time to delay for in milliseconds.
+ */
+typedef void (*MYRIOTA_SerialStreamDelayFn_t)(const uint32_t ms);
+
+/** The serial driver under a stream. */
+typedef struct {
+  /** Non-blocking read of the driver's receive buffer. */
+  MYRIOTA_SerialStreamReadFn_t read;
+  /** Write to the serial device. */
+  MYRIOTA_SerialStreamWriteFn_t write;
+  /** Millisecond tick source. */
+  MYRIOTA_SerialStreamTickGetFn_t tick_get;
+  /** Optional millisecond delay to sleep in while waiting, NULL to busy poll. */
+  MYRIOTA_SerialStreamDelayFn_t delay_ms;
+  /** The baud rate, which sizes the delays. Optional, 0 delays 1 ms at a time. */
+  uint32_t baud_rate;
+} MYRIOTA_SerialStreamInterface;
+
+/** A buffered serial stream, managed by the library once initialized. */
+typedef struct {
+  /** The serial driver. */
+  MYRIOTA_SerialStreamInterface interface;
+  /** The ring buffer. */
+  uint8_t *buffer;
+  /** The ring buffer's capacity less one, the capacity is a power of two. */
+  size_t mask;
+  /** The number of bytes received into the ring buffer, free running. */
+  size_t head;
+  /** The number of bytes consumed from the ring buffer, free running. */
+  size_t tail;
+  /** The tick at which bytes were last received. */
+  uint32_t last_rx_tick;
+  /** The total time spent in the interface's delay_ms, free running. */
+  uint32_t waited_ms;
+} MYRIOTA_SerialStream;
+
+/**
+ * Whether a deadline has been reached, allowing for the tick counter wrapping
+ * around. Deadlines must be less than 2^31 ms (~24 days) away.
+ *
+ * \param[in] now The current tick.
+ * \param[in] deadline The deadline.
+ * \return true once `now` is at or after `deadline`.
+ */
+static inline bool MYRIOTA_SerialStreamExpired(const uint32_t now, const uint32_t deadline) {
+  return (int32_t)(now - deadline) >= 0;
+}
+
+/**
+ * Initialize a stream over a serial driver. The driver must already be
+ * initialized, e.g. with FLEX_SerialInit().
+ *
+ * \param[out] stream The stream to initialize.
+ * \param[in] interface The serial driver.
+ * \param[in] buffer The ring buffer, owned by the stream until it is no longer used.
+ * \param[in] capacity The size of `buffer`, a power of two.
+ * \return 0 on success, -SERIAL_STREAM_ERROR_INVALID_ARGUMENT if an argument is invalid.
+ */
+int MYRIOTA_SerialStreamInit(MYRIOTA_SerialStream *const stream,
+  const MYRIOTA_SerialStreamInterface interface, uint8_t *const buffer, const size_t capacity);
+
+/**
+ * Get an absolute deadline for the framing primitives.
+ *
+ * \param[in] stream The stream.
+ * \param[in] timeout_ms The time from now until the deadline.
+ * \return the deadline tick.
+ */
+uint32_t MYRIOTA_SerialStreamDeadline(const MYRIOTA_SerialStream *const stream,
+  const uint32_t timeout_ms);
+
+/**
+ * Sleep towards a deadline in a single call to the interface's delay_ms,
+ * rather than spinning on the tick counter. The delay is bounded by the
+ * deadline, by the time the `expected` bytes take to arrive at the interface's
+ * baud rate, and by the time half the driver's receive buffer takes to fill.
+ *
+ * The framing primitives wait with this between polls of the driver. Other
+ * deadlines, e.g. a sensor's stabilization time, can be waited out with:
+ *
+ *     while (!MYRIOTA_SerialStreamExpired(FLEX_TickGet(), deadline)) {
+ *       MYRIOTA_SerialStreamWait(&stream, deadline, 0);
+ *       MYRIOTA_SerialStreamPoll(&stream);
+ *     }
+ *
+ * \param[in,out] stream The stream, whose waited_ms accumulates the time slept.
+ * \param[in] deadline The tick not to sleep past.
+ * \param[in] expected The number of bytes still expected, 0 if unknown.
+ * \return the time slept in milliseconds, 0 if the deadline has been reached
+ *         or the interface has no delay_ms.
+ */
+uint32_t MYRIOTA_SerialStreamWait(MYRIOTA_SerialStream *const stream, const uint32_t deadline,
+  const size_t expected);
+
+/**
+ * Move everything the driver has received into the ring buffer, in as few
+ * reads as the ring buffer's wrap around allows. Bytes that don't fit are
+ * left with the driver.
+ *
+ * \param[in,out] stream The stream.
+ * \return the number of bytes received, or -SERIAL_STREAM_ERROR_IO_FAILURE.
+ */
+int MYRIOTA_SerialStreamPoll(MYRIOTA_SerialStream *const stream);
+
+/**
+ * The number of bytes in the ring buffer.
+ *
+ * \param[in] stream The stream.
+ * \return the number of bytes waiting to be read.
+ */
+size_t MYRIOTA_SerialStreamAvailable(const MYRIOTA_SerialStream *const stream);
+
+/**
+ * Discard everything received so far, e.g. stale bytes before a request.
+ *
+ * \param[in,out] stream The stream.
+ * \return 0 on success, or -SERIAL_STREAM_ERROR_IO_FAILURE.
+ */
+int MYRIOTA_SerialStreamDiscard(MYRIOTA_SerialStream *const stream);
+
+/**
+ * Read whatever has been received without waiting.
+ *
+ * \param[in,out] stream The stream.
+ * \param[out] rx The buffer to read into.
+ * \param[in] length The size of `rx`.
+ * \return the number of bytes read, or -SERIAL_STREAM_ERROR_IO_FAILURE.
+ */
+int MYRIOTA_SerialStreamRead(MYRIOTA_SerialStream *const stream, uint8_t *const rx,
+  const size_t length);
+
+/**
+ * Write to the serial device.
+ *
+ * \param[in] stream The stream.
+ * \param[in] tx The bytes to write.
+ * \param[in] length The number of bytes to write.
+ * \return 0 on success, or -SERIAL_STREAM_ERROR_IO_FAILURE.
+ */
+int MYRIOTA_SerialStreamWrite(MYRIOTA_SerialStream *const stream, const uint8_t *const tx,
+  const size_t length);
+
+/**
+ * Read up to and including a delimiter, e.g. a line terminated by '\\n'. The
+ * delimiter is consumed but not copied to `rx`.
+ *
+ * If `max` bytes, or a full ring buffer, arrive without a delimiter they are
+ * copied to `rx` and consumed, and -SERIAL_STREAM_ERROR_OVERFLOW returned.
+ *
+ * \param[in,out] stream The stream.
+ * \param[in] delimiter The byte that ends the frame.
+ * \param[out] rx The buffer to read the frame into.
+ * \param[in] max The size of `rx`.
+ * \param[in] deadline The tick by which the delimiter must arrive.
+ * \return the length of the frame excluding the delimiter, or < 0 on failure.
+ * \retval -SERIAL_STREAM_ERROR_TIMEOUT: the frame is incomplete, and left in the ring buffer
+ * \retval -SERIAL_STREAM_ERROR_OVERFLOW: the frame is longer than `max`
+ * \retval -SERIAL_STREAM_ERROR_IO_FAILURE: the driver failed
+ */
+int MYRIOTA_SerialStreamReadUntil(MYRIOTA_SerialStream *const stream, const uint8_t delimiter,
+  uint8_t *const rx, const size_t max, const uint32_t deadline);
+
+/**
+ * Read exactly `count` bytes, e.g. a fixed length frame or the remainder of a
+ * frame whose length is in its header.
+ *
+ * \param[in,out] stream The stream.
+ * \param[out] rx The buffer to read into.
+ * \param[in] count The number of bytes to read, at most the ring buffer's capacity.
+ * \param[in] deadline The tick by which the bytes must arrive.
+ * \return `count`, or < 0 on failure.
+ * \retval -SERIAL_STREAM_ERROR_TIMEOUT: the bytes are incomplete, and left in the ring buffer
+ * \retval -SERIAL_STREAM_ERROR_INVALID_ARGUMENT: `count` exceeds the ring buffer's capacity
+ * \retval -SERIAL_STREAM_ERROR_IO_FAILURE: the driver failed
+ */
+int MYRIOTA_SerialStreamReadExactly(MYRIOTA_SerialStream *const stream, uint8_t *const rx,
+  const size_t count, const uint32_t deadline);
+
+/**
+ * Read a frame delimited by silence on the line, e.g. a Modbus RTU frame.
+ * Returns once `max` bytes have been read, or once the line has been idle for
+ * more than `idle_ms` after the first byte. Once the frame has started, the
+ * stream sleeps for at most `idle_ms` at a time.
+ *
+ * \param[in,out] stream The stream.
+ * \param[out] rx The buffer to read into.
+ * \param[in] max The size of `rx`.
+ * \param[in] idle_ms The silence that ends a frame in milliseconds.
+ * \param[in] deadline The tick by which the first byte must arrive.
+ * \return the number of bytes read, 0 if none arrived before the deadline, or
+ *         -SERIAL_STREAM_ERROR_IO_FAILURE.
+ */
+int MYRIOTA_SerialStreamReadUntilIdle(MYRIOTA_SerialStream *const stream, uint8_t *const rx,
+  const size_t max, const uint32_t idle_ms, const uint32_t deadline);
+
+/** \} */
+
+#endif /* MYRIOTA_SERIAL_STREAM_H */
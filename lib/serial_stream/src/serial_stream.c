@@ -0,0 +1,533 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "myriota/serial_stream.h"
+#include <string.h>
+
+// Bits per character on the wire: start, 8 data and stop.
+#define SERIAL_STREAM_BITS_PER_BYTE 10
+
+static inline size_t stream_capacity(const MYRIOTA_SerialStream *const stream) {
+  return stream->mask + 1;
+}
+
+// Copy `count` bytes from `offset` bytes past the ring buffer's tail, in at
+// most two pieces either side of the wrap around.
+static void stream_peek(const MYRIOTA_SerialStream *const stream, const size_t offset,
+  uint8_t *const dest, const size_t count) {
+  const size_t index = (stream->tail + offset) & stream->mask;
+  const size_t first = stream_capacity(stream) - index < count ? stream_capacity(stream) - index
+                                                               : count;
+  memcpy(dest, &stream->buffer[index], first);
+  memcpy(&dest[first], stream->buffer, count - first);
+}
+
+static void stream_take(MYRIOTA_SerialStream *const stream, uint8_t *const dest,
+  const size_t count) {
+  stream_peek(stream, 0, dest, count);
+  stream->tail += count;
+}
+
+// Find `delimiter` within bytes [from, to) past the ring buffer's tail.
+// Returns its offset from the tail, or `to` if it isn't there.
+static size_t stream_find(const MYRIOTA_SerialStream *const stream, const uint8_t delimiter,
+  size_t from, const size_t to) {
+  while (from < to) {
+    const size_t index = (stream->tail + from) & stream->mask;
+    size_t count = stream_capacity(stream) - index;
+    if (count > to - from) {
+      count = to - from;
+    }
+    const uint8_t *const found = memchr(&stream->buffer[index], delimiter, count);
+    if (found != NULL) {
+      return from + (size_t)(found - &stream->buffer[index]);
+    }
+    from += count;
+  }
+  return to;
+}
+
+// The time `bytes` take to arrive in whole milliseconds, rounded down.
+static uint32_t stream_bytes_ms(const MYRIOTA_SerialStream *const stream, const size_t bytes) {
+  return (uint32_t)((uint64_t)bytes * SERIAL_STREAM_BITS_PER_BYTE * 1000 /
+                    stream->interface.baud_rate);
+}
+
+static uint32_t stream_wait(MYRIOTA_SerialStream *const stream, const uint32_t deadline,
+  const size_t expected, const uint32_t max_ms) {
+  if (stream->interface.delay_ms == NULL) {
+    return 0;
+  }
+
+  const uint32_t now = stream->interface.tick_get();
+  if (MYRIOTA_SerialStreamExpired(now, deadline)) {
+    return 0;
+  }
+  uint32_t ms = deadline - now;
+  if (ms > max_ms) {
+    ms = max_ms;
+  }
+
+  if (stream->interface.baud_rate == 0) {
+    ms = ms > 0 ? 1 : 0;
+  } else {
+    // Wake before the driver's receive buffer is half full. Lines fast enough
+    // to fill that in under a millisecond are polled without sleeping.
+    const uint32_t overrun_ms = stream_bytes_ms(stream, SERIAL_STREAM_DRIVER_BUFFER_SIZE / 2);
+    if (ms > overrun_ms) {
+      ms = overrun_ms;
+    }
+    if (expected > 0) {
+      uint32_t expected_ms = stream_bytes_ms(stream, expected);
+      if (expected_ms == 0) {
+        expected_ms = 1;
+      }
+      if (ms > expected_ms) {
+        ms = expected_ms;
+      }
+    }
+  }
+
+  if (ms > 0) {
+    stream->interface.delay_ms(ms);
+    stream->waited_ms += ms;
+  }
+  return ms;
+}
+
+int MYRIOTA_SerialStreamInit(MYRIOTA_SerialStream *const stream,
+  const MYRIOTA_SerialStreamInterface interface, uint8_t *const buffer, const size_t capacity) {
+  if (stream == NULL || interface.read == NULL || interface.write == NULL ||
+      interface.tick_get == NULL || buffer == NULL || capacity == 0 ||
+      (capacity & (capacity - 1)) != 0) {
+    return -SERIAL_STREAM_ERROR_INVALID_ARGUMENT;
+  }
+
+  stream->interface = interface;
+  stream->buffer = buffer;
+  stream->mask = capacity - 1;
+  stream->head = 0;
+  stream->tail = 0;
+  stream->last_rx_tick = interface.tick_get();
+  stream->waited_ms = 0;
+  return SERIAL_STREAM_SUCCESS;
+}
+
+uint32_t MYRIOTA_SerialStreamDeadline(const MYRIOTA_SerialStream *const stream,
+  const uint32_t timeout_ms) {
+  return stream->interface.tick_get() + timeout_ms;
+}
+
+uint32_t MYRIOTA_SerialStreamWait(MYRIOTA_SerialStream *const stream, const uint32_t deadline,
+  const size_t expected) {
+  return stream_wait(stream, deadline, expected, UINT32_MAX);
+}
+
+int MYRIOTA_SerialStreamPoll(MYRIOTA_SerialStream *const stream) {
+  size_t received = 0;
+  while (MYRIOTA_SerialStreamAvailable(stream) < stream_capacity(stream)) {
+    const size_t index = stream->head & stream->mask;
+    size_t count = stream_capacity(stream) - MYRIOTA_SerialStreamAvailable(stream);
+    if (count > stream_capacity(stream) - index) {
+      count = stream_capacity(stream) - index;
+    }
+
+    const int result = stream->interface.read(&stream->buffer[index], count);
+    if (result < 0) {
+      return -SERIAL_STREAM_ERROR_IO_FAILURE;
+    }
+    stream->head += (size_t)result;
+    received += (size_t)result;
+
+    // Only read again if the driver may have more than the space up to the
+    // wrap around.
+    if ((size_t)result < count) {
+      break;
+    }
+  }
+
+  if (received > 0) {
+    stream->last_rx_tick = stream->interface.tick_get();
+  }
+  return (int)received;
+}
+
+size_t MYRIOTA_SerialStreamAvailable(const MYRIOTA_SerialStream *const stream) {
+  return stream->head - stream->tail;
+}
+
+int MYRIOTA_SerialStreamDiscard(MYRIOTA_SerialStream *const stream) {
+  int result;
+  do {
+    stream->tail = stream->head;
+    result = MYRIOTA_SerialStreamPoll(stream);
+  } while (result > 0);
+  stream->tail = stream->head;
+  return result < 0 ? result : SERIAL_STREAM_SUCCESS;
+}
+
+int MYRIOTA_SerialStreamRead(MYRIOTA_SerialStream *const stream, uint8_t *const rx,
+  const size_t length) {
+  const int result = MYRIOTA_SerialStreamPoll(stream);
+  if (result < 0) {
+    return result;
+  }
+
+  size_t count = MYRIOTA_SerialStreamAvailable(stream);
+  if (count > length) {
+    count = length;
+  }
+  stream_take(stream, rx, count);
+  return (int)count;
+}
+
+int MYRIOTA_SerialStreamWrite(MYRIOTA_SerialStream *const stream, const uint8_t *const tx,
+  const size_t length) {
+  if (stream->interface.write(tx, length) < 0) {
+    return -SERIAL_STREAM_ERROR_IO_FAILURE;
+  }
+  return SERIAL_STREAM_SUCCESS;
+}
+
+int MYRIOTA_SerialStreamReadUntil(MYRIOTA_SerialStream *const stream, const uint8_t delimiter,
+  uint8_t *const rx, const size_t max, const uint32_t deadline) {
+  // Bytes before `scanned` are known not to be the delimiter, so each byte is
+  // only searched once however many polls the frame takes to arrive.
+  size_t scanned = 0;
+  while (true) {
+    const int result = MYRIOTA_SerialStreamPoll(stream);
+    if (result < 0) {
+      return result;
+    }
+
+    const size_t available = MYRIOTA_SerialStreamAvailable(stream);
+    const size_t window = available < max + 1 ? available : max + 1;
+    const size_t found = stream_find(stream, delimiter, scanned, window);
+    if (found < window) {
+      stream_take(stream, rx, found);
+      ++stream->tail;
+      return (int)found;
+    }
+    scanned = window;
+
+    if (available > max || available == stream_capacity(stream)) {
+      const size_t count = available < max ? available : max;
+      stream_take(stream, rx, count);
+      return -SERIAL_STREAM_ERROR_OVERFLOW;
+    }
+
+    if (MYRIOTA_SerialStreamExpired(stream->interface.tick_get(), deadline)) {
+      return -SERIAL_STREAM_ERROR_TIMEOUT;
+    }
+    stream_wait(stream, deadline, 0, UINT32_MAX);
+  }
+}
+
+int MYRIOTA_SerialStreamReadExactly(MYRIOTA_SerialStream *const stream, uint8_t *const rx,
+  const size_t count, const uint32_t deadline) {
+  if (count > stream_capacity(stream)) {
+    return -SERIAL_STREAM_ERROR_INVALID_ARGUMENT;
+  }
+
+  while (true) {
+    const int result = MYRIOTA_SerialStreamPoll(stream);
+    if (result < 0) {
+      return result;
+    }
+
+    if (MYRIOTA_SerialStreamAvailable(stream) >= count) {
+      stream_take(stream, rx, count);
+      return (int)count;
+    }
+
+    if (MYRIOTA_SerialStreamExpired(stream->interface.tick_get(), deadline)) {
+      return -SERIAL_STREAM_ERROR_TIMEOUT;
+    }
+    stream_wait(stream, deadline, count - MYRIOTA_SerialStreamAvailable(stream), UINT32_MAX);
+  }
+}
+
+int MYRIOTA_SerialStreamReadUntilIdle(MYRIOTA_SerialStream *const stream, uint8_t *const rx,
+  const size_t max, const uint32_t idle_ms, const uint32_t deadline) {
+  size_t count = 0;
+  while (true) {
+    const int result = MYRIOTA_SerialStreamRead(stream, &rx[count], max - count);
+    if (result < 0) {
+      return result;
+    }
+    count += (size_t)result;
+    if (count == max) {
+      return (int)count;
+    }
+
+    const uint32_t now = stream->interface.tick_get();
+    if (count == 0 && MYRIOTA_SerialStreamExpired(now, deadline)) {
+      return 0;
+    }
+    if (count == 0) {
+      stream_wait(stream, deadline, max, UINT32_MAX);
+    } else if (now - stream->last_rx_tick > idle_ms) {
+      return (int)count;
+    } else {
+      // The frame's end is found by polling, so wait no longer than the
+      // silence that ends it.
+      stream_wait(stream, stream->last_rx_tick + idle_ms + 1, max - count, idle_ms);
+    }
+  }
+}
+
+#ifdef MYRIOTA_SERIAL_STREAM_UNIT_TESTS
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+/*
+ * `cmocka.h` must be included after standard the above library headers.
+ * NOTE: This comment has dual purpose:
+ * 1. Document the ordering requirement.
+ * 2. Prevent `clang-format` from reordering the headers.
+ */
+#include <cmocka.h>
+
+#include "serial_stream_fake.h"
+
+#define TEST_BAUD_RATE 115200
+
+static struct serial_stream_fake fake;
+static MYRIOTA_SerialStream stream;
+static uint8_t stream_buffer[64];
+
+static void test_stream_init(const uint32_t baud_rate) {
+  const struct serial_stream_fake_config config = {
+    .baud_rate = baud_rate,
+    .driver_buffer_size = 50,
+    .read_cost_us = 10,
+    .tick_cost_us = 1,
+  };
+  serial_stream_fake_init(&fake, &config);
+  assert_int_equal(MYRIOTA_SerialStreamInit(&stream, serial_stream_fake_interface(),
+                     stream_buffer, sizeof(stream_buffer)),
+    SERIAL_STREAM_SUCCESS);
+}
+
+static void test_receive(const char *const bytes, const uint32_t delay_us) {
+  assert_int_equal(
+    serial_stream_fake_receive(&fake, (const uint8_t *)bytes, strlen(bytes), delay_us),
+    strlen(bytes));
+}
+
+static void test_init_arguments(void **state) {
+  (void)state;
+  test_stream_init(0);
+  const MYRIOTA_SerialStreamInterface interface = serial_stream_fake_interface();
+  assert_int_equal(MYRIOTA_SerialStreamInit(&stream, interface, stream_buffer, 48),
+    -SERIAL_STREAM_ERROR_INVALID_ARGUMENT);
+  assert_int_equal(MYRIOTA_SerialStreamInit(&stream, interface, NULL, 64),
+    -SERIAL_STREAM_ERROR_INVALID_ARGUMENT);
+  MYRIOTA_SerialStreamInterface no_tick = interface;
+  no_tick.tick_get = NULL;
+  assert_int_equal(MYRIOTA_SerialStreamInit(&stream, no_tick, stream_buffer, 64),
+    -SERIAL_STREAM_ERROR_INVALID_ARGUMENT);
+}
+
+static void test_deadline_wraps(void **state) {
+  (void)state;
+  assert_false(MYRIOTA_SerialStreamExpired(UINT32_MAX - 5, 10));
+  assert_true(MYRIOTA_SerialStreamExpired(10, 10));
+  assert_true(MYRIOTA_SerialStreamExpired(11, UINT32_MAX - 5));
+  assert_false(MYRIOTA_SerialStreamExpired(UINT32_MAX, 0));
+}
+
+static void test_read_until_delimiter(void **state) {
+  (void)state;
+  test_stream_init(TEST_BAUD_RATE);
+  test_receive("hello\nworld\n", 1000);
+
+  uint8_t rx[16] = {0};
+  const uint32_t deadline = MYRIOTA_SerialStreamDeadline(&stream, 100);
+  assert_int_equal(MYRIOTA_SerialStreamReadUntil(&stream, '\n', rx, sizeof(rx), deadline), 5);
+  assert_memory_equal(rx, "hello", 5);
+  assert_int_equal(MYRIOTA_SerialStreamReadUntil(&stream, '\n', rx, sizeof(rx), deadline), 5);
+  assert_memory_equal(rx, "world", 5);
+  assert_int_equal(MYRIOTA_SerialStreamAvailable(&stream), 0);
+
+  // An incomplete line is kept for the next read.
+  test_receive("part", 0);
+  assert_int_equal(
+    MYRIOTA_SerialStreamReadUntil(&stream, '\n', rx, sizeof(rx),
+      MYRIOTA_SerialStreamDeadline(&stream, 10)),
+    -SERIAL_STREAM_ERROR_TIMEOUT);
+  assert_int_equal(MYRIOTA_SerialStreamAvailable(&stream), 4);
+  test_receive("ial\n", 0);
+  assert_int_equal(MYRIOTA_SerialStreamReadUntil(&stream, '\n', rx, sizeof(rx),
+                     MYRIOTA_SerialStreamDeadline(&stream, 10)),
+    7);
+  assert_memory_equal(rx, "partial", 7);
+
+  // A line that fills `rx` without a delimiter overflows.
+  test_receive("0123456789\n", 0);
+  assert_int_equal(MYRIOTA_SerialStreamReadUntil(&stream, '\n', rx, 8,
+                     MYRIOTA_SerialStreamDeadline(&stream, 10)),
+    -SERIAL_STREAM_ERROR_OVERFLOW);
+  assert_memory_equal(rx, "01234567", 8);
+  assert_int_equal(MYRIOTA_SerialStreamReadUntil(&stream, '\n', rx, 8,
+                     MYRIOTA_SerialStreamDeadline(&stream, 10)),
+    2);
+  assert_memory_equal(rx, "89", 2);
+}
+
+static void test_read_exactly(void **state) {
+  (void)state;
+  test_stream_init(TEST_BAUD_RATE);
+
+  // Fill past the ring buffer's wrap around, so frames are copied in two pieces.
+  uint8_t bytes[100];
+  for (size_t i = 0; i < sizeof(bytes); ++i) {
+    bytes[i] = (uint8_t)i;
+  }
+  assert_int_equal(serial_stream_fake_receive(&fake, bytes, sizeof(bytes), 0), sizeof(bytes));
+
+  uint8_t rx[sizeof(bytes)] = {0};
+  size_t offset = 0;
+  while (offset < sizeof(bytes)) {
+    const size_t count = sizeof(bytes) - offset < 30 ? sizeof(bytes) - offset : 30;
+    assert_int_equal(MYRIOTA_SerialStreamReadExactly(&stream, &rx[offset], count,
+                       MYRIOTA_SerialStreamDeadline(&stream, 100)),
+      count);
+    offset += count;
+  }
+  assert_memory_equal(rx, bytes, sizeof(bytes));
+  assert_int_equal(fake.overruns, 0);
+
+  test_receive("abc", 0);
+  assert_int_equal(MYRIOTA_SerialStreamReadExactly(&stream, rx, 4,
+                     MYRIOTA_SerialStreamDeadline(&stream, 10)),
+    -SERIAL_STREAM_ERROR_TIMEOUT);
+  assert_int_equal(MYRIOTA_SerialStreamAvailable(&stream), 3);
+  assert_int_equal(MYRIOTA_SerialStreamReadExactly(&stream, rx, sizeof(stream_buffer) + 1, 0),
+    -SERIAL_STREAM_ERROR_INVALID_ARGUMENT);
+}
+
+static void test_read_until_idle(void **state) {
+  (void)state;
+  test_stream_init(9600);
+
+  // Two frames separated by more than the idle time are read separately.
+  test_receive("first", 5000);
+  test_receive("second", 10000);
+  uint8_t rx[16] = {0};
+  assert_int_equal(MYRIOTA_SerialStreamReadUntilIdle(&stream, rx, sizeof(rx), 4,
+                     MYRIOTA_SerialStreamDeadline(&stream, 100)),
+    5);
+  assert_memory_equal(rx, "first", 5);
+  assert_int_equal(MYRIOTA_SerialStreamReadUntilIdle(&stream, rx, sizeof(rx), 4,
+                     MYRIOTA_SerialStreamDeadline(&stream, 100)),
+    6);
+  assert_memory_equal(rx, "second", 6);
+
+  // Nothing arrives before the deadline.
+  const uint64_t start_us = fake.now_us;
+  assert_int_equal(MYRIOTA_SerialStreamReadUntilIdle(&stream, rx, sizeof(rx), 4,
+                     MYRIOTA_SerialStreamDeadline(&stream, 20)),
+    0);
+  assert_true(fake.now_us - start_us >= 19000);
+
+  // Reading stops at `max`, leaving the rest of the frame buffered.
+  test_receive("0123456789", 0);
+  assert_int_equal(MYRIOTA_SerialStreamReadUntilIdle(&stream, rx, 4, 4,
+                     MYRIOTA_SerialStreamDeadline(&stream, 100)),
+    4);
+  assert_int_equal(MYRIOTA_SerialStreamReadUntilIdle(&stream, rx, sizeof(rx), 4,
+                     MYRIOTA_SerialStreamDeadline(&stream, 100)),
+    6);
+  assert_memory_equal(rx, "456789", 6);
+}
+
+static void test_bulk_reads(void **state) {
+  (void)state;
+  test_stream_init(0);
+
+  // A line already waiting with the driver is read in one call, rather than
+  // a call per byte.
+  test_receive("a line of forty bytes waiting to be read\n", 0);
+  uint8_t rx[64] = {0};
+  assert_int_equal(MYRIOTA_SerialStreamReadUntil(&stream, '\n', rx, sizeof(rx),
+                     MYRIOTA_SerialStreamDeadline(&stream, 10)),
+    40);
+  assert_true(fake.read_calls <= 2);
+
+  uint8_t tx[] = "OK\n";
+  assert_int_equal(MYRIOTA_SerialStreamWrite(&stream, tx, 3), SERIAL_STREAM_SUCCESS);
+  assert_memory_equal(fake.tx, "OK\n", 3);
+
+  test_receive("stale", 0);
+  assert_int_equal(MYRIOTA_SerialStreamDiscard(&stream), SERIAL_STREAM_SUCCESS);
+  assert_int_equal(MYRIOTA_SerialStreamAvailable(&stream), 0);
+  assert_int_equal(MYRIOTA_SerialStreamRead(&stream, rx, sizeof(rx)), 0);
+}
+
+static void test_wait(void **state) {
+  (void)state;
+  test_stream_init(9600);
+
+  // A frame arriving over ~60 ms is waited for in delays rather than polls,
+  // without the driver's receive buffer overrunning.
+  uint8_t bytes[60];
+  memset(bytes, 0x5a, sizeof(bytes));
+  assert_int_equal(serial_stream_fake_receive(&fake, bytes, sizeof(bytes), 2000), sizeof(bytes));
+  uint8_t rx[sizeof(bytes)] = {0};
+  assert_int_equal(MYRIOTA_SerialStreamReadExactly(&stream, rx, sizeof(rx),
+                     MYRIOTA_SerialStreamDeadline(&stream, 500)),
+    sizeof(rx));
+  assert_memory_equal(rx, bytes, sizeof(bytes));
+  assert_int_equal(fake.overruns, 0);
+  assert_true(stream.waited_ms >= 50);
+  assert_true(fake.read_calls < 20);
+
+  // Other deadlines are waited out in delays of at most the time half the
+  // driver's buffer takes to fill, across the tick counter wrapping around.
+  fake.now_us = (uint64_t)(UINT32_MAX - 10) * 1000;
+  const uint32_t waited_ms = stream.waited_ms;
+  const uint32_t delay_calls = fake.delay_calls;
+  const uint32_t deadline = MYRIOTA_SerialStreamDeadline(&stream, 100);
+  while (!MYRIOTA_SerialStreamExpired(serial_stream_fake_interface().tick_get(), deadline)) {
+    assert_true(MYRIOTA_SerialStreamWait(&stream, deadline, 0) <= 26);
+  }
+  assert_true(stream.waited_ms - waited_ms >= 99 && stream.waited_ms - waited_ms <= 100);
+  assert_int_equal(fake.delay_calls - delay_calls, 4);
+  assert_int_equal(MYRIOTA_SerialStreamWait(&stream, deadline, 0), 0);
+
+  // Without a delay the stream busy polls.
+  MYRIOTA_SerialStreamInterface interface = serial_stream_fake_interface();
+  interface.delay_ms = NULL;
+  assert_int_equal(
+    MYRIOTA_SerialStreamInit(&stream, interface, stream_buffer, sizeof(stream_buffer)),
+    SERIAL_STREAM_SUCCESS);
+  assert_int_equal(
+    MYRIOTA_SerialStreamWait(&stream, MYRIOTA_SerialStreamDeadline(&stream, 100), 0), 0);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_init_arguments),
+    cmocka_unit_test(test_deadline_wraps),
+    cmocka_unit_test(test_read_until_delimiter),
+    cmocka_unit_test(test_read_exactly),
+    cmocka_unit_test(test_read_until_idle),
+    cmocka_unit_test(test_bulk_reads),
+    cmocka_unit_test(test_wait),
+  };
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
+#endif /** MYRIOTA_SERIAL_STREAM_UNIT_TESTS */
@@ -0,0 +1,136 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Host benchmark of batching synthetic sensor series into 20 byte messages,
+// against sending each sample in its own message as a 32 bit timestamp and 32
+// bit value. Reports the samples carried per transmitted byte by each, and the
+// CPU time the series takes per sample added.
+//
+// NOTE: CPU time is measured on the host, use it as a relative figure rather
+// than as an absolute figure for the device.
+
+#include <stdio.h>
+#include <time.h>
+
+#include "myriota/timeseries.h"
+
+#define BENCHMARK_SAMPLES 20000
+#define BENCHMARK_MESSAGE_SIZE 20
+#define BENCHMARK_SAMPLES_MAX 128
+#define BENCHMARK_INTERVAL_S 900
+#define BENCHMARK_TIME 1700000000
+#define BENCHMARK_ABSOLUTE_SIZE 8
+
+typedef int32_t (*sample_fn)(size_t index);
+
+struct scenario {
+  const char *name;
+  sample_fn sample;
+};
+
+static uint32_t noise_state;
+
+// Deterministic noise from -amplitude to amplitude.
+static int32_t noise(const int32_t amplitude) {
+  noise_state = noise_state * 1664525 + 1013904223;
+  return (int32_t)((noise_state >> 16) % (uint32_t)(2 * amplitude + 1)) - amplitude;
+}
+
+// A tank level in mm draining by a few mm an interval, refilled each week.
+static int32_t tank_level(const size_t index) {
+  return 20000 - (int32_t)(index % 672) * 25 + noise(2);
+}
+
+// A temperature in 0.1 degC following a daily cycle.
+static int32_t temperature(const size_t index) {
+  const int32_t phase = (int32_t)(index % 96);
+  return 150 + (phase < 48 ? phase : 96 - phase) * 3 + noise(1);
+}
+
+// A pulse count, e.g. of a flow meter, that rises steadily.
+static int32_t pulse_count(const size_t index) {
+  static int32_t count;
+  if (index == 0) {
+    count = 0;
+  }
+  count += 40 + noise(8);
+  return count;
+}
+
+struct sent {
+  size_t messages;
+  size_t bytes;
+};
+
+static int send(void *ctx, const uint8_t *message, size_t size) {
+  struct sent *const sent = ctx;
+  (void)message;
+  ++sent->messages;
+  sent->bytes += size;
+  return 0;
+}
+
+static double elapsed_seconds(const struct timespec *const start,
+  const struct timespec *const end) {
+  return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static int run(const struct scenario *const scenario) {
+  static int32_t samples[BENCHMARK_SAMPLES_MAX];
+  static uint8_t message[BENCHMARK_MESSAGE_SIZE];
+  struct sent sent = {0};
+  const MYRIOTA_TimeSeriesOptions options = {
+    .interval_s = BENCHMARK_INTERVAL_S,
+    .samples = samples,
+    .samples_max = BENCHMARK_SAMPLES_MAX,
+    .message = message,
+    .message_size = sizeof(message),
+    .send = send,
+    .ctx = &sent,
+  };
+  MYRIOTA_TimeSeries series;
+  int result = MYRIOTA_TimeSeriesInit(&series, &options);
+
+  noise_state = 1;
+  struct timespec start, end;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+  for (size_t i = 0; i < BENCHMARK_SAMPLES; ++i) {
+    result |= MYRIOTA_TimeSeriesAdd(&series, BENCHMARK_TIME + i * BENCHMARK_INTERVAL_S,
+      scenario->sample(i));
+  }
+  result |= MYRIOTA_TimeSeriesFlush(&series);
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+
+  const double batched = (double)BENCHMARK_SAMPLES / sent.bytes;
+  const double absolute = 1.0 / BENCHMARK_ABSOLUTE_SIZE;
+  printf("%-12s %10.1f %14.3f %14.3f %8.2fx %12.1f%s\n", scenario->name,
+    (double)BENCHMARK_SAMPLES / sent.messages, absolute, batched, batched / absolute,
+    elapsed_seconds(&start, &end) * 1e9 / BENCHMARK_SAMPLES, result ? " FAILED" : "");
+  return result;
+}
+
+int main(void) {
+  const struct scenario scenarios[] = {
+    {"tank level", tank_level},
+    {"temperature", temperature},
+    {"pulse count", pulse_count},
+  };
+
+  int result = 0;
+  printf("%-12s %10s %14s %14s %9s %12s\n", "series", "samples/msg", "abs (smp/B)",
+    "batch (smp/B)", "gain", "cpu (ns/smp)");
+  for (size_t i = 0; i < sizeof(scenarios) / sizeof(*scenarios); ++i) {
+    result |= run(&scenarios[i]);
+  }
+  return result;
+}
@@ -0,0 +1,182 @@
+/// \file timeseries.h Myriota Time Series Batching
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MYRIOTA_TIMESERIES_H
+#define MYRIOTA_TIMESERIES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** \defgroup Time_Series Time Series Library
+ * Batch samples taken at a fixed interval into one message, sent as a base
+ * timestamp and interval, the first value, and the differences between
+ * consecutive values (or between consecutive differences) in a variable width
+ * code. Slowly changing readings, such as tank levels and temperatures, take
+ * a few bits each instead of a timestamp and value each.
+ *
+ * A message is packed most significant bit first with the bit packer
+ * (myriota/bitpack.h):
+ *
+ * | Field | Encoding |
+ * | ----- | -------- |
+ * | Base timestamp | 32 bit unsigned epoch seconds |
+ * | Interval | Varint of 7 bit groups, seconds |
+ * | Count | Varint of 7 bit groups |
+ * | Residuals | 1 bit, 0 for deltas or 1 for delta of deltas |
+ * | Group bits | 3 bit unsigned, the residuals' varint group bits less one |
+ * | First value | Zigzag varint of 7 bit groups |
+ * | Count - 1 residuals | Zigzag varints of the group bits |
+ *
+ * The residual encoding and group bits are chosen for each message to make it
+ * as small as possible. `scripts/timeseries_decode.py` decodes the messages.
+ * \{
+ */
+
+/** Error codes for the time series. */
+typedef enum {
+  TIMESERIES_SUCCESS = 0,
+  TIMESERIES_ERROR_INVALID_ARGUMENT,
+  TIMESERIES_ERROR_SEND_FAILURE,
+} MYRIOTA_TimeSeriesErrors;
+
+/** The residual encodings. */
+typedef enum {
+  /** The difference between consecutive values, for values that wander. */
+  TIMESERIES_RESIDUALS_DELTA = 0,
+  /** The difference between consecutive deltas, for values that trend. */
+  TIMESERIES_RESIDUALS_DELTA_OF_DELTA = 1,
+} MYRIOTA_TimeSeriesResiduals;
+
+/** The largest residual varint group size tried, in bits. */
+#define TIMESERIES_GROUP_BITS_MAX 8
+
+/** The smallest message size, which holds a sample with any timestamp, interval and value. */
+#define TIMESERIES_MESSAGE_SIZE_MIN 16
+
+/**
+ * Send a packed message, e.g. with FLEX_MessageSchedule().
+ *
+ * \param[in] ctx The user defined context from the options.
+ * \param[in] message The packed message.
+ * \param[in] size The size of the message in bytes.
+ * \return 0 on success, or < 0 on failure.
+ */
+typedef int (*MYRIOTA_TimeSeriesSendFn_t)(void *ctx, const uint8_t *message, size_t size);
+
+/** Time series options. */
+typedef struct {
+  /** The sampling interval in seconds. */
+  uint32_t interval_s;
+  /** The age of the first sample at which a batch is sent, 0 to only send full batches. */
+  uint32_t max_age_s;
+  /** Storage for a batch of samples. */
+  int32_t *samples;
+  /** The number of samples `samples` holds, at most one batch. */
+  size_t samples_max;
+  /** The buffer messages are packed into, its size is the largest message sent. */
+  uint8_t *message;
+  /** The size of `message` in bytes. */
+  size_t message_size;
+  /** Sends a packed message. */
+  MYRIOTA_TimeSeriesSendFn_t send;
+  /** User defined context for `send`. */
+  void *ctx;
+} MYRIOTA_TimeSeriesOptions;
+
+/** A time series accumulator, managed by the library once initialized. */
+typedef struct {
+  /** The options. */
+  MYRIOTA_TimeSeriesOptions options;
+  /** The timestamp of the first sample in the batch. */
+  uint32_t base_time;
+  /** The number of samples in the batch. */
+  size_t count;
+  /** The residual bits of the batch for each encoding and group size. */
+  uint32_t residual_bits[2][TIMESERIES_GROUP_BITS_MAX];
+} MYRIOTA_TimeSeries;
+
+/**
+ * Initialize a time series.
+ *
+ * \param[out] series The series to initialize.
+ * \param[in] options The series options.
+ * \return 0 on success, -TIMESERIES_ERROR_INVALID_ARGUMENT if an option is invalid.
+ */
+int MYRIOTA_TimeSeriesInit(MYRIOTA_TimeSeries *const series,
+  const MYRIOTA_TimeSeriesOptions *const options);
+
+/**
+ * Add a sample. The batch is sent first if the sample doesn't fit in its
+ * message or doesn't follow on from it, i.e. its timestamp is more than half
+ * an interval from the next slot. It is sent after the sample is added once
+ * `samples_max` samples have been added or the batch reaches `max_age_s`.
+ *
+ * Samples are timestamped on decoding as base timestamp + n * interval.
+ *
+ * \param[in,out] series The series.
+ * \param[in] time The sample's epoch timestamp in seconds.
+ * \param[in] value The sample, e.g. a level in mm or a temperature in 0.1 degC.
+ * \return 0 on success, or -TIMESERIES_ERROR_SEND_FAILURE if a batch failed to
+ *         send, in which case it is discarded.
+ */
+int MYRIOTA_TimeSeriesAdd(MYRIOTA_TimeSeries *const series, const uint32_t time,
+  const int32_t value);
+
+/**
+ * Send the batch if it has reached `max_age_s`, e.g. from a job scheduled
+ * for the deadline when samples may stop arriving.
+ *
+ * \param[in,out] series The series.
+ * \param[in] now The current epoch time in seconds.
+ * \return 0 on success, or -TIMESERIES_ERROR_SEND_FAILURE.
+ */
+int MYRIOTA_TimeSeriesPoll(MYRIOTA_TimeSeries *const series, const uint32_t now);
+
+/**
+ * Send the batch now, e.g. before FLEX_MessageSave().
+ *
+ * \param[in,out] series The series.
+ * \return 0 on success or with an empty batch, or -TIMESERIES_ERROR_SEND_FAILURE.
+ */
+int MYRIOTA_TimeSeriesFlush(MYRIOTA_TimeSeries *const series);
+
+/**
+ * The size of the message the current batch would be sent in.
+ *
+ * \param[in] series The series.
+ * \return the size in bytes, 0 with an empty batch.
+ */
+size_t MYRIOTA_TimeSeriesMessageSize(const MYRIOTA_TimeSeries *const series);
+
+/**
+ * Pack samples into a message without batching them, e.g. to compare
+ * encodings or from samples kept elsewhere.
+ *
+ * \param[in] base_time The timestamp of the first sample.
+ * \param[in] interval_s The sampling interval in seconds.
+ * \param[in] samples The samples.
+ * \param[in] count The number of samples, at least 1.
+ * \param[out] message The buffer to pack into.
+ * \param[in] message_size The size of `message` in bytes.
+ * \return the message size in bytes, or -TIMESERIES_ERROR_INVALID_ARGUMENT if
+ *         the samples don't fit.
+ */
+int MYRIOTA_TimeSeriesEncode(const uint32_t base_time, const uint32_t interval_s,
+  const int32_t *const samples, const size_t count, uint8_t *const message,
+  const size_t message_size);
+
+/** \} */
+
+#endif /* MYRIOTA_TIMESERIES_H */
@@ -0,0 +1,513 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "myriota/timeseries.h"
+#include <string.h>
+#include "myriota/bitpack.h"
+
+#define TIMESERIES_ENCODINGS 2
+#define TIMESERIES_HEADER_GROUP_BITS 7
+#define TIMESERIES_TIME_BITS 32
+#define TIMESERIES_ENCODING_BITS 1
+#define TIMESERIES_GROUP_BITS_WIDTH 3
+
+// The residual bits of a batch for each encoding and residual group size.
+typedef uint32_t residual_bits_t[TIMESERIES_ENCODINGS][TIMESERIES_GROUP_BITS_MAX];
+
+static size_t varint_bits(uint64_t value, const uint8_t group_bits) {
+  size_t groups = 1;
+  while ((value >>= group_bits) != 0) {
+    ++groups;
+  }
+  return groups * (group_bits + 1);
+}
+
+static inline uint64_t zigzag(const int64_t value) {
+  return ((uint64_t)value << 1) ^ (value < 0 ? UINT64_MAX : 0);
+}
+
+static size_t header_bits(const uint32_t interval_s, const size_t count, const int32_t first) {
+  return TIMESERIES_TIME_BITS + varint_bits(interval_s, TIMESERIES_HEADER_GROUP_BITS) +
+         varint_bits(count, TIMESERIES_HEADER_GROUP_BITS) + TIMESERIES_ENCODING_BITS +
+         TIMESERIES_GROUP_BITS_WIDTH + varint_bits(zigzag(first), TIMESERIES_HEADER_GROUP_BITS);
+}
+
+// The residuals of sample `index`, at least 1, for each encoding. The delta of
+// deltas starts from a delta of 0, so the first is the first delta.
+static void sample_residuals(const int32_t *const samples, const size_t index,
+  int64_t residuals[TIMESERIES_ENCODINGS]) {
+  const int64_t delta = (int64_t)samples[index] - samples[index - 1];
+  const int64_t previous = index >= 2 ? (int64_t)samples[index - 1] - samples[index - 2] : 0;
+  residuals[TIMESERIES_RESIDUALS_DELTA] = delta;
+  residuals[TIMESERIES_RESIDUALS_DELTA_OF_DELTA] = delta - previous;
+}
+
+// The residual bits of a batch with sample `index` added.
+static void residual_bits_add(const residual_bits_t bits, const int32_t *const samples,
+  const size_t index, residual_bits_t sum) {
+  int64_t residuals[TIMESERIES_ENCODINGS];
+  sample_residuals(samples, index, residuals);
+  for (size_t encoding = 0; encoding < TIMESERIES_ENCODINGS; ++encoding) {
+    const uint64_t encoded = zigzag(residuals[encoding]);
+    for (uint8_t group_bits = 1; group_bits <= TIMESERIES_GROUP_BITS_MAX; ++group_bits) {
+      sum[encoding][group_bits - 1] =
+        bits[encoding][group_bits - 1] + varint_bits(encoded, group_bits);
+    }
+  }
+}
+
+// The smallest residual bits of a batch, and the encoding and group size to
+// pack it with.
+static uint32_t residual_bits_best(const residual_bits_t bits,
+  MYRIOTA_TimeSeriesResiduals *const encoding, uint8_t *const group_bits) {
+  uint32_t best = UINT32_MAX;
+  for (size_t e = 0; e < TIMESERIES_ENCODINGS; ++e) {
+    for (uint8_t g = 1; g <= TIMESERIES_GROUP_BITS_MAX; ++g) {
+      if (bits[e][g - 1] < best) {
+        best = bits[e][g - 1];
+        *encoding = (MYRIOTA_TimeSeriesResiduals)e;
+        *group_bits = g;
+      }
+    }
+  }
+  return best;
+}
+
+static int encode(const uint32_t base_time, const uint32_t interval_s,
+  const int32_t *const samples, const size_t count, const residual_bits_t bits,
+  uint8_t *const message, const size_t message_size) {
+  MYRIOTA_TimeSeriesResiduals encoding = TIMESERIES_RESIDUALS_DELTA;
+  uint8_t group_bits = 1;
+  residual_bits_best(bits, &encoding, &group_bits);
+
+  MYRIOTA_BitPacker packer;
+  int result = MYRIOTA_BitPackInit(&packer, message, message_size);
+  result |= MYRIOTA_BitPackUnsigned(&packer, base_time, TIMESERIES_TIME_BITS);
+  result |= MYRIOTA_BitPackVarint(&packer, interval_s, TIMESERIES_HEADER_GROUP_BITS);
+  result |= MYRIOTA_BitPackVarint(&packer, count, TIMESERIES_HEADER_GROUP_BITS);
+  result |= MYRIOTA_BitPackUnsigned(&packer, encoding, TIMESERIES_ENCODING_BITS);
+  result |= MYRIOTA_BitPackUnsigned(&packer, group_bits - 1, TIMESERIES_GROUP_BITS_WIDTH);
+  result |= MYRIOTA_BitPackZigZag(&packer, samples[0], TIMESERIES_HEADER_GROUP_BITS);
+  for (size_t i = 1; i < count && result == BITPACK_SUCCESS; ++i) {
+    int64_t residuals[TIMESERIES_ENCODINGS];
+    sample_residuals(samples, i, residuals);
+    result = MYRIOTA_BitPackZigZag(&packer, residuals[encoding], group_bits);
+  }
+  if (result != BITPACK_SUCCESS) {
+    return -TIMESERIES_ERROR_INVALID_ARGUMENT;
+  }
+  return MYRIOTA_BitPackBytes(&packer);
+}
+
+// Whether a sample at `time` takes the batch's next slot, i.e. is within half
+// an interval of it.
+static bool series_follows(const MYRIOTA_TimeSeries *const series, const uint32_t time) {
+  const uint32_t interval_s = series->options.interval_s;
+  const uint32_t expected = series->base_time + (uint32_t)series->count * interval_s;
+  const int32_t offset = (int32_t)(time - expected);
+  const uint64_t magnitude = offset < 0 ? (uint64_t)(-(int64_t)offset) : (uint64_t)offset;
+  return 2 * magnitude <= interval_s;
+}
+
+// Whether the batch with the sample in slot `count` added fits in a message.
+static bool series_fits(const MYRIOTA_TimeSeries *const series) {
+  const MYRIOTA_TimeSeriesOptions *const options = &series->options;
+  residual_bits_t bits;
+  residual_bits_add(series->residual_bits, options->samples, series->count, bits);
+  MYRIOTA_TimeSeriesResiduals encoding;
+  uint8_t group_bits;
+  const size_t total = header_bits(options->interval_s, series->count + 1, options->samples[0]) +
+                       residual_bits_best(bits, &encoding, &group_bits);
+  return total <= options->message_size * 8;
+}
+
+static bool series_expired(const MYRIOTA_TimeSeries *const series, const uint32_t now) {
+  const uint32_t max_age_s = series->options.max_age_s;
+  return series->count > 0 && max_age_s > 0 && now - series->base_time >= max_age_s;
+}
+
+int MYRIOTA_TimeSeriesInit(MYRIOTA_TimeSeries *const series,
+  const MYRIOTA_TimeSeriesOptions *const options) {
+  if (series == NULL || options == NULL || options->interval_s == 0 ||
+      options->samples == NULL || options->samples_max == 0 || options->message == NULL ||
+      options->message_size < TIMESERIES_MESSAGE_SIZE_MIN || options->send == NULL) {
+    return -TIMESERIES_ERROR_INVALID_ARGUMENT;
+  }
+
+  memset(series, 0, sizeof(*series));
+  series->options = *options;
+  return TIMESERIES_SUCCESS;
+}
+
+int MYRIOTA_TimeSeriesAdd(MYRIOTA_TimeSeries *const series, const uint32_t time,
+  const int32_t value) {
+  int result = TIMESERIES_SUCCESS;
+  int32_t *const samples = series->options.samples;
+
+  samples[series->count] = value;
+  if (series->count > 0 && (!series_follows(series, time) || !series_fits(series))) {
+    result = MYRIOTA_TimeSeriesFlush(series);
+    samples[0] = value;
+  }
+
+  if (series->count == 0) {
+    series->base_time = time;
+    memset(series->residual_bits, 0, sizeof(series->residual_bits));
+  } else {
+    residual_bits_add(series->residual_bits, samples, series->count, series->residual_bits);
+  }
+  ++series->count;
+
+  if (series->count == series->options.samples_max || series_expired(series, time)) {
+    const int flushed = MYRIOTA_TimeSeriesFlush(series);
+    if (result == TIMESERIES_SUCCESS) {
+      result = flushed;
+    }
+  }
+  return result;
+}
+
+int MYRIOTA_TimeSeriesPoll(MYRIOTA_TimeSeries *const series, const uint32_t now) {
+  return series_expired(series, now) ? MYRIOTA_TimeSeriesFlush(series) : TIMESERIES_SUCCESS;
+}
+
+int MYRIOTA_TimeSeriesFlush(MYRIOTA_TimeSeries *const series) {
+  if (series->count == 0) {
+    return TIMESERIES_SUCCESS;
+  }
+
+  const MYRIOTA_TimeSeriesOptions *const options = &series->options;
+  const int size = encode(series->base_time, options->interval_s, options->samples,
+    series->count, series->residual_bits, options->message, options->message_size);
+  series->count = 0;
+  if (size < 0 || options->send(options->ctx, options->message, size) < 0) {
+    return -TIMESERIES_ERROR_SEND_FAILURE;
+  }
+  return TIMESERIES_SUCCESS;
+}
+
+size_t MYRIOTA_TimeSeriesMessageSize(const MYRIOTA_TimeSeries *const series) {
+  if (series->count == 0) {
+    return 0;
+  }
+
+  MYRIOTA_TimeSeriesResiduals encoding;
+  uint8_t group_bits;
+  const size_t bits =
+    header_bits(series->options.interval_s, series->count, series->options.samples[0]) +
+    residual_bits_best(series->residual_bits, &encoding, &group_bits);
+  return (bits + 7) / 8;
+}
+
+int MYRIOTA_TimeSeriesEncode(const uint32_t base_time, const uint32_t interval_s,
+  const int32_t *const samples, const size_t count, uint8_t *const message,
+  const size_t message_size) {
+  if (samples == NULL || count == 0 || message == NULL) {
+    return -TIMESERIES_ERROR_INVALID_ARGUMENT;
+  }
+
+  residual_bits_t bits;
+  memset(bits, 0, sizeof(bits));
+  for (size_t i = 1; i < count; ++i) {
+    residual_bits_add(bits, samples, i, bits);
+  }
+  return encode(base_time, interval_s, samples, count, bits, message, message_size);
+}
+
+#ifdef MYRIOTA_TIMESERIES_UNIT_TESTS
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+/*
+ * `cmocka.h` must be included after standard the above library headers.
+ * NOTE: This comment has dual purpose:
+ * 1. Document the ordering requirement.
+ * 2. Prevent `clang-format` from reordering the headers.
+ */
+#include <cmocka.h>
+
+#define TEST_MESSAGE_SIZE 20
+#define TEST_SAMPLES_MAX 64
+#define TEST_SENT_MAX 8
+#define TEST_INTERVAL_S 900
+#define TEST_TIME 1700000000
+
+struct test_sent {
+  uint8_t messages[TEST_SENT_MAX][TEST_MESSAGE_SIZE];
+  size_t sizes[TEST_SENT_MAX];
+  size_t count;
+  int result;
+};
+
+static int test_send(void *ctx, const uint8_t *message, size_t size) {
+  struct test_sent *const sent = ctx;
+  if (sent->result < 0) {
+    return sent->result;
+  }
+  assert_true(sent->count < TEST_SENT_MAX);
+  memcpy(sent->messages[sent->count], message, size);
+  sent->sizes[sent->count++] = size;
+  return 0;
+}
+
+static struct test_sent sent;
+static int32_t test_samples[TEST_SAMPLES_MAX];
+static uint8_t test_message[TEST_MESSAGE_SIZE];
+
+static void test_series_init(MYRIOTA_TimeSeries *const series, const uint32_t max_age_s) {
+  memset(&sent, 0, sizeof(sent));
+  const MYRIOTA_TimeSeriesOptions options = {
+    .interval_s = TEST_INTERVAL_S,
+    .max_age_s = max_age_s,
+    .samples = test_samples,
+    .samples_max = TEST_SAMPLES_MAX,
+    .message = test_message,
+    .message_size = sizeof(test_message),
+    .send = test_send,
+    .ctx = &sent,
+  };
+  assert_int_equal(MYRIOTA_TimeSeriesInit(series, &options), TIMESERIES_SUCCESS);
+}
+
+// Decodes a message as scripts/timeseries_decode.py does, returning the count.
+static size_t test_decode(const uint8_t *const message, const size_t size,
+  uint32_t *const base_time, uint32_t *const interval_s, int32_t *const samples) {
+  MYRIOTA_BitUnpacker unpacker;
+  uint64_t time, interval, count, encoding, group_bits;
+  int64_t value;
+  assert_int_equal(MYRIOTA_BitUnpackInit(&unpacker, message, size), BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitUnpackUnsigned(&unpacker, &time, 32), BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitUnpackVarint(&unpacker, &interval, 7), BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitUnpackVarint(&unpacker, &count, 7), BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitUnpackUnsigned(&unpacker, &encoding, 1), BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitUnpackUnsigned(&unpacker, &group_bits, 3), BITPACK_SUCCESS);
+  assert_int_equal(MYRIOTA_BitUnpackZigZag(&unpacker, &value, 7), BITPACK_SUCCESS);
+  *base_time = time;
+  *interval_s = interval;
+  samples[0] = value;
+  int64_t delta = 0;
+  for (size_t i = 1; i < count; ++i) {
+    int64_t residual;
+    assert_int_equal(MYRIOTA_BitUnpackZigZag(&unpacker, &residual, group_bits + 1),
+      BITPACK_SUCCESS);
+    delta = encoding == TIMESERIES_RESIDUALS_DELTA ? residual : delta + residual;
+    value += delta;
+    samples[i] = value;
+  }
+  // Only padding is left.
+  assert_true(size * 8 - unpacker.bits < 8);
+  return count;
+}
+
+static void test_init_arguments(void **state) {
+  (void)state;
+  MYRIOTA_TimeSeries series;
+  MYRIOTA_TimeSeriesOptions options = {
+    .interval_s = TEST_INTERVAL_S,
+    .samples = test_samples,
+    .samples_max = TEST_SAMPLES_MAX,
+    .message = test_message,
+    .message_size = sizeof(test_message),
+    .send = test_send,
+    .ctx = &sent,
+  };
+  assert_int_equal(MYRIOTA_TimeSeriesInit(&series, &options), TIMESERIES_SUCCESS);
+  assert_int_equal(MYRIOTA_TimeSeriesMessageSize(&series), 0);
+  assert_int_equal(MYRIOTA_TimeSeriesFlush(&series), TIMESERIES_SUCCESS);
+
+  assert_int_equal(MYRIOTA_TimeSeriesInit(NULL, &options), -TIMESERIES_ERROR_INVALID_ARGUMENT);
+  options.interval_s = 0;
+  assert_int_equal(MYRIOTA_TimeSeriesInit(&series, &options), -TIMESERIES_ERROR_INVALID_ARGUMENT);
+  options.interval_s = TEST_INTERVAL_S;
+  options.message_size = TIMESERIES_MESSAGE_SIZE_MIN - 1;
+  assert_int_equal(MYRIOTA_TimeSeriesInit(&series, &options), -TIMESERIES_ERROR_INVALID_ARGUMENT);
+  options.message_size = sizeof(test_message);
+  options.send = NULL;
+  assert_int_equal(MYRIOTA_TimeSeriesInit(&series, &options), -TIMESERIES_ERROR_INVALID_ARGUMENT);
+}
+
+static void test_encode(void **state) {
+  (void)state;
+  uint8_t message[TEST_MESSAGE_SIZE];
+  uint32_t base_time, interval_s;
+  int32_t decoded[TEST_SAMPLES_MAX];
+
+  // A single sample takes the header alone:
+  // 32 bit time, 2 group interval, 1 group count, 4 bits, 2 group value.
+  const int32_t single = -100;
+  assert_int_equal(MYRIOTA_TimeSeriesEncode(TEST_TIME, TEST_INTERVAL_S, &single, 1, message,
+                     sizeof(message)),
+    10);
+  assert_int_equal(test_decode(message, 10, &base_time, &interval_s, decoded), 1);
+  assert_int_equal(base_time, TEST_TIME);
+  assert_int_equal(interval_s, TEST_INTERVAL_S);
+  assert_int_equal(decoded[0], single);
+
+  // A steady ramp is all zero delta of deltas after the first, two bits each
+  // with 1 bit groups.
+  int32_t ramp[32];
+  for (size_t i = 0; i < 32; ++i) {
+    ramp[i] = 5000 - 7 * (int32_t)i;
+  }
+  int size = MYRIOTA_TimeSeriesEncode(TEST_TIME, TEST_INTERVAL_S, ramp, 32, message,
+    sizeof(message));
+  assert_int_equal(size, 18);
+  assert_int_equal(test_decode(message, size, &base_time, &interval_s, decoded), 32);
+  assert_memory_equal(decoded, ramp, sizeof(ramp));
+  assert_int_equal(message[7] >> 4, 0x8);
+
+  // Values far apart still round trip, in 22 bytes.
+  const int32_t extremes[] = {INT32_MIN, INT32_MAX, INT32_MIN};
+  uint8_t large[32];
+  size = MYRIOTA_TimeSeriesEncode(0, 1, extremes, 3, large, sizeof(large));
+  assert_int_equal(size, 22);
+  assert_int_equal(test_decode(large, size, &base_time, &interval_s, decoded), 3);
+  assert_memory_equal(decoded, extremes, sizeof(extremes));
+
+  assert_int_equal(MYRIOTA_TimeSeriesEncode(0, 1, extremes, 3, message, sizeof(message)),
+    -TIMESERIES_ERROR_INVALID_ARGUMENT);
+  assert_int_equal(MYRIOTA_TimeSeriesEncode(0, 1, extremes, 0, message, sizeof(message)),
+    -TIMESERIES_ERROR_INVALID_ARGUMENT);
+}
+
+static void test_full_messages(void **state) {
+  (void)state;
+  MYRIOTA_TimeSeries series;
+  test_series_init(&series, 0);
+
+  // A slowly draining tank level in mm, with noise.
+  int32_t level[100];
+  for (size_t i = 0; i < 100; ++i) {
+    level[i] = 20000 - 3 * (int32_t)i + (int32_t)((i * 7) % 5) - 2;
+    assert_int_equal(MYRIOTA_TimeSeriesAdd(&series, TEST_TIME + i * TEST_INTERVAL_S, level[i]),
+      TIMESERIES_SUCCESS);
+    assert_true(MYRIOTA_TimeSeriesMessageSize(&series) <= TEST_MESSAGE_SIZE);
+  }
+  assert_int_equal(MYRIOTA_TimeSeriesFlush(&series), TIMESERIES_SUCCESS);
+  assert_int_equal(MYRIOTA_TimeSeriesMessageSize(&series), 0);
+
+  // The batches are sent in order, filling each message, and decode to the samples.
+  size_t total = 0;
+  size_t bytes = 0;
+  for (size_t i = 0; i < sent.count; ++i) {
+    uint32_t base_time, interval_s;
+    int32_t decoded[TEST_SAMPLES_MAX];
+    const size_t count = test_decode(sent.messages[i], sent.sizes[i], &base_time, &interval_s,
+      decoded);
+    assert_int_equal(base_time, TEST_TIME + total * TEST_INTERVAL_S);
+    assert_memory_equal(decoded, &level[total], count * sizeof(*decoded));
+    if (i + 1 < sent.count) {
+      assert_true(sent.sizes[i] >= TEST_MESSAGE_SIZE - 1);
+    }
+    total += count;
+    bytes += sent.sizes[i];
+  }
+  assert_int_equal(total, 100);
+  // At least 3 times as many samples per byte as a 32 bit time and value each.
+  assert_true(bytes * 3 <= 100 * 8);
+}
+
+static void test_batch_limits(void **state) {
+  (void)state;
+  MYRIOTA_TimeSeries series;
+  test_series_init(&series, 0);
+
+  // Samples within half an interval of their slot join the batch, others start a new one.
+  assert_int_equal(MYRIOTA_TimeSeriesAdd(&series, TEST_TIME, 10), TIMESERIES_SUCCESS);
+  assert_int_equal(MYRIOTA_TimeSeriesAdd(&series, TEST_TIME + TEST_INTERVAL_S + 450, 11),
+    TIMESERIES_SUCCESS);
+  assert_int_equal(MYRIOTA_TimeSeriesAdd(&series, TEST_TIME + 2 * TEST_INTERVAL_S - 450, 12),
+    TIMESERIES_SUCCESS);
+  assert_int_equal(sent.count, 0);
+  assert_int_equal(MYRIOTA_TimeSeriesAdd(&series, TEST_TIME + 3 * TEST_INTERVAL_S + 451, 13),
+    TIMESERIES_SUCCESS);
+  assert_int_equal(sent.count, 1);
+  assert_int_equal(series.count, 1);
+  assert_int_equal(series.base_time, TEST_TIME + 3 * TEST_INTERVAL_S + 451);
+
+  uint32_t base_time, interval_s;
+  int32_t decoded[TEST_SAMPLES_MAX];
+  assert_int_equal(test_decode(sent.messages[0], sent.sizes[0], &base_time, &interval_s, decoded),
+    3);
+  assert_int_equal(decoded[2], 12);
+
+  // A full samples buffer is sent straight away.
+  test_series_init(&series, 0);
+  series.options.samples_max = 4;
+  for (size_t i = 0; i < 4; ++i) {
+    assert_int_equal(MYRIOTA_TimeSeriesAdd(&series, TEST_TIME + i * TEST_INTERVAL_S, 0),
+      TIMESERIES_SUCCESS);
+  }
+  assert_int_equal(sent.count, 1);
+  assert_int_equal(series.count, 0);
+}
+
+static void test_max_age(void **state) {
+  (void)state;
+  MYRIOTA_TimeSeries series;
+  test_series_init(&series, 4 * TEST_INTERVAL_S);
+
+  assert_int_equal(MYRIOTA_TimeSeriesPoll(&series, TEST_TIME), TIMESERIES_SUCCESS);
+  for (size_t i = 0; i < 4; ++i) {
+    assert_int_equal(MYRIOTA_TimeSeriesAdd(&series, TEST_TIME + i * TEST_INTERVAL_S, 0),
+      TIMESERIES_SUCCESS);
+  }
+  assert_int_equal(MYRIOTA_TimeSeriesPoll(&series, TEST_TIME + 4 * TEST_INTERVAL_S - 1),
+    TIMESERIES_SUCCESS);
+  assert_int_equal(sent.count, 0);
+  assert_int_equal(MYRIOTA_TimeSeriesPoll(&series, TEST_TIME + 4 * TEST_INTERVAL_S),
+    TIMESERIES_SUCCESS);
+  assert_int_equal(sent.count, 1);
+
+  // A sample that reaches the age sends the batch with it.
+  for (size_t i = 0; i < 5; ++i) {
+    assert_int_equal(MYRIOTA_TimeSeriesAdd(&series, TEST_TIME + i * TEST_INTERVAL_S, 0),
+      TIMESERIES_SUCCESS);
+  }
+  assert_int_equal(sent.count, 2);
+  uint32_t base_time, interval_s;
+  int32_t decoded[TEST_SAMPLES_MAX];
+  assert_int_equal(test_decode(sent.messages[1], sent.sizes[1], &base_time, &interval_s, decoded),
+    5);
+}
+
+static void test_send_failure(void **state) {
+  (void)state;
+  MYRIOTA_TimeSeries series;
+  test_series_init(&series, 0);
+
+  assert_int_equal(MYRIOTA_TimeSeriesAdd(&series, TEST_TIME, 1), TIMESERIES_SUCCESS);
+  sent.result = -1;
+  // The failed batch is dropped and the sample starts the next.
+  assert_int_equal(MYRIOTA_TimeSeriesAdd(&series, TEST_TIME + 10 * TEST_INTERVAL_S, 2),
+    -TIMESERIES_ERROR_SEND_FAILURE);
+  assert_int_equal(series.count, 1);
+  assert_int_equal(MYRIOTA_TimeSeriesFlush(&series), -TIMESERIES_ERROR_SEND_FAILURE);
+  assert_int_equal(series.count, 0);
+  assert_int_equal(sent.count, 0);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_init_arguments),
+    cmocka_unit_test(test_encode),
+    cmocka_unit_test(test_full_messages),
+    cmocka_unit_test(test_batch_limits),
+    cmocka_unit_test(test_max_age),
+    cmocka_unit_test(test_send_failure),
+  };
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
+#endif /** MYRIOTA_TIMESERIES_UNIT_TESTS */
@@ -0,0 +1,346 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+# Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause-Attribution
+#
+# This file is licensed under the BSD with attribution  (the "License"); you
+# may not use these files except in compliance with the License.
+#
+# You may obtain a copy of the License here:
+# LICENSE-BSD-3-Clause-Attribution.txt and at
+# https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+#
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Generate a message's C encoder and Python decoder from its schema.
+
+A schema is a JSON file naming the message and listing its fields in order:
+
+    {
+      "name": "telemetry",
+      "fields": [
+        {"name": "time", "bits": 32},
+        {"name": "latitude", "bits": 25, "divisor": 100, "min": -9000000, "scale": 1e-5},
+        {"name": "temperatures", "bits": 10, "min": -400, "scale": 0.1, "count": 4}
+      ]
+    }
+
+Each field is packed most significant bit first in `bits` bits (1 to 32), as
+the device value divided by `divisor` (rounded, default 1) less `min`
+(default 0), clamped to the field. A field with a `count` is repeated that many
+times. The host value is the packed value plus `min`, times `scale` (default
+1). Fields with a negative `min` are signed on the device.
+
+The C encoder is a header with the message's struct and an inline function
+that packs it with the field offsets worked out here, so the device runs
+straight line shifts with no schema at run time. The Python decoder unpacks a
+batch of messages into a NumPy array per field.
+"""
+
+import decimal
+import json
+import os
+import re
+import sys
+
+_FIELD_KEYS = {"name", "bits", "divisor", "min", "scale", "count"}
+_IDENTIFIER = re.compile(r"^[A-Za-z_][A-Za-z0-9_]*$")
+
+_LICENSE = """\
+Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+SPDX-License-Identifier: BSD-3-Clause-Attribution
+
+This file is licensed under the BSD with attribution  (the "License"); you
+may not use these files except in compliance with the License.
+
+You may obtain a copy of the License here:
+LICENSE-BSD-3-Clause-Attribution.txt and at
+https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+
+See the License for the specific language governing permissions and
+limitations under the License."""
+
+
+class SchemaError(Exception):
+    pass
+
+
+class Field(object):
+    def __init__(self, spec, offset):
+        unknown = set(spec) - _FIELD_KEYS
+        if unknown:
+            raise SchemaError("Unknown field keys: {}".format(", ".join(sorted(unknown))))
+        self.name = spec.get("name", "")
+        if not _IDENTIFIER.match(self.name):
+            raise SchemaError("Invalid field name: {!r}".format(self.name))
+        self.bits = spec.get("bits")
+        self.divisor = spec.get("divisor", 1)
+        self.min = spec.get("min", 0)
+        self.scale = spec.get("scale", 1)
+        self.count = spec.get("count", 1)
+        for key in ("bits", "divisor", "min", "count"):
+            if not isinstance(getattr(self, key), int) or isinstance(getattr(self, key), bool):
+                raise SchemaError("Field {} {} must be an integer".format(self.name, key))
+        if not 1 <= self.bits <= 32:
+            raise SchemaError("Field {} bits must be 1 to 32".format(self.name))
+        if self.divisor < 1 or self.count < 1:
+            raise SchemaError("Field {} divisor and count must be positive".format(self.name))
+        if not isinstance(self.scale, (int, float)) or self.scale == 0:
+            raise SchemaError("Field {} scale must be a non-zero number".format(self.name))
+        self.offset = offset
+        self.max = (1 << self.bits) - 1
+
+    @property
+    def size(self):
+        return self.bits * self.count
+
+    @property
+    def decimals(self):
+        """The decimal places of the host value."""
+        exponent = decimal.Decimal(repr(self.scale)).normalize().as_tuple().exponent
+        return max(0, -exponent)
+
+    @property
+    def c_type(self):
+        return "int32_t" if self.min < 0 else "uint32_t"
+
+
+class Schema(object):
+    def __init__(self, spec):
+        self.name = spec.get("name", "")
+        if not _IDENTIFIER.match(self.name):
+            raise SchemaError("Invalid message name: {!r}".format(self.name))
+        self.fields = []
+        offset = 0
+        for field_spec in spec.get("fields", []):
+            field = Field(field_spec, offset)
+            if field.name in [f.name for f in self.fields]:
+                raise SchemaError("Duplicate field name: {}".format(field.name))
+            self.fields.append(field)
+            offset += field.size
+        if not self.fields:
+            raise SchemaError("Message {} has no fields".format(self.name))
+        self.bits = offset
+        self.size = (offset + 7) // 8
+
+
+def _byte_writes(offset, bits):
+    """The (byte, right shift, left shift, first) writes packing a field."""
+    writes = []
+    position = offset
+    end = offset + bits
+    while position < end:
+        byte = position // 8
+        chunk_end = min(end, (byte + 1) * 8)
+        writes.append((byte, end - chunk_end, (byte + 1) * 8 - chunk_end, position == byte * 8))
+        position = chunk_end
+    return writes
+
+
+def generate_header(schema, source):
+    name = schema.name
+    upper = name.upper()
+    lines = ["// " + line if line else "//" for line in _LICENSE.splitlines()]
+    lines += [
+        "",
+        "// Generated by message_codec.py from {}, do not edit.".format(source),
+        "",
+        "#ifndef {}_CODEC_H".format(upper),
+        "#define {}_CODEC_H".format(upper),
+        "",
+        "#include <stdint.h>",
+        "",
+        "/** The size of a {} message in bytes. */".format(name),
+        "#define {}_SIZE {}".format(upper, schema.size),
+        "",
+        "/** A {} message's fields, in device units. */".format(name),
+        "typedef struct {",
+    ]
+    for field in schema.fields:
+        array = "[{}]".format(field.count) if field.count > 1 else ""
+        lines.append("  {} {}{};".format(field.c_type, field.name, array))
+    lines += [
+        "}} {}_t;".format(name),
+        "",
+        "// A value divided by `divisor`, rounded, less `min` and clamped to 0 to `max`.",
+        "static inline uint32_t {}_field(const int64_t value, const int64_t divisor,".format(name),
+        "  const int64_t min, const int64_t max) {",
+        "  const int64_t half = divisor / 2;",
+        "  const int64_t field = (value < 0 ? value - half : value + half) / divisor - min;",
+        "  return (uint32_t)(field < 0 ? 0 : (field > max ? max : field));",
+        "}",
+        "",
+        "/**",
+        " * Pack a {} message, e.g. for FLEX_MessageSchedule().".format(name),
+        " *",
+        " * \\param[in] fields The fields.",
+        " * \\param[out] message The message, {}_SIZE bytes.".format(upper),
+        " */",
+        "static inline void {0}_encode(const {0}_t *const fields, uint8_t *const message) {{".format(
+            name
+        ),
+        "  uint32_t field;",
+    ]
+    for field in schema.fields:
+        for index in range(field.count):
+            member = field.name + ("[{}]".format(index) if field.count > 1 else "")
+            offset = field.offset + index * field.bits
+            lines.append("  // {}: bits {} to {}".format(member, offset, offset + field.bits - 1))
+            lines.append(
+                "  field = {}_field(fields->{}, {}, {}, {});".format(
+                    name, member, field.divisor, field.min, field.max
+                )
+            )
+            for byte, right, left, first in _byte_writes(offset, field.bits):
+                value = "field"
+                if right:
+                    value = "({} >> {})".format(value, right)
+                if left:
+                    value = "({} << {})".format(value, left)
+                lines.append(
+                    "  message[{}] {} (uint8_t){};".format(byte, "=" if first else "|=", value)
+                )
+    lines += [
+        "}",
+        "",
+        "#endif /* {}_CODEC_H */".format(upper),
+        "",
+    ]
+    return "\n".join(lines)
+
+
+_DECODER = '''\
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+{license}
+
+# Generated by message_codec.py from {source}, do not edit.
+
+"""Decode {name} messages."""
+
+import json
+import sys
+
+import numpy as np
+
+SIZE = {size}
+
+# The fields' name, bit offset, bits, count, min, scale and decimal places.
+FIELDS = (
+{fields}
+)
+
+
+def decode(messages):
+    """Decode a sequence of messages, bytes each, into a dict of a NumPy
+    array per field, with a row per message. Repeated fields have a column
+    per repetition."""
+    messages = [bytes(message) for message in messages]
+    for message in messages:
+        if len(message) != SIZE:
+            raise ValueError("{name} messages are {{}} bytes, not {{}}".format(SIZE, len(message)))
+    data = np.frombuffer(b"".join(messages), dtype=np.uint8).reshape(len(messages), SIZE)
+    bits = np.unpackbits(data, axis=1).astype(np.int64)
+
+    columns = {{}}
+    for name, offset, width, count, minimum, scale, _ in FIELDS:
+        weights = np.left_shift(1, np.arange(width - 1, -1, -1, dtype=np.int64))
+        field = bits[:, offset : offset + width * count].reshape(len(messages), count, width)
+        values = field @ weights + minimum
+        if scale != 1:
+            values = values * scale
+        columns[name] = values if count > 1 else values[:, 0]
+    return columns
+
+
+def main(argv=None):
+    """CLI entrypoint."""
+    import argparse
+
+    parser = argparse.ArgumentParser(
+        description="Decode {name} messages into CSV. Messages are given as hex strings, or "
+        "read from the JSON output of message_store.py query."
+    )
+    parser.add_argument("messages", nargs="*", help="Hex encoded messages")
+    parser.add_argument(
+        "-j",
+        "--json",
+        type=argparse.FileType("r"),
+        help="JSON message store items with hex encoded 'Value' fields, - for stdin",
+    )
+
+    args = parser.parse_args(argv)
+
+    messages = list(args.messages)
+    if args.json:
+        messages += [item["Value"] for item in json.load(args.json)]
+    if not messages:
+        sys.exit("No messages to decode")
+
+    try:
+        columns = decode([bytes.fromhex(message) for message in messages])
+    except ValueError as e:
+        sys.exit("Invalid message: {{}}".format(e))
+
+    header = []
+    for name, _, _, count, _, _, _ in FIELDS:
+        header += [name] if count == 1 else ["{{}}_{{}}".format(name, i) for i in range(count)]
+    lines = [",".join(header)]
+    for row in range(len(messages)):
+        cells = []
+        for name, _, _, count, _, _, decimals in FIELDS:
+            values = columns[name].reshape(len(messages), count)[row]
+            cells += ["{{:.{{}}f}}".format(value, decimals) for value in values]
+        lines.append(",".join(cells))
+    return "\\n".join(lines)
+
+
+if __name__ == "__main__":
+    print(main())
+'''
+
+
+def generate_decoder(schema, source):
+    fields = "\n".join(
+        "    ({!r}, {}, {}, {}, {}, {!r}, {}),".format(
+            field.name, field.offset, field.bits, field.count, field.min, field.scale, field.decimals
+        )
+        for field in schema.fields
+    )
+    return _DECODER.format(
+        license="\n".join("# " + line if line else "#" for line in _LICENSE.splitlines()),
+        source=source,
+        name=schema.name,
+        size=schema.size,
+        fields=fields,
+    )
+
+
+def main(argv=None):
+    """CLI entrypoint."""
+    import argparse
+
+    parser = argparse.ArgumentParser(
+        description="Generate a message's C encoder header and Python decoder from its schema."
+    )
+    parser.add_argument("schema", help="JSON message schema")
+    parser.add_argument("header", help="C encoder header to write")
+    parser.add_argument("decoder", help="Python decoder to write")
+    args = parser.parse_args(argv)
+
+    source = os.path.basename(args.schema)
+    try:
+        with open(args.schema, "r") as file:
+            schema = Schema(json.load(file))
+    except (ValueError, SchemaError) as e:
+        sys.exit("{}: {}".format(args.schema, e))
+
+    with open(args.header, "w") as file:
+        file.write(generate_header(schema, source))
+    with open(args.decoder, "w") as file:
+        file.write(generate_decoder(schema, source))
+
+
+if __name__ == "__main__":
+    main()
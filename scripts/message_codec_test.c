@@ -0,0 +1,35 @@
+// Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+// SPDX-License-Identifier: BSD-3-Clause-Attribution
+//
+// This file is licensed under the BSD with attribution  (the "License"); you
+// may not use these files except in compliance with the License.
+//
+// You may obtain a copy of the License here:
+// LICENSE-BSD-3-Clause-Attribution.txt and at
+// https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+//
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Packs the known codec_test message checked by message_codec_test.py and
+// prints it as hex.
+
+#include <stdio.h>
+#include "codec_test_codec.h"
+
+int main(void) {
+  const codec_test_t fields = {
+    .time = 1700000000,
+    .latitude = -338123456,
+    .temperature = -123,
+    .flags = {5, 2},
+  };
+  uint8_t message[CODEC_TEST_SIZE];
+  codec_test_encode(&fields, message);
+
+  for (size_t i = 0; i < sizeof(message); i++) {
+    printf("%02x", message[i]);
+  }
+  printf("\n");
+  return 0;
+}
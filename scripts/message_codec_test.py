@@ -0,0 +1,67 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+# Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause-Attribution
+#
+# This file is licensed under the BSD with attribution  (the "License"); you
+# may not use these files except in compliance with the License.
+#
+# You may obtain a copy of the License here:
+# LICENSE-BSD-3-Clause-Attribution.txt and at
+# https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+#
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Round trip a message through the encoder and decoder that message_codec.py
+generates from message_codec_test.json.
+
+The encoder packs known device values in message_codec_test.c, which must
+match the golden message here, and the decoder must return the host values.
+"""
+
+import importlib.util
+import os
+import subprocess
+import sys
+
+# time 1700000000, latitude -338123456 / 100, temperature -123, flags 5 and 2
+GOLDEN = "6553f1002ade26a2b500"
+
+EXPECTED = {
+    "time": [1700000000],
+    "latitude": [-33.81235],
+    "temperature": [-12.3],
+    "flags": [[5, 2]],
+}
+
+
+def main(argv=None):
+    """CLI entrypoint."""
+    import argparse
+
+    parser = argparse.ArgumentParser(description="Round trip the message codec test message.")
+    parser.add_argument("decoder", help="Generated Python decoder")
+    parser.add_argument("encoder", help="Program printing the message packed by the C encoder")
+    args = parser.parse_args(argv)
+
+    import numpy as np
+
+    message = subprocess.check_output([os.path.abspath(args.encoder)]).decode().strip()
+    if message != GOLDEN:
+        sys.exit("Encoded {}, expected {}".format(message, GOLDEN))
+
+    spec = importlib.util.spec_from_file_location("codec_test_codec", args.decoder)
+    decoder = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(decoder)
+
+    columns = decoder.decode([bytes.fromhex(message)])
+    if sorted(columns) != sorted(EXPECTED):
+        sys.exit("Decoded fields {}, expected {}".format(sorted(columns), sorted(EXPECTED)))
+    for name, expected in EXPECTED.items():
+        if not np.allclose(columns[name], expected, rtol=0, atol=1e-9):
+            sys.exit("Decoded {} {}, expected {}".format(name, columns[name].tolist(), expected))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,109 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+# Copyright (c) 2024, Myriota Pty Ltd, All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause-Attribution
+#
+# This file is licensed under the BSD with attribution  (the "License"); you
+# may not use these files except in compliance with the License.
+#
+# You may obtain a copy of the License here:
+# LICENSE-BSD-3-Clause-Attribution.txt and at
+# https://spdx.org/licenses/BSD-3-Clause-Attribution.html
+#
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Decode messages sent by the time series library (lib/timeseries)."""
+
+import sys
+import json
+
+_HEADER_GROUP_BITS = 7
+_RESIDUALS_DELTA_OF_DELTA = 1
+
+
+class _BitReader(object):
+    """Reads fields most significant bit first, as myriota/bitpack.h packs them."""
+
+    def __init__(self, message):
+        self._value = int.from_bytes(bytes(message), "big")
+        self._size = len(message) * 8
+        self._position = 0
+
+    def unsigned(self, width):
+        if self._position + width > self._size:
+            raise ValueError("Message is truncated")
+        self._position += width
+        return (self._value >> (self._size - self._position)) & ((1 << width) - 1)
+
+    def varint(self, group_bits):
+        value = 0
+        shift = 0
+        more = True
+        while more:
+            value |= self.unsigned(group_bits) << shift
+            more = self.unsigned(1) != 0
+            shift += group_bits
+        return value
+
+    def zigzag(self, group_bits):
+        value = self.varint(group_bits)
+        return (value >> 1) ^ -(value & 1)
+
+
+def decode(message):
+    """Decode a message into a list of (epoch timestamp, value) samples."""
+    reader = _BitReader(message)
+    base_time = reader.unsigned(32)
+    interval = reader.varint(_HEADER_GROUP_BITS)
+    count = reader.varint(_HEADER_GROUP_BITS)
+    encoding = reader.unsigned(1)
+    group_bits = reader.unsigned(3) + 1
+    value = reader.zigzag(_HEADER_GROUP_BITS)
+
+    samples = [(base_time, value)] if count > 0 else []
+    delta = 0
+    for i in range(1, count):
+        residual = reader.zigzag(group_bits)
+        delta = delta + residual if encoding == _RESIDUALS_DELTA_OF_DELTA else residual
+        value += delta
+        samples.append((base_time + i * interval, value))
+    return samples
+
+
+def main(argv=None):
+    """CLI entrypoint."""
+    import argparse
+
+    parser = argparse.ArgumentParser(
+        description="Decode time series messages into timestamp,value lines. Messages are "
+        "given as hex strings, or read from the JSON output of message_store.py query."
+    )
+    parser.add_argument("messages", nargs="*", help="Hex encoded messages")
+    parser.add_argument(
+        "-j",
+        "--json",
+        type=argparse.FileType("r"),
+        help="JSON message store items with hex encoded 'Value' fields, - for stdin",
+    )
+
+    args = parser.parse_args(argv)
+
+    messages = list(args.messages)
+    if args.json:
+        messages += [item["Value"] for item in json.load(args.json)]
+    if not messages:
+        sys.exit("No messages to decode")
+
+    lines = []
+    for message in messages:
+        try:
+            samples = decode(bytearray.fromhex(message))
+        except ValueError as e:
+            sys.exit("Invalid message {}: {}".format(message, e))
+        lines += ["{},{}".format(time, value) for time, value in samples]
+    return "\n".join(lines)
+
+
+if __name__ == "__main__":
+    print(main())